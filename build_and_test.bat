@@ -4,7 +4,7 @@ echo Building SnapEngine...
 if not exist "build" mkdir build
 cd build
 
-cmake -G "Visual Studio 17 2022" -A x64 ..
+cmake -G "Visual Studio 17 2022" -A x64 -DSNAPENGINE_COUNT_ALLOCATIONS=ON ..
 if %ERRORLEVEL% neq 0 (
     echo CMake generation failed
     exit /b %ERRORLEVEL%
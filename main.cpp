@@ -10,12 +10,22 @@
 #include "Mesh.h"
 #include "Vertex.h"
 #include "Tests.h"
+#include "Benchmarks.h"
+#include "Profiler.h"
+#include "GlApi.h"
+#include "StreamBuffer.h"
 
 int main(int argc, char* argv[])
 {
     bool runTests = false;
+    bool runBenchmarks = false;
+    bool renderThread = false;
+    bool onDemand = false;
+    std::string tracePath;
+    std::string capturePath;
+    bool glStats = false;
 
-    // Check for --test argument
+    // Check for --test and --bench arguments
     for (int i = 1; i < argc; ++i)
     {
         std::string arg = argv[i];
@@ -24,6 +34,31 @@ int main(int argc, char* argv[])
             runTests = true;
             break;
         }
+        if (arg == "--bench")
+        {
+            runBenchmarks = true;
+            break;
+        }
+        if (arg == "--render-thread")
+        {
+            renderThread = true;
+        }
+        if (arg == "--on-demand")
+        {
+            onDemand = true;
+        }
+        if (arg == "--profile" && i + 1 < argc)
+        {
+            tracePath = argv[++i];
+        }
+        if (arg == "--gl-stats")
+        {
+            glStats = true;
+        }
+        if (arg == "--capture" && i + 1 < argc)
+        {
+            capturePath = argv[++i];
+        }
     }
 
     if (runTests)
@@ -31,6 +66,28 @@ int main(int argc, char* argv[])
         return Tests::RunAllTests() ? 0 : 1;
     }
 
+    if (runBenchmarks)
+    {
+        return Benchmarks::RunAllBenchmarks() ? 0 : 1;
+    }
+
+    if (!tracePath.empty())
+    {
+        Profiler::SetEnabled(true);
+        Profiler::Get().SetThreadName("Main");
+    }
+
+    if (glStats)
+    {
+        GlApi::SetLogInterval(300);
+    }
+
+    // Record from the start so the captured frame's resources are in the capture
+    if (!capturePath.empty())
+    {
+        GlApi::BeginCapture(capturePath, 60);
+    }
+
     try
     {
         std::cout << "SnapEngine starting...\n";
@@ -49,14 +106,8 @@ int main(int argc, char* argv[])
         glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
         std::cout << "OpenGL context configured\n";
 
-        // Create window
+        // Create window; the constructor throws if it fails
         Window window("SnapEngine - VibrantKnight Demo", 1280, 720);
-        if (!window.Create())
-        {
-            std::cerr << "Failed to create window" << std::endl;
-            glfwTerminate();
-            return 1;
-        }
         std::cout << "Window created successfully\n";
 
         // Load VibrantKnight model
@@ -77,14 +128,29 @@ int main(int argc, char* argv[])
             glm::vec3(0.0f, 180.0f, 0.0f));   // Rotate to face camera
         std::cout << "Model added to scene\n";
 
-        std::cout << "Entering main loop...\n";
-        // Main loop
-        while (window.ProcessMessages())
+        // Fixed 60 Hz simulation, rendering synced to the display
+        window.SetFixedTimestep(1.0 / 60.0);
+        window.SetSwapInterval(1);
+        window.SetRenderThreadEnabled(renderThread);
+        window.SetRenderMode(onDemand ? ON_DEMAND_RENDERING : CONTINUOUS_RENDERING);
+
+        std::cout << (renderThread ? "Entering threaded main loop...\n" : "Entering main loop...\n");
+        window.Run();
+
+        std::cout << "Main loop ended\n";
+
+        if (glStats)
         {
-            // ProcessMessages handles everything now
+            std::cout << "Object constants: " << StreamBuffer::FormatStats(window.GetScene()->GetObjectConstantStats()) << "\n";
         }
 
-        std::cout << "Main loop ended\n";
+        if (!tracePath.empty())
+        {
+            Profiler::Get().Collect();
+            std::cout << Profiler::Get().FormatStatistics();
+            if (Profiler::Get().WriteChromeTrace(tracePath))
+                std::cout << "Profile written to " << tracePath << "\n";
+        }
 
         // Cleanup is handled by destructors
         glfwTerminate();
@@ -0,0 +1,91 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+
+#include "HeadlessContext.h"
+#include "GlApi.h"
+#include "GlReplay.h"
+
+namespace {
+
+constexpr int WARMUP_FRAMES = 10;
+
+void PrintUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " <capture> [--frames N]\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::string capturePath = argv[1];
+    int frames = 100;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc)
+        {
+            frames = std::atoi(argv[++i]);
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    GlCapture capture;
+    if (!capture.Read(capturePath))
+    {
+        std::cerr << "Failed to read GL capture " << capturePath << std::endl;
+        return 1;
+    }
+    if (frames <= 0 || capture.width <= 0 || capture.height <= 0)
+    {
+        std::cerr << "Nothing to replay" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        // Captured binds of the window's framebuffer go to the offscreen one
+        HeadlessContext context(capture.width, capture.height);
+        GlReplay replay(capture);
+        replay.SetDefaultFramebuffer(context.GetFramebuffer());
+        if (!replay.Setup())
+            return 1;
+
+        for (int i = 0; i < WARMUP_FRAMES; ++i)
+        {
+            if (!replay.ReplayFrame())
+                return 1;
+        }
+        GlApi::Finish();
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < frames; ++i)
+            replay.ReplayFrame();
+        GlApi::Finish();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "Replayed " << frames << " frames of " << capture.width << "x" << capture.height
+                  << ": " << ms / frames << " ms/frame\n";
+        std::cout << "Per frame: " << GlApi::FormatStats(GlApi::GetFrameStats()) << "\n";
+        if (replay.GetUnknownNames() > 0)
+            std::cout << "Warning: " << replay.GetUnknownNames() << " object names were used but never created in the capture\n";
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -1,37 +1,106 @@
-#version 460 core
+#version 450 core
 
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoord;
+in vec3 ViewPos;
 
 out vec4 FragColor;
 
-uniform vec3 lightPos;
-uniform vec3 lightColor;
-uniform vec3 viewPos;
+// Per-frame constants, same block as basic.vert
+layout (std140, binding = 2) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+    int lightCount;             // 0 when the light buffers are not bound
+    vec3 lightPos;
+    float clusterDepthScale;    // Slice = floor(log(depth) * scale + bias)
+    vec3 lightColor;
+    float clusterDepthBias;
+};
 
-uniform sampler2D texture_diffuse1;
+// Texture units match MaterialTextureSlot
+layout (binding = 0) uniform sampler2D texture_diffuse1;
+layout (binding = 1) uniform sampler2D texture_specular1;
 
-void main()
+// Material parameters, uploaded once per Material
+layout (std140, binding = 1) uniform MaterialConstants
 {
-    // Ambient
-    float ambientStrength = 0.1;
-    vec3 ambient = ambientStrength * lightColor;
+    vec4 diffuseColor;      // Opacity in w
+    float specularStrength;
+    float shininess;
+    float alphaCutoff;
+    uint textureMask;       // Bit per bound texture: 1 diffuse, 2 specular
+};
 
-    // Diffuse
-    vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
+// Dynamic lights, binned into view clusters by LightClusters every frame
+const uint CLUSTER_TILES_X = 16u;   // LightClusters::TILES_X
+const uint CLUSTER_TILES_Y = 9u;    // LightClusters::TILES_Y
+const uint CLUSTER_SLICES = 24u;    // LightClusters::SLICES
+
+struct PackedLight
+{
+    vec4 positionRange;         // World position, range in w
+    vec4 colorSpotScale;        // Color times intensity, spot cone scale in w
+    vec4 directionSpotOffset;   // Spot axis, spot cone offset in w
+};
+
+layout (std430, binding = 0) readonly buffer ClusterLights { PackedLight lights[]; };
+layout (std430, binding = 1) readonly buffer ClusterCells { uvec2 clusterCells[]; };    // First index, count
+layout (std430, binding = 2) readonly buffer ClusterIndices { uint lightIndices[]; };
+
+// Diffuse and specular of one light
+vec3 Shade(vec3 norm, vec3 viewDir, vec3 lightDir, vec3 radiance, float specularMask)
+{
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * lightColor;
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+    return (diff + specularStrength * specularMask * spec) * radiance;
+}
 
-    // Specular
-    float specularStrength = 0.5;
+void main()
+{
+    vec4 albedo = diffuseColor;
+    if ((textureMask & 1u) != 0u)
+        albedo *= texture(texture_diffuse1, TexCoord);
+#ifdef ALPHA_TEST
+    if (albedo.a < alphaCutoff)
+        discard;
+#endif
+
+    vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
-    vec3 reflectDir = reflect(-lightDir, norm);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-    vec3 specular = specularStrength * spec * lightColor;
+    float specularMask = (textureMask & 2u) != 0u ? texture(texture_specular1, TexCoord).r : 1.0;
+
+    // Ambient and the headlight
+    float ambientStrength = 0.1;
+    vec3 result = ambientStrength * lightColor;
+    result += Shade(norm, viewDir, normalize(lightPos - FragPos), lightColor, specularMask);
+
+    // The lights of this fragment's cluster
+    if (lightCount > 0)
+    {
+        vec4 clip = projection * vec4(ViewPos, 1.0);
+        uvec2 tile = uvec2(clamp((clip.xy / clip.w * 0.5 + 0.5) * vec2(CLUSTER_TILES_X, CLUSTER_TILES_Y),
+                                 vec2(0.0), vec2(CLUSTER_TILES_X - 1u, CLUSTER_TILES_Y - 1u)));
+        float slice = floor(log(max(-ViewPos.z, 1e-6)) * clusterDepthScale + clusterDepthBias);
+        uint cluster = (uint(clamp(slice, 0.0, float(CLUSTER_SLICES - 1u))) * CLUSTER_TILES_Y + tile.y) * CLUSTER_TILES_X + tile.x;
+
+        uvec2 cell = clusterCells[cluster];
+        for (uint i = 0u; i < cell.y; ++i)
+        {
+            PackedLight light = lights[lightIndices[cell.x + i]];
+            vec3 toLight = light.positionRange.xyz - FragPos;
+            float distanceSquared = dot(toLight, toLight);
+            vec3 lightDir = toLight * inversesqrt(max(distanceSquared, 1e-8));
+
+            // Fade to 0 at the range, and across the spot cone
+            float falloff = clamp(1.0 - distanceSquared / (light.positionRange.w * light.positionRange.w), 0.0, 1.0);
+            float spot = clamp(dot(-lightDir, light.directionSpotOffset.xyz) * light.colorSpotScale.w + light.directionSpotOffset.w, 0.0, 1.0);
+            result += Shade(norm, viewDir, lightDir, light.colorSpotScale.rgb * (falloff * falloff * spot), specularMask);
+        }
+    }
 
-    // Combine
-    vec3 result = (ambient + diffuse + specular) * vec3(texture(texture_diffuse1, TexCoord));
-    FragColor = vec4(result, 1.0);
+    FragColor = vec4(result * albedo.rgb, 1.0);
 }
@@ -1,4 +1,4 @@
-#version 460 core
+#version 450 core
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
@@ -7,16 +7,38 @@ layout (location = 2) in vec2 aTexCoord;
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
+out vec3 ViewPos;   // For the light cluster lookup
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Per-frame constants, streamed by Scene::Submit; a block rather than uniforms because
+// the program is shared by windows rendering on different threads
+layout (std140, binding = 2) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+    int lightCount;             // 0 when the light buffers are not bound
+    vec3 lightPos;
+    float clusterDepthScale;    // Slice = floor(log(depth) * scale + bias)
+    vec3 lightColor;
+    float clusterDepthBias;
+};
+
+// Per-object constants, streamed through a ring buffer by Scene::Submit
+layout (std140, binding = 0) uniform ObjectConstants
+{
+    mat4 model;
+    mat3 normalMatrix;  // transpose(inverse(mat3(model))), computed once per object on the CPU
+};
+
+// The depth pre-pass computes the same position in depth.vert
+invariant gl_Position;
 
 void main()
 {
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = normalMatrix * aNormal;
     TexCoord = aTexCoord;
+    ViewPos = vec3(view * vec4(FragPos, 1.0));
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
@@ -0,0 +1,6 @@
+#version 450 core
+
+// Depth pre-pass: the rasterizer writes depth, nothing is shaded
+void main()
+{
+}
@@ -0,0 +1,32 @@
+#version 450 core
+
+layout (location = 0) in vec3 aPos;
+
+// Same block as basic.vert; only the matrices are read
+layout (std140, binding = 2) uniform FrameConstants
+{
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+    int lightCount;
+    vec3 lightPos;
+    float clusterDepthScale;
+    vec3 lightColor;
+    float clusterDepthBias;
+};
+
+// Same block as basic.vert; only the model matrix is read
+layout (std140, binding = 0) uniform ObjectConstants
+{
+    mat4 model;
+    mat3 normalMatrix;
+};
+
+// Must match basic.vert exactly, or GL_EQUAL in the main pass rejects fragments
+invariant gl_Position;
+
+void main()
+{
+    vec3 FragPos = vec3(model * vec4(aPos, 1.0));
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,198 @@
+#include "AllocationCounter.h"
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <memory>
+#include <vector>
+#include <string>
+
+namespace {
+
+thread_local uint64_t t_allocations = 0;
+
+// Process-wide: memory is often freed on another thread than the one that allocated it
+std::atomic<size_t> s_liveBytes{ 0 };
+std::atomic<size_t> s_peakBytes{ 0 };
+
+} // namespace
+
+#ifdef SNAPENGINE_COUNT_ALLOCATIONS
+
+namespace {
+
+// Each block starts with a header holding its size, so a delete knows what it frees; the
+// size sits right before the pointer handed out. Keeps malloc's alignment.
+constexpr std::size_t HEADER_SIZE = alignof(std::max_align_t);
+
+void TrackAllocation(std::size_t size)
+{
+    ++t_allocations;
+    size_t live = s_liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+    size_t peak = s_peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !s_peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+}
+
+void* StoreSize(void* block, std::size_t offset, std::size_t size)
+{
+    char* pointer = static_cast<char*>(block) + offset;
+    std::memcpy(pointer - sizeof(std::size_t), &size, sizeof(std::size_t));
+    TrackAllocation(size);
+    return pointer;
+}
+
+std::size_t ReleaseSize(void* pointer)
+{
+    std::size_t size;
+    std::memcpy(&size, static_cast<char*>(pointer) - sizeof(std::size_t), sizeof(std::size_t));
+    s_liveBytes.fetch_sub(size, std::memory_order_relaxed);
+    return size;
+}
+
+std::size_t GetAlignedHeaderSize(std::align_val_t alignment)
+{
+    return std::max(static_cast<std::size_t>(alignment), HEADER_SIZE);
+}
+
+void* Allocate(std::size_t size)
+{
+    void* block = std::malloc(HEADER_SIZE + size);
+    if (block == nullptr)
+        throw std::bad_alloc();
+    return StoreSize(block, HEADER_SIZE, size);
+}
+
+void* AllocateAligned(std::size_t size, std::align_val_t alignment)
+{
+    std::size_t header = GetAlignedHeaderSize(alignment);
+#ifdef _MSC_VER
+    // MSVC has no aligned_alloc; memory from _aligned_malloc must go back through _aligned_free
+    void* block = _aligned_malloc(header + size, header);
+#else
+    // aligned_alloc needs a size that is a multiple of the alignment
+    std::size_t rounded = (header + size + header - 1) / header * header;
+    void* block = std::aligned_alloc(header, rounded);
+#endif
+    if (block == nullptr)
+        throw std::bad_alloc();
+    return StoreSize(block, header, size);
+}
+
+void Free(void* pointer)
+{
+    if (pointer == nullptr)
+        return;
+    ReleaseSize(pointer);
+    std::free(static_cast<char*>(pointer) - HEADER_SIZE);
+}
+
+void FreeAligned(void* pointer, std::align_val_t alignment)
+{
+    if (pointer == nullptr)
+        return;
+    ReleaseSize(pointer);
+    void* block = static_cast<char*>(pointer) - GetAlignedHeaderSize(alignment);
+#ifdef _MSC_VER
+    _aligned_free(block);
+#else
+    std::free(block);
+#endif
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return Allocate(size); }
+void* operator new[](std::size_t size) { return Allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return Allocate(size); } catch (...) { return nullptr; }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    try { return Allocate(size); } catch (...) { return nullptr; }
+}
+
+void operator delete(void* pointer) noexcept { Free(pointer); }
+void operator delete[](void* pointer) noexcept { Free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { Free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { Free(pointer); }
+void operator delete(void* pointer, std::align_val_t alignment) noexcept { FreeAligned(pointer, alignment); }
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept { FreeAligned(pointer, alignment); }
+void operator delete(void* pointer, std::size_t, std::align_val_t alignment) noexcept { FreeAligned(pointer, alignment); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t alignment) noexcept { FreeAligned(pointer, alignment); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { Free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { Free(pointer); }
+
+#endif
+
+uint64_t AllocationCounter::GetCount()
+{
+    return t_allocations;
+}
+
+size_t AllocationCounter::GetLiveBytes()
+{
+    return s_liveBytes.load(std::memory_order_relaxed);
+}
+
+size_t AllocationCounter::GetPeakBytes()
+{
+    return s_peakBytes.load(std::memory_order_relaxed);
+}
+
+void AllocationCounter::ResetPeakBytes()
+{
+    s_peakBytes.store(s_liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void AllocationCounter::test()
+{
+    std::cout << "[AllocationCounter] Running tests...\n";
+
+    if (!IsEnabled())
+    {
+        std::cout << "[AllocationCounter] Built without SNAPENGINE_COUNT_ALLOCATIONS, skipping tests\n";
+        return;
+    }
+
+    uint64_t before = GetCount();
+    auto value = std::make_unique<int>(42);
+    assert(GetCount() == before + 1 && "operator new should be counted");
+
+    struct alignas(64) Aligned { char bytes[64]; };
+    auto aligned = std::make_unique<Aligned>();
+    assert(reinterpret_cast<uintptr_t>(aligned.get()) % 64 == 0 && "Aligned allocation misaligned");
+    assert(GetCount() == before + 2 && "Aligned operator new should be counted");
+
+    std::vector<int> numbers;
+    numbers.reserve(16);
+    uint64_t reserved = GetCount();
+    for (int i = 0; i < 16; ++i)
+        numbers.push_back(i);
+    assert(GetCount() == reserved && "Pushing into reserved capacity should not allocate");
+
+    // Live bytes follow allocations and frees, aligned ones included; the peak keeps the highest total
+    const size_t blockSize = 1 << 20;
+    ResetPeakBytes();
+    size_t live = GetLiveBytes();
+    assert(GetPeakBytes() == live && "Resetting should bring the peak down to the live bytes");
+    {
+        auto block = std::make_unique<char[]>(blockSize);
+        auto second = std::make_unique<Aligned>();
+        assert(GetLiveBytes() == live + blockSize + sizeof(Aligned) && "Allocations should add their size");
+    }
+    assert(GetLiveBytes() == live && "Frees should subtract their size");
+    assert(GetPeakBytes() == live + blockSize + sizeof(Aligned) && "The peak should outlive the allocations");
+
+    std::cout << "[AllocationCounter] Tests passed!\n";
+}
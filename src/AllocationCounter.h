@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * \class AllocationCounter
+ * \brief Counts heap allocations made through operator new, per thread, and the bytes they hold.
+ *
+ * When SNAPENGINE_COUNT_ALLOCATIONS is defined (CMake option of the same name, off by
+ * default) AllocationCounter.cpp replaces the global operator new and delete with
+ * versions that forward to malloc and free and bump a thread-local counter, so tests
+ * can assert that a code path does not allocate:
+ *
+ *     uint64_t before = AllocationCounter::GetCount();
+ *     mesh.Draw();
+ *     assert(!AllocationCounter::IsEnabled() || AllocationCounter::GetCount() == before);
+ *
+ * Live bytes are tracked for the whole process, with a high-water mark, so a benchmark
+ * can measure the peak memory of a code path:
+ *
+ *     AllocationCounter::ResetPeakBytes();
+ *     size_t before = AllocationCounter::GetLiveBytes();
+ *     manager.LoadData();
+ *     size_t peak = AllocationCounter::GetPeakBytes() - before;
+ *
+ * The replacement is global to every program linking the library, so shipping builds
+ * leave the option off and keep the standard allocator; GetCount() then stays at zero.
+ */
+class AllocationCounter
+{
+public:
+    /**
+     * \brief Check whether allocations are counted in this build.
+     * \return True if SNAPENGINE_COUNT_ALLOCATIONS is defined.
+     */
+    static constexpr bool IsEnabled()
+    {
+#ifdef SNAPENGINE_COUNT_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * \brief Get the number of allocations made by the calling thread.
+     * \return Allocations since the thread started; 0 if counting is disabled.
+     */
+    static uint64_t GetCount();
+
+    /**
+     * \brief Get the bytes allocated through operator new and not freed yet, by any thread.
+     * \return Requested sizes summed, without allocator overhead; 0 if counting is disabled.
+     */
+    static size_t GetLiveBytes();
+
+    /**
+     * \brief Get the highest GetLiveBytes() since the last ResetPeakBytes().
+     * \return Peak live bytes; 0 if counting is disabled.
+     */
+    static size_t GetPeakBytes();
+
+    /**
+     * \brief Start a new high-water mark at the current live bytes.
+     */
+    static void ResetPeakBytes();
+
+    /**
+     * \brief Run unit tests for the AllocationCounter class.
+     */
+    static void test();
+};
@@ -0,0 +1,54 @@
+#include "Benchmarks.h"
+#include <iostream>
+#include <exception>
+
+#include "Window.h"
+#include "Model.h"
+#include "Scene.h"
+#include "Frustum.h"
+#include "DynamicBvh.h"
+#include "OcclusionCuller.h"
+#include "TransformHierarchy.h"
+#include "HeadlessContext.h"
+#include "Profiler.h"
+#include "StreamBuffer.h"
+#include "ProgramCache.h"
+#include "ShaderPermutations.h"
+#include "LightClusters.h"
+#include "DataManager.h"
+
+namespace Benchmarks {
+
+bool RunAllBenchmarks()
+{
+    try
+    {
+        // Benchmarks measure CPU-side work only
+        Window::SetTestMode(true);
+        Scene::SetTestMode(true);
+        Model::SetTestMode(true);
+
+        Scene::benchmark();
+        Frustum::benchmark();
+        DynamicBvh::benchmark();
+        OcclusionCuller::benchmark();
+        TransformHierarchy::benchmark();
+        HeadlessContext::benchmark();
+        Profiler::benchmark();
+        StreamBuffer::benchmark();
+        ProgramCache::benchmark();
+        ShaderPermutations::benchmark();
+        LightClusters::benchmark();
+        DataManager::benchmark();
+
+        std::cout << "\nAll benchmarks finished!\n";
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+} // namespace Benchmarks
@@ -0,0 +1,22 @@
+#pragma once
+
+/**
+ * \namespace Benchmarks
+ * \brief Contains the performance benchmarks for SnapEngine.
+ * 
+ * Benchmarks mirror the Tests namespace: each class that has something worth
+ * measuring provides a static benchmark() function, and this namespace runs them.
+ * Benchmarks are run by passing --bench to the main executable.
+ */
+namespace Benchmarks {
+    /**
+     * \brief Run all performance benchmarks for SnapEngine components.
+     * 
+     * Graphics components are put in test mode, so only CPU-side work is measured.
+     * Results are written to standard output.
+     * 
+     * \return True if all benchmarks ran, false if any benchmark threw.
+     */
+    bool RunAllBenchmarks();
+
+} // namespace Benchmarks
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+
+/**
+ * \struct BoundingBox
+ * \brief An axis-aligned bounding box.
+ *
+ * A default-constructed box is empty (min > max) and becomes valid once a point is added.
+ */
+struct BoundingBox
+{
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());     ///< Minimum corner
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());    ///< Maximum corner
+
+    /**
+     * \brief Default constructor. Creates an empty box.
+     */
+    BoundingBox() = default;
+
+    /**
+     * \brief Constructor.
+     * \param minCorner Minimum corner.
+     * \param maxCorner Maximum corner.
+     */
+    BoundingBox(const glm::vec3& minCorner, const glm::vec3& maxCorner)
+        : min(minCorner), max(maxCorner)
+    {
+    }
+
+    /**
+     * \brief Check whether the box contains anything.
+     * \return True if min <= max on every axis.
+     */
+    bool IsValid() const
+    {
+        return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+    }
+
+    /**
+     * \brief Grow the box to contain a point.
+     * \param point The point to include.
+     */
+    void Expand(const glm::vec3& point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    /**
+     * \brief Grow the box to contain another box.
+     * \param other The box to include.
+     */
+    void Expand(const BoundingBox& other)
+    {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    /**
+     * \brief Check whether two boxes overlap (touching counts as overlapping).
+     * \param other The other box.
+     * \return True if the boxes overlap.
+     */
+    bool Intersects(const BoundingBox& other) const
+    {
+        return min.x <= other.max.x && other.min.x <= max.x
+            && min.y <= other.max.y && other.min.y <= max.y
+            && min.z <= other.max.z && other.min.z <= max.z;
+    }
+
+    /**
+     * \brief Check whether a point lies inside the box (boundary included).
+     * \param point The point.
+     * \return True if the point is inside.
+     */
+    bool Contains(const glm::vec3& point) const
+    {
+        return min.x <= point.x && point.x <= max.x
+            && min.y <= point.y && point.y <= max.y
+            && min.z <= point.z && point.z <= max.z;
+    }
+
+    /**
+     * \brief Get the center of the box.
+     * \return Box center.
+     */
+    glm::vec3 GetCenter() const { return (min + max) * 0.5f; }
+
+    /**
+     * \brief Get the half-size of the box on each axis.
+     * \return Box extents.
+     */
+    glm::vec3 GetExtents() const { return (max - min) * 0.5f; }
+
+    /**
+     * \brief Get the radius of the sphere centered on the box that encloses it.
+     * \return Bounding sphere radius.
+     */
+    float GetRadius() const { return glm::length(GetExtents()); }
+
+    /**
+     * \brief Transform the box and return the axis-aligned box enclosing the result.
+     * \param transform Affine transform to apply.
+     * \return World-space box.
+     */
+    BoundingBox Transformed(const glm::mat4& transform) const
+    {
+        if (!IsValid())
+            return *this;
+
+        // Arvo's method: transform the center, then project the extents on each axis
+        glm::vec3 center = glm::vec3(transform * glm::vec4(GetCenter(), 1.0f));
+        glm::vec3 extents = GetExtents();
+        glm::vec3 worldExtents(0.0f);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            worldExtents[axis] = std::abs(transform[0][axis]) * extents.x
+                               + std::abs(transform[1][axis]) * extents.y
+                               + std::abs(transform[2][axis]) * extents.z;
+        }
+        return BoundingBox(center - worldExtents, center + worldExtents);
+    }
+
+    /**
+     * \brief Runs unit tests for the BoundingBox structure.
+     */
+    static void test()
+    {
+        std::cout << "[BoundingBox] Running tests...\n";
+
+        BoundingBox box;
+        assert(!box.IsValid() && "Default box should be empty");
+
+        box.Expand(glm::vec3(-1.0f, 0.0f, 2.0f));
+        box.Expand(glm::vec3(1.0f, 2.0f, 4.0f));
+        assert(box.IsValid() && "Box should be valid after expansion");
+        assert(box.GetCenter() == glm::vec3(0.0f, 1.0f, 3.0f) && "Box center incorrect");
+        assert(box.GetExtents() == glm::vec3(1.0f, 1.0f, 1.0f) && "Box extents incorrect");
+
+        glm::mat4 transform(1.0f);
+        transform[0][0] = 2.0f;                                 // Scale x by 2
+        transform[3] = glm::vec4(10.0f, 0.0f, 0.0f, 1.0f);      // Translate x by 10
+        assert(box.Contains(glm::vec3(0.0f, 1.0f, 3.0f)) && !box.Contains(glm::vec3(0.0f, 3.0f, 3.0f)) && "Contains incorrect");
+        assert(box.Intersects(BoundingBox(glm::vec3(1.0f), glm::vec3(5.0f))) && "Touching boxes should intersect");
+        assert(!box.Intersects(BoundingBox(glm::vec3(1.5f), glm::vec3(5.0f))) && "Disjoint boxes should not intersect");
+
+        BoundingBox moved = box.Transformed(transform);
+        assert(moved.min == glm::vec3(8.0f, 0.0f, 2.0f) && "Transformed min incorrect");
+        assert(moved.max == glm::vec3(12.0f, 2.0f, 4.0f) && "Transformed max incorrect");
+
+        std::cout << "[BoundingBox] Tests passed!\n";
+    }
+};
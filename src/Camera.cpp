@@ -1,6 +1,7 @@
 #include "Camera.h"
 #include <iostream>
 #include <cassert>
+#include <cmath>
 
 // Initialize static members
 bool Camera::s_testMode = false;
@@ -15,6 +16,7 @@ Camera::Camera(const glm::vec3& position)
     , m_movementSpeed(SPEED)
     , m_mouseSensitivity(SENSITIVITY)
     , m_zoom(ZOOM)
+    , m_dirty(true)
 {
     UpdateCameraVectors();
 }
@@ -26,6 +28,7 @@ Camera::~Camera()
 void Camera::ProcessKeyboard(CameraMovement direction, float deltaTime)
 {
     float velocity = m_movementSpeed * deltaTime;
+    m_dirty = true;
     if (direction == FORWARD)
         m_position += m_front * velocity;
     if (direction == BACKWARD)
@@ -55,10 +58,12 @@ void Camera::ProcessMouseMovement(float xoffset, float yoffset, bool constrainPi
 
     // Update Front, Right and Up Vectors using the updated Euler angles
     UpdateCameraVectors();
+    m_dirty = true;
 }
 
 void Camera::ProcessMouseScroll(float yoffset)
 {
+    m_dirty = true;
     if (m_zoom >= 1.0f && m_zoom <= 45.0f)
         m_zoom -= yoffset;
     if (m_zoom <= 1.0f)
@@ -72,6 +77,16 @@ glm::mat4 Camera::GetViewMatrix() const
     return glm::lookAt(m_position, m_position + m_front, m_up);
 }
 
+void Camera::LookAt(const glm::vec3& position, const glm::vec3& target)
+{
+    glm::vec3 direction = glm::normalize(target - position);
+    m_position = position;
+    m_yaw = glm::degrees(std::atan2(direction.z, direction.x));
+    m_pitch = glm::degrees(std::asin(glm::clamp(direction.y, -1.0f, 1.0f)));
+    UpdateCameraVectors();
+    m_dirty = true;
+}
+
 void Camera::UpdateCameraVectors()
 {
     // Calculate the new Front vector
@@ -97,9 +112,15 @@ void Camera::test()
     assert(camera.GetUp() == glm::vec3(0.0f, 1.0f, 0.0f) && "Initial up vector incorrect");
     assert(camera.GetZoom() == 45.0f && "Initial zoom incorrect");
 
+    // Test dirty tracking
+    assert(camera.IsDirty() && "New camera should be dirty");
+    camera.ClearDirty();
+    assert(!camera.IsDirty() && "ClearDirty failed");
+
     // Test camera movement
     camera.ProcessKeyboard(Camera::CameraMovement::FORWARD, 1.0f);
     assert(camera.GetPosition().z < 3.0f && "Forward movement failed");
+    assert(camera.IsDirty() && "Movement should mark the camera dirty");
 
     camera.ProcessKeyboard(Camera::CameraMovement::RIGHT, 1.0f);
     assert(camera.GetPosition().x > 0.0f && "Right movement failed");
@@ -108,6 +129,11 @@ void Camera::test()
     camera.ProcessMouseMovement(10.0f, 0.0f);
     assert(camera.GetFront() != glm::vec3(0.0f, 0.0f, -1.0f) && "Mouse movement failed to update front vector");
 
+    // Test looking at a point
+    camera.LookAt(glm::vec3(4.0f, 3.0f, 0.0f), glm::vec3(0.0f, 3.0f, 0.0f));
+    assert(camera.GetPosition() == glm::vec3(4.0f, 3.0f, 0.0f) && "LookAt failed to move the camera");
+    assert(glm::length(camera.GetFront() - glm::vec3(-1.0f, 0.0f, 0.0f)) < 1e-5f && "LookAt failed to turn the camera");
+
     // Test mouse scroll
     float initialZoom = camera.GetZoom();
     camera.ProcessMouseScroll(1.0f);
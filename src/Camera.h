@@ -67,6 +67,24 @@ public:
      */
     glm::mat4 GetViewMatrix() const;
 
+    /**
+     * \brief Move the camera and turn it towards a point.
+     * \param position New camera position.
+     * \param target Point to look at; must differ from position.
+     */
+    void LookAt(const glm::vec3& position, const glm::vec3& target);
+
+    /**
+     * \brief Check whether the camera moved, turned or zoomed since the last ClearDirty().
+     * \return True if the view changed.
+     */
+    bool IsDirty() const { return m_dirty; }
+
+    /**
+     * \brief Mark the current view as rendered.
+     */
+    void ClearDirty() { m_dirty = false; }
+
     /**
      * \brief Get camera position.
      * \return Camera position.
@@ -125,6 +143,7 @@ private:
     float m_movementSpeed;    ///< Movement speed
     float m_mouseSensitivity; ///< Mouse sensitivity
     float m_zoom;             ///< Zoom level (FOV)
+    bool m_dirty;             ///< View changed since the last ClearDirty()
 
     static bool s_testMode; ///< Test mode flag
 };
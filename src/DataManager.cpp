@@ -1,7 +1,138 @@
 #include "DataManager.h"
+#include "MappedFile.h"
+#include "AllocationCounter.h"
+#include "Profiler.h"
 #include <fstream>
 #include <iostream>
 #include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+
+namespace {
+
+// Builds the elements of a top-level JSON array from SAX events and hands each one out
+// as soon as it is complete.
+class ObjectStreamer : public nlohmann::json_sax<nlohmann::json>
+{
+public:
+    using json = nlohmann::json;
+    using Dispatch = std::function<void(json&&)>;
+
+    explicit ObjectStreamer(Dispatch dispatch) : m_dispatch(std::move(dispatch)) {}
+
+    bool null() override { return AddValue(nullptr); }
+    bool boolean(bool value) override { return AddValue(value); }
+    bool number_integer(number_integer_t value) override { return AddValue(value); }
+    bool number_unsigned(number_unsigned_t value) override { return AddValue(value); }
+    bool number_float(number_float_t value, const string_t&) override { return AddValue(value); }
+    bool string(string_t& value) override { return AddValue(std::move(value)); }
+    bool binary(binary_t& value) override { return AddValue(json::binary(std::move(value))); }
+
+    bool start_object(std::size_t) override { return Open(json::object()); }
+    bool key(string_t& key) override
+    {
+        m_key = std::move(key);
+        return true;
+    }
+    bool end_object() override { return Close(); }
+
+    bool start_array(std::size_t) override
+    {
+        // The top-level array itself is never built
+        if (m_open.empty() && !m_inRoot)
+        {
+            m_inRoot = true;
+            return true;
+        }
+        return Open(json::array());
+    }
+    bool end_array() override
+    {
+        if (m_open.empty())
+        {
+            m_inRoot = false;
+            return true;
+        }
+        return Close();
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& error) override
+    {
+        m_error = error.what();
+        return false;
+    }
+
+    // The parse error, if the parse failed on the syntax
+    const std::string& GetError() const { return m_error; }
+
+    // True if the parse failed because the document is not an array
+    bool IsRootMismatch() const { return m_rootMismatch; }
+
+private:
+    // Put a value into the innermost open container, or make it the element
+    json* Insert(json&& value)
+    {
+        if (m_open.empty())
+        {
+            m_element = std::move(value);
+            return &m_element;
+        }
+
+        json& parent = *m_open.back();
+        if (parent.is_object())
+            return &(parent[m_key] = std::move(value));
+        parent.push_back(std::move(value));
+        return &parent.back();
+    }
+
+    // Check that a new element is inside the top-level array
+    bool InRoot()
+    {
+        m_rootMismatch = !m_inRoot;
+        return m_inRoot;
+    }
+
+    bool AddValue(json&& value)
+    {
+        if (m_open.empty() && !InRoot())
+            return false;
+
+        Insert(std::move(value));
+        if (m_open.empty())
+            m_dispatch(std::move(m_element));
+        return true;
+    }
+
+    bool Open(json&& container)
+    {
+        if (m_open.empty() && !InRoot())
+            return false;
+
+        // Elements are only appended to the innermost container, so outer pointers stay valid
+        m_open.push_back(Insert(std::move(container)));
+        return true;
+    }
+
+    bool Close()
+    {
+        m_open.pop_back();
+        if (m_open.empty())
+            m_dispatch(std::move(m_element));
+        return true;
+    }
+
+    Dispatch m_dispatch;            ///< Receives each completed element
+    json m_element;                 ///< Element being built
+    std::vector<json*> m_open;      ///< Open containers of the element, outermost first
+    string_t m_key;                 ///< Key of the next object member
+    bool m_inRoot = false;          ///< Inside the top-level array
+    bool m_rootMismatch = false;    ///< The document is not an array
+    std::string m_error;            ///< Syntax error message
+};
+
+} // namespace
 
 DataManager::DataManager(const std::string& filename)
     : m_filename(filename)
@@ -17,7 +148,24 @@ bool DataManager::Initialize()
 
 bool DataManager::LoadData()
 {
-    std::cout << "Attempting to load data from: " << m_filename << std::endl;
+    PROFILE_SCOPE("DataManager::LoadData");
+    std::cout << "Attempting to load data from: " << m_filename << "\n";
+
+    m_stats = DataLoadStats();
+    auto start = std::chrono::steady_clock::now();
+    bool loaded = m_streaming ? LoadStreaming() : LoadDocument();
+    m_stats.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (loaded)
+    {
+        std::cout << "Loaded " << m_stats.objects << " objects (" << m_stats.dispatched << " dispatched, "
+                  << m_stats.skipped << " skipped) in " << m_stats.loadMs << " ms\n";
+    }
+    return loaded;
+}
+
+bool DataManager::LoadDocument()
+{
     std::ifstream file(m_filename);
     if (!file.is_open())
     {
@@ -25,11 +173,11 @@ bool DataManager::LoadData()
         return false;
     }
 
+    // Strict, like the streaming parser: trailing content after the array is an error
     nlohmann::json j;
     try
     {
-        file >> j;
-        std::cout << "Successfully parsed JSON data" << std::endl;
+        j = nlohmann::json::parse(file);
     }
     catch (const std::exception& e)
     {
@@ -43,34 +191,64 @@ bool DataManager::LoadData()
         return false;
     }
 
-    std::cout << "Found " << j.size() << " objects in JSON array" << std::endl;
-
     for (auto& obj : j)
+        DispatchObject(std::move(obj));
+
+    return true;
+}
+
+bool DataManager::LoadStreaming()
+{
+    MappedFile file;
+    if (!file.Open(m_filename))
     {
-        if (!obj.contains("class"))
-        {
-            std::cerr << "JSON object missing 'class' field; skipping...\n";
-            continue;
-        }
+        std::cerr << "Failed to open file: " << m_filename << "\n";
+        return false;
+    }
 
-        std::string classType = obj["class"];
-        std::cout << "Processing object of class: " << classType << std::endl;
-        
-        if (classType == "window" || classType == "Window")
-        {
-            std::cout << "Found window object with title: " << obj["title"] << std::endl;
-            m_windowManager.addJsonObject(obj);
-        }
+    ObjectStreamer streamer([this](nlohmann::json&& object) { DispatchObject(std::move(object)); });
+    const char* begin = file.GetData();
+    if (!nlohmann::json::sax_parse(begin, begin + file.GetSize(), &streamer))
+    {
+        if (streamer.IsRootMismatch())
+            std::cerr << "Expected a JSON array in file: " << m_filename << "\n";
         else
-        {
-            std::cerr << "Unknown class type: " << classType 
-                      << " - no manager to handle this object. Skipping.\n";
-        }
+            std::cerr << "JSON parse error: " << streamer.GetError() << "\n";
+        return false;
     }
 
     return true;
 }
 
+void DataManager::DispatchObject(nlohmann::json&& object)
+{
+    ++m_stats.objects;
+
+    auto classField = object.find("class");
+    if (classField == object.end() || !classField->is_string())
+    {
+        if (m_verbose)
+            std::cerr << "JSON object missing 'class' field; skipping...\n";
+        ++m_stats.skipped;
+        return;
+    }
+
+    const std::string& classType = classField->get_ref<const std::string&>();
+    if (classType == "window" || classType == "Window")
+    {
+        if (m_verbose)
+            std::cout << "Found window object with title: " << object.value("title", nlohmann::json()) << "\n";
+        m_windowManager.addJsonObject(std::move(object));
+        ++m_stats.dispatched;
+    }
+    else
+    {
+        if (m_verbose)
+            std::cerr << "Unknown class type: " << classType << " - no manager to handle this object. Skipping.\n";
+        ++m_stats.skipped;
+    }
+}
+
 void DataManager::CreateManagedObjects()
 {
     std::cout << "Creating managed objects..." << std::endl;
@@ -127,8 +305,128 @@ void DataManager::test()
     assert(windows[1]->GetWidth() == 800 && "Second window width incorrect");
     assert(windows[1]->GetHeight() == 600 && "Second window height incorrect");
 
+    // Test that objects are moved into their manager, not copied
+    {
+        WindowManager manager;
+        nlohmann::json object = { { "class", "window" }, { "title", "Moved" } };
+        const auto* members = object.get_ptr<const nlohmann::json::object_t*>();
+        manager.addJsonObject(std::move(object));
+        assert(manager.getJsonObjects().back().get_ptr<const nlohmann::json::object_t*>() == members && "Object should be moved");
+    }
+
+    // Test that streaming hands out the same objects as parsing the whole document
+    const char* streamFilename = "test_stream_data.json";
+    {
+        std::ofstream outFile(streamFilename);
+        outFile << R"([
+            { "class": "window", "title": "Nested", "width": 640, "height": 480,
+              "extra": { "tags": [ "a", [ 1, 2.5, true, null ], { "deep": {} } ], "empty": [] } },
+            42,
+            [ { "class": "window" } ],
+            { "title": "No class" },
+            { "class": 7 },
+            { "class": "unknown", "something": "ignored" },
+            { "class": "Window", "title": "Last", "width": 1, "height": 2 }
+        ])";
+    }
+    {
+        DataManager document(streamFilename);
+        DataManager streamed(streamFilename);
+        streamed.SetStreaming(true);
+        assert(!document.IsStreaming() && streamed.IsStreaming() && "Streaming should be opt-in");
+        bool documentLoaded = document.LoadData();
+        bool streamLoaded = streamed.LoadData();
+        assert(documentLoaded && streamLoaded && "Failed to load stream test data");
+
+        const auto& expected = document.GetWindowManager().getJsonObjects();
+        const auto& actual = streamed.GetWindowManager().getJsonObjects();
+        assert(expected.size() == 2 && actual == expected && "Streaming should dispatch the same objects");
+        assert(actual[0]["extra"]["tags"][1][1] == 2.5 && actual[0]["extra"]["tags"][2]["deep"].empty() && "Nested values should survive streaming");
+
+        const DataLoadStats& stats = streamed.GetLoadStats();
+        assert(stats.objects == 7 && stats.dispatched == 2 && stats.skipped == 5 && "Wrong streaming counters");
+        assert(document.GetLoadStats().objects == 7 && document.GetLoadStats().skipped == 5 && "Wrong document counters");
+    }
+
+    // Test that both modes reject the same malformed files
+    for (bool streaming : { false, true })
+    {
+        auto loads = [streamFilename, streaming](const char* contents)
+        {
+            {
+                std::ofstream outFile(streamFilename, std::ios::trunc);
+                outFile << contents;
+            }
+            DataManager loader(streamFilename);
+            loader.SetStreaming(streaming);
+            return loader.LoadData();
+        };
+        bool loaded = loads(R"({ "class": "window" })");
+        assert(!loaded && "A top-level object should be rejected");
+        loaded = loads("5");
+        assert(!loaded && "A top-level scalar should be rejected");
+        loaded = loads(R"([ { "class": "window" }, )");
+        assert(!loaded && "A truncated file should be rejected");
+        loaded = loads("");
+        assert(!loaded && "An empty file should be rejected");
+        loaded = loads("[] []");
+        assert(!loaded && "Trailing content should be rejected");
+        loaded = loads("[]");
+        assert(loaded && "An empty array should load");
+
+        DataManager missing("missing_data.json");
+        missing.SetStreaming(streaming);
+        loaded = missing.LoadData();
+        assert(!loaded && "A missing file should fail");
+    }
+    std::remove(streamFilename);
+
     // Clean up - disable test mode
     Window::SetTestMode(false);
 
     std::cout << "[DataManager] Tests passed!\n";
 }
+
+void DataManager::benchmark()
+{
+    std::cout << "\n[DataManager] Benchmark: loading a large scene file\n";
+
+    // Window objects with some nested payload, as an exported scene would have
+    const char* filename = "benchmark_data.json";
+    const size_t objectCount = 100000;
+    {
+        std::ofstream outFile(filename);
+        outFile << "[\n";
+        for (size_t i = 0; i < objectCount; ++i)
+        {
+            outFile << R"(  { "class": "window", "title": "Window )" << i << R"(", "width": 1280, "height": 720, )"
+                    << R"("camera": { "position": [ 1.5, 2.25, -3.0 ], "fov": 45.0 }, "tags": [ "overview", "control-room" ] })"
+                    << (i + 1 < objectCount ? ",\n" : "\n");
+        }
+        outFile << "]\n";
+    }
+    std::cout << "  " << objectCount << " objects, " << std::filesystem::file_size(filename) / (1024 * 1024) << " MB\n";
+
+    for (bool streaming : { false, true })
+    {
+        DataManager manager(filename);
+        manager.SetStreaming(streaming);
+
+        // Peak memory includes what the managers keep; the difference is the loader's overhead
+        AllocationCounter::ResetPeakBytes();
+        size_t liveBefore = AllocationCounter::GetLiveBytes();
+        uint64_t allocations = AllocationCounter::GetCount();
+        bool loaded = manager.LoadData();
+        allocations = AllocationCounter::GetCount() - allocations;
+        double peakMb = static_cast<double>(AllocationCounter::GetPeakBytes() - liveBefore) / (1024.0 * 1024.0);
+        double keptMb = static_cast<double>(AllocationCounter::GetLiveBytes() - liveBefore) / (1024.0 * 1024.0);
+
+        std::cout << "  " << (streaming ? "streaming: " : "document:  ") << (loaded ? "" : "FAILED, ") << manager.GetLoadStats().loadMs
+                  << " ms";
+        if (AllocationCounter::IsEnabled())
+            std::cout << ", " << allocations << " allocations, peak " << peakMb << " MB (" << keptMb << " MB kept)";
+        std::cout << "\n";
+    }
+
+    std::remove(filename);
+}
@@ -5,12 +5,27 @@
 #include <nlohmann/json.hpp>
 #include "WindowManager.h"
 
+/// \struct DataLoadStats
+/// \brief Counters of the last DataManager::LoadData().
+struct DataLoadStats
+{
+    size_t objects = 0;         ///< Elements of the top-level array
+    size_t dispatched = 0;      ///< Objects handed to a manager
+    size_t skipped = 0;         ///< Elements without a known class
+    double loadMs = 0.0;        ///< Time spent in LoadData()
+};
+
 /// \class DataManager
 /// \brief Loads JSON data from a file and distributes objects to the appropriate managers.
 ///
 /// The data file should contain a JSON array of objects. Each object must have a "class" 
 /// field that indicates which manager should handle it (e.g., "window"). Currently, 
 /// DataManager routes "window" objects to WindowManager. Extend as needed for other managers.
+///
+/// By default the whole file is parsed into one document before the objects are handed
+/// out. For large scene files, streaming mode parses the memory-mapped file with the SAX
+/// interface instead and moves each object to its manager as soon as it is complete, so
+/// only one object is held as a document at a time.
 class DataManager
 {
 public:
@@ -30,6 +45,27 @@ public:
     /// \return True if the file was successfully loaded and parsed, false otherwise.
     bool LoadData();
 
+    /// \brief Choose how LoadData() reads the file.
+    ///
+    /// Both modes accept the same files: one JSON array and nothing after it. When
+    /// streaming, objects before a syntax error have already been handed to their
+    /// managers when LoadData() fails.
+    ///
+    /// \param enabled True to stream the file, false to parse it as one document.
+    void SetStreaming(bool enabled) { m_streaming = enabled; }
+
+    /// \brief Check whether LoadData() streams the file.
+    /// \return True if streaming.
+    bool IsStreaming() const { return m_streaming; }
+
+    /// \brief Log every object LoadData() handles; otherwise only a summary is logged.
+    /// \param enabled True to log each object.
+    void SetVerbose(bool enabled) { m_verbose = enabled; }
+
+    /// \brief Get the counters of the last LoadData().
+    /// \return Statistics.
+    const DataLoadStats& GetLoadStats() const { return m_stats; }
+
     /// \brief Instructs all owned managers to create their objects.
     ///
     /// This calls createObjects() on each managed manager so that
@@ -45,7 +81,22 @@ public:
     /// Attempts to load a small JSON sample, verifies distribution of objects, etc.
     static void test();
 
+    /// \brief Measure loading a large file as one document against streaming it.
+    static void benchmark();
+
 private:
+    /// \brief Parse the whole file, then hand out its objects.
+    /// \return True on success.
+    bool LoadDocument();
+
+    /// \brief Parse the mapped file with the SAX interface, handing out objects as they complete.
+    /// \return True on success.
+    bool LoadStreaming();
+
+    /// \brief Move an element of the top-level array to the manager of its class.
+    /// \param object The element.
+    void DispatchObject(nlohmann::json&& object);
+
     /// \brief The name/path of the JSON file to load.
     std::string m_filename;
 
@@ -53,4 +104,8 @@ private:
     ///
     /// Extend this class to own other manager types as needed.
     WindowManager m_windowManager;
+
+    bool m_streaming = false;   ///< LoadData() streams the file
+    bool m_verbose = false;     ///< Log each object
+    DataLoadStats m_stats;      ///< Counters of the last LoadData()
 };
@@ -0,0 +1,616 @@
+#include "DynamicBvh.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+DynamicBvh::DynamicBvh(float margin)
+    : m_margin(margin)
+{
+}
+
+int DynamicBvh::AllocateNode()
+{
+    if (m_freeList == NULL_NODE)
+    {
+        // Grow the pool and chain the new nodes into the free list
+        size_t oldSize = m_nodes.size();
+        size_t newSize = std::max<size_t>(16, oldSize * 2);
+        m_nodes.resize(newSize);
+        for (size_t i = oldSize; i < newSize; ++i)
+        {
+            m_nodes[i].parent = (i + 1 < newSize) ? static_cast<int>(i + 1) : NULL_NODE;
+            m_nodes[i].height = -1;
+        }
+        m_freeList = static_cast<int>(oldSize);
+    }
+
+    int node = m_freeList;
+    m_freeList = m_nodes[node].parent;
+    m_nodes[node] = Node();
+    m_nodes[node].height = 0;
+    return node;
+}
+
+void DynamicBvh::FreeNode(int node)
+{
+    m_nodes[node].parent = m_freeList;
+    m_nodes[node].height = -1;
+    m_freeList = node;
+}
+
+int DynamicBvh::CreateProxy(const BoundingBox& box, uint32_t userData)
+{
+    int proxyId = AllocateNode();
+    glm::vec3 margin(m_margin);
+    m_nodes[proxyId].box = BoundingBox(box.min - margin, box.max + margin);
+    m_nodes[proxyId].userData = userData;
+    InsertLeaf(proxyId);
+    ++m_proxyCount;
+    return proxyId;
+}
+
+void DynamicBvh::DestroyProxy(int proxyId)
+{
+    assert(proxyId >= 0 && proxyId < static_cast<int>(m_nodes.size()) && m_nodes[proxyId].IsLeaf());
+    RemoveLeaf(proxyId);
+    FreeNode(proxyId);
+    --m_proxyCount;
+}
+
+bool DynamicBvh::MoveProxy(int proxyId, const BoundingBox& box)
+{
+    assert(proxyId >= 0 && proxyId < static_cast<int>(m_nodes.size()) && m_nodes[proxyId].IsLeaf());
+    if (Contains(m_nodes[proxyId].box, box))
+        return false;
+
+    RemoveLeaf(proxyId);
+    glm::vec3 margin(m_margin);
+    m_nodes[proxyId].box = BoundingBox(box.min - margin, box.max + margin);
+    InsertLeaf(proxyId);
+    return true;
+}
+
+void DynamicBvh::Clear()
+{
+    m_nodes.clear();
+    m_root = NULL_NODE;
+    m_freeList = NULL_NODE;
+    m_proxyCount = 0;
+}
+
+void DynamicBvh::InsertLeaf(int leaf)
+{
+    if (m_root == NULL_NODE)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Descend towards the sibling with the lowest surface-area cost
+    const BoundingBox leafBox = m_nodes[leaf].box;
+    int index = m_root;
+    while (!m_nodes[index].IsLeaf())
+    {
+        const Node& node = m_nodes[index];
+        float area = SurfaceArea(node.box);
+        float combinedArea = SurfaceArea(Union(node.box, leafBox));
+
+        // Cost of making a new parent for this node and the leaf
+        float cost = 2.0f * combinedArea;
+
+        // Minimum cost of pushing the leaf further down the tree
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](int child)
+        {
+            const Node& c = m_nodes[child];
+            float newArea = SurfaceArea(Union(leafBox, c.box));
+            return c.IsLeaf() ? newArea + inheritanceCost
+                              : (newArea - SurfaceArea(c.box)) + inheritanceCost;
+        };
+        float cost1 = descendCost(node.child1);
+        float cost2 = descendCost(node.child2);
+
+        if (cost < cost1 && cost < cost2)
+            break;
+
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    int sibling = index;
+    int oldParent = m_nodes[sibling].parent;
+    int newParent = AllocateNode();
+    m_nodes[newParent].parent = oldParent;
+    m_nodes[newParent].box = Union(leafBox, m_nodes[sibling].box);
+    m_nodes[newParent].height = m_nodes[sibling].height + 1;
+    m_nodes[newParent].child1 = sibling;
+    m_nodes[newParent].child2 = leaf;
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    if (oldParent != NULL_NODE)
+    {
+        if (m_nodes[oldParent].child1 == sibling)
+            m_nodes[oldParent].child1 = newParent;
+        else
+            m_nodes[oldParent].child2 = newParent;
+    }
+    else
+    {
+        m_root = newParent;
+    }
+
+    FixUpwards(m_nodes[leaf].parent);
+}
+
+void DynamicBvh::RemoveLeaf(int leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = NULL_NODE;
+        return;
+    }
+
+    int parent = m_nodes[leaf].parent;
+    int grandParent = m_nodes[parent].parent;
+    int sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    if (grandParent != NULL_NODE)
+    {
+        // Replace the parent with the sibling
+        if (m_nodes[grandParent].child1 == parent)
+            m_nodes[grandParent].child1 = sibling;
+        else
+            m_nodes[grandParent].child2 = sibling;
+        m_nodes[sibling].parent = grandParent;
+        FreeNode(parent);
+        FixUpwards(grandParent);
+    }
+    else
+    {
+        m_root = sibling;
+        m_nodes[sibling].parent = NULL_NODE;
+        FreeNode(parent);
+    }
+}
+
+void DynamicBvh::FixUpwards(int index)
+{
+    while (index != NULL_NODE)
+    {
+        index = Balance(index);
+
+        Node& node = m_nodes[index];
+        const Node& child1 = m_nodes[node.child1];
+        const Node& child2 = m_nodes[node.child2];
+        node.height = 1 + std::max(child1.height, child2.height);
+        node.box = Union(child1.box, child2.box);
+
+        index = node.parent;
+    }
+}
+
+int DynamicBvh::Balance(int iA)
+{
+    Node& A = m_nodes[iA];
+    if (A.IsLeaf() || A.height < 2)
+        return iA;
+
+    int iB = A.child1;
+    int iC = A.child2;
+    Node& B = m_nodes[iB];
+    Node& C = m_nodes[iC];
+
+    int balance = C.height - B.height;
+
+    // Rotate C up
+    if (balance > 1)
+    {
+        int iF = C.child1;
+        int iG = C.child2;
+        Node& F = m_nodes[iF];
+        Node& G = m_nodes[iG];
+
+        // Swap A and C
+        C.child1 = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+
+        // A's old parent should point to C
+        if (C.parent != NULL_NODE)
+        {
+            if (m_nodes[C.parent].child1 == iA)
+                m_nodes[C.parent].child1 = iC;
+            else
+                m_nodes[C.parent].child2 = iC;
+        }
+        else
+        {
+            m_root = iC;
+        }
+
+        // Keep the taller grandchild under C
+        if (F.height > G.height)
+        {
+            C.child2 = iF;
+            A.child2 = iG;
+            G.parent = iA;
+            A.box = Union(B.box, G.box);
+            C.box = Union(A.box, F.box);
+            A.height = 1 + std::max(B.height, G.height);
+            C.height = 1 + std::max(A.height, F.height);
+        }
+        else
+        {
+            C.child2 = iG;
+            A.child2 = iF;
+            F.parent = iA;
+            A.box = Union(B.box, F.box);
+            C.box = Union(A.box, G.box);
+            A.height = 1 + std::max(B.height, F.height);
+            C.height = 1 + std::max(A.height, G.height);
+        }
+        return iC;
+    }
+
+    // Rotate B up
+    if (balance < -1)
+    {
+        int iD = B.child1;
+        int iE = B.child2;
+        Node& D = m_nodes[iD];
+        Node& E = m_nodes[iE];
+
+        // Swap A and B
+        B.child1 = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+
+        // A's old parent should point to B
+        if (B.parent != NULL_NODE)
+        {
+            if (m_nodes[B.parent].child1 == iA)
+                m_nodes[B.parent].child1 = iB;
+            else
+                m_nodes[B.parent].child2 = iB;
+        }
+        else
+        {
+            m_root = iB;
+        }
+
+        // Keep the taller grandchild under B
+        if (D.height > E.height)
+        {
+            B.child2 = iD;
+            A.child1 = iE;
+            E.parent = iA;
+            A.box = Union(C.box, E.box);
+            B.box = Union(A.box, D.box);
+            A.height = 1 + std::max(C.height, E.height);
+            B.height = 1 + std::max(A.height, D.height);
+        }
+        else
+        {
+            B.child2 = iE;
+            A.child1 = iD;
+            D.parent = iA;
+            A.box = Union(C.box, D.box);
+            B.box = Union(A.box, E.box);
+            A.height = 1 + std::max(C.height, D.height);
+            B.height = 1 + std::max(A.height, E.height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
+
+float DynamicBvh::GetAreaRatio() const
+{
+    if (m_root == NULL_NODE)
+        return 0.0f;
+
+    float rootArea = SurfaceArea(m_nodes[m_root].box);
+    if (rootArea <= 0.0f)
+        return 0.0f;
+
+    float totalArea = 0.0f;
+    for (const auto& node : m_nodes)
+    {
+        if (node.height >= 0)
+            totalArea += SurfaceArea(node.box);
+    }
+    return totalArea / rootArea;
+}
+
+bool DynamicBvh::Validate() const
+{
+    if (m_root == NULL_NODE)
+        return m_proxyCount == 0;
+
+    if (m_nodes[m_root].parent != NULL_NODE)
+        return false;
+
+    int leaves = ValidateSubtree(m_root, NULL_NODE);
+    if (leaves < 0 || static_cast<size_t>(leaves) != m_proxyCount)
+        return false;
+
+    // Every node is either in the tree or on the free list
+    size_t freeCount = 0;
+    for (int node = m_freeList; node != NULL_NODE; node = m_nodes[node].parent)
+        ++freeCount;
+    size_t treeCount = 2 * m_proxyCount - 1;
+    return freeCount + treeCount == m_nodes.size();
+}
+
+int DynamicBvh::ValidateSubtree(int index, int parent) const
+{
+    const Node& node = m_nodes[index];
+    if (node.parent != parent || node.height < 0)
+        return -1;
+
+    if (node.IsLeaf())
+        return (node.child2 == NULL_NODE && node.height == 0) ? 1 : -1;
+
+    const Node& child1 = m_nodes[node.child1];
+    const Node& child2 = m_nodes[node.child2];
+    // Rotations fix one level per ancestor, so a leaf inserted beside a tall subtree can
+    // leave siblings differing by more than one; only the heights themselves must agree
+    if (node.height != 1 + std::max(child1.height, child2.height))
+        return -1;
+    if (!Contains(node.box, child1.box) || !Contains(node.box, child2.box))
+        return -1;
+
+    int leaves1 = ValidateSubtree(node.child1, index);
+    int leaves2 = ValidateSubtree(node.child2, index);
+    if (leaves1 < 0 || leaves2 < 0)
+        return -1;
+    return leaves1 + leaves2;
+}
+
+bool DynamicBvh::RayIntersectsBox(const glm::vec3& origin, const glm::vec3& inverseDirection,
+                                  const BoundingBox& box, float maxDistance, float& distance)
+{
+    float tMin = 0.0f;
+    float tMax = maxDistance;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float t1 = (box.min[axis] - origin[axis]) * inverseDirection[axis];
+        float t2 = (box.max[axis] - origin[axis]) * inverseDirection[axis];
+
+        // A ray parallel to the slab gives NaN (0 * inf) when it lies on a slab face
+        if (t1 != t1 || t2 != t2)
+        {
+            if (origin[axis] < box.min[axis] || origin[axis] > box.max[axis])
+                return false;
+            continue;
+        }
+
+        tMin = std::max(tMin, std::min(t1, t2));
+        tMax = std::min(tMax, std::max(t1, t2));
+        if (tMin > tMax)
+            return false;
+    }
+    distance = tMin;
+    return true;
+}
+
+float DynamicBvh::SurfaceArea(const BoundingBox& box)
+{
+    glm::vec3 d = box.max - box.min;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+BoundingBox DynamicBvh::Union(const BoundingBox& a, const BoundingBox& b)
+{
+    return BoundingBox(glm::min(a.min, b.min), glm::max(a.max, b.max));
+}
+
+bool DynamicBvh::Contains(const BoundingBox& outer, const BoundingBox& inner)
+{
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z
+        && inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+}
+
+namespace {
+
+BoundingBox RandomBox(std::mt19937& rng, float worldSize, float maxSize)
+{
+    std::uniform_real_distribution<float> position(-worldSize, worldSize);
+    std::uniform_real_distribution<float> size(0.1f, maxSize);
+    glm::vec3 center(position(rng), position(rng), position(rng));
+    glm::vec3 extents(size(rng), size(rng), size(rng));
+    return BoundingBox(center - extents, center + extents);
+}
+
+} // namespace
+
+void DynamicBvh::test()
+{
+    std::cout << "[DynamicBvh] Running tests...\n";
+
+    DynamicBvh bvh(0.5f);
+    assert(bvh.Validate() && bvh.GetHeight() == -1 && "Empty tree invalid");
+
+    // Insert
+    std::mt19937 rng(1234);
+    const uint32_t count = 2000;
+    std::vector<BoundingBox> boxes(count);
+    std::vector<int> proxies(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        boxes[i] = RandomBox(rng, 100.0f, 3.0f);
+        proxies[i] = bvh.CreateProxy(boxes[i], i);
+    }
+    assert(bvh.Validate() && "Tree invalid after inserts");
+    assert(bvh.GetProxyCount() == count && "Wrong proxy count");
+    assert(bvh.GetHeight() <= 2 * 11 && "Tree is not balanced");
+
+    // Box query must report a superset of the exact overlaps (fat boxes are conservative)
+    BoundingBox query(glm::vec3(-20.0f), glm::vec3(25.0f));
+    std::vector<uint8_t> reported(count, 0);
+    bvh.QueryAABB(query, [&](uint32_t id) { reported[id] = 1; return true; });
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (boxes[i].Intersects(query))
+            assert(reported[i] && "QueryAABB missed an overlapping proxy");
+        if (reported[i])
+            assert(bvh.GetFatBounds(proxies[i]).Intersects(query) && "QueryAABB reported a non-overlapping proxy");
+    }
+
+    // Sphere query
+    std::fill(reported.begin(), reported.end(), uint8_t(0));
+    glm::vec3 center(10.0f, -5.0f, 3.0f);
+    float radius = 30.0f;
+    bvh.QuerySphere(center, radius, [&](uint32_t id) { reported[id] = 1; return true; });
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        glm::vec3 closest = glm::clamp(center, boxes[i].min, boxes[i].max);
+        if (glm::length(closest - center) <= radius)
+            assert(reported[i] && "QuerySphere missed an overlapping proxy");
+    }
+
+    // Frustum query
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 80.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum(projection * view);
+    std::fill(reported.begin(), reported.end(), uint8_t(0));
+    bvh.QueryFrustum(frustum, [&](uint32_t id) { reported[id] = 1; return true; });
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (frustum.TestAABB(boxes[i]))
+            assert(reported[i] && "QueryFrustum missed a visible proxy");
+    }
+
+    // Raycast: nearest exact hit must match brute force
+    glm::vec3 origin(-150.0f, 1.0f, 2.0f);
+    glm::vec3 direction(1.0f, 0.01f, -0.02f);
+    glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    float bruteDistance = std::numeric_limits<float>::max();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        float d;
+        if (RayIntersectsBox(origin, inverseDirection, boxes[i], 1000.0f, d))
+            bruteDistance = std::min(bruteDistance, d);
+    }
+    float bvhDistance = std::numeric_limits<float>::max();
+    bvh.Raycast(origin, direction, 1000.0f, [&](uint32_t id, float maxDistance)
+    {
+        float d;
+        if (RayIntersectsBox(origin, inverseDirection, boxes[id], maxDistance, d))
+        {
+            bvhDistance = std::min(bvhDistance, d);
+            return d;
+        }
+        return maxDistance;
+    });
+    assert(bvhDistance == bruteDistance && "Raycast did not find the nearest hit");
+
+    // Small moves stay inside the fat box, large moves reinsert
+    BoundingBox nudged(boxes[0].min + glm::vec3(0.1f), boxes[0].max + glm::vec3(0.1f));
+    bool reinserted = bvh.MoveProxy(proxies[0], nudged);
+    assert(!reinserted && "Small move should not reinsert");
+    BoundingBox moved(boxes[0].min + glm::vec3(50.0f), boxes[0].max + glm::vec3(50.0f));
+    reinserted = bvh.MoveProxy(proxies[0], moved);
+    assert(reinserted && "Large move should reinsert");
+    assert(bvh.Validate() && "Tree invalid after moves");
+
+    // Remove half
+    for (uint32_t i = 0; i < count; i += 2)
+    {
+        bvh.DestroyProxy(proxies[i]);
+    }
+    assert(bvh.Validate() && "Tree invalid after removals");
+    assert(bvh.GetProxyCount() == count / 2 && "Wrong proxy count after removals");
+
+    // Freed nodes are reused
+    size_t poolSize = bvh.m_nodes.size();
+    bvh.CreateProxy(boxes[0], 0);
+    assert(bvh.m_nodes.size() == poolSize && bvh.Validate() && "Reinsert after removal failed");
+
+    bvh.Clear();
+    assert(bvh.Validate() && bvh.GetProxyCount() == 0 && "Clear failed");
+
+    // A leaf far from everything becomes the root's sibling, deeper than one rotation can fix
+    for (uint32_t i = 0; i < 9; ++i)
+    {
+        glm::vec3 center(static_cast<float>(i) * 10.0f, 0.0f, 0.0f);
+        bvh.CreateProxy(BoundingBox(center - glm::vec3(1.0f), center + glm::vec3(1.0f)), i);
+    }
+    bvh.CreateProxy(BoundingBox(glm::vec3(299.0f, -1.0f, -1.0f), glm::vec3(301.0f, 1.0f, 1.0f)), 9);
+    assert(bvh.Validate() && bvh.GetProxyCount() == 10 && "A distant leaf should leave a valid tree");
+    bvh.Clear();
+
+    std::cout << "[DynamicBvh] Tests passed!\n";
+}
+
+void DynamicBvh::benchmark()
+{
+    std::cout << "\nRunning DynamicBvh benchmarks...\n";
+
+    using Clock = std::chrono::high_resolution_clock;
+    auto elapsedMs = [](Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum(projection * view);
+
+    for (uint32_t count : { 100000u, 1000000u })
+    {
+        std::mt19937 rng(99);
+        std::vector<BoundingBox> boxes(count);
+        for (auto& box : boxes)
+            box = RandomBox(rng, 1000.0f, 2.0f);
+
+        DynamicBvh bvh(0.25f);
+        std::vector<int> proxies(count);
+
+        auto start = Clock::now();
+        for (uint32_t i = 0; i < count; ++i)
+            proxies[i] = bvh.CreateProxy(boxes[i], i);
+        double buildMs = elapsedMs(start);
+
+        // Move 10% of the objects: half jitter within the margin, half jump
+        std::uniform_real_distribution<float> jitter(-0.2f, 0.2f);
+        std::uniform_real_distribution<float> jump(-20.0f, 20.0f);
+        size_t reinserted = 0;
+        start = Clock::now();
+        for (uint32_t i = 0; i < count; i += 10)
+        {
+            glm::vec3 offset = (i % 20 == 0) ? glm::vec3(jitter(rng), jitter(rng), jitter(rng))
+                                             : glm::vec3(jump(rng), jump(rng), jump(rng));
+            boxes[i] = BoundingBox(boxes[i].min + offset, boxes[i].max + offset);
+            reinserted += bvh.MoveProxy(proxies[i], boxes[i]) ? 1 : 0;
+        }
+        double moveMs = elapsedMs(start);
+
+        size_t visible = 0;
+        start = Clock::now();
+        bvh.QueryFrustum(frustum, [&](uint32_t) { ++visible; return true; });
+        double frustumMs = elapsedMs(start);
+
+        size_t overlaps = 0;
+        std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+        start = Clock::now();
+        const int boxQueries = 1000;
+        for (int q = 0; q < boxQueries; ++q)
+        {
+            glm::vec3 c(position(rng), position(rng), position(rng));
+            bvh.QueryAABB(BoundingBox(c - glm::vec3(10.0f), c + glm::vec3(10.0f)), [&](uint32_t) { ++overlaps; return true; });
+        }
+        double boxQueryUs = elapsedMs(start) * 1000.0 / boxQueries;
+
+        std::cout << "  " << count << " objects: build " << buildMs << " ms, move 10% " << moveMs << " ms ("
+                  << reinserted << " reinserted), frustum query " << frustumMs << " ms (" << visible
+                  << " visible), box query " << boxQueryUs << " us avg, height " << bvh.GetHeight()
+                  << ", area ratio " << bvh.GetAreaRatio() << "\n";
+    }
+}
@@ -0,0 +1,411 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "BoundingBox.h"
+#include "Frustum.h"
+
+/**
+ * \class DynamicBvh
+ * \brief A dynamic bounding volume hierarchy over axis-aligned boxes.
+ *
+ * Each proxy is a leaf holding a "fat" box: the real bounds grown by a margin, so that
+ * small movements do not touch the tree at all. When a proxy escapes its fat box it is
+ * removed and reinserted. Insertion picks a sibling by surface-area cost and both
+ * insertion and removal rebalance the ancestors with AVL-style rotations, so insert,
+ * remove and move are O(log N).
+ *
+ * Queries report the 32-bit user data of every leaf whose fat box passes the test;
+ * callers refine against their exact bounds if they need to.
+ */
+class DynamicBvh
+{
+public:
+    /// Index of a missing node.
+    static constexpr int NULL_NODE = -1;
+
+    /**
+     * \brief Constructor.
+     * \param margin Distance by which proxy boxes are fattened on every side.
+     */
+    explicit DynamicBvh(float margin = 0.1f);
+
+    /**
+     * \brief Insert a proxy.
+     * \param box Exact bounds of the object.
+     * \param userData Value reported by queries for this proxy.
+     * \return Proxy id.
+     */
+    int CreateProxy(const BoundingBox& box, uint32_t userData);
+
+    /**
+     * \brief Remove a proxy.
+     * \param proxyId Id returned by CreateProxy().
+     */
+    void DestroyProxy(int proxyId);
+
+    /**
+     * \brief Update the bounds of a proxy.
+     * \param proxyId Id returned by CreateProxy().
+     * \param box New exact bounds of the object.
+     * \return True if the proxy left its fat box and was reinserted.
+     */
+    bool MoveProxy(int proxyId, const BoundingBox& box);
+
+    /**
+     * \brief Get the user data of a proxy.
+     * \param proxyId Proxy id.
+     * \return User data.
+     */
+    uint32_t GetUserData(int proxyId) const { return m_nodes[proxyId].userData; }
+
+    /**
+     * \brief Change the user data of a proxy, e.g. after the object it refers to moved in memory.
+     * \param proxyId Proxy id.
+     * \param userData New user data.
+     */
+    void SetUserData(int proxyId, uint32_t userData) { m_nodes[proxyId].userData = userData; }
+
+    /**
+     * \brief Get the fattened bounds stored for a proxy.
+     * \param proxyId Proxy id.
+     * \return Fat box.
+     */
+    const BoundingBox& GetFatBounds(int proxyId) const { return m_nodes[proxyId].box; }
+
+    /**
+     * \brief Remove all proxies.
+     */
+    void Clear();
+
+    /**
+     * \brief Get the number of proxies.
+     * \return Proxy count.
+     */
+    size_t GetProxyCount() const { return m_proxyCount; }
+
+    /**
+     * \brief Get the height of the tree (0 for a single leaf, -1 when empty).
+     * \return Tree height.
+     */
+    int GetHeight() const { return m_root == NULL_NODE ? -1 : m_nodes[m_root].height; }
+
+    /**
+     * \brief Get the ratio of the summed surface area of all nodes to the root's area.
+     *
+     * Lower is better; it approximates the expected number of nodes a query visits.
+     *
+     * \return Area ratio, 0 when empty.
+     */
+    float GetAreaRatio() const;
+
+    /**
+     * \brief Check the structural invariants of the tree.
+     * \return True if parent links, heights, boxes and counts are all consistent.
+     */
+    bool Validate() const;
+
+    /**
+     * \brief Report every proxy whose fat box overlaps a box.
+     * \param box Query box.
+     * \param callback Called as bool(uint32_t userData); return false to stop.
+     */
+    template <typename Callback>
+    void QueryAABB(const BoundingBox& box, Callback&& callback) const;
+
+    /**
+     * \brief Report every proxy whose fat box overlaps a sphere.
+     * \param center Sphere center.
+     * \param radius Sphere radius.
+     * \param callback Called as bool(uint32_t userData); return false to stop.
+     */
+    template <typename Callback>
+    void QuerySphere(const glm::vec3& center, float radius, Callback&& callback) const;
+
+    /**
+     * \brief Report every proxy whose fat box intersects a frustum.
+     *
+     * Subtrees that are fully inside the frustum are reported without further plane tests.
+     *
+     * \param frustum The frustum.
+     * \param callback Called as bool(uint32_t userData); return false to stop.
+     */
+    template <typename Callback>
+    void QueryFrustum(const Frustum& frustum, Callback&& callback) const;
+
+    /**
+     * \brief Report proxies whose fat box is hit by a ray, nearest subtrees first.
+     *
+     * The callback performs the exact test and returns the new maximum distance: the hit
+     * distance to clip the ray, the passed-in maximum to ignore the proxy, or 0 to stop.
+     *
+     * \param origin Ray origin.
+     * \param direction Ray direction (need not be normalized; distances are in its units).
+     * \param maxDistance Maximum ray parameter.
+     * \param callback Called as float(uint32_t userData, float maxDistance).
+     */
+    template <typename Callback>
+    void Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) const;
+
+    /**
+     * \brief Intersect a ray with a box using the slab method.
+     * \param origin Ray origin.
+     * \param inverseDirection Component-wise reciprocal of the ray direction.
+     * \param box The box.
+     * \param maxDistance Maximum ray parameter.
+     * \param distance Output entry distance (0 if the origin is inside).
+     * \return True if the ray hits the box within [0, maxDistance].
+     */
+    static bool RayIntersectsBox(const glm::vec3& origin, const glm::vec3& inverseDirection,
+                                 const BoundingBox& box, float maxDistance, float& distance);
+
+    /**
+     * \brief Run unit tests for the DynamicBvh class.
+     */
+    static void test();
+
+    /**
+     * \brief Run performance benchmarks for the DynamicBvh class.
+     */
+    static void benchmark();
+
+private:
+    /**
+     * \struct Node
+     * \brief A tree node. Leaves have child1 == NULL_NODE.
+     */
+    struct Node
+    {
+        BoundingBox box;            ///< Fat box (leaves) or union of children
+        int parent = NULL_NODE;     ///< Parent node, or next free node while on the free list
+        int child1 = NULL_NODE;     ///< First child
+        int child2 = NULL_NODE;     ///< Second child
+        int height = -1;            ///< 0 for leaves, -1 for free nodes
+        uint32_t userData = 0;      ///< Caller data (leaves only)
+
+        bool IsLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    /**
+     * \class TraversalStack
+     * \brief Fixed-size node stack that only allocates for degenerate trees.
+     */
+    class TraversalStack
+    {
+    public:
+        void Push(int node)
+        {
+            if (m_size < m_fixed.size())
+                m_fixed[m_size] = node;
+            else
+                m_overflow.push_back(node);
+            ++m_size;
+        }
+
+        int Pop()
+        {
+            --m_size;
+            if (m_size < m_fixed.size())
+                return m_fixed[m_size];
+            int node = m_overflow.back();
+            m_overflow.pop_back();
+            return node;
+        }
+
+        bool Empty() const { return m_size == 0; }
+
+    private:
+        std::array<int, 128> m_fixed;   ///< Inline storage
+        std::vector<int> m_overflow;    ///< Storage past the inline capacity
+        size_t m_size = 0;              ///< Number of entries
+    };
+
+    int AllocateNode();
+    void FreeNode(int node);
+    void InsertLeaf(int leaf);
+    void RemoveLeaf(int leaf);
+
+    /**
+     * \brief Rotate node A up or down if its subtrees differ in height by more than one.
+     * \param iA Node to balance.
+     * \return The node now at A's position.
+     */
+    int Balance(int iA);
+
+    /**
+     * \brief Recompute height and box of a node and its ancestors, rebalancing on the way.
+     * \param node First node to fix.
+     */
+    void FixUpwards(int node);
+
+    /**
+     * \brief Recursively validate a subtree.
+     * \return Number of leaves in the subtree, or -1 if it is inconsistent.
+     */
+    int ValidateSubtree(int node, int parent) const;
+
+    static float SurfaceArea(const BoundingBox& box);
+    static BoundingBox Union(const BoundingBox& a, const BoundingBox& b);
+    static bool Contains(const BoundingBox& outer, const BoundingBox& inner);
+
+    std::vector<Node> m_nodes;      ///< Node pool
+    int m_root = NULL_NODE;         ///< Root node
+    int m_freeList = NULL_NODE;     ///< First free node
+    size_t m_proxyCount = 0;        ///< Number of leaves
+    float m_margin;                 ///< Fat box margin
+};
+
+template <typename Callback>
+void DynamicBvh::QueryAABB(const BoundingBox& box, Callback&& callback) const
+{
+    if (m_root == NULL_NODE)
+        return;
+
+    TraversalStack stack;
+    stack.Push(m_root);
+    while (!stack.Empty())
+    {
+        const Node& node = m_nodes[stack.Pop()];
+        if (!node.box.Intersects(box))
+            continue;
+
+        if (node.IsLeaf())
+        {
+            if (!callback(node.userData))
+                return;
+        }
+        else
+        {
+            stack.Push(node.child1);
+            stack.Push(node.child2);
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicBvh::QuerySphere(const glm::vec3& center, float radius, Callback&& callback) const
+{
+    if (m_root == NULL_NODE)
+        return;
+
+    const float radiusSquared = radius * radius;
+    TraversalStack stack;
+    stack.Push(m_root);
+    while (!stack.Empty())
+    {
+        const Node& node = m_nodes[stack.Pop()];
+        glm::vec3 closest = glm::clamp(center, node.box.min, node.box.max);
+        glm::vec3 offset = closest - center;
+        if (glm::dot(offset, offset) > radiusSquared)
+            continue;
+
+        if (node.IsLeaf())
+        {
+            if (!callback(node.userData))
+                return;
+        }
+        else
+        {
+            stack.Push(node.child1);
+            stack.Push(node.child2);
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicBvh::QueryFrustum(const Frustum& frustum, Callback&& callback) const
+{
+    if (m_root == NULL_NODE)
+        return;
+
+    // Stack entries carry an "already fully inside" bit so inner subtrees skip plane tests
+    TraversalStack stack;
+    stack.Push(m_root << 1);
+    while (!stack.Empty())
+    {
+        int entry = stack.Pop();
+        const Node& node = m_nodes[entry >> 1];
+        bool inside = (entry & 1) != 0;
+
+        if (!inside)
+        {
+            Frustum::Containment containment = frustum.Classify(node.box);
+            if (containment == Frustum::OUTSIDE)
+                continue;
+            inside = containment == Frustum::INSIDE;
+        }
+
+        if (node.IsLeaf())
+        {
+            if (!callback(node.userData))
+                return;
+        }
+        else
+        {
+            stack.Push((node.child1 << 1) | (inside ? 1 : 0));
+            stack.Push((node.child2 << 1) | (inside ? 1 : 0));
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicBvh::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) const
+{
+    if (m_root == NULL_NODE)
+        return;
+
+    const float inf = std::numeric_limits<float>::infinity();
+    glm::vec3 inverseDirection(direction.x != 0.0f ? 1.0f / direction.x : inf,
+                               direction.y != 0.0f ? 1.0f / direction.y : inf,
+                               direction.z != 0.0f ? 1.0f / direction.z : inf);
+
+    TraversalStack stack;
+    stack.Push(m_root);
+    while (!stack.Empty())
+    {
+        const Node& node = m_nodes[stack.Pop()];
+        float entry = 0.0f;
+        if (!RayIntersectsBox(origin, inverseDirection, node.box, maxDistance, entry))
+            continue;
+
+        if (node.IsLeaf())
+        {
+            float result = callback(node.userData, maxDistance);
+            if (result <= 0.0f)
+                return;
+            maxDistance = std::min(maxDistance, result);
+            continue;
+        }
+
+        // Visit the nearer child first so the ray gets clipped early
+        float entry1 = inf, entry2 = inf;
+        bool hit1 = RayIntersectsBox(origin, inverseDirection, m_nodes[node.child1].box, maxDistance, entry1);
+        bool hit2 = RayIntersectsBox(origin, inverseDirection, m_nodes[node.child2].box, maxDistance, entry2);
+        if (hit1 && hit2)
+        {
+            if (entry1 <= entry2)
+            {
+                stack.Push(node.child2);
+                stack.Push(node.child1);
+            }
+            else
+            {
+                stack.Push(node.child1);
+                stack.Push(node.child2);
+            }
+        }
+        else if (hit1)
+        {
+            stack.Push(node.child1);
+        }
+        else if (hit2)
+        {
+            stack.Push(node.child2);
+        }
+    }
+}
@@ -0,0 +1,118 @@
+#include "FrameClock.h"
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+// Sleeps are trusted up to this close to the deadline; the rest is yielded away
+constexpr auto SLEEP_SLACK = std::chrono::milliseconds(1);
+
+} // namespace
+
+FrameClock::FrameClock(double fixedTimestep, double maxFrameTime)
+    : m_fixedTimestep(fixedTimestep)
+    , m_maxFrameTime(maxFrameTime)
+    , m_accumulator(0.0)
+    , m_clampedFrames(0)
+{
+    assert(fixedTimestep > 0.0 && "FrameClock: fixed timestep must be positive");
+}
+
+int FrameClock::Advance(double frameTime)
+{
+    if (frameTime > m_maxFrameTime)
+    {
+        frameTime = m_maxFrameTime;
+        ++m_clampedFrames;
+    }
+    m_accumulator += std::max(frameTime, 0.0);
+
+    int steps = 0;
+    while (m_accumulator >= m_fixedTimestep)
+    {
+        m_accumulator -= m_fixedTimestep;
+        ++steps;
+    }
+    return steps;
+}
+
+void FrameClock::SetFixedTimestep(double seconds)
+{
+    assert(seconds > 0.0 && "FrameClock: fixed timestep must be positive");
+    // Keep the interpolation factor where it was
+    m_accumulator = GetAlpha() * seconds;
+    m_fixedTimestep = seconds;
+}
+
+void FrameClock::SleepUntil(Clock::time_point deadline)
+{
+    auto now = Clock::now();
+    if (deadline - now > SLEEP_SLACK)
+        std::this_thread::sleep_until(deadline - SLEEP_SLACK);
+    while (Clock::now() < deadline)
+    {
+        std::this_thread::yield();
+    }
+}
+
+void FrameClock::test()
+{
+    std::cout << "[FrameClock] Running tests...\n";
+
+    // Test whole steps and the leftover fraction
+    {
+        FrameClock clock(0.01, 0.25);
+        int steps = clock.Advance(0.005);
+        assert(steps == 0 && std::abs(clock.GetAlpha() - 0.5) < 1e-9 && "Half a step should not simulate");
+        steps = clock.Advance(0.03);
+        assert(steps == 3 && std::abs(clock.GetAlpha() - 0.5) < 1e-9 && "Leftover time should carry over");
+        steps = clock.Advance(0.0) + clock.Advance(-1.0);
+        assert(steps == 0 && "Zero or negative frame time should not simulate");
+    }
+
+    // Test that simulated time tracks real time for irregular frames
+    {
+        FrameClock clock(1.0 / 60.0, 0.25);
+        double elapsed = 0.0;
+        int steps = 0;
+        for (int frame = 0; frame < 1000; ++frame)
+        {
+            double frameTime = 0.004 + 0.003 * static_cast<double>(frame % 7);
+            elapsed += frameTime;
+            steps += clock.Advance(frameTime);
+        }
+        double simulated = steps * clock.GetFixedTimestep() + clock.GetAlpha() * clock.GetFixedTimestep();
+        assert(std::abs(simulated - elapsed) < 1e-6 && "Simulated time should match elapsed time");
+        assert(clock.GetAlpha() >= 0.0 && clock.GetAlpha() < 1.0 && "Alpha should be a fraction of a step");
+    }
+
+    // Test the spike clamp
+    {
+        FrameClock clock(0.01, 0.1);
+        int steps = clock.Advance(5.0);
+        assert(steps == 10 && clock.GetClampedFrames() == 1 && "Spikes should be clamped");
+        steps = clock.Advance(0.05);
+        assert(steps == 5 && clock.GetClampedFrames() == 1 && "Normal frames should not be clamped");
+    }
+
+    // Test changing the step
+    {
+        FrameClock clock(0.01, 0.25);
+        clock.Advance(0.0025);
+        clock.SetFixedTimestep(0.02);
+        assert(std::abs(clock.GetAlpha() - 0.25) < 1e-9 && "Alpha should survive a step change");
+    }
+
+    // Test sleeping until a deadline
+    {
+        auto deadline = Clock::now() + std::chrono::milliseconds(5);
+        SleepUntil(deadline);
+        assert(Clock::now() >= deadline && "SleepUntil should not return early");
+        SleepUntil(Clock::now() - std::chrono::milliseconds(1));
+    }
+
+    std::cout << "[FrameClock] Tests passed!\n";
+}
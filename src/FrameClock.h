@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/**
+ * \class FrameClock
+ * \brief Fixed-timestep accumulator and frame limiter for the main loop.
+ *
+ * Each frame, the measured frame time is clamped (so a breakpoint, a window drag or a
+ * hitch does not trigger a long burst of catch-up steps) and added to an accumulator.
+ * The simulation then runs in whole fixed steps, and rendering interpolates between
+ * the last two simulation states using the leftover fraction returned by GetAlpha().
+ */
+class FrameClock
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * \brief Constructor.
+     * \param fixedTimestep Simulation step in seconds.
+     * \param maxFrameTime Longest frame time fed to the accumulator, in seconds.
+     */
+    explicit FrameClock(double fixedTimestep = 1.0 / 60.0, double maxFrameTime = 0.25);
+
+    /**
+     * \brief Add a frame's elapsed time and consume it in fixed steps.
+     * \param frameTime Seconds since the previous frame; clamped to [0, max frame time].
+     * \return Number of fixed steps to simulate this frame.
+     */
+    int Advance(double frameTime);
+
+    /**
+     * \brief Get the interpolation factor between the previous and current simulation state.
+     * \return Accumulated time not yet simulated, as a fraction of a step in [0, 1).
+     */
+    double GetAlpha() const { return m_accumulator / m_fixedTimestep; }
+
+    /**
+     * \brief Set the simulation step.
+     * \param seconds Step in seconds, greater than zero.
+     */
+    void SetFixedTimestep(double seconds);
+
+    /**
+     * \brief Get the simulation step.
+     * \return Step in seconds.
+     */
+    double GetFixedTimestep() const { return m_fixedTimestep; }
+
+    /**
+     * \brief Set the spike clamp.
+     * \param seconds Longest frame time fed to the accumulator.
+     */
+    void SetMaxFrameTime(double seconds) { m_maxFrameTime = seconds; }
+
+    /**
+     * \brief Get the spike clamp.
+     * \return Longest frame time fed to the accumulator, in seconds.
+     */
+    double GetMaxFrameTime() const { return m_maxFrameTime; }
+
+    /**
+     * \brief Get the number of frames whose time was clamped.
+     * \return Clamped frame count.
+     */
+    uint64_t GetClampedFrames() const { return m_clampedFrames; }
+
+    /**
+     * \brief Block until a point in time without busy-spinning for most of the wait.
+     *
+     * Sleeps until shortly before the deadline, as sleeps may overshoot by the scheduler
+     * granularity, then yields for the remainder.
+     *
+     * \param deadline Time to wait for.
+     */
+    static void SleepUntil(Clock::time_point deadline);
+
+    /**
+     * \brief Run unit tests for the FrameClock class.
+     */
+    static void test();
+
+private:
+    double m_fixedTimestep;     ///< Simulation step in seconds
+    double m_maxFrameTime;      ///< Spike clamp in seconds
+    double m_accumulator;       ///< Time not yet simulated
+    uint64_t m_clampedFrames;   ///< Frames longer than m_maxFrameTime
+};
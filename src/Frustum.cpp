@@ -0,0 +1,307 @@
+#include "Frustum.h"
+#include "ThreadPool.h"
+#include "Simd.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <atomic>
+#include <glm/gtc/matrix_transform.hpp>
+
+Frustum::Frustum()
+{
+    // Planes that everything is in front of
+    for (auto& plane : m_planes)
+    {
+        plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+    Update(viewProjection);
+}
+
+void Frustum::Update(const glm::mat4& viewProjection)
+{
+    // glm is column-major: row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+    const glm::mat4& m = viewProjection;
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    m_planes[LEFT_PLANE]   = row3 + row0;
+    m_planes[RIGHT_PLANE]  = row3 - row0;
+    m_planes[BOTTOM_PLANE] = row3 + row1;
+    m_planes[TOP_PLANE]    = row3 - row1;
+    m_planes[NEAR_PLANE]   = row3 + row2;   // OpenGL clip space: -w <= z <= w
+    m_planes[FAR_PLANE]    = row3 - row2;
+
+    for (auto& plane : m_planes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f)
+        {
+            plane /= length;
+        }
+    }
+}
+
+bool Frustum::TestSphere(const glm::vec3& center, float radius) const
+{
+    for (const auto& plane : m_planes)
+    {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    }
+    return true;
+}
+
+bool Frustum::TestAABB(const BoundingBox& box) const
+{
+    if (!box.IsValid())
+        return false;
+
+    for (const auto& plane : m_planes)
+    {
+        // Test the corner furthest along the plane normal
+        glm::vec3 positive(plane.x >= 0.0f ? box.max.x : box.min.x,
+                           plane.y >= 0.0f ? box.max.y : box.min.y,
+                           plane.z >= 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+Frustum::Containment Frustum::Classify(const BoundingBox& box) const
+{
+    if (!box.IsValid())
+        return OUTSIDE;
+
+    Containment result = INSIDE;
+    glm::vec3 center = box.GetCenter();
+    glm::vec3 extents = box.GetExtents();
+    for (const auto& plane : m_planes)
+    {
+        glm::vec3 normal(plane);
+        float distance = glm::dot(normal, center) + plane.w;
+        float reach = glm::dot(glm::abs(normal), extents);
+        if (distance < -reach)
+            return OUTSIDE;
+        if (distance < reach)
+            result = INTERSECTS;
+    }
+    return result;
+}
+
+size_t Frustum::CullSpheres(const float* x, const float* y, const float* z, const float* radius,
+                            size_t count, uint8_t* visible, ThreadPool* pool) const
+{
+    if (pool == nullptr || count < 2 * PARALLEL_BATCH_SIZE)
+    {
+        return CullSpheresRange(x, y, z, radius, 0, count, visible);
+    }
+
+    std::atomic<size_t> visibleCount{0};
+    pool->ParallelFor(count, PARALLEL_BATCH_SIZE, [&](size_t begin, size_t end, size_t)
+    {
+        visibleCount.fetch_add(CullSpheresRange(x, y, z, radius, begin, end, visible), std::memory_order_relaxed);
+    });
+    return visibleCount.load();
+}
+
+size_t Frustum::CullSpheresScalar(const float* x, const float* y, const float* z, const float* radius,
+                                  size_t begin, size_t end, uint8_t* visible) const
+{
+    size_t visibleCount = 0;
+    for (size_t i = begin; i < end; ++i)
+    {
+        bool inside = TestSphere(glm::vec3(x[i], y[i], z[i]), radius[i]);
+        visible[i] = inside ? 1 : 0;
+        visibleCount += inside ? 1 : 0;
+    }
+    return visibleCount;
+}
+
+size_t Frustum::CullSpheresRange(const float* x, const float* y, const float* z, const float* radius,
+                                 size_t begin, size_t end, uint8_t* visible) const
+{
+    size_t visibleCount = 0;
+    size_t i = begin;
+
+#if defined(SNAPENGINE_AVX)
+    __m256 px[PLANE_COUNT], py[PLANE_COUNT], pz[PLANE_COUNT], pw[PLANE_COUNT];
+    for (int p = 0; p < PLANE_COUNT; ++p)
+    {
+        px[p] = _mm256_set1_ps(m_planes[p].x);
+        py[p] = _mm256_set1_ps(m_planes[p].y);
+        pz[p] = _mm256_set1_ps(m_planes[p].z);
+        pw[p] = _mm256_set1_ps(m_planes[p].w);
+    }
+
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 cx = _mm256_loadu_ps(x + i);
+        __m256 cy = _mm256_loadu_ps(y + i);
+        __m256 cz = _mm256_loadu_ps(z + i);
+        __m256 negR = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i));
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < PLANE_COUNT; ++p)
+        {
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], cx), _mm256_mul_ps(py[p], cy)),
+                                     _mm256_add_ps(_mm256_mul_ps(pz[p], cz), pw[p]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (int lane = 0; lane < 8; ++lane)
+        {
+            uint8_t bit = static_cast<uint8_t>((mask >> lane) & 1);
+            visible[i + lane] = bit;
+            visibleCount += bit;
+        }
+    }
+#elif defined(SNAPENGINE_SSE)
+    __m128 px[PLANE_COUNT], py[PLANE_COUNT], pz[PLANE_COUNT], pw[PLANE_COUNT];
+    for (int p = 0; p < PLANE_COUNT; ++p)
+    {
+        px[p] = _mm_set1_ps(m_planes[p].x);
+        py[p] = _mm_set1_ps(m_planes[p].y);
+        pz[p] = _mm_set1_ps(m_planes[p].z);
+        pw[p] = _mm_set1_ps(m_planes[p].w);
+    }
+
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(x + i);
+        __m128 cy = _mm_loadu_ps(y + i);
+        __m128 cz = _mm_loadu_ps(z + i);
+        __m128 negR = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < PLANE_COUNT; ++p)
+        {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], cx), _mm_mul_ps(py[p], cy)),
+                                  _mm_add_ps(_mm_mul_ps(pz[p], cz), pw[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        visible[i + 0] = static_cast<uint8_t>(mask & 1);
+        visible[i + 1] = static_cast<uint8_t>((mask >> 1) & 1);
+        visible[i + 2] = static_cast<uint8_t>((mask >> 2) & 1);
+        visible[i + 3] = static_cast<uint8_t>((mask >> 3) & 1);
+        visibleCount += static_cast<size_t>((mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1));
+    }
+#endif
+
+    // Remainder (or everything, without SIMD)
+    visibleCount += CullSpheresScalar(x, y, z, radius, i, end, visible);
+    return visibleCount;
+}
+
+void Frustum::test()
+{
+    std::cout << "[Frustum] Running tests...\n";
+
+    // Camera at the origin looking down -z
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum(projection * view);
+
+    // Sphere tests
+    assert(frustum.TestSphere(glm::vec3(0.0f, 0.0f, -10.0f), 1.0f) && "Sphere in front should be visible");
+    assert(!frustum.TestSphere(glm::vec3(0.0f, 0.0f, 10.0f), 1.0f) && "Sphere behind should be culled");
+    assert(!frustum.TestSphere(glm::vec3(0.0f, 0.0f, -200.0f), 1.0f) && "Sphere past far plane should be culled");
+    assert(!frustum.TestSphere(glm::vec3(30.0f, 0.0f, -10.0f), 1.0f) && "Sphere to the right should be culled");
+    assert(frustum.TestSphere(glm::vec3(10.5f, 0.0f, -10.0f), 1.0f) && "Sphere straddling the side plane should be visible");
+
+    // Box tests
+    assert(frustum.TestAABB(BoundingBox(glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -4.0f))) && "Box in front should be visible");
+    assert(!frustum.TestAABB(BoundingBox(glm::vec3(-1.0f, -1.0f, 4.0f), glm::vec3(1.0f, 1.0f, 6.0f))) && "Box behind should be culled");
+    assert(!frustum.TestAABB(BoundingBox()) && "Empty box should be culled");
+    assert(frustum.Classify(BoundingBox(glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -4.0f))) == INSIDE && "Box should be inside");
+    assert(frustum.Classify(BoundingBox(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f))) == INTERSECTS && "Box around the eye should intersect");
+    assert(frustum.Classify(BoundingBox(glm::vec3(-1.0f, -1.0f, 4.0f), glm::vec3(1.0f, 1.0f, 6.0f))) == OUTSIDE && "Box behind should be outside");
+
+    // Default frustum contains everything
+    Frustum everything;
+    assert(everything.TestSphere(glm::vec3(1e6f), 0.0f) && "Default frustum should contain everything");
+
+    // Batched kernel (with odd count to exercise the scalar tail) must match the reference
+    const size_t count = 70003;
+    std::vector<float> xs(count), ys(count), zs(count), rs(count);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 5.0f);
+    for (size_t i = 0; i < count; ++i)
+    {
+        xs[i] = position(rng);
+        ys[i] = position(rng);
+        zs[i] = position(rng);
+        rs[i] = size(rng);
+    }
+
+    std::vector<uint8_t> batched(count), reference(count);
+    size_t expected = frustum.CullSpheresScalar(xs.data(), ys.data(), zs.data(), rs.data(), 0, count, reference.data());
+    size_t single = frustum.CullSpheres(xs.data(), ys.data(), zs.data(), rs.data(), count, batched.data());
+    assert(single == expected && "SIMD visible count mismatch");
+    assert(batched == reference && "SIMD visibility mismatch");
+
+    ThreadPool pool(3);
+    std::fill(batched.begin(), batched.end(), uint8_t(2));
+    size_t parallel = frustum.CullSpheres(xs.data(), ys.data(), zs.data(), rs.data(), count, batched.data(), &pool);
+    assert(parallel == expected && "Parallel visible count mismatch");
+    assert(batched == reference && "Parallel visibility mismatch");
+
+    std::cout << "[Frustum] Tests passed!\n";
+}
+
+void Frustum::benchmark()
+{
+    std::cout << "\nRunning Frustum benchmarks...\n";
+
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum(projection * view);
+    ThreadPool& pool = ThreadPool::Get();
+
+    using Clock = std::chrono::high_resolution_clock;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> size(0.5f, 4.0f);
+
+    std::cout << "  objects      scalar(ms)   simd(ms)   simd+" << pool.GetThreadCount() << "threads(ms)   visible\n";
+    for (size_t count = 1000; count <= 1000000; count *= 10)
+    {
+        std::vector<float> xs(count), ys(count), zs(count), rs(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            xs[i] = position(rng);
+            ys[i] = position(rng);
+            zs[i] = position(rng);
+            rs[i] = size(rng);
+        }
+        std::vector<uint8_t> visible(count);
+
+        const int iterations = count >= 100000 ? 10 : 100;
+        auto time = [&](auto&& body)
+        {
+            auto start = Clock::now();
+            for (int it = 0; it < iterations; ++it)
+                body();
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+        };
+
+        size_t visibleCount = 0;
+        double scalarMs = time([&] { visibleCount = frustum.CullSpheresScalar(xs.data(), ys.data(), zs.data(), rs.data(), 0, count, visible.data()); });
+        double simdMs = time([&] { frustum.CullSpheres(xs.data(), ys.data(), zs.data(), rs.data(), count, visible.data()); });
+        double parallelMs = time([&] { frustum.CullSpheres(xs.data(), ys.data(), zs.data(), rs.data(), count, visible.data(), &pool); });
+
+        std::cout << "  " << count << "\t" << scalarMs << "\t" << simdMs << "\t" << parallelMs << "\t" << visibleCount << "\n";
+    }
+}
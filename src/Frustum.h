@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "BoundingBox.h"
+
+class ThreadPool;
+
+/**
+ * \class Frustum
+ * \brief View frustum planes for visibility culling.
+ *
+ * Planes are extracted from a view-projection matrix (Gribb/Hartmann) and normalized,
+ * with normals pointing into the frustum. Besides single sphere and box tests, the class
+ * provides a batched kernel that tests bounding spheres stored as separate x/y/z/radius
+ * arrays, 4 (SSE) or 8 (AVX) spheres at a time, optionally split across a ThreadPool.
+ */
+class Frustum
+{
+public:
+    /**
+     * \brief Plane indices.
+     */
+    enum Plane
+    {
+        LEFT_PLANE = 0,
+        RIGHT_PLANE,
+        BOTTOM_PLANE,
+        TOP_PLANE,
+        NEAR_PLANE,
+        FAR_PLANE,
+        PLANE_COUNT
+    };
+
+    /**
+     * \brief Result of classifying a volume against the frustum.
+     */
+    enum Containment
+    {
+        OUTSIDE = 0,
+        INTERSECTS,
+        INSIDE
+    };
+
+    /**
+     * \brief Default constructor. Creates a frustum that contains everything.
+     */
+    Frustum();
+
+    /**
+     * \brief Constructor.
+     * \param viewProjection Combined projection * view matrix.
+     */
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    /**
+     * \brief Re-extract the planes from a view-projection matrix.
+     * \param viewProjection Combined projection * view matrix.
+     */
+    void Update(const glm::mat4& viewProjection);
+
+    /**
+     * \brief Get a plane as (normal.xyz, distance).
+     * \param plane Plane index.
+     * \return The plane.
+     */
+    const glm::vec4& GetPlane(Plane plane) const { return m_planes[plane]; }
+
+    /**
+     * \brief Test a sphere against the frustum.
+     * \param center Sphere center.
+     * \param radius Sphere radius.
+     * \return True if the sphere is at least partially inside.
+     */
+    bool TestSphere(const glm::vec3& center, float radius) const;
+
+    /**
+     * \brief Test an axis-aligned box against the frustum.
+     * \param box The box. Invalid (empty) boxes are reported as outside.
+     * \return True if the box is at least partially inside.
+     */
+    bool TestAABB(const BoundingBox& box) const;
+
+    /**
+     * \brief Classify an axis-aligned box against the frustum.
+     *
+     * Conservative like TestAABB(): boxes near frustum corners may be reported as
+     * INTERSECTS although they are outside.
+     *
+     * \param box The box. Invalid (empty) boxes are OUTSIDE.
+     * \return Whether the box is outside, straddling, or fully inside the frustum.
+     */
+    Containment Classify(const BoundingBox& box) const;
+
+    /**
+     * \brief Test a batch of spheres stored as separate component arrays.
+     * \param x Sphere center x coordinates.
+     * \param y Sphere center y coordinates.
+     * \param z Sphere center z coordinates.
+     * \param radius Sphere radii.
+     * \param count Number of spheres.
+     * \param visible Output, one byte per sphere: 1 if visible, 0 if culled.
+     * \param pool Optional pool to split large batches across. May be nullptr.
+     * \return Number of visible spheres.
+     */
+    size_t CullSpheres(const float* x, const float* y, const float* z, const float* radius,
+                       size_t count, uint8_t* visible, ThreadPool* pool = nullptr) const;
+
+    /**
+     * \brief Run unit tests for the Frustum class.
+     */
+    static void test();
+
+    /**
+     * \brief Run performance benchmarks for the Frustum class.
+     */
+    static void benchmark();
+
+    /// Batches smaller than this are never split across threads.
+    static constexpr size_t PARALLEL_BATCH_SIZE = 16384;
+
+private:
+    /**
+     * \brief Batched SIMD kernel over [begin, end).
+     * \return Number of visible spheres in the range.
+     */
+    size_t CullSpheresRange(const float* x, const float* y, const float* z, const float* radius,
+                            size_t begin, size_t end, uint8_t* visible) const;
+
+    /**
+     * \brief Scalar reference kernel over [begin, end).
+     * \return Number of visible spheres in the range.
+     */
+    size_t CullSpheresScalar(const float* x, const float* y, const float* z, const float* radius,
+                             size_t begin, size_t end, uint8_t* visible) const;
+
+    glm::vec4 m_planes[PLANE_COUNT];    ///< Normalized planes, normals pointing inward
+};
@@ -0,0 +1,439 @@
+#include "GlApi.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cassert>
+#include <cstdio>
+
+namespace {
+
+// File signature and format version of captures
+const char CAPTURE_MAGIC[8] = { 'S', 'N', 'A', 'P', 'G', 'L', 'C', '1' };
+constexpr uint32_t CAPTURE_VERSION = 1;
+
+// Where recorded calls currently go
+enum CapturePhase
+{
+    CAPTURE_SETUP,          // Before the first frame, or between frames
+    CAPTURE_SKIPPED_FRAME,  // Inside a frame before the captured one
+    CAPTURE_FRAME           // Inside the captured frame
+};
+
+std::mutex s_captureMutex;                  // Guards everything below
+GlCapture s_capture;                        // Capture being recorded
+GlCapture s_lastCapture;                    // Capture finished most recently
+std::string s_capturePath;                  // File the capture is written to
+uint64_t s_captureFrame = 0;                // Frames to skip before the captured one
+uint64_t s_captureFramesSeen = 0;           // Frames begun since BeginCapture()
+CapturePhase s_capturePhase = CAPTURE_SETUP;
+
+std::mutex s_statsMutex;                    // Guards the published counters
+GlFrameStats s_lastFrameStats;              // Counters of the last ended frame
+uint64_t s_framesEnded = 0;                 // Frames ended on any thread
+
+template <typename T>
+void WriteValue(std::ostream& stream, const T& value)
+{
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool ReadValue(std::istream& stream, T& value)
+{
+    return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+} // namespace
+
+// Initialize static members
+std::atomic<bool> GlApi::s_capturing{ false };
+uint64_t GlApi::s_logInterval = 0;
+GLuint GlApi::s_testNames = 0;
+bool GlApi::s_testMode = false;
+
+GlApi::Recorder::Recorder(Op op, bool lifetime)
+    : m_lock(s_captureMutex)
+    , m_stream(nullptr)
+{
+    // The capture may have finished between IsCapturing() and taking the lock
+    if (!s_capturing.load(std::memory_order_relaxed))
+        return;
+
+    if (s_capturePhase == CAPTURE_FRAME)
+        m_stream = &s_capture.frame;
+    else if (s_capturePhase == CAPTURE_SETUP || lifetime)
+        m_stream = &s_capture.setup;
+    Put(op);
+}
+
+void GlApi::BeginFrame()
+{
+    // Calls made between frames, e.g. while loading, are not part of the frame
+    t_stats = GlFrameStats();
+    if (!IsCapturing())
+        return;
+
+    std::lock_guard<std::mutex> lock(s_captureMutex);
+    s_capturePhase = s_captureFramesSeen == s_captureFrame ? CAPTURE_FRAME : CAPTURE_SKIPPED_FRAME;
+    ++s_captureFramesSeen;
+}
+
+void GlApi::EndFrame()
+{
+    GlFrameStats stats = t_stats;
+    t_stats = GlFrameStats();
+
+    uint64_t frame;
+    {
+        std::lock_guard<std::mutex> lock(s_statsMutex);
+        s_lastFrameStats = stats;
+        frame = ++s_framesEnded;
+    }
+    if (s_logInterval > 0 && frame % s_logInterval == 0)
+        std::cout << "[GL] frame " << frame << ": " << FormatStats(stats) << "\n";
+
+    if (!IsCapturing())
+        return;
+
+    std::unique_lock<std::mutex> lock(s_captureMutex);
+    if (s_capturePhase != CAPTURE_FRAME)
+    {
+        s_capturePhase = CAPTURE_SETUP;
+        return;
+    }
+
+    // The captured frame is complete
+    s_capturing = false;
+    s_capturePhase = CAPTURE_SETUP;
+    s_capture.width = t_state.viewportWidth;
+    s_capture.height = t_state.viewportHeight;
+    s_lastCapture = std::move(s_capture);
+    s_capture = GlCapture();
+    std::string path = s_capturePath;
+    lock.unlock();
+
+    if (!path.empty() && s_lastCapture.Write(path))
+    {
+        std::cout << "GL capture written to " << path << " (" << s_lastCapture.setup.size() << " setup bytes, "
+                  << s_lastCapture.frame.size() << " frame bytes)\n";
+    }
+}
+
+GlFrameStats GlApi::GetFrameStats()
+{
+    std::lock_guard<std::mutex> lock(s_statsMutex);
+    return s_lastFrameStats;
+}
+
+std::string GlApi::FormatStats(const GlFrameStats& stats)
+{
+    std::ostringstream line;
+    line << stats.calls << " calls, " << stats.drawCalls << " draws (" << stats.indices << " indices), "
+         << stats.stateChanges << " state changes (" << stats.redundantStateChanges << " redundant), "
+         << stats.uniformUploads << " uniform uploads, " << stats.uniformLookups << " uniform lookups, "
+         << stats.bytesUploaded << " bytes uploaded";
+    return line.str();
+}
+
+bool GlApi::BeginCapture(const std::string& path, uint64_t frame)
+{
+    std::lock_guard<std::mutex> lock(s_captureMutex);
+    if (s_capturing)
+        return false;
+
+    s_capture = GlCapture();
+    s_capturePath = path;
+    s_captureFrame = frame;
+    s_captureFramesSeen = 0;
+    s_capturePhase = CAPTURE_SETUP;
+    s_capturing = true;
+    return true;
+}
+
+void GlApi::CancelCapture()
+{
+    std::lock_guard<std::mutex> lock(s_captureMutex);
+    s_capturing = false;
+    s_capture = GlCapture();
+    s_capturePhase = CAPTURE_SETUP;
+}
+
+GlCapture GlApi::GetLastCapture()
+{
+    std::lock_guard<std::mutex> lock(s_captureMutex);
+    return s_lastCapture;
+}
+
+GLsizei GlApi::GetMipLevelCount(GLsizei width, GLsizei height)
+{
+    GLsizei levels = 1;
+    for (GLsizei size = std::max(width, height); size > 1; size /= 2)
+        ++levels;
+    return levels;
+}
+
+size_t GlApi::GetImageSize(GLsizei width, GLsizei height, GLenum format, GLenum type, GLint alignment)
+{
+    if (width <= 0 || height <= 0)
+        return 0;
+
+    size_t components = 4;
+    switch (format)
+    {
+    case GL_RED:
+    case GL_DEPTH_COMPONENT:
+        components = 1;
+        break;
+    case GL_RG:
+        components = 2;
+        break;
+    case GL_RGB:
+    case GL_BGR:
+        components = 3;
+        break;
+    default:
+        break;
+    }
+
+    size_t componentSize = 1;
+    switch (type)
+    {
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:
+        componentSize = 2;
+        break;
+    case GL_UNSIGNED_INT:
+    case GL_INT:
+    case GL_FLOAT:
+        componentSize = 4;
+        break;
+    default:
+        break;
+    }
+
+    size_t rowSize = static_cast<size_t>(width) * components * componentSize;
+    size_t align = static_cast<size_t>(std::max(alignment, 1));
+    size_t stride = (rowSize + align - 1) / align * align;
+    return stride * static_cast<size_t>(height - 1) + rowSize;
+}
+
+bool GlCapture::Write(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    file.write(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    WriteValue(file, CAPTURE_VERSION);
+    WriteValue(file, static_cast<int32_t>(width));
+    WriteValue(file, static_cast<int32_t>(height));
+    for (const std::vector<uint8_t>* stream : { &setup, &frame })
+    {
+        WriteValue(file, static_cast<uint64_t>(stream->size()));
+        file.write(reinterpret_cast<const char*>(stream->data()), static_cast<std::streamsize>(stream->size()));
+    }
+    return static_cast<bool>(file);
+}
+
+bool GlCapture::Read(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open capture " << path << std::endl;
+        return false;
+    }
+
+    char magic[sizeof(CAPTURE_MAGIC)];
+    uint32_t version = 0;
+    int32_t w = 0;
+    int32_t h = 0;
+    if (!file.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), CAPTURE_MAGIC) ||
+        !ReadValue(file, version) || version != CAPTURE_VERSION || !ReadValue(file, w) || !ReadValue(file, h))
+    {
+        std::cerr << "Not a GL capture: " << path << std::endl;
+        return false;
+    }
+
+    for (std::vector<uint8_t>* stream : { &setup, &frame })
+    {
+        uint64_t size = 0;
+        if (!ReadValue(file, size))
+        {
+            std::cerr << "Truncated GL capture: " << path << std::endl;
+            return false;
+        }
+        // Check the size against the file before allocating
+        std::streampos position = file.tellg();
+        file.seekg(0, std::ios::end);
+        uint64_t remaining = static_cast<uint64_t>(file.tellg() - position);
+        file.seekg(position);
+        if (size > remaining)
+        {
+            std::cerr << "Truncated GL capture: " << path << std::endl;
+            return false;
+        }
+        stream->resize(static_cast<size_t>(size));
+        file.read(reinterpret_cast<char*>(stream->data()), static_cast<std::streamsize>(size));
+    }
+    width = w;
+    height = h;
+    return static_cast<bool>(file);
+}
+
+void GlApi::test()
+{
+    std::cout << "[GlApi] Running tests...\n";
+
+    SetTestMode(true);
+    ResetStateCache();
+    EndFrame();
+
+    // Test counters
+    {
+        GLuint buffers[2];
+        GenBuffers(2, buffers);
+        assert(buffers[0] != 0 && buffers[1] != buffers[0] && "Test mode should hand out distinct names");
+        BindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+        BindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+        std::vector<float> vertices(30);
+        BufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.size() * sizeof(float)), vertices.data(), GL_STATIC_DRAW);
+        BufferData(GL_ELEMENT_ARRAY_BUFFER, 64, nullptr, GL_DYNAMIC_DRAW);
+        UseProgram(7);
+        UseProgram(7);
+        UseProgram(8);
+        ActiveTexture(GL_TEXTURE1);
+        BindTexture(GL_TEXTURE_2D, 3);
+        ActiveTexture(GL_TEXTURE0);
+        BindTexture(GL_TEXTURE_2D, 3);
+        ActiveTexture(GL_TEXTURE1);
+        BindTexture(GL_TEXTURE_2D, 3);
+        float matrix[16] = {};
+        UniformMatrix4fv(GetUniformLocation(8, "model"), 1, GL_FALSE, matrix);
+        DrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr);
+        DrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+
+        const GlFrameStats& stats = GetCurrentStats();
+        assert(stats.drawCalls == 2 && stats.indices == 42 && "Wrong draw counts");
+        assert(stats.stateChanges == 11 && "Wrong state change count");
+        // Second array buffer bind, second UseProgram(7), texture 3 rebound on unit 1
+        assert(stats.redundantStateChanges == 3 && "Wrong redundant state change count");
+        assert(stats.uniformUploads == 1 && stats.uniformLookups == 1 && "Wrong uniform counts");
+        assert(stats.bytesUploaded == 120 && "Only data actually passed should count as uploaded");
+        assert(stats.calls == 18 && "Every call should be counted");
+
+        EndFrame();
+        assert(GetCurrentStats().calls == 0 && "EndFrame should reset the counters");
+        assert(GetFrameStats().drawCalls == 2 && "EndFrame should publish the counters");
+        assert(FormatStats(GetFrameStats()).find("2 draws (42 indices)") != std::string::npos && "Wrong log line");
+    }
+
+    // Test image sizes with row padding
+    {
+        assert(GetImageSize(3, 2, GL_RGB, GL_UNSIGNED_BYTE, 4) == 12 + 9 && "Rows should be padded except the last");
+        assert(GetImageSize(3, 2, GL_RGB, GL_UNSIGNED_BYTE, 1) == 18 && "Tightly packed rows");
+        assert(GetImageSize(2, 2, GL_RGBA, GL_FLOAT, 4) == 64 && "Float components");
+        assert(GetImageSize(0, 4, GL_RGBA, GL_UNSIGNED_BYTE, 4) == 0 && "Empty image");
+        assert(GetMipLevelCount(256, 256) == 9 && GetMipLevelCount(300, 17) == 9 && GetMipLevelCount(1, 1) == 1 &&
+               "Mipmap chains should go down to 1x1");
+    }
+
+    // Test which calls end up in which stream
+    {
+        bool started = BeginCapture("", 1);
+        bool startedTwice = BeginCapture("", 1);
+        assert(started && "BeginCapture failed");
+        assert(!startedTwice && "Only one capture at a time");
+
+        GLuint vertexArray = 0;
+        GenVertexArrays(1, &vertexArray);               // setup
+        Enable(GL_DEPTH_TEST);                          // setup
+
+        BeginFrame();                                   // skipped frame 0
+        Clear(GL_COLOR_BUFFER_BIT);                     // dropped
+        GLuint texture = 0;
+        GenTextures(1, &texture);                       // lifetime op, kept in setup
+        VertexArrayAttribBinding(vertexArray, 0, 0);    // vertex array format, kept in setup
+        EndFrame();
+        assert(IsCapturing() && "Capture should wait for its frame");
+
+        BeginFrame();                                   // captured frame 1
+        Viewport(0, 0, 320, 200);
+        BindVertexArray(vertexArray);
+        DrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, nullptr);
+        EndFrame();
+        assert(!IsCapturing() && "Capture should end with its frame");
+
+        GlCapture capture = GetLastCapture();
+        assert(capture.width == 320 && capture.height == 200 && "Capture should store the viewport");
+
+        auto readOps = [](const std::vector<uint8_t>& stream, const std::vector<size_t>& argumentBytes)
+        {
+            std::vector<uint16_t> ops;
+            size_t offset = 0;
+            for (size_t bytes : argumentBytes)
+            {
+                uint16_t op;
+                std::memcpy(&op, stream.data() + offset, sizeof(op));
+                ops.push_back(op);
+                offset += sizeof(op) + bytes;
+            }
+            return offset == stream.size() ? ops : std::vector<uint16_t>();
+        };
+        // Gen records are count + blob (size + names)
+        std::vector<uint16_t> setupOps = readOps(capture.setup, { 4 + 8 + 4, 4, 4 + 8 + 4, 12 });
+        assert((setupOps == std::vector<uint16_t>{ OP_GEN_VERTEX_ARRAYS, OP_ENABLE, OP_GEN_TEXTURES, OP_VERTEX_ARRAY_ATTRIB_BINDING }) &&
+               "Wrong setup stream");
+        std::vector<uint16_t> frameOps = readOps(capture.frame, { 16, 4, 4 + 4 + 4 + 8 });
+        assert((frameOps == std::vector<uint16_t>{ OP_VIEWPORT, OP_BIND_VERTEX_ARRAY, OP_DRAW_ELEMENTS }) && "Wrong frame stream");
+
+        Clear(GL_COLOR_BUFFER_BIT);
+        assert(GetLastCapture().frame.size() == capture.frame.size() && "Nothing should be recorded after the capture");
+
+        BeginCapture("", 0);
+        Enable(GL_BLEND);
+        CancelCapture();
+        assert(!IsCapturing() && "CancelCapture should stop recording");
+    }
+
+    // Test capture files
+    {
+        GlCapture capture;
+        capture.width = 64;
+        capture.height = 32;
+        capture.setup = { 1, 2, 3 };
+        capture.frame = { 4, 5 };
+        std::string path = "gl_capture_test.glc";
+        bool written = capture.Write(path);
+        assert(written && "GlCapture::Write failed");
+
+        GlCapture loaded;
+        bool read = loaded.Read(path);
+        assert(read && "GlCapture::Read failed");
+        assert(loaded.width == 64 && loaded.height == 32 && loaded.setup == capture.setup && loaded.frame == capture.frame &&
+               "Capture should survive a round trip");
+
+        // Truncate the frame stream
+        {
+            std::ofstream truncated(path, std::ios::binary);
+            truncated.write(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+            WriteValue(truncated, CAPTURE_VERSION);
+            WriteValue(truncated, int32_t(1));
+            WriteValue(truncated, int32_t(1));
+            WriteValue(truncated, uint64_t(1000));
+        }
+        read = loaded.Read(path);
+        assert(!read && "Truncated capture should be rejected");
+        std::remove(path.c_str());
+    }
+
+    EndFrame();
+    ResetStateCache();
+    SetTestMode(false);
+
+    std::cout << "[GlApi] Tests passed!\n";
+}
@@ -0,0 +1,1007 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <GL/glew.h>
+
+/**
+ * \struct GlFrameStats
+ * \brief GL work issued through GlApi during one frame.
+ */
+struct GlFrameStats
+{
+    uint64_t calls = 0;                 ///< GL calls of any kind
+    uint64_t drawCalls = 0;             ///< glDraw* calls
+    uint64_t indices = 0;               ///< Indices submitted by draw calls
+    uint64_t stateChanges = 0;          ///< Binds, enables and other pipeline state changes
+    uint64_t redundantStateChanges = 0; ///< State changes that set the value already set
+    uint64_t uniformUploads = 0;        ///< glUniform* calls
+    uint64_t uniformLookups = 0;        ///< glGetUniformLocation calls
+    uint64_t bytesUploaded = 0;         ///< Buffer and texture data handed to the driver
+};
+
+/**
+ * \struct GlCapture
+ * \brief A captured frame: the calls that created the resources it uses, then the frame itself.
+ *
+ * Both streams are sequences of GlApi::Op records with their arguments and data inline,
+ * in host byte order.
+ */
+struct GlCapture
+{
+    int width = 0;                      ///< Viewport size when the frame was captured
+    int height = 0;                     ///< Viewport height
+    std::vector<uint8_t> setup;         ///< Calls made before the frame, resource contents included
+    std::vector<uint8_t> frame;         ///< Calls made during the frame
+
+    /**
+     * \brief Write the capture to a file.
+     * \param path File to write.
+     * \return True on success.
+     */
+    bool Write(const std::string& path) const;
+
+    /**
+     * \brief Read a capture written by Write().
+     * \param path File to read.
+     * \return True on success.
+     */
+    bool Read(const std::string& path);
+};
+
+/**
+ * \class GlApi
+ * \brief Thin interception layer between the engine and OpenGL.
+ *
+ * Engine code calls GlApi::DrawElements() and friends, which take the arguments of the gl*
+ * function of the same name, instead of calling OpenGL directly. Each wrapper forwards to
+ * the driver and updates the calling thread's GlFrameStats, which EndFrame() publishes for
+ * GetFrameStats(). Redundant state changes are only counted, never skipped; the shadow
+ * state behind them assumes one context per thread.
+ *
+ * While a capture is active every call is also serialized with its data. Calls made
+ * before the captured frame form the setup stream, except that inside earlier frames
+ * only object creation, deletion and vertex array formats are kept; calls made during
+ * the captured frame form the frame stream. GlReplay plays a capture back without the
+ * engine. Readbacks, status queries and the profiler's timer queries are not captured.
+ */
+class GlApi
+{
+public:
+    /**
+     * \enum Op
+     * \brief Record types of a capture stream.
+     */
+    enum Op : uint16_t
+    {
+        OP_CLEAR, OP_DRAW_ELEMENTS,
+        OP_CLEAR_COLOR, OP_VIEWPORT, OP_ENABLE, OP_DISABLE, OP_USE_PROGRAM, OP_BIND_VERTEX_ARRAY,
+        OP_BIND_BUFFER, OP_ACTIVE_TEXTURE, OP_BIND_TEXTURE, OP_BIND_FRAMEBUFFER, OP_BIND_RENDERBUFFER,
+        OP_PIXEL_STOREI, OP_TEX_PARAMETERI, OP_VERTEX_ATTRIB_POINTER, OP_ENABLE_VERTEX_ATTRIB_ARRAY,
+        OP_GET_UNIFORM_LOCATION, OP_UNIFORM_1I, OP_UNIFORM_1F, OP_UNIFORM_3FV, OP_UNIFORM_MATRIX_3FV, OP_UNIFORM_MATRIX_4FV,
+        OP_BUFFER_DATA, OP_TEX_IMAGE_2D, OP_GENERATE_MIPMAP, OP_RENDERBUFFER_STORAGE, OP_FRAMEBUFFER_RENDERBUFFER,
+        OP_GEN_BUFFERS, OP_GEN_VERTEX_ARRAYS, OP_GEN_TEXTURES, OP_GEN_FRAMEBUFFERS, OP_GEN_RENDERBUFFERS,
+        OP_DELETE_BUFFERS, OP_DELETE_VERTEX_ARRAYS, OP_DELETE_TEXTURES, OP_DELETE_FRAMEBUFFERS, OP_DELETE_RENDERBUFFERS,
+        OP_CREATE_SHADER, OP_SHADER_SOURCE, OP_COMPILE_SHADER, OP_DELETE_SHADER,
+        OP_CREATE_PROGRAM, OP_ATTACH_SHADER, OP_LINK_PROGRAM, OP_DELETE_PROGRAM,
+        OP_BIND_BUFFER_RANGE, OP_CREATE_BUFFERS, OP_NAMED_BUFFER_STORAGE, OP_NAMED_BUFFER_SUB_DATA,
+        OP_PROGRAM_PARAMETERI, OP_BIND_TEXTURE_UNIT, OP_DEPTH_FUNC, OP_DEPTH_MASK, OP_COLOR_MASK,
+        OP_CREATE_VERTEX_ARRAYS, OP_CREATE_TEXTURES, OP_CREATE_FRAMEBUFFERS, OP_CREATE_RENDERBUFFERS,
+        OP_VERTEX_ARRAY_VERTEX_BUFFER, OP_VERTEX_ARRAY_ELEMENT_BUFFER, OP_ENABLE_VERTEX_ARRAY_ATTRIB,
+        OP_VERTEX_ARRAY_ATTRIB_FORMAT, OP_VERTEX_ARRAY_ATTRIB_BINDING,
+        OP_TEXTURE_STORAGE_2D, OP_TEXTURE_SUB_IMAGE_2D, OP_GENERATE_TEXTURE_MIPMAP, OP_TEXTURE_PARAMETERI,
+        OP_NAMED_RENDERBUFFER_STORAGE, OP_NAMED_FRAMEBUFFER_RENDERBUFFER,
+        OP_COUNT
+    };
+
+    /**
+     * \class Recorder
+     * \brief Appends one call to the active capture stream.
+     *
+     * Holds the capture lock for its lifetime. Calls that the capture drops get a
+     * recorder that ignores its arguments.
+     */
+    class Recorder
+    {
+    public:
+        /**
+         * \brief Constructor. Starts a record.
+         * \param op The call.
+         * \param lifetime Whether the call creates, deletes or formats objects, which is kept
+         *        even in frames before the captured one.
+         */
+        Recorder(Op op, bool lifetime = false);
+
+        Recorder(const Recorder&) = delete;
+        Recorder& operator=(const Recorder&) = delete;
+
+        /**
+         * \brief Append a value.
+         * \param value Trivially copyable argument.
+         */
+        template <typename T>
+        void Put(const T& value) { PutBytes(&value, sizeof(T)); }
+
+        /**
+         * \brief Append a length-prefixed block of data.
+         * \param data The data; may be nullptr if size is 0.
+         * \param size Size in bytes.
+         */
+        void PutBlob(const void* data, size_t size)
+        {
+            Put(static_cast<uint64_t>(size));
+            PutBytes(data, size);
+        }
+
+    private:
+        /**
+         * \brief Append raw bytes if the call is kept.
+         * \param data The bytes.
+         * \param size Byte count.
+         */
+        void PutBytes(const void* data, size_t size)
+        {
+            if (m_stream != nullptr && size > 0)
+                m_stream->insert(m_stream->end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+        }
+
+        std::lock_guard<std::mutex> m_lock;     ///< Capture lock
+        std::vector<uint8_t>* m_stream;         ///< Stream the call goes to, nullptr if dropped
+    };
+
+    // Drawing
+
+    static void Clear(GLbitfield mask)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(OP_CLEAR); r.Put(mask); }
+        if (!s_testMode) glClear(mask);
+    }
+
+    static void DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+    {
+        GlFrameStats& stats = Count();
+        stats.calls++;
+        stats.drawCalls++;
+        stats.indices += static_cast<uint64_t>(count);
+        if (IsCapturing()) { Recorder r(OP_DRAW_ELEMENTS); r.Put(mode); r.Put(count); r.Put(type); r.Put(reinterpret_cast<uint64_t>(indices)); }
+        if (!s_testMode) glDrawElements(mode, count, type, indices);
+    }
+
+    // Pipeline state
+
+    static void ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+    {
+        CountState(false);
+        if (IsCapturing()) { Recorder r(OP_CLEAR_COLOR); r.Put(red); r.Put(green); r.Put(blue); r.Put(alpha); }
+        if (!s_testMode) glClearColor(red, green, blue, alpha);
+    }
+
+    static void Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        CountState(false);
+        t_state.viewportWidth = width;
+        t_state.viewportHeight = height;
+        if (IsCapturing()) { Recorder r(OP_VIEWPORT); r.Put(x); r.Put(y); r.Put(width); r.Put(height); }
+        if (!s_testMode) glViewport(x, y, width, height);
+    }
+
+    static void Enable(GLenum cap)
+    {
+        CountState(false);
+        if (IsCapturing()) { Recorder r(OP_ENABLE); r.Put(cap); }
+        if (!s_testMode) glEnable(cap);
+    }
+
+    static void Disable(GLenum cap)
+    {
+        CountState(false);
+        if (IsCapturing()) { Recorder r(OP_DISABLE); r.Put(cap); }
+        if (!s_testMode) glDisable(cap);
+    }
+
+    static void DepthFunc(GLenum func)
+    {
+        CountState(false);
+        if (IsCapturing()) { Recorder r(OP_DEPTH_FUNC); r.Put(func); }
+        if (!s_testMode) glDepthFunc(func);
+    }
+
+    static void DepthMask(GLboolean flag)
+    {
+        CountState(false);
+        if (IsCapturing()) { Recorder r(OP_DEPTH_MASK); r.Put(flag); }
+        if (!s_testMode) glDepthMask(flag);
+    }
+
+    static void ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+    {
+        CountState(false);
+        if (IsCapturing()) { Recorder r(OP_COLOR_MASK); r.Put(red); r.Put(green); r.Put(blue); r.Put(alpha); }
+        if (!s_testMode) glColorMask(red, green, blue, alpha);
+    }
+
+    static void UseProgram(GLuint program)
+    {
+        CountState(Exchange(t_state.program, program));
+        if (IsCapturing()) { Recorder r(OP_USE_PROGRAM); r.Put(program); }
+        if (!s_testMode) glUseProgram(program);
+    }
+
+    static void BindVertexArray(GLuint array)
+    {
+        CountState(Exchange(t_state.vertexArray, array));
+        if (IsCapturing()) { Recorder r(OP_BIND_VERTEX_ARRAY); r.Put(array); }
+        if (!s_testMode) glBindVertexArray(array);
+    }
+
+    static void BindBuffer(GLenum target, GLuint buffer)
+    {
+        CountState(target == GL_ARRAY_BUFFER && Exchange(t_state.arrayBuffer, buffer));
+        if (IsCapturing()) { Recorder r(OP_BIND_BUFFER); r.Put(target); r.Put(buffer); }
+        if (!s_testMode) glBindBuffer(target, buffer);
+    }
+
+    static void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+    {
+        CountState(false);
+        if (IsCapturing())
+        {
+            Recorder r(OP_BIND_BUFFER_RANGE);
+            r.Put(target); r.Put(index); r.Put(buffer); r.Put(static_cast<uint64_t>(offset)); r.Put(static_cast<uint64_t>(size));
+        }
+        if (!s_testMode) glBindBufferRange(target, index, buffer, offset, size);
+    }
+
+    static void BindTextureUnit(GLuint unit, GLuint texture)
+    {
+        CountState(unit < MAX_TRACKED_TEXTURE_UNITS && Exchange(t_state.textures[unit], texture));
+        if (IsCapturing()) { Recorder r(OP_BIND_TEXTURE_UNIT); r.Put(unit); r.Put(texture); }
+        if (!s_testMode) glBindTextureUnit(unit, texture);
+    }
+
+    static void ActiveTexture(GLenum texture)
+    {
+        CountState(Exchange(t_state.activeTexture, texture - GL_TEXTURE0));
+        if (IsCapturing()) { Recorder r(OP_ACTIVE_TEXTURE); r.Put(texture); }
+        if (!s_testMode) glActiveTexture(texture);
+    }
+
+    static void BindTexture(GLenum target, GLuint texture)
+    {
+        bool redundant = target == GL_TEXTURE_2D && t_state.activeTexture < MAX_TRACKED_TEXTURE_UNITS &&
+                         Exchange(t_state.textures[t_state.activeTexture], texture);
+        CountState(redundant);
+        if (IsCapturing()) { Recorder r(OP_BIND_TEXTURE); r.Put(target); r.Put(texture); }
+        if (!s_testMode) glBindTexture(target, texture);
+    }
+
+    static void BindFramebuffer(GLenum target, GLuint framebuffer)
+    {
+        CountState(target == GL_FRAMEBUFFER && Exchange(t_state.framebuffer, framebuffer));
+        if (IsCapturing()) { Recorder r(OP_BIND_FRAMEBUFFER); r.Put(target); r.Put(framebuffer); }
+        if (!s_testMode) glBindFramebuffer(target, framebuffer);
+    }
+
+    static void BindRenderbuffer(GLenum target, GLuint renderbuffer)
+    {
+        CountState(false);
+        if (IsCapturing()) { Recorder r(OP_BIND_RENDERBUFFER); r.Put(target); r.Put(renderbuffer); }
+        if (!s_testMode) glBindRenderbuffer(target, renderbuffer);
+    }
+
+    static void PixelStorei(GLenum pname, GLint param)
+    {
+        CountState(false);
+        if (pname == GL_UNPACK_ALIGNMENT)
+            t_state.unpackAlignment = param;
+        else if (pname == GL_PACK_ALIGNMENT)
+            t_state.packAlignment = param;
+        if (IsCapturing()) { Recorder r(OP_PIXEL_STOREI); r.Put(pname); r.Put(param); }
+        if (!s_testMode) glPixelStorei(pname, param);
+    }
+
+    static void TexParameteri(GLenum target, GLenum pname, GLint param)
+    {
+        CountState(false);
+        if (IsCapturing()) { Recorder r(OP_TEX_PARAMETERI); r.Put(target); r.Put(pname); r.Put(param); }
+        if (!s_testMode) glTexParameteri(target, pname, param);
+    }
+
+    static void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer)
+    {
+        CountState(false);
+        if (IsCapturing())
+        {
+            Recorder r(OP_VERTEX_ATTRIB_POINTER);
+            r.Put(index); r.Put(size); r.Put(type); r.Put(normalized); r.Put(stride); r.Put(reinterpret_cast<uint64_t>(pointer));
+        }
+        if (!s_testMode) glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+    }
+
+    static void EnableVertexAttribArray(GLuint index)
+    {
+        CountState(false);
+        if (IsCapturing()) { Recorder r(OP_ENABLE_VERTEX_ATTRIB_ARRAY); r.Put(index); }
+        if (!s_testMode) glEnableVertexAttribArray(index);
+    }
+
+    // Direct state access: edits a named object without binding it
+
+    static void VertexArrayVertexBuffer(GLuint vaobj, GLuint bindingindex, GLuint buffer, GLintptr offset, GLsizei stride)
+    {
+        Count().calls++;
+        if (IsCapturing())
+        {
+            // Vertex array formats are set once after creation, often on a mesh's first
+            // draw, so they are kept like creation
+            Recorder r(OP_VERTEX_ARRAY_VERTEX_BUFFER, true);
+            r.Put(vaobj); r.Put(bindingindex); r.Put(buffer); r.Put(static_cast<uint64_t>(offset)); r.Put(stride);
+        }
+        if (!s_testMode) glVertexArrayVertexBuffer(vaobj, bindingindex, buffer, offset, stride);
+    }
+
+    static void VertexArrayElementBuffer(GLuint vaobj, GLuint buffer)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(OP_VERTEX_ARRAY_ELEMENT_BUFFER, true); r.Put(vaobj); r.Put(buffer); }
+        if (!s_testMode) glVertexArrayElementBuffer(vaobj, buffer);
+    }
+
+    static void EnableVertexArrayAttrib(GLuint vaobj, GLuint index)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(OP_ENABLE_VERTEX_ARRAY_ATTRIB, true); r.Put(vaobj); r.Put(index); }
+        if (!s_testMode) glEnableVertexArrayAttrib(vaobj, index);
+    }
+
+    static void VertexArrayAttribFormat(GLuint vaobj, GLuint attribindex, GLint size, GLenum type, GLboolean normalized, GLuint relativeoffset)
+    {
+        Count().calls++;
+        if (IsCapturing())
+        {
+            Recorder r(OP_VERTEX_ARRAY_ATTRIB_FORMAT, true);
+            r.Put(vaobj); r.Put(attribindex); r.Put(size); r.Put(type); r.Put(normalized); r.Put(relativeoffset);
+        }
+        if (!s_testMode) glVertexArrayAttribFormat(vaobj, attribindex, size, type, normalized, relativeoffset);
+    }
+
+    static void VertexArrayAttribBinding(GLuint vaobj, GLuint attribindex, GLuint bindingindex)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(OP_VERTEX_ARRAY_ATTRIB_BINDING, true); r.Put(vaobj); r.Put(attribindex); r.Put(bindingindex); }
+        if (!s_testMode) glVertexArrayAttribBinding(vaobj, attribindex, bindingindex);
+    }
+
+    static void TextureParameteri(GLuint texture, GLenum pname, GLint param)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(OP_TEXTURE_PARAMETERI); r.Put(texture); r.Put(pname); r.Put(param); }
+        if (!s_testMode) glTextureParameteri(texture, pname, param);
+    }
+
+    static void NamedFramebufferRenderbuffer(GLuint framebuffer, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
+    {
+        Count().calls++;
+        if (IsCapturing())
+        {
+            Recorder r(OP_NAMED_FRAMEBUFFER_RENDERBUFFER);
+            r.Put(framebuffer); r.Put(attachment); r.Put(renderbuffertarget); r.Put(renderbuffer);
+        }
+        if (!s_testMode) glNamedFramebufferRenderbuffer(framebuffer, attachment, renderbuffertarget, renderbuffer);
+    }
+
+    static GLenum CheckNamedFramebufferStatus(GLuint framebuffer, GLenum target)
+    {
+        Count().calls++;
+        return s_testMode ? GL_FRAMEBUFFER_COMPLETE : glCheckNamedFramebufferStatus(framebuffer, target);
+    }
+
+    // Uniforms
+
+    static GLint GetUniformLocation(GLuint program, const GLchar* name)
+    {
+        GlFrameStats& stats = Count();
+        stats.calls++;
+        stats.uniformLookups++;
+        GLint location = s_testMode ? 0 : glGetUniformLocation(program, name);
+        if (IsCapturing()) { Recorder r(OP_GET_UNIFORM_LOCATION); r.Put(program); r.PutBlob(name, std::strlen(name)); r.Put(location); }
+        return location;
+    }
+
+    static void Uniform1i(GLint location, GLint v0)
+    {
+        CountUniform();
+        if (IsCapturing()) { Recorder r(OP_UNIFORM_1I); r.Put(location); r.Put(v0); }
+        if (!s_testMode) glUniform1i(location, v0);
+    }
+
+    static void Uniform1f(GLint location, GLfloat v0)
+    {
+        CountUniform();
+        if (IsCapturing()) { Recorder r(OP_UNIFORM_1F); r.Put(location); r.Put(v0); }
+        if (!s_testMode) glUniform1f(location, v0);
+    }
+
+    static void Uniform3fv(GLint location, GLsizei count, const GLfloat* value)
+    {
+        CountUniform();
+        if (IsCapturing()) { Recorder r(OP_UNIFORM_3FV); r.Put(location); r.Put(count); r.PutBlob(value, sizeof(GLfloat) * 3 * count); }
+        if (!s_testMode) glUniform3fv(location, count, value);
+    }
+
+    static void UniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+    {
+        CountUniform();
+        if (IsCapturing())
+        {
+            Recorder r(OP_UNIFORM_MATRIX_3FV);
+            r.Put(location); r.Put(count); r.Put(transpose); r.PutBlob(value, sizeof(GLfloat) * 9 * count);
+        }
+        if (!s_testMode) glUniformMatrix3fv(location, count, transpose, value);
+    }
+
+    static void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+    {
+        CountUniform();
+        if (IsCapturing())
+        {
+            Recorder r(OP_UNIFORM_MATRIX_4FV);
+            r.Put(location); r.Put(count); r.Put(transpose); r.PutBlob(value, sizeof(GLfloat) * 16 * count);
+        }
+        if (!s_testMode) glUniformMatrix4fv(location, count, transpose, value);
+    }
+
+    // Resource contents
+
+    static void BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+    {
+        GlFrameStats& stats = Count();
+        stats.calls++;
+        stats.bytesUploaded += data != nullptr ? static_cast<uint64_t>(size) : 0;
+        if (IsCapturing())
+        {
+            Recorder r(OP_BUFFER_DATA);
+            r.Put(target); r.Put(static_cast<uint64_t>(size)); r.Put(usage); r.PutBlob(data, data != nullptr ? static_cast<size_t>(size) : 0);
+        }
+        if (!s_testMode) glBufferData(target, size, data, usage);
+    }
+
+    static void NamedBufferStorage(GLuint buffer, GLsizeiptr size, const void* data, GLbitfield flags)
+    {
+        GlFrameStats& stats = Count();
+        stats.calls++;
+        stats.bytesUploaded += data != nullptr ? static_cast<uint64_t>(size) : 0;
+        // Immutable storage is part of creating the buffer, so it is kept like creation
+        if (IsCapturing())
+        {
+            Recorder r(OP_NAMED_BUFFER_STORAGE, true);
+            r.Put(buffer); r.Put(static_cast<uint64_t>(size)); r.Put(flags); r.PutBlob(data, data != nullptr ? static_cast<size_t>(size) : 0);
+        }
+        if (!s_testMode) glNamedBufferStorage(buffer, size, data, flags);
+    }
+
+    static void NamedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+    {
+        NoteMappedWrite(buffer, offset, size, data);
+        if (!s_testMode) glNamedBufferSubData(buffer, offset, size, data);
+    }
+
+    /**
+     * \brief Account for data the caller wrote into a mapped buffer.
+     *
+     * Writes through a mapping bypass GL, so they are counted as uploads and captured as
+     * NamedBufferSubData calls here instead. Nothing is forwarded to the driver.
+     *
+     * \param buffer Buffer written to.
+     * \param offset Offset of the written range.
+     * \param size Size of the written range.
+     * \param data The written bytes, i.e. the mapped range.
+     */
+    static void NoteMappedWrite(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+    {
+        GlFrameStats& stats = Count();
+        stats.calls++;
+        stats.bytesUploaded += static_cast<uint64_t>(size);
+        if (IsCapturing())
+        {
+            Recorder r(OP_NAMED_BUFFER_SUB_DATA);
+            r.Put(buffer); r.Put(static_cast<uint64_t>(offset)); r.PutBlob(data, static_cast<size_t>(size));
+        }
+    }
+
+    static void* MapNamedBufferRange(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access)
+    {
+        Count().calls++;
+        return s_testMode ? nullptr : glMapNamedBufferRange(buffer, offset, length, access);
+    }
+
+    static GLboolean UnmapNamedBuffer(GLuint buffer)
+    {
+        Count().calls++;
+        return s_testMode ? GL_TRUE : glUnmapNamedBuffer(buffer);
+    }
+
+    static void TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border,
+                           GLenum format, GLenum type, const void* pixels)
+    {
+        size_t size = pixels != nullptr ? GetImageSize(width, height, format, type, t_state.unpackAlignment) : 0;
+        GlFrameStats& stats = Count();
+        stats.calls++;
+        stats.bytesUploaded += size;
+        if (IsCapturing())
+        {
+            Recorder r(OP_TEX_IMAGE_2D);
+            r.Put(target); r.Put(level); r.Put(internalformat); r.Put(width); r.Put(height); r.Put(border); r.Put(format); r.Put(type);
+            r.PutBlob(pixels, size);
+        }
+        if (!s_testMode) glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+    }
+
+    static void GenerateMipmap(GLenum target)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(OP_GENERATE_MIPMAP); r.Put(target); }
+        if (!s_testMode) glGenerateMipmap(target);
+    }
+
+    static void TextureStorage2D(GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height)
+    {
+        Count().calls++;
+        // Like NamedBufferStorage, immutable storage is part of creating the texture
+        if (IsCapturing())
+        {
+            Recorder r(OP_TEXTURE_STORAGE_2D, true);
+            r.Put(texture); r.Put(levels); r.Put(internalformat); r.Put(width); r.Put(height);
+        }
+        if (!s_testMode) glTextureStorage2D(texture, levels, internalformat, width, height);
+    }
+
+    static void TextureSubImage2D(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                                  GLenum format, GLenum type, const void* pixels)
+    {
+        size_t size = pixels != nullptr ? GetImageSize(width, height, format, type, t_state.unpackAlignment) : 0;
+        GlFrameStats& stats = Count();
+        stats.calls++;
+        stats.bytesUploaded += size;
+        if (IsCapturing())
+        {
+            Recorder r(OP_TEXTURE_SUB_IMAGE_2D);
+            r.Put(texture); r.Put(level); r.Put(xoffset); r.Put(yoffset); r.Put(width); r.Put(height); r.Put(format); r.Put(type);
+            r.PutBlob(pixels, size);
+        }
+        if (!s_testMode) glTextureSubImage2D(texture, level, xoffset, yoffset, width, height, format, type, pixels);
+    }
+
+    static void GenerateTextureMipmap(GLuint texture)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(OP_GENERATE_TEXTURE_MIPMAP); r.Put(texture); }
+        if (!s_testMode) glGenerateTextureMipmap(texture);
+    }
+
+    static void NamedRenderbufferStorage(GLuint renderbuffer, GLenum internalformat, GLsizei width, GLsizei height)
+    {
+        Count().calls++;
+        if (IsCapturing())
+        {
+            Recorder r(OP_NAMED_RENDERBUFFER_STORAGE, true);
+            r.Put(renderbuffer); r.Put(internalformat); r.Put(width); r.Put(height);
+        }
+        if (!s_testMode) glNamedRenderbufferStorage(renderbuffer, internalformat, width, height);
+    }
+
+    static void RenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(OP_RENDERBUFFER_STORAGE); r.Put(target); r.Put(internalformat); r.Put(width); r.Put(height); }
+        if (!s_testMode) glRenderbufferStorage(target, internalformat, width, height);
+    }
+
+    static void FramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
+    {
+        Count().calls++;
+        if (IsCapturing())
+        {
+            Recorder r(OP_FRAMEBUFFER_RENDERBUFFER);
+            r.Put(target); r.Put(attachment); r.Put(renderbuffertarget); r.Put(renderbuffer);
+        }
+        if (!s_testMode) glFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+    }
+
+    static GLenum CheckFramebufferStatus(GLenum target)
+    {
+        Count().calls++;
+        return s_testMode ? GL_FRAMEBUFFER_COMPLETE : glCheckFramebufferStatus(target);
+    }
+
+    static void ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void* pixels)
+    {
+        Count().calls++;
+        if (!s_testMode) glReadPixels(x, y, width, height, format, type, pixels);
+    }
+
+    static void Finish()
+    {
+        Count().calls++;
+        if (!s_testMode) glFinish();
+    }
+
+    static void GetIntegerv(GLenum pname, GLint* data)
+    {
+        Count().calls++;
+        if (!s_testMode) glGetIntegerv(pname, data);
+    }
+
+    // Synchronization, not captured
+
+    static GLsync FenceSync(GLenum condition, GLbitfield flags)
+    {
+        Count().calls++;
+        return s_testMode ? nullptr : glFenceSync(condition, flags);
+    }
+
+    static GLenum ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+    {
+        Count().calls++;
+        return s_testMode ? GL_ALREADY_SIGNALED : glClientWaitSync(sync, flags, timeout);
+    }
+
+    static void DeleteSync(GLsync sync)
+    {
+        Count().calls++;
+        if (!s_testMode) glDeleteSync(sync);
+    }
+
+    // Objects
+
+    static void GenBuffers(GLsizei n, GLuint* buffers) { Generate(OP_GEN_BUFFERS, n, buffers, glGenBuffers); }
+    static void CreateBuffers(GLsizei n, GLuint* buffers) { Generate(OP_CREATE_BUFFERS, n, buffers, glCreateBuffers); }
+    static void GenVertexArrays(GLsizei n, GLuint* arrays) { Generate(OP_GEN_VERTEX_ARRAYS, n, arrays, glGenVertexArrays); }
+    static void CreateVertexArrays(GLsizei n, GLuint* arrays) { Generate(OP_CREATE_VERTEX_ARRAYS, n, arrays, glCreateVertexArrays); }
+    static void GenTextures(GLsizei n, GLuint* textures) { Generate(OP_GEN_TEXTURES, n, textures, glGenTextures); }
+    static void GenFramebuffers(GLsizei n, GLuint* framebuffers) { Generate(OP_GEN_FRAMEBUFFERS, n, framebuffers, glGenFramebuffers); }
+    static void GenRenderbuffers(GLsizei n, GLuint* renderbuffers) { Generate(OP_GEN_RENDERBUFFERS, n, renderbuffers, glGenRenderbuffers); }
+    static void CreateFramebuffers(GLsizei n, GLuint* framebuffers) { Generate(OP_CREATE_FRAMEBUFFERS, n, framebuffers, glCreateFramebuffers); }
+    static void CreateRenderbuffers(GLsizei n, GLuint* renderbuffers) { Generate(OP_CREATE_RENDERBUFFERS, n, renderbuffers, glCreateRenderbuffers); }
+
+    static void CreateTextures(GLenum target, GLsizei n, GLuint* textures)
+    {
+        Count().calls++;
+        if (s_testMode)
+        {
+            for (GLsizei i = 0; i < n; ++i)
+                textures[i] = ++s_testNames;
+        }
+        else
+        {
+            glCreateTextures(target, n, textures);
+        }
+        if (IsCapturing()) { Recorder r(OP_CREATE_TEXTURES, true); r.Put(target); r.Put(n); r.PutBlob(textures, sizeof(GLuint) * n); }
+    }
+
+    static void DeleteBuffers(GLsizei n, const GLuint* buffers) { Delete(OP_DELETE_BUFFERS, n, buffers, glDeleteBuffers); }
+    static void DeleteVertexArrays(GLsizei n, const GLuint* arrays) { Delete(OP_DELETE_VERTEX_ARRAYS, n, arrays, glDeleteVertexArrays); }
+    static void DeleteTextures(GLsizei n, const GLuint* textures) { Delete(OP_DELETE_TEXTURES, n, textures, glDeleteTextures); }
+    static void DeleteFramebuffers(GLsizei n, const GLuint* framebuffers) { Delete(OP_DELETE_FRAMEBUFFERS, n, framebuffers, glDeleteFramebuffers); }
+    static void DeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) { Delete(OP_DELETE_RENDERBUFFERS, n, renderbuffers, glDeleteRenderbuffers); }
+
+    static GLuint CreateShader(GLenum type)
+    {
+        Count().calls++;
+        GLuint shader = s_testMode ? ++s_testNames : glCreateShader(type);
+        if (IsCapturing()) { Recorder r(OP_CREATE_SHADER, true); r.Put(type); r.Put(shader); }
+        return shader;
+    }
+
+    static void ShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+    {
+        Count().calls++;
+        if (IsCapturing())
+        {
+            Recorder r(OP_SHADER_SOURCE);
+            r.Put(shader); r.Put(count);
+            for (GLsizei i = 0; i < count; ++i)
+            {
+                r.PutBlob(string[i], length != nullptr && length[i] >= 0 ? static_cast<size_t>(length[i]) : std::strlen(string[i]));
+            }
+        }
+        if (!s_testMode) glShaderSource(shader, count, string, length);
+    }
+
+    static void CompileShader(GLuint shader)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(OP_COMPILE_SHADER); r.Put(shader); }
+        if (!s_testMode) glCompileShader(shader);
+    }
+
+    static void GetShaderiv(GLuint shader, GLenum pname, GLint* params)
+    {
+        Count().calls++;
+        if (s_testMode) *params = GL_TRUE; else glGetShaderiv(shader, pname, params);
+    }
+
+    static void GetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+    {
+        Count().calls++;
+        if (s_testMode) { if (bufSize > 0) infoLog[0] = '\0'; } else glGetShaderInfoLog(shader, bufSize, length, infoLog);
+    }
+
+    static void DeleteShader(GLuint shader)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(OP_DELETE_SHADER, true); r.Put(shader); }
+        if (!s_testMode) glDeleteShader(shader);
+    }
+
+    static GLuint CreateProgram()
+    {
+        Count().calls++;
+        GLuint program = s_testMode ? ++s_testNames : glCreateProgram();
+        if (IsCapturing()) { Recorder r(OP_CREATE_PROGRAM, true); r.Put(program); }
+        return program;
+    }
+
+    static void AttachShader(GLuint program, GLuint shader)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(OP_ATTACH_SHADER); r.Put(program); r.Put(shader); }
+        if (!s_testMode) glAttachShader(program, shader);
+    }
+
+    static void LinkProgram(GLuint program)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(OP_LINK_PROGRAM); r.Put(program); }
+        if (!s_testMode) glLinkProgram(program);
+    }
+
+    // The compiler thread count only affects timing, so it is not captured
+
+    static void MaxShaderCompilerThreads(GLuint count)
+    {
+        Count().calls++;
+        if (s_testMode) return;
+        if (GLEW_KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(count); else glMaxShaderCompilerThreadsARB(count);
+    }
+
+    static void ProgramParameteri(GLuint program, GLenum pname, GLint value)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(OP_PROGRAM_PARAMETERI); r.Put(program); r.Put(pname); r.Put(value); }
+        if (!s_testMode) glProgramParameteri(program, pname, value);
+    }
+
+    // Program binaries are driver specific, so they are not captured; see ProgramCache
+
+    static void GetProgramBinary(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary)
+    {
+        Count().calls++;
+        if (s_testMode) { if (length != nullptr) *length = 0; } else glGetProgramBinary(program, bufSize, length, binaryFormat, binary);
+    }
+
+    static void ProgramBinary(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length)
+    {
+        Count().calls++;
+        if (!s_testMode) glProgramBinary(program, binaryFormat, binary, length);
+    }
+
+    static void GetProgramiv(GLuint program, GLenum pname, GLint* params)
+    {
+        Count().calls++;
+        if (s_testMode) *params = GL_TRUE; else glGetProgramiv(program, pname, params);
+    }
+
+    static void GetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog)
+    {
+        Count().calls++;
+        if (s_testMode) { if (bufSize > 0) infoLog[0] = '\0'; } else glGetProgramInfoLog(program, bufSize, length, infoLog);
+    }
+
+    static void DeleteProgram(GLuint program)
+    {
+        Count().calls++;
+        if (t_state.program == program)
+            t_state.program = 0;
+        if (IsCapturing()) { Recorder r(OP_DELETE_PROGRAM, true); r.Put(program); }
+        if (!s_testMode) glDeleteProgram(program);
+    }
+
+    // Frames and statistics
+
+    /**
+     * \brief Mark the start of a frame on the calling thread and reset its counters.
+     */
+    static void BeginFrame();
+
+    /**
+     * \brief Mark the end of a frame: publish the calling thread's counters and reset them.
+     *
+     * Also finishes a capture whose frame this was, and logs the counters if a log
+     * interval is set.
+     */
+    static void EndFrame();
+
+    /**
+     * \brief Get the counters of the most recently ended frame on any thread.
+     * \return The counters.
+     */
+    static GlFrameStats GetFrameStats();
+
+    /**
+     * \brief Get the calling thread's counters since its last BeginFrame() or EndFrame().
+     * \return The counters.
+     */
+    static const GlFrameStats& GetCurrentStats() { return t_stats; }
+
+    /**
+     * \brief Format counters as one log line.
+     * \param stats The counters.
+     * \return Text without a trailing newline.
+     */
+    static std::string FormatStats(const GlFrameStats& stats);
+
+    /**
+     * \brief Log the counters of every Nth frame to std::cout.
+     * \param frames Interval in frames, 0 to disable.
+     */
+    static void SetLogInterval(uint64_t frames) { s_logInterval = frames; }
+
+    /**
+     * \brief Forget the shadowed bindings of the calling thread, e.g. after switching contexts.
+     */
+    static void ResetStateCache() { t_state = ShadowState(); }
+
+    // Capture
+
+    /**
+     * \brief Start recording for a frame capture.
+     *
+     * Start before the resources the frame uses are created, i.e. before loading.
+     *
+     * \param path File the capture is written to when the frame ends.
+     * \param frame Number of BeginFrame() calls to skip before the captured frame.
+     * \return False if a capture is already active.
+     */
+    static bool BeginCapture(const std::string& path, uint64_t frame);
+
+    /**
+     * \brief Stop recording without writing anything.
+     */
+    static void CancelCapture();
+
+    /**
+     * \brief Check whether calls are being recorded.
+     * \return True while a capture is active.
+     */
+    static bool IsCapturing() { return s_capturing.load(std::memory_order_relaxed); }
+
+    /**
+     * \brief Get the capture finished most recently.
+     * \return The capture; empty if none has finished.
+     */
+    static GlCapture GetLastCapture();
+
+    /**
+     * \brief Compute the client memory size of pixel data.
+     * \param width Width in pixels.
+     * \param height Height in pixels.
+     * \param format Pixel format, e.g. GL_RGBA.
+     * \param type Component type, e.g. GL_UNSIGNED_BYTE.
+     * \param alignment Row alignment in bytes.
+     * \return Size in bytes; the last row is not padded.
+     */
+    static size_t GetImageSize(GLsizei width, GLsizei height, GLenum format, GLenum type, GLint alignment);
+
+    /**
+     * \brief Compute the number of levels of a full mipmap chain.
+     * \param width Width of the base level.
+     * \param height Height of the base level.
+     * \return Levels down to 1x1, for TextureStorage2D().
+     */
+    static GLsizei GetMipLevelCount(GLsizei width, GLsizei height);
+
+    /**
+     * \brief Run unit tests for the GlApi class.
+     */
+    static void test();
+
+    /**
+     * \brief Enable or disable test mode, in which nothing is forwarded to the driver.
+     * \param enabled Whether to enable test mode.
+     */
+    static void SetTestMode(bool enabled) { s_testMode = enabled; }
+
+    /**
+     * \brief Check if test mode is enabled.
+     * \return Whether test mode is enabled.
+     */
+    static bool IsTestMode() { return s_testMode; }
+
+private:
+    static constexpr GLuint MAX_TRACKED_TEXTURE_UNITS = 32; ///< Texture units whose bindings are shadowed
+
+    /**
+     * \struct ShadowState
+     * \brief Bindings last set through GlApi on a thread, for spotting redundant changes.
+     */
+    struct ShadowState
+    {
+        GLuint program = ~0u;                       ///< Current program
+        GLuint vertexArray = ~0u;                   ///< Bound vertex array
+        GLuint arrayBuffer = ~0u;                   ///< GL_ARRAY_BUFFER binding
+        GLuint framebuffer = ~0u;                   ///< GL_FRAMEBUFFER binding
+        GLuint activeTexture = 0;                   ///< Active unit, 0-based
+        GLuint textures[MAX_TRACKED_TEXTURE_UNITS]; ///< GL_TEXTURE_2D binding per unit
+        GLint unpackAlignment = 4;                  ///< GL_UNPACK_ALIGNMENT
+        GLint packAlignment = 4;                    ///< GL_PACK_ALIGNMENT
+        GLsizei viewportWidth = 0;                  ///< Last viewport width
+        GLsizei viewportHeight = 0;                 ///< Last viewport height
+
+        ShadowState() { std::fill(std::begin(textures), std::end(textures), ~0u); }
+    };
+
+    static GlFrameStats& Count() { return t_stats; }
+
+    static void CountState(bool redundant)
+    {
+        t_stats.calls++;
+        t_stats.stateChanges++;
+        t_stats.redundantStateChanges += redundant ? 1 : 0;
+    }
+
+    static void CountUniform()
+    {
+        t_stats.calls++;
+        t_stats.uniformUploads++;
+    }
+
+    /**
+     * \brief Store a new value and report whether it was already set.
+     */
+    static bool Exchange(GLuint& current, GLuint value)
+    {
+        bool same = current == value;
+        current = value;
+        return same;
+    }
+
+    template <typename Function>
+    static void Generate(Op op, GLsizei n, GLuint* names, Function function)
+    {
+        Count().calls++;
+        if (s_testMode)
+        {
+            for (GLsizei i = 0; i < n; ++i)
+                names[i] = ++s_testNames;
+        }
+        else
+        {
+            function(n, names);
+        }
+        if (IsCapturing()) { Recorder r(op, true); r.Put(n); r.PutBlob(names, sizeof(GLuint) * n); }
+    }
+
+    template <typename Function>
+    static void Delete(Op op, GLsizei n, const GLuint* names, Function function)
+    {
+        Count().calls++;
+        if (IsCapturing()) { Recorder r(op, true); r.Put(n); r.PutBlob(names, sizeof(GLuint) * n); }
+        if (!s_testMode) function(n, names);
+    }
+
+    static inline thread_local GlFrameStats t_stats;    ///< Calling thread's counters for the current frame
+    static inline thread_local ShadowState t_state;     ///< Calling thread's shadowed bindings
+
+    static std::atomic<bool> s_capturing;               ///< Whether calls are recorded
+    static uint64_t s_logInterval;                      ///< Frames between log lines, 0 for none
+    static GLuint s_testNames;                          ///< Last object name handed out in test mode
+    static bool s_testMode;                             ///< Test mode flag
+};
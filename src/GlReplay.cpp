@@ -0,0 +1,791 @@
+#include "GlReplay.h"
+#include <iostream>
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+/**
+ * Bounds-checked cursor over a capture stream. A failed read leaves the reader failed
+ * and returns zeros.
+ */
+class StreamReader
+{
+public:
+    explicit StreamReader(const std::vector<uint8_t>& stream)
+        : m_data(stream.data())
+        , m_size(stream.size())
+        , m_offset(0)
+        , m_failed(false)
+    {
+    }
+
+    template <typename T>
+    T Get()
+    {
+        T value{};
+        if (!Check(sizeof(T)))
+            return value;
+        std::memcpy(&value, m_data + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return value;
+    }
+
+    // Returns a pointer into the stream, nullptr for an empty blob
+    const uint8_t* GetBlob(size_t& size)
+    {
+        uint64_t length = Get<uint64_t>();
+        size = 0;
+        if (!Check(length))
+            return nullptr;
+        const uint8_t* blob = length > 0 ? m_data + m_offset : nullptr;
+        m_offset += static_cast<size_t>(length);
+        size = static_cast<size_t>(length);
+        return blob;
+    }
+
+    bool AtEnd() const { return m_offset == m_size; }
+    bool Failed() const { return m_failed; }
+
+private:
+    bool Check(uint64_t size)
+    {
+        if (m_failed || size > m_size - m_offset)
+            m_failed = true;
+        return !m_failed;
+    }
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_offset;
+    bool m_failed;
+};
+
+} // namespace
+
+GlReplay::GlReplay(const GlCapture& capture)
+    : m_capture(capture)
+    , m_program(0)
+    , m_defaultFramebuffer(0)
+    , m_unknownNames(0)
+{
+}
+
+bool GlReplay::Setup()
+{
+    return Run(m_capture.setup);
+}
+
+bool GlReplay::ReplayFrame()
+{
+    GlApi::BeginFrame();
+    bool result = Run(m_capture.frame);
+    GlApi::EndFrame();
+    return result;
+}
+
+GLuint GlReplay::Map(ObjectKind kind, GLuint name)
+{
+    if (name == 0)
+        return kind == FRAMEBUFFER_OBJECT ? m_defaultFramebuffer : 0;
+
+    auto it = m_names[kind].find(name);
+    if (it != m_names[kind].end())
+        return it->second;
+
+    // A framebuffer made before the capture started, e.g. a HeadlessContext's, stands in for the default one
+    if (kind == FRAMEBUFFER_OBJECT)
+        return m_defaultFramebuffer;
+    ++m_unknownNames;
+    return 0;
+}
+
+GLint GlReplay::MapLocation(GLint location) const
+{
+    auto it = m_locations.find((static_cast<uint64_t>(m_program) << 32) | static_cast<uint32_t>(location));
+    return it != m_locations.end() ? it->second : location;
+}
+
+bool GlReplay::Run(const std::vector<uint8_t>& stream)
+{
+    StreamReader in(stream);
+    std::vector<GLuint> names;
+    std::vector<const GLchar*> sources;
+    std::vector<GLint> lengths;
+
+    // Objects: read the captured names, then create or delete and update the mapping
+    auto generate = [&](ObjectKind kind, auto function)
+    {
+        GLsizei count = in.Get<GLsizei>();
+        size_t size = 0;
+        const uint8_t* captured = in.GetBlob(size);
+        if (in.Failed() || count < 0 || size != sizeof(GLuint) * static_cast<size_t>(count))
+            return false;
+        names.resize(static_cast<size_t>(count));
+        function(count, names.data());
+        for (GLsizei i = 0; i < count; ++i)
+        {
+            GLuint name;
+            std::memcpy(&name, captured + sizeof(GLuint) * i, sizeof(GLuint));
+            m_names[kind][name] = names[i];
+        }
+        return true;
+    };
+    auto remove = [&](ObjectKind kind, void (*function)(GLsizei, const GLuint*))
+    {
+        GLsizei count = in.Get<GLsizei>();
+        size_t size = 0;
+        const uint8_t* captured = in.GetBlob(size);
+        if (in.Failed() || count < 0 || size != sizeof(GLuint) * static_cast<size_t>(count))
+            return false;
+        names.resize(static_cast<size_t>(count));
+        for (GLsizei i = 0; i < count; ++i)
+        {
+            GLuint name;
+            std::memcpy(&name, captured + sizeof(GLuint) * i, sizeof(GLuint));
+            names[i] = Map(kind, name);
+            m_names[kind].erase(name);
+        }
+        function(count, names.data());
+        return true;
+    };
+    // Uniform arrays: the blob must hold count values of the given size
+    auto uniformData = [&](GLsizei count, size_t valueSize)
+    {
+        size_t size = 0;
+        const uint8_t* data = in.GetBlob(size);
+        return count >= 0 && size == valueSize * static_cast<size_t>(count) ? reinterpret_cast<const GLfloat*>(data) : nullptr;
+    };
+
+    while (!in.AtEnd() && !in.Failed())
+    {
+        uint16_t op = in.Get<uint16_t>();
+        bool valid = true;
+        switch (op)
+        {
+        case GlApi::OP_CLEAR:
+            GlApi::Clear(in.Get<GLbitfield>());
+            break;
+        case GlApi::OP_DRAW_ELEMENTS:
+        {
+            GLenum mode = in.Get<GLenum>();
+            GLsizei count = in.Get<GLsizei>();
+            GLenum type = in.Get<GLenum>();
+            uint64_t offset = in.Get<uint64_t>();
+            if (!in.Failed())
+                GlApi::DrawElements(mode, count, type, reinterpret_cast<const void*>(offset));
+            break;
+        }
+        case GlApi::OP_CLEAR_COLOR:
+        {
+            GLfloat r = in.Get<GLfloat>();
+            GLfloat g = in.Get<GLfloat>();
+            GLfloat b = in.Get<GLfloat>();
+            GLfloat a = in.Get<GLfloat>();
+            GlApi::ClearColor(r, g, b, a);
+            break;
+        }
+        case GlApi::OP_VIEWPORT:
+        {
+            GLint x = in.Get<GLint>();
+            GLint y = in.Get<GLint>();
+            GLsizei w = in.Get<GLsizei>();
+            GLsizei h = in.Get<GLsizei>();
+            GlApi::Viewport(x, y, w, h);
+            break;
+        }
+        case GlApi::OP_ENABLE:
+            GlApi::Enable(in.Get<GLenum>());
+            break;
+        case GlApi::OP_DISABLE:
+            GlApi::Disable(in.Get<GLenum>());
+            break;
+        case GlApi::OP_DEPTH_FUNC:
+            GlApi::DepthFunc(in.Get<GLenum>());
+            break;
+        case GlApi::OP_DEPTH_MASK:
+            GlApi::DepthMask(in.Get<GLboolean>());
+            break;
+        case GlApi::OP_COLOR_MASK:
+        {
+            GLboolean r = in.Get<GLboolean>();
+            GLboolean g = in.Get<GLboolean>();
+            GLboolean b = in.Get<GLboolean>();
+            GLboolean a = in.Get<GLboolean>();
+            GlApi::ColorMask(r, g, b, a);
+            break;
+        }
+        case GlApi::OP_USE_PROGRAM:
+            m_program = Map(PROGRAM_OBJECT, in.Get<GLuint>());
+            GlApi::UseProgram(m_program);
+            break;
+        case GlApi::OP_BIND_VERTEX_ARRAY:
+            GlApi::BindVertexArray(Map(VERTEX_ARRAY_OBJECT, in.Get<GLuint>()));
+            break;
+        case GlApi::OP_BIND_BUFFER:
+        {
+            GLenum target = in.Get<GLenum>();
+            GlApi::BindBuffer(target, Map(BUFFER_OBJECT, in.Get<GLuint>()));
+            break;
+        }
+        case GlApi::OP_BIND_TEXTURE_UNIT:
+        {
+            GLuint unit = in.Get<GLuint>();
+            GlApi::BindTextureUnit(unit, Map(TEXTURE_OBJECT, in.Get<GLuint>()));
+            break;
+        }
+        case GlApi::OP_ACTIVE_TEXTURE:
+            GlApi::ActiveTexture(in.Get<GLenum>());
+            break;
+        case GlApi::OP_BIND_TEXTURE:
+        {
+            GLenum target = in.Get<GLenum>();
+            GlApi::BindTexture(target, Map(TEXTURE_OBJECT, in.Get<GLuint>()));
+            break;
+        }
+        case GlApi::OP_BIND_FRAMEBUFFER:
+        {
+            GLenum target = in.Get<GLenum>();
+            GlApi::BindFramebuffer(target, Map(FRAMEBUFFER_OBJECT, in.Get<GLuint>()));
+            break;
+        }
+        case GlApi::OP_BIND_RENDERBUFFER:
+        {
+            GLenum target = in.Get<GLenum>();
+            GlApi::BindRenderbuffer(target, Map(RENDERBUFFER_OBJECT, in.Get<GLuint>()));
+            break;
+        }
+        case GlApi::OP_PIXEL_STOREI:
+        {
+            GLenum pname = in.Get<GLenum>();
+            GlApi::PixelStorei(pname, in.Get<GLint>());
+            break;
+        }
+        case GlApi::OP_TEX_PARAMETERI:
+        {
+            GLenum target = in.Get<GLenum>();
+            GLenum pname = in.Get<GLenum>();
+            GlApi::TexParameteri(target, pname, in.Get<GLint>());
+            break;
+        }
+        case GlApi::OP_VERTEX_ATTRIB_POINTER:
+        {
+            GLuint index = in.Get<GLuint>();
+            GLint size = in.Get<GLint>();
+            GLenum type = in.Get<GLenum>();
+            GLboolean normalized = in.Get<GLboolean>();
+            GLsizei stride = in.Get<GLsizei>();
+            uint64_t offset = in.Get<uint64_t>();
+            if (!in.Failed())
+                GlApi::VertexAttribPointer(index, size, type, normalized, stride, reinterpret_cast<const void*>(offset));
+            break;
+        }
+        case GlApi::OP_ENABLE_VERTEX_ATTRIB_ARRAY:
+            GlApi::EnableVertexAttribArray(in.Get<GLuint>());
+            break;
+        case GlApi::OP_GET_UNIFORM_LOCATION:
+        {
+            GLuint program = Map(PROGRAM_OBJECT, in.Get<GLuint>());
+            size_t size = 0;
+            const uint8_t* name = in.GetBlob(size);
+            GLint captured = in.Get<GLint>();
+            if (in.Failed())
+                break;
+            std::string uniform(reinterpret_cast<const char*>(name), size);
+            m_locations[(static_cast<uint64_t>(program) << 32) | static_cast<uint32_t>(captured)] =
+                GlApi::GetUniformLocation(program, uniform.c_str());
+            break;
+        }
+        case GlApi::OP_UNIFORM_1I:
+        {
+            GLint location = MapLocation(in.Get<GLint>());
+            GlApi::Uniform1i(location, in.Get<GLint>());
+            break;
+        }
+        case GlApi::OP_UNIFORM_1F:
+        {
+            GLint location = MapLocation(in.Get<GLint>());
+            GlApi::Uniform1f(location, in.Get<GLfloat>());
+            break;
+        }
+        case GlApi::OP_UNIFORM_3FV:
+        {
+            GLint location = MapLocation(in.Get<GLint>());
+            GLsizei count = in.Get<GLsizei>();
+            const GLfloat* value = uniformData(count, sizeof(GLfloat) * 3);
+            valid = value != nullptr || count == 0;
+            if (valid && !in.Failed())
+                GlApi::Uniform3fv(location, count, value);
+            break;
+        }
+        case GlApi::OP_UNIFORM_MATRIX_3FV:
+        case GlApi::OP_UNIFORM_MATRIX_4FV:
+        {
+            GLint location = MapLocation(in.Get<GLint>());
+            GLsizei count = in.Get<GLsizei>();
+            GLboolean transpose = in.Get<GLboolean>();
+            bool matrix4 = op == GlApi::OP_UNIFORM_MATRIX_4FV;
+            const GLfloat* value = uniformData(count, sizeof(GLfloat) * (matrix4 ? 16 : 9));
+            valid = value != nullptr || count == 0;
+            if (!valid || in.Failed())
+                break;
+            if (matrix4)
+                GlApi::UniformMatrix4fv(location, count, transpose, value);
+            else
+                GlApi::UniformMatrix3fv(location, count, transpose, value);
+            break;
+        }
+        case GlApi::OP_BUFFER_DATA:
+        {
+            GLenum target = in.Get<GLenum>();
+            uint64_t size = in.Get<uint64_t>();
+            GLenum usage = in.Get<GLenum>();
+            size_t dataSize = 0;
+            const uint8_t* data = in.GetBlob(dataSize);
+            valid = data == nullptr || dataSize == size;
+            if (valid && !in.Failed())
+                GlApi::BufferData(target, static_cast<GLsizeiptr>(size), data, usage);
+            break;
+        }
+        case GlApi::OP_TEX_IMAGE_2D:
+        {
+            GLenum target = in.Get<GLenum>();
+            GLint level = in.Get<GLint>();
+            GLint internalFormat = in.Get<GLint>();
+            GLsizei w = in.Get<GLsizei>();
+            GLsizei h = in.Get<GLsizei>();
+            GLint border = in.Get<GLint>();
+            GLenum format = in.Get<GLenum>();
+            GLenum type = in.Get<GLenum>();
+            size_t size = 0;
+            const uint8_t* pixels = in.GetBlob(size);
+            // The recorded size used the capture's unpack alignment, which the replayed PixelStorei calls restore
+            valid = pixels == nullptr || size >= GlApi::GetImageSize(w, h, format, type, 1);
+            if (valid && !in.Failed())
+                GlApi::TexImage2D(target, level, internalFormat, w, h, border, format, type, pixels);
+            break;
+        }
+        case GlApi::OP_GENERATE_MIPMAP:
+            GlApi::GenerateMipmap(in.Get<GLenum>());
+            break;
+        case GlApi::OP_RENDERBUFFER_STORAGE:
+        {
+            GLenum target = in.Get<GLenum>();
+            GLenum internalFormat = in.Get<GLenum>();
+            GLsizei w = in.Get<GLsizei>();
+            GLsizei h = in.Get<GLsizei>();
+            GlApi::RenderbufferStorage(target, internalFormat, w, h);
+            break;
+        }
+        case GlApi::OP_FRAMEBUFFER_RENDERBUFFER:
+        {
+            GLenum target = in.Get<GLenum>();
+            GLenum attachment = in.Get<GLenum>();
+            GLenum renderbufferTarget = in.Get<GLenum>();
+            GlApi::FramebufferRenderbuffer(target, attachment, renderbufferTarget, Map(RENDERBUFFER_OBJECT, in.Get<GLuint>()));
+            break;
+        }
+        case GlApi::OP_GEN_BUFFERS:
+            valid = generate(BUFFER_OBJECT, GlApi::GenBuffers);
+            break;
+        case GlApi::OP_GEN_VERTEX_ARRAYS:
+            valid = generate(VERTEX_ARRAY_OBJECT, GlApi::GenVertexArrays);
+            break;
+        case GlApi::OP_GEN_TEXTURES:
+            valid = generate(TEXTURE_OBJECT, GlApi::GenTextures);
+            break;
+        case GlApi::OP_GEN_FRAMEBUFFERS:
+            valid = generate(FRAMEBUFFER_OBJECT, GlApi::GenFramebuffers);
+            break;
+        case GlApi::OP_GEN_RENDERBUFFERS:
+            valid = generate(RENDERBUFFER_OBJECT, GlApi::GenRenderbuffers);
+            break;
+        case GlApi::OP_DELETE_BUFFERS:
+            valid = remove(BUFFER_OBJECT, GlApi::DeleteBuffers);
+            break;
+        case GlApi::OP_DELETE_VERTEX_ARRAYS:
+            valid = remove(VERTEX_ARRAY_OBJECT, GlApi::DeleteVertexArrays);
+            break;
+        case GlApi::OP_DELETE_TEXTURES:
+            valid = remove(TEXTURE_OBJECT, GlApi::DeleteTextures);
+            break;
+        case GlApi::OP_DELETE_FRAMEBUFFERS:
+            valid = remove(FRAMEBUFFER_OBJECT, GlApi::DeleteFramebuffers);
+            break;
+        case GlApi::OP_DELETE_RENDERBUFFERS:
+            valid = remove(RENDERBUFFER_OBJECT, GlApi::DeleteRenderbuffers);
+            break;
+        case GlApi::OP_CREATE_SHADER:
+        {
+            GLenum type = in.Get<GLenum>();
+            GLuint captured = in.Get<GLuint>();
+            if (!in.Failed())
+                m_names[SHADER_OBJECT][captured] = GlApi::CreateShader(type);
+            break;
+        }
+        case GlApi::OP_SHADER_SOURCE:
+        {
+            GLuint shader = Map(SHADER_OBJECT, in.Get<GLuint>());
+            GLsizei count = in.Get<GLsizei>();
+            sources.clear();
+            lengths.clear();
+            for (GLsizei i = 0; i < count && !in.Failed(); ++i)
+            {
+                size_t size = 0;
+                const uint8_t* source = in.GetBlob(size);
+                sources.push_back(source != nullptr ? reinterpret_cast<const GLchar*>(source) : "");
+                lengths.push_back(static_cast<GLint>(size));
+            }
+            if (!in.Failed())
+                GlApi::ShaderSource(shader, count, sources.data(), lengths.data());
+            break;
+        }
+        case GlApi::OP_COMPILE_SHADER:
+            GlApi::CompileShader(Map(SHADER_OBJECT, in.Get<GLuint>()));
+            break;
+        case GlApi::OP_DELETE_SHADER:
+        {
+            GLuint captured = in.Get<GLuint>();
+            GlApi::DeleteShader(Map(SHADER_OBJECT, captured));
+            m_names[SHADER_OBJECT].erase(captured);
+            break;
+        }
+        case GlApi::OP_CREATE_PROGRAM:
+        {
+            GLuint captured = in.Get<GLuint>();
+            if (!in.Failed())
+                m_names[PROGRAM_OBJECT][captured] = GlApi::CreateProgram();
+            break;
+        }
+        case GlApi::OP_ATTACH_SHADER:
+        {
+            GLuint program = Map(PROGRAM_OBJECT, in.Get<GLuint>());
+            GlApi::AttachShader(program, Map(SHADER_OBJECT, in.Get<GLuint>()));
+            break;
+        }
+        case GlApi::OP_PROGRAM_PARAMETERI:
+        {
+            GLuint program = Map(PROGRAM_OBJECT, in.Get<GLuint>());
+            GLenum pname = in.Get<GLenum>();
+            GlApi::ProgramParameteri(program, pname, in.Get<GLint>());
+            break;
+        }
+        case GlApi::OP_LINK_PROGRAM:
+            GlApi::LinkProgram(Map(PROGRAM_OBJECT, in.Get<GLuint>()));
+            break;
+        case GlApi::OP_DELETE_PROGRAM:
+        {
+            GLuint captured = in.Get<GLuint>();
+            GlApi::DeleteProgram(Map(PROGRAM_OBJECT, captured));
+            m_names[PROGRAM_OBJECT].erase(captured);
+            break;
+        }
+        case GlApi::OP_BIND_BUFFER_RANGE:
+        {
+            GLenum target = in.Get<GLenum>();
+            GLuint index = in.Get<GLuint>();
+            GLuint buffer = Map(BUFFER_OBJECT, in.Get<GLuint>());
+            uint64_t offset = in.Get<uint64_t>();
+            uint64_t size = in.Get<uint64_t>();
+            GlApi::BindBufferRange(target, index, buffer, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size));
+            break;
+        }
+        case GlApi::OP_CREATE_BUFFERS:
+            valid = generate(BUFFER_OBJECT, GlApi::CreateBuffers);
+            break;
+        case GlApi::OP_NAMED_BUFFER_STORAGE:
+        {
+            GLuint buffer = Map(BUFFER_OBJECT, in.Get<GLuint>());
+            uint64_t size = in.Get<uint64_t>();
+            GLbitfield flags = in.Get<GLbitfield>();
+            size_t dataSize = 0;
+            const uint8_t* data = in.GetBlob(dataSize);
+            valid = data == nullptr || dataSize == size;
+            // Writes made through a mapping come back as NamedBufferSubData calls, which need dynamic storage
+            if (valid && !in.Failed())
+                GlApi::NamedBufferStorage(buffer, static_cast<GLsizeiptr>(size), data, flags | GL_DYNAMIC_STORAGE_BIT);
+            break;
+        }
+        case GlApi::OP_NAMED_BUFFER_SUB_DATA:
+        {
+            GLuint buffer = Map(BUFFER_OBJECT, in.Get<GLuint>());
+            uint64_t offset = in.Get<uint64_t>();
+            size_t size = 0;
+            const uint8_t* data = in.GetBlob(size);
+            if (!in.Failed() && size > 0)
+                GlApi::NamedBufferSubData(buffer, static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size), data);
+            break;
+        }
+        case GlApi::OP_CREATE_VERTEX_ARRAYS:
+            valid = generate(VERTEX_ARRAY_OBJECT, GlApi::CreateVertexArrays);
+            break;
+        case GlApi::OP_CREATE_FRAMEBUFFERS:
+            valid = generate(FRAMEBUFFER_OBJECT, GlApi::CreateFramebuffers);
+            break;
+        case GlApi::OP_CREATE_RENDERBUFFERS:
+            valid = generate(RENDERBUFFER_OBJECT, GlApi::CreateRenderbuffers);
+            break;
+        case GlApi::OP_CREATE_TEXTURES:
+        {
+            GLenum target = in.Get<GLenum>();
+            valid = generate(TEXTURE_OBJECT, [target](GLsizei count, GLuint* textures) { GlApi::CreateTextures(target, count, textures); });
+            break;
+        }
+        case GlApi::OP_VERTEX_ARRAY_VERTEX_BUFFER:
+        {
+            GLuint vertexArray = Map(VERTEX_ARRAY_OBJECT, in.Get<GLuint>());
+            GLuint binding = in.Get<GLuint>();
+            GLuint buffer = Map(BUFFER_OBJECT, in.Get<GLuint>());
+            uint64_t offset = in.Get<uint64_t>();
+            GLsizei stride = in.Get<GLsizei>();
+            if (!in.Failed())
+                GlApi::VertexArrayVertexBuffer(vertexArray, binding, buffer, static_cast<GLintptr>(offset), stride);
+            break;
+        }
+        case GlApi::OP_VERTEX_ARRAY_ELEMENT_BUFFER:
+        {
+            GLuint vertexArray = Map(VERTEX_ARRAY_OBJECT, in.Get<GLuint>());
+            GlApi::VertexArrayElementBuffer(vertexArray, Map(BUFFER_OBJECT, in.Get<GLuint>()));
+            break;
+        }
+        case GlApi::OP_ENABLE_VERTEX_ARRAY_ATTRIB:
+        {
+            GLuint vertexArray = Map(VERTEX_ARRAY_OBJECT, in.Get<GLuint>());
+            GlApi::EnableVertexArrayAttrib(vertexArray, in.Get<GLuint>());
+            break;
+        }
+        case GlApi::OP_VERTEX_ARRAY_ATTRIB_FORMAT:
+        {
+            GLuint vertexArray = Map(VERTEX_ARRAY_OBJECT, in.Get<GLuint>());
+            GLuint index = in.Get<GLuint>();
+            GLint size = in.Get<GLint>();
+            GLenum type = in.Get<GLenum>();
+            GLboolean normalized = in.Get<GLboolean>();
+            GLuint offset = in.Get<GLuint>();
+            if (!in.Failed())
+                GlApi::VertexArrayAttribFormat(vertexArray, index, size, type, normalized, offset);
+            break;
+        }
+        case GlApi::OP_VERTEX_ARRAY_ATTRIB_BINDING:
+        {
+            GLuint vertexArray = Map(VERTEX_ARRAY_OBJECT, in.Get<GLuint>());
+            GLuint index = in.Get<GLuint>();
+            GlApi::VertexArrayAttribBinding(vertexArray, index, in.Get<GLuint>());
+            break;
+        }
+        case GlApi::OP_TEXTURE_STORAGE_2D:
+        {
+            GLuint texture = Map(TEXTURE_OBJECT, in.Get<GLuint>());
+            GLsizei levels = in.Get<GLsizei>();
+            GLenum internalFormat = in.Get<GLenum>();
+            GLsizei w = in.Get<GLsizei>();
+            GLsizei h = in.Get<GLsizei>();
+            if (!in.Failed())
+                GlApi::TextureStorage2D(texture, levels, internalFormat, w, h);
+            break;
+        }
+        case GlApi::OP_TEXTURE_SUB_IMAGE_2D:
+        {
+            GLuint texture = Map(TEXTURE_OBJECT, in.Get<GLuint>());
+            GLint level = in.Get<GLint>();
+            GLint x = in.Get<GLint>();
+            GLint y = in.Get<GLint>();
+            GLsizei w = in.Get<GLsizei>();
+            GLsizei h = in.Get<GLsizei>();
+            GLenum format = in.Get<GLenum>();
+            GLenum type = in.Get<GLenum>();
+            size_t size = 0;
+            const uint8_t* pixels = in.GetBlob(size);
+            // As for OP_TEX_IMAGE_2D, the replayed PixelStorei calls restore the alignment
+            valid = pixels == nullptr || size >= GlApi::GetImageSize(w, h, format, type, 1);
+            if (valid && !in.Failed())
+                GlApi::TextureSubImage2D(texture, level, x, y, w, h, format, type, pixels);
+            break;
+        }
+        case GlApi::OP_GENERATE_TEXTURE_MIPMAP:
+            GlApi::GenerateTextureMipmap(Map(TEXTURE_OBJECT, in.Get<GLuint>()));
+            break;
+        case GlApi::OP_TEXTURE_PARAMETERI:
+        {
+            GLuint texture = Map(TEXTURE_OBJECT, in.Get<GLuint>());
+            GLenum pname = in.Get<GLenum>();
+            GlApi::TextureParameteri(texture, pname, in.Get<GLint>());
+            break;
+        }
+        case GlApi::OP_NAMED_RENDERBUFFER_STORAGE:
+        {
+            GLuint renderbuffer = Map(RENDERBUFFER_OBJECT, in.Get<GLuint>());
+            GLenum internalFormat = in.Get<GLenum>();
+            GLsizei w = in.Get<GLsizei>();
+            GLsizei h = in.Get<GLsizei>();
+            GlApi::NamedRenderbufferStorage(renderbuffer, internalFormat, w, h);
+            break;
+        }
+        case GlApi::OP_NAMED_FRAMEBUFFER_RENDERBUFFER:
+        {
+            GLuint framebuffer = Map(FRAMEBUFFER_OBJECT, in.Get<GLuint>());
+            GLenum attachment = in.Get<GLenum>();
+            GLenum renderbufferTarget = in.Get<GLenum>();
+            GlApi::NamedFramebufferRenderbuffer(framebuffer, attachment, renderbufferTarget, Map(RENDERBUFFER_OBJECT, in.Get<GLuint>()));
+            break;
+        }
+        default:
+            valid = false;
+            break;
+        }
+
+        if (!valid || in.Failed())
+        {
+            std::cerr << "Malformed GL capture stream (op " << op << ")" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void GlReplay::test()
+{
+    std::cout << "[GlReplay] Running tests...\n";
+
+    GlApi::SetTestMode(true);
+    GlApi::ResetStateCache();
+    GlApi::EndFrame();
+
+    // Record a small scene: a program, a mesh and a texture, then a frame that draws it
+    bool started = GlApi::BeginCapture("", 0);
+    assert(started && "BeginCapture failed");
+    GLuint shader = GlApi::CreateShader(GL_VERTEX_SHADER);
+    const char* source = "void main() {}";
+    GlApi::ShaderSource(shader, 1, &source, nullptr);
+    GlApi::CompileShader(shader);
+    GLuint program = GlApi::CreateProgram();
+    GlApi::AttachShader(program, shader);
+    GlApi::LinkProgram(program);
+    GlApi::DeleteShader(shader);
+
+    GLuint vertexArray = 0;
+    GLuint buffers[2];
+    GlApi::GenVertexArrays(1, &vertexArray);
+    GlApi::GenBuffers(2, buffers);
+    GlApi::BindVertexArray(vertexArray);
+    std::vector<float> vertices(9, 1.0f);
+    std::vector<unsigned int> indices = { 0, 1, 2 };
+    GlApi::BindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    GlApi::BufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices.size() * sizeof(float)), vertices.data(), GL_STATIC_DRAW);
+    GlApi::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+    GlApi::BufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(unsigned int)), indices.data(), GL_STATIC_DRAW);
+    GlApi::EnableVertexAttribArray(0);
+    GlApi::VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 12, nullptr);
+    GlApi::BindVertexArray(0);
+
+    GLuint texture = 0;
+    GlApi::GenTextures(1, &texture);
+    GlApi::BindTexture(GL_TEXTURE_2D, texture);
+    std::vector<uint8_t> pixels(2 * 2 * 3, 255);
+    GlApi::PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    GlApi::TexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 2, 2, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    GlApi::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    // The same resources again, created through direct state access
+    GLuint dsaVertexArray = 0;
+    GLuint dsaBuffers[2];
+    GlApi::CreateBuffers(2, dsaBuffers);
+    GlApi::NamedBufferStorage(dsaBuffers[0], static_cast<GLsizeiptr>(vertices.size() * sizeof(float)), vertices.data(), 0);
+    GlApi::NamedBufferStorage(dsaBuffers[1], static_cast<GLsizeiptr>(indices.size() * sizeof(unsigned int)), indices.data(), 0);
+    GlApi::CreateVertexArrays(1, &dsaVertexArray);
+    GlApi::VertexArrayVertexBuffer(dsaVertexArray, 0, dsaBuffers[0], 0, 12);
+    GlApi::VertexArrayElementBuffer(dsaVertexArray, dsaBuffers[1]);
+    GlApi::EnableVertexArrayAttrib(dsaVertexArray, 0);
+    GlApi::VertexArrayAttribFormat(dsaVertexArray, 0, 3, GL_FLOAT, GL_FALSE, 0);
+    GlApi::VertexArrayAttribBinding(dsaVertexArray, 0, 0);
+
+    GLuint dsaTexture = 0;
+    GlApi::CreateTextures(GL_TEXTURE_2D, 1, &dsaTexture);
+    GlApi::TextureStorage2D(dsaTexture, GlApi::GetMipLevelCount(2, 2), GL_RGB8, 2, 2);
+    GlApi::TextureSubImage2D(dsaTexture, 0, 0, 0, 2, 2, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    GlApi::GenerateTextureMipmap(dsaTexture);
+    GlApi::TextureParameteri(dsaTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+    GLuint renderbuffer = 0;
+    GLuint framebuffer = 0;
+    GlApi::CreateRenderbuffers(1, &renderbuffer);
+    GlApi::NamedRenderbufferStorage(renderbuffer, GL_RGBA8, 32, 32);
+    GlApi::CreateFramebuffers(1, &framebuffer);
+    GlApi::NamedFramebufferRenderbuffer(framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+
+    GlApi::BeginFrame();
+    GlApi::Viewport(0, 0, 32, 32);
+    GlApi::ClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    GlApi::Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    GlApi::UseProgram(program);
+    float matrix[16] = { 1.0f };
+    float color[3] = { 1.0f, 0.5f, 0.0f };
+    GlApi::UniformMatrix4fv(GlApi::GetUniformLocation(program, "model"), 1, GL_FALSE, matrix);
+    GlApi::Uniform3fv(GlApi::GetUniformLocation(program, "color"), 1, color);
+    GlApi::ActiveTexture(GL_TEXTURE0);
+    GlApi::BindTexture(GL_TEXTURE_2D, texture);
+    GlApi::BindVertexArray(vertexArray);
+    GlApi::DrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, nullptr);
+    GlApi::BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    GlApi::BindTextureUnit(0, dsaTexture);
+    GlApi::BindVertexArray(dsaVertexArray);
+    GlApi::DrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, nullptr);
+    GlFrameStats captured = GlApi::GetCurrentStats();
+    GlApi::EndFrame();
+
+    GlCapture capture = GlApi::GetLastCapture();
+    assert(!capture.setup.empty() && !capture.frame.empty() && "Capture should have both streams");
+
+    // Test replaying the capture
+    {
+        std::string path = "gl_replay_test.glc";
+        bool written = capture.Write(path);
+        assert(written && "GlCapture::Write failed");
+        GlCapture loaded;
+        bool read = loaded.Read(path);
+        assert(read && "GlCapture::Read failed");
+        std::remove(path.c_str());
+
+        GlReplay replay(loaded);
+        bool setUp = replay.Setup();
+        assert(setUp && "Setup stream should replay");
+        for (int i = 0; i < 3; ++i)
+        {
+            bool replayed = replay.ReplayFrame();
+            assert(replayed && "Frame stream should replay");
+            GlFrameStats replayedStats = GlApi::GetFrameStats();
+            assert(replayedStats.drawCalls == captured.drawCalls && replayedStats.indices == captured.indices &&
+                   replayedStats.uniformUploads == captured.uniformUploads && replayedStats.calls == captured.calls &&
+                   "Replayed frame should issue the captured calls");
+        }
+        assert(replay.GetUnknownNames() == 0 && "All names should have been created by the setup stream");
+    }
+
+    // Test that frames replayed without their setup report unknown names
+    {
+        GlReplay replay(capture);
+        bool replayed = replay.ReplayFrame();
+        assert(replayed && "Frame stream should replay");
+        assert(replay.GetUnknownNames() > 0 && "Objects missing from the setup should be reported");
+    }
+
+    // Test malformed streams
+    {
+        GlCapture broken = capture;
+        broken.frame.resize(broken.frame.size() - 3);
+        GlReplay truncated(broken);
+        bool setUp = truncated.Setup();
+        bool replayed = truncated.ReplayFrame();
+        assert(setUp && !replayed && "Truncated stream should be rejected");
+
+        broken.frame = { 0xFF, 0xFF };
+        GlReplay unknown(broken);
+        replayed = unknown.ReplayFrame();
+        assert(!replayed && "Unknown op should be rejected");
+    }
+
+    GlApi::ResetStateCache();
+    GlApi::SetTestMode(false);
+
+    std::cout << "[GlReplay] Tests passed!\n";
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include "GlApi.h"
+
+/**
+ * \class GlReplay
+ * \brief Plays a GlCapture back through GlApi, without the engine.
+ *
+ * Setup() recreates the captured resources once; ReplayFrame() then issues the captured
+ * frame as often as needed, so the cost of submitting it can be measured on its own.
+ * Object names and uniform locations are remapped to the ones the replay context hands
+ * out, and the default framebuffer can be redirected, e.g. to a HeadlessContext.
+ */
+class GlReplay
+{
+public:
+    /**
+     * \brief Constructor.
+     * \param capture The capture; must outlive the replay.
+     */
+    explicit GlReplay(const GlCapture& capture);
+
+    /**
+     * \brief Recreate the captured resources. Requires a current context.
+     * \return False if the setup stream is malformed.
+     */
+    bool Setup();
+
+    /**
+     * \brief Issue the captured frame once, between GlApi::BeginFrame() and EndFrame().
+     * \return False if the frame stream is malformed.
+     */
+    bool ReplayFrame();
+
+    /**
+     * \brief Set the framebuffer that captured binds of framebuffer 0 go to.
+     * \param framebuffer Framebuffer name in the replay context.
+     */
+    void SetDefaultFramebuffer(GLuint framebuffer) { m_defaultFramebuffer = framebuffer; }
+
+    /**
+     * \brief Get the number of object names that were used without being created in the capture.
+     *
+     * Non-zero when the capture started after some of the frame's resources were created.
+     * Framebuffers are not counted; unknown ones are taken to be the default framebuffer.
+     *
+     * \return Unknown names seen so far.
+     */
+    size_t GetUnknownNames() const { return m_unknownNames; }
+
+    /**
+     * \brief Run unit tests for the GlReplay class.
+     */
+    static void test();
+
+private:
+    /**
+     * \enum ObjectKind
+     * \brief Name spaces of GL objects.
+     */
+    enum ObjectKind
+    {
+        BUFFER_OBJECT, VERTEX_ARRAY_OBJECT, TEXTURE_OBJECT, FRAMEBUFFER_OBJECT, RENDERBUFFER_OBJECT,
+        SHADER_OBJECT, PROGRAM_OBJECT, OBJECT_KIND_COUNT
+    };
+
+    /**
+     * \brief Execute one stream.
+     * \param stream The recorded calls.
+     * \return False if the stream is malformed.
+     */
+    bool Run(const std::vector<uint8_t>& stream);
+
+    /**
+     * \brief Translate a captured object name.
+     * \param kind Name space.
+     * \param name Captured name.
+     * \return Replay name; 0 for 0 and for unknown names, except for framebuffers, which
+     *         go to the default framebuffer.
+     */
+    GLuint Map(ObjectKind kind, GLuint name);
+
+    /**
+     * \brief Translate a captured uniform location of the current program.
+     * \param location Captured location.
+     * \return Replay location.
+     */
+    GLint MapLocation(GLint location) const;
+
+    const GlCapture& m_capture;                                     ///< Played capture
+    std::unordered_map<GLuint, GLuint> m_names[OBJECT_KIND_COUNT];  ///< Captured to replay names
+    std::unordered_map<uint64_t, GLint> m_locations;                ///< (replay program, captured location) to replay location
+    GLuint m_program;                                               ///< Current replay program
+    GLuint m_defaultFramebuffer;                                    ///< Target of captured framebuffer 0
+    size_t m_unknownNames;                                          ///< Names used without being created
+};
@@ -0,0 +1,631 @@
+#include "HeadlessContext.h"
+#include "Scene.h"
+#include "Model.h"
+#include "Profiler.h"
+#include "GlApi.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+
+#ifdef SNAPENGINE_HAS_EGL
+    #include <EGL/egl.h>
+    #include <EGL/eglext.h>
+#endif
+
+namespace {
+
+// The engine's shaders target GL 4.5 core, the highest version Mesa llvmpipe exposes
+constexpr int CONTEXT_MAJOR_VERSION = 4;
+constexpr int CONTEXT_MINOR_VERSION = 5;
+
+// Flip an image stored bottom row first, as glReadPixels returns it
+template <typename T>
+void FlipRows(std::vector<T>& data, size_t rowLength, size_t rows)
+{
+    for (size_t top = 0, bottom = rows - 1; top < bottom; ++top, --bottom)
+    {
+        std::swap_ranges(data.begin() + top * rowLength, data.begin() + (top + 1) * rowLength, data.begin() + bottom * rowLength);
+    }
+}
+
+#ifdef SNAPENGINE_HAS_EGL
+bool HasExtension(const char* extensions, const char* name)
+{
+    if (extensions == nullptr)
+        return false;
+    size_t length = std::strlen(name);
+    for (const char* p = std::strstr(extensions, name); p != nullptr; p = std::strstr(p + length, name))
+    {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+            return true;
+    }
+    return false;
+}
+#endif
+
+// A cube of side 2 centred on the origin, wound counter-clockwise; untextured white by default
+Mesh MakeCube(std::shared_ptr<Material> material = nullptr)
+{
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    const glm::vec3 normals[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    for (const glm::vec3& n : normals)
+    {
+        glm::vec3 u(n.y, n.z, n.x);
+        glm::vec3 v = glm::cross(n, u);
+        unsigned int base = static_cast<unsigned int>(vertices.size());
+        vertices.push_back({ n - u - v, n, { 0.0f, 0.0f } });
+        vertices.push_back({ n + u - v, n, { 1.0f, 0.0f } });
+        vertices.push_back({ n + u + v, n, { 1.0f, 1.0f } });
+        vertices.push_back({ n - u + v, n, { 0.0f, 1.0f } });
+        indices.insert(indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+    }
+    if (!material)
+        material = std::make_shared<Material>(std::vector<Texture>(), MaterialParameters());
+    return Mesh(vertices, indices, material);
+}
+
+// A mipmapped RGB checkerboard, created like the textures Model loads
+GLuint MakeCheckerTexture(int size, int cell)
+{
+    std::vector<uint8_t> texels(static_cast<size_t>(size) * size * 3);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            uint8_t value = ((x / cell + y / cell) % 2 == 0) ? 220 : 60;
+            uint8_t* texel = &texels[(static_cast<size_t>(y) * size + x) * 3];
+            texel[0] = value;
+            texel[1] = static_cast<uint8_t>(value / 2 + 40);
+            texel[2] = static_cast<uint8_t>(255 - value);
+        }
+    }
+
+    return Model::CreateTexture(texels.data(), size, size, 3);
+}
+
+} // namespace
+
+HeadlessContext::HeadlessContext(int width, int height, const HeadlessContext* shareWith)
+    : m_width(width)
+    , m_height(height)
+    , m_display(nullptr)
+    , m_context(nullptr)
+    , m_surface(nullptr)
+    , m_framebuffer(0)
+    , m_colorBuffer(0)
+    , m_depthBuffer(0)
+    , m_shareWith(shareWith)
+{
+    if (!CreateContext())
+    {
+        DestroyContext();
+        throw std::runtime_error("Failed to create headless GL context");
+    }
+
+    // Load GL entry points; glewInit() would also require a GLX display
+    glewExperimental = GL_TRUE;
+    if (glewContextInit() != GLEW_OK)
+    {
+        DestroyContext();
+        throw std::runtime_error("Failed to initialize GLEW for headless context");
+    }
+
+    const GLubyte* renderer = glGetString(GL_RENDERER);
+    m_renderer = renderer != nullptr ? reinterpret_cast<const char*>(renderer) : "";
+
+    if (!CreateFramebuffer())
+    {
+        DestroyFramebuffer();
+        DestroyContext();
+        throw std::runtime_error("Failed to create headless framebuffer");
+    }
+
+    // Configure OpenGL
+    GlApi::Enable(GL_DEPTH_TEST);
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    if (MakeCurrent())
+    {
+        PROFILE_CALL(Profiler::Get().ReleaseGpuQueries());
+        DestroyFramebuffer();
+    }
+    DestroyContext();
+}
+
+bool HeadlessContext::CreateContext()
+{
+#ifdef SNAPENGINE_HAS_EGL
+    // Prefer the surfaceless platform, which needs neither a display server nor a GPU
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    EGLDisplay display = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (m_shareWith != nullptr)
+        display = static_cast<EGLDisplay>(m_shareWith->m_display);
+    else if (getPlatformDisplay != nullptr && HasExtension(clientExtensions, "EGL_MESA_platform_surfaceless"))
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        std::cerr << "Failed to initialize EGL display" << std::endl;
+        return false;
+    }
+    m_display = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cerr << "EGL implementation does not support desktop OpenGL" << std::endl;
+        return false;
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+    {
+        std::cerr << "No EGL config supports desktop OpenGL" << std::endl;
+        return false;
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, CONTEXT_MAJOR_VERSION,
+        EGL_CONTEXT_MINOR_VERSION, CONTEXT_MINOR_VERSION,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext shareContext = m_shareWith != nullptr ? static_cast<EGLContext>(m_shareWith->m_context) : EGL_NO_CONTEXT;
+    EGLContext context = eglCreateContext(display, config, shareContext, contextAttributes);
+    if (context == EGL_NO_CONTEXT)
+    {
+        std::cerr << "Failed to create EGL context (error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        return false;
+    }
+    m_context = context;
+
+    // Rendering goes to our own framebuffer; a tiny pbuffer only stands in when the
+    // context cannot be made current without a surface
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!HasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+    {
+        const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+        if (surface == EGL_NO_SURFACE)
+        {
+            std::cerr << "Failed to create EGL pbuffer surface" << std::endl;
+            return false;
+        }
+    }
+    m_surface = surface;
+
+    return MakeCurrent();
+#else
+    std::cerr << "Headless rendering requires EGL support at build time" << std::endl;
+    return false;
+#endif
+}
+
+void HeadlessContext::DestroyContext()
+{
+#ifdef SNAPENGINE_HAS_EGL
+    if (m_display == nullptr)
+        return;
+
+    EGLDisplay display = static_cast<EGLDisplay>(m_display);
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_surface != EGL_NO_SURFACE)
+        eglDestroySurface(display, static_cast<EGLSurface>(m_surface));
+    if (m_context != nullptr)
+        eglDestroyContext(display, static_cast<EGLContext>(m_context));
+
+    // The display is the sharing context's too; it terminates it
+    if (m_shareWith == nullptr)
+        eglTerminate(display);
+#endif
+    m_display = nullptr;
+    m_context = nullptr;
+    m_surface = nullptr;
+}
+
+bool HeadlessContext::MakeCurrent()
+{
+#ifdef SNAPENGINE_HAS_EGL
+    if (m_display == nullptr || m_context == nullptr)
+        return false;
+
+    EGLSurface surface = static_cast<EGLSurface>(m_surface);
+    if (eglMakeCurrent(static_cast<EGLDisplay>(m_display), surface, surface, static_cast<EGLContext>(m_context)) != EGL_TRUE)
+        return false;
+
+    // The shadowed bindings may be another context's
+    GlApi::ResetStateCache();
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool HeadlessContext::CreateFramebuffer()
+{
+    GlApi::CreateRenderbuffers(1, &m_colorBuffer);
+    GlApi::NamedRenderbufferStorage(m_colorBuffer, GL_RGBA8, m_width, m_height);
+
+    GlApi::CreateRenderbuffers(1, &m_depthBuffer);
+    GlApi::NamedRenderbufferStorage(m_depthBuffer, GL_DEPTH_COMPONENT24, m_width, m_height);
+
+    GlApi::CreateFramebuffers(1, &m_framebuffer);
+    GlApi::NamedFramebufferRenderbuffer(m_framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+    GlApi::NamedFramebufferRenderbuffer(m_framebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+
+    GLenum status = GlApi::CheckNamedFramebufferStatus(m_framebuffer, GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << "Headless framebuffer incomplete (status 0x" << std::hex << status << std::dec << ")" << std::endl;
+        return false;
+    }
+
+    Bind();
+    return true;
+}
+
+void HeadlessContext::DestroyFramebuffer()
+{
+    if (m_framebuffer != 0)
+        GlApi::DeleteFramebuffers(1, &m_framebuffer);
+    if (m_colorBuffer != 0)
+        GlApi::DeleteRenderbuffers(1, &m_colorBuffer);
+    if (m_depthBuffer != 0)
+        GlApi::DeleteRenderbuffers(1, &m_depthBuffer);
+    m_framebuffer = 0;
+    m_colorBuffer = 0;
+    m_depthBuffer = 0;
+}
+
+bool HeadlessContext::Resize(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return false;
+
+    DestroyFramebuffer();
+    m_width = width;
+    m_height = height;
+    return CreateFramebuffer();
+}
+
+void HeadlessContext::Bind() const
+{
+    GlApi::BindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    GlApi::Viewport(0, 0, m_width, m_height);
+}
+
+void HeadlessContext::Render(Scene& scene)
+{
+    GlApi::BeginFrame();
+    Bind();
+    scene.BuildSnapshot(m_snapshot);
+    m_snapshot.viewportWidth = m_width;
+    m_snapshot.viewportHeight = m_height;
+    scene.Submit(m_snapshot);
+    m_snapshot.released.clear();
+    GlApi::EndFrame();
+    PROFILE_CALL(Profiler::Get().ResolveGpuQueries());
+}
+
+bool HeadlessContext::ReadColor(std::vector<uint8_t>& pixels) const
+{
+    if (m_framebuffer == 0)
+        return false;
+
+    pixels.resize(static_cast<size_t>(m_width) * m_height * 4);
+    GlApi::BindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    GlApi::PixelStorei(GL_PACK_ALIGNMENT, 1);
+    GlApi::ReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    FlipRows(pixels, static_cast<size_t>(m_width) * 4, static_cast<size_t>(m_height));
+    return glGetError() == GL_NO_ERROR;
+}
+
+bool HeadlessContext::ReadDepth(std::vector<float>& depths) const
+{
+    if (m_framebuffer == 0)
+        return false;
+
+    depths.resize(static_cast<size_t>(m_width) * m_height);
+    GlApi::BindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    GlApi::PixelStorei(GL_PACK_ALIGNMENT, 4);
+    GlApi::ReadPixels(0, 0, m_width, m_height, GL_DEPTH_COMPONENT, GL_FLOAT, depths.data());
+    FlipRows(depths, static_cast<size_t>(m_width), static_cast<size_t>(m_height));
+    return glGetError() == GL_NO_ERROR;
+}
+
+size_t HeadlessContext::CountDifferentPixels(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int tolerance)
+{
+    if (a.size() != b.size() || a.size() % 4 != 0)
+        return SIZE_MAX;
+
+    size_t different = 0;
+    for (size_t i = 0; i < a.size(); i += 4)
+    {
+        for (size_t c = 0; c < 4; ++c)
+        {
+            if (std::abs(static_cast<int>(a[i + c]) - static_cast<int>(b[i + c])) > tolerance)
+            {
+                ++different;
+                break;
+            }
+        }
+    }
+    return different;
+}
+
+void HeadlessContext::test()
+{
+    std::cout << "[HeadlessContext] Running tests...\n";
+
+    // Test image comparison
+    {
+        std::vector<uint8_t> a = { 10, 20, 30, 255, 0, 0, 0, 255, 100, 100, 100, 255 };
+        std::vector<uint8_t> b = { 12, 20, 30, 255, 0, 9, 0, 255, 100, 100, 100, 255 };
+        assert(CountDifferentPixels(a, a, 0) == 0 && "Identical images should not differ");
+        assert(CountDifferentPixels(a, b, 0) == 2 && "Wrong count without tolerance");
+        assert(CountDifferentPixels(a, b, 2) == 1 && "Tolerance should absorb small differences");
+        assert(CountDifferentPixels(a, std::vector<uint8_t>(8), 0) == SIZE_MAX && "Size mismatch should be reported");
+    }
+
+    // Test row flipping
+    {
+        std::vector<int> rows = { 1, 1, 2, 2, 3, 3 };
+        FlipRows(rows, 2, 3);
+        assert(rows == std::vector<int>({ 3, 3, 2, 2, 1, 1 }) && "Rows should be reversed");
+    }
+
+    // Everything else needs a real context
+    bool sceneTestMode = Scene::IsTestMode();
+    bool modelTestMode = Model::IsTestMode();
+    try
+    {
+        const int width = 64;
+        const int height = 48;
+        HeadlessContext context(width, height);
+        std::cout << "[HeadlessContext] Rendering with " << context.GetRenderer() << "\n";
+
+        Scene::SetTestMode(false);
+        Model::SetTestMode(false);
+        {
+            Scene scene;
+            auto cube = std::make_shared<Model>();
+            cube->AddMesh(MakeCube());
+            scene.AddModel(cube);
+
+            context.Render(scene);
+            std::vector<uint8_t> color;
+            std::vector<float> depth;
+            bool colorRead = context.ReadColor(color);
+            bool depthRead = context.ReadDepth(depth);
+            assert(colorRead && color.size() == static_cast<size_t>(width * height * 4) && "Color readback failed");
+            assert(depthRead && depth.size() == static_cast<size_t>(width * height) && "Depth readback failed");
+
+            // The corner shows the clear color (0.2, 0.3, 0.3) at the far plane, the centre the cube
+            std::vector<uint8_t> clearColor = { 51, 77, 77, 255 };
+            std::vector<uint8_t> corner(color.begin(), color.begin() + 4);
+            size_t centre = static_cast<size_t>(height / 2 * width + width / 2);
+            std::vector<uint8_t> middle(color.begin() + centre * 4, color.begin() + centre * 4 + 4);
+            assert(CountDifferentPixels(corner, clearColor, 1) == 0 && depth[0] == 1.0f && "Corner should show the clear color");
+            assert(CountDifferentPixels(middle, clearColor, 1) == 1 && depth[centre] < 1.0f && "Cube should cover the centre");
+            assert(cube->GetMeshes()[0].vao == 0 && scene.GetVertexArrays()->GetCount() == 1 &&
+                   "Scenes should draw through their own vertex arrays, not the mesh's");
+
+            // Rendering the same frame again gives the same image
+            std::vector<uint8_t> again;
+            context.Render(scene);
+            context.ReadColor(again);
+            assert(CountDifferentPixels(color, again, 0) == 0 && "Rendering should be deterministic");
+
+            // A depth pre-pass changes which fragments are shaded, not the image
+            auto behind = std::make_shared<Model>();
+            behind->AddMesh(MakeCube());
+            scene.AddModel(behind, glm::vec3(0.5f, 0.25f, -1.5f), glm::vec3(1.0f), glm::vec3(0.0f, 30.0f, 0.0f));
+            context.Render(scene);
+            context.ReadColor(color);
+            scene.SetDepthPrePass(true);
+            context.Render(scene);
+            context.ReadColor(again);
+            assert(CountDifferentPixels(color, again, 0) == 0 && "Depth pre-pass should not change the image");
+            assert(glGetError() == GL_NO_ERROR && "GL error in depth pre-pass");
+
+            // A red light between the camera and the cube only adds red, with or without the pre-pass
+            Light red;
+            red.position = glm::vec3(0.0f, 0.0f, 1.8f);
+            red.color = glm::vec3(1.0f, 0.0f, 0.0f);
+            red.range = 3.0f;
+            scene.AddLight(red);
+            std::vector<uint8_t> lit;
+            context.Render(scene);
+            context.ReadColor(lit);
+            size_t reddened = 0;
+            bool othersKept = true;
+            for (size_t i = 0; i < lit.size(); i += 4)
+            {
+                reddened += lit[i] > again[i] ? 1 : 0;
+                othersKept = othersKept && lit[i + 1] == again[i + 1] && lit[i + 2] == again[i + 2];
+            }
+            assert(reddened > 0 && othersKept && "Light should redden the cube");
+            assert(scene.GetLightClusterStats().assignments > 0 && "Light should be binned");
+            scene.SetDepthPrePass(false);
+            context.Render(scene);
+            context.ReadColor(again);
+            assert(CountDifferentPixels(lit, again, 0) == 0 && "Clustered lights should not depend on the pre-pass");
+            assert(glGetError() == GL_NO_ERROR && "GL error with clustered lights");
+
+            // A checkerboard texture shows on the cube, created without errors
+            GLuint checker = MakeCheckerTexture(64, 8);
+            auto checkered = std::make_shared<Material>(std::vector<Texture>{ { checker, "texture_diffuse", "" } }, MaterialParameters());
+            auto checkeredCube = std::make_shared<Model>();
+            checkeredCube->AddMesh(MakeCube(checkered));
+            std::vector<uint8_t> plain, textured;
+            {
+                Scene single;
+                single.AddModel(cube);
+                context.Render(single);
+                context.ReadColor(plain);
+            }
+            {
+                Scene single;
+                single.AddModel(checkeredCube);
+                context.Render(single);
+                context.ReadColor(textured);
+            }
+            assert(CountDifferentPixels(plain, textured, 0) > 0 && "Texture should change the image");
+            assert(glGetError() == GL_NO_ERROR && "GL error with an immutable texture");
+
+            // A shared context draws the same meshes and shaders through its own vertex arrays
+            {
+                HeadlessContext shared(width, height, &context);
+                {
+                    Scene single(scene.GetResources());
+                    single.AddModel(cube);
+                    shared.Render(single);
+                    std::vector<uint8_t> sharedColor;
+                    shared.ReadColor(sharedColor);
+                    assert(CountDifferentPixels(plain, sharedColor, 0) == 0 && "A shared context should render the same image");
+                    assert(single.GetVertexArrays()->GetCount() == 1 && "The shared mesh should get a vertex array of its own");
+                    assert(glGetError() == GL_NO_ERROR && "GL error in a shared context");
+                }
+            }
+            bool current = context.MakeCurrent();
+            assert(current && "Failed to switch back from the shared context");
+
+            // Resizing reallocates the framebuffer
+            bool resized = context.Resize(32, 16);
+            assert(resized && "Resize failed");
+            context.Render(scene);
+            colorRead = context.ReadColor(again);
+            assert(colorRead && again.size() == 32 * 16 * 4 && "Readback after resize failed");
+            assert(glGetError() == GL_NO_ERROR && "GL error after resize");
+            GlApi::DeleteTextures(1, &checker);
+        }
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << "[HeadlessContext] " << e.what() << ", skipping rendering tests\n";
+    }
+    Scene::SetTestMode(sceneTestMode);
+    Model::SetTestMode(modelTestMode);
+
+    std::cout << "[HeadlessContext] Tests passed!\n";
+}
+
+void HeadlessContext::benchmark()
+{
+    std::cout << "\nRunning HeadlessContext benchmarks...\n";
+
+    bool sceneTestMode = Scene::IsTestMode();
+    bool modelTestMode = Model::IsTestMode();
+    try
+    {
+        HeadlessContext context(1280, 720);
+        Scene::SetTestMode(false);
+        Model::SetTestMode(false);
+        {
+            Scene scene;
+            auto cube = std::make_shared<Model>();
+            cube->AddMesh(MakeCube());
+            for (int i = 0; i < 400; ++i)
+            {
+                glm::vec3 position(static_cast<float>(i % 20) - 10.0f, static_cast<float>(i / 20) - 10.0f, -20.0f);
+                scene.AddModel(cube, position, glm::vec3(0.4f), glm::vec3(0.0f, static_cast<float>(i * 7 % 360), 0.0f));
+            }
+
+            using Clock = std::chrono::high_resolution_clock;
+            std::vector<uint8_t> pixels;
+            const int frames = 50;
+            context.Render(scene);
+            GlApi::Finish();
+
+            auto start = Clock::now();
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                context.Render(scene);
+                GlApi::Finish();
+            }
+            double frameMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+
+            start = Clock::now();
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                context.ReadColor(pixels);
+            }
+            double readbackMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+
+            std::cout << "  " << context.GetRenderer() << ", " << context.GetWidth() << "x" << context.GetHeight() << ", "
+                      << scene.GetObjectCount() << " cubes: " << frameMs << " ms/frame, color readback " << readbackMs << " ms\n";
+        }
+
+        // Overdraw: full-screen textured slabs, each its own model. Draws are grouped by
+        // model address, so ranking the models by address fixes the order they are drawn in:
+        // back to front shades every layer, front to back is the best case without a pre-pass.
+        {
+            GLuint checker = MakeCheckerTexture(256, 16);
+            auto material = std::make_shared<Material>(
+                std::vector<Texture>{ { checker, "texture_diffuse", "" }, { checker, "texture_specular", "" } }, MaterialParameters());
+            const int layers = 64;
+            std::vector<std::shared_ptr<Model>> slabs;
+            for (int i = 0; i < layers; ++i)
+            {
+                slabs.push_back(std::make_shared<Model>());
+                slabs.back()->AddMesh(MakeCube(material));
+            }
+            std::sort(slabs.begin(), slabs.end());
+
+            using Clock = std::chrono::high_resolution_clock;
+            const int frames = 10;
+            const char* orders[2] = { "back to front", "front to back" };
+            for (int order = 0; order < 2; ++order)
+            {
+                Scene scene;
+                for (int i = 0; i < layers; ++i)
+                {
+                    float depth = static_cast<float>(order == 0 ? i : layers - 1 - i);
+                    scene.AddModel(slabs[i], glm::vec3(0.0f, 0.0f, -8.0f + 0.1f * depth), glm::vec3(8.0f, 8.0f, 0.02f));
+                }
+
+                double frameMs[2] = {};
+                for (int prePass = 0; prePass < 2; ++prePass)
+                {
+                    scene.SetDepthPrePass(prePass != 0);
+                    context.Render(scene);
+                    GlApi::Finish();
+
+                    auto start = Clock::now();
+                    for (int frame = 0; frame < frames; ++frame)
+                    {
+                        context.Render(scene);
+                        GlApi::Finish();
+                    }
+                    frameMs[prePass] = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+                }
+
+                std::cout << "  " << layers << " full-screen layers " << orders[order] << ": " << frameMs[0] << " ms/frame, with depth pre-pass "
+                          << frameMs[1] << " ms/frame (" << frameMs[0] / frameMs[1] << "x)\n";
+            }
+            GlApi::DeleteTextures(1, &checker);
+        }
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << "  " << e.what() << ", skipped\n";
+    }
+    Scene::SetTestMode(sceneTestMode);
+    Model::SetTestMode(modelTestMode);
+}
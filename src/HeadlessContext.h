@@ -0,0 +1,165 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <string>
+#include <GL/glew.h>
+#include "RenderSnapshot.h"
+
+class Scene;
+
+/**
+ * \class HeadlessContext
+ * \brief An OpenGL context without a window that renders into an offscreen framebuffer.
+ *
+ * The context comes from EGL: the Mesa surfaceless platform when available, otherwise
+ * the default display with EGL_KHR_surfaceless_context or a 1x1 pbuffer. It works on
+ * display-less machines with Mesa llvmpipe, for real frame-time benchmarks and
+ * image-diff tests. Rendering goes to a framebuffer object with an RGBA8 color buffer
+ * and a 24-bit depth buffer, which can be read back after each frame.
+ *
+ * Support is compiled in when SNAPENGINE_HAS_EGL is defined; otherwise the constructor
+ * always throws.
+ */
+class HeadlessContext
+{
+public:
+    /**
+     * \brief Constructor. Creates the context, makes it current and creates the framebuffer.
+     * \param width Framebuffer width.
+     * \param height Framebuffer height.
+     * \param shareWith Context to share objects with, or nullptr. Must outlive this one.
+     * \throws std::runtime_error if no headless context can be created.
+     */
+    HeadlessContext(int width, int height, const HeadlessContext* shareWith = nullptr);
+
+    /**
+     * \brief Destructor. Deletes the framebuffer and destroys the context.
+     */
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    /**
+     * \brief Make the context current on the calling thread.
+     * \return True on success.
+     */
+    bool MakeCurrent();
+
+    /**
+     * \brief Reallocate the framebuffer for a new size.
+     * \param width New width.
+     * \param height New height.
+     * \return True if the framebuffer is complete.
+     */
+    bool Resize(int width, int height);
+
+    /**
+     * \brief Bind the framebuffer and set the viewport to cover it.
+     */
+    void Bind() const;
+
+    /**
+     * \brief Render one frame of a scene into the framebuffer.
+     *
+     * The scene must have been created while this context was current, with test mode off.
+     *
+     * \param scene The scene to render.
+     */
+    void Render(Scene& scene);
+
+    /**
+     * \brief Read back the color buffer.
+     * \param pixels Receives width * height RGBA8 pixels, top row first.
+     * \return True on success.
+     */
+    bool ReadColor(std::vector<uint8_t>& pixels) const;
+
+    /**
+     * \brief Read back the depth buffer.
+     * \param depths Receives width * height window-space depths in [0, 1], top row first.
+     * \return True on success.
+     */
+    bool ReadDepth(std::vector<float>& depths) const;
+
+    /**
+     * \brief Get the framebuffer width.
+     * \return Width in pixels.
+     */
+    int GetWidth() const { return m_width; }
+
+    /**
+     * \brief Get the framebuffer height.
+     * \return Height in pixels.
+     */
+    int GetHeight() const { return m_height; }
+
+    /**
+     * \brief Get the offscreen framebuffer.
+     * \return Framebuffer name; 0 in test mode.
+     */
+    GLuint GetFramebuffer() const { return m_framebuffer; }
+
+    /**
+     * \brief Get the GL renderer string, e.g. "llvmpipe (LLVM 15.0.6, 256 bits)".
+     * \return Renderer name.
+     */
+    const std::string& GetRenderer() const { return m_renderer; }
+
+    /**
+     * \brief Count the pixels of two RGBA8 images that differ by more than a tolerance.
+     * \param a First image.
+     * \param b Second image, same size as a.
+     * \param tolerance Largest per-channel difference still considered equal.
+     * \return Number of differing pixels, or SIZE_MAX if the sizes differ.
+     */
+    static size_t CountDifferentPixels(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int tolerance);
+
+    /**
+     * \brief Run unit tests for the HeadlessContext class.
+     *
+     * Rendering tests are skipped when no headless context can be created.
+     */
+    static void test();
+
+    /**
+     * \brief Measure real frame times of a scene rendered offscreen.
+     */
+    static void benchmark();
+
+private:
+    /**
+     * \brief Create the EGL display, context and, if needed, surface.
+     * \return True on success.
+     */
+    bool CreateContext();
+
+    /**
+     * \brief Destroy the EGL objects.
+     */
+    void DestroyContext();
+
+    /**
+     * \brief Create the framebuffer and its attachments at the current size.
+     * \return True if the framebuffer is complete.
+     */
+    bool CreateFramebuffer();
+
+    /**
+     * \brief Delete the framebuffer and its attachments.
+     */
+    void DestroyFramebuffer();
+
+    int m_width;                    ///< Framebuffer width
+    int m_height;                   ///< Framebuffer height
+    void* m_display;                ///< EGLDisplay
+    void* m_context;                ///< EGLContext
+    void* m_surface;                ///< EGLSurface, EGL_NO_SURFACE when surfaceless
+    GLuint m_framebuffer;           ///< Offscreen framebuffer
+    GLuint m_colorBuffer;           ///< RGBA8 color renderbuffer
+    GLuint m_depthBuffer;           ///< 24-bit depth renderbuffer
+    std::string m_renderer;         ///< GL_RENDERER string
+    const HeadlessContext* m_shareWith; ///< Context sharing its objects and display, or nullptr
+    RenderSnapshot m_snapshot;      ///< Snapshot reused by Render()
+};
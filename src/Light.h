@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+/**
+ * \enum LightType
+ * \brief Shapes of dynamic lights.
+ */
+enum LightType
+{
+    POINT_LIGHT = 0,    ///< Shines in every direction
+    SPOT_LIGHT          ///< Shines in a cone around its direction
+};
+
+/**
+ * \struct Light
+ * \brief A dynamic light, shaded by the clustered lighting in basic.frag.
+ *
+ * Lights fade smoothly to nothing at their range, so a light only affects the clusters
+ * its range sphere overlaps.
+ */
+struct Light
+{
+    LightType type = POINT_LIGHT;                   ///< Shape
+    glm::vec3 position = glm::vec3(0.0f);           ///< World position
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f); ///< World direction of a spot light's axis, normalized
+    glm::vec3 color = glm::vec3(1.0f);              ///< Linear color
+    float intensity = 1.0f;                         ///< Multiplies color
+    float range = 10.0f;                            ///< Distance at which the light has faded out
+    float innerConeAngle = 20.0f;                   ///< Spot light half-angle of full intensity, in degrees
+    float outerConeAngle = 30.0f;                   ///< Spot light half-angle where it has faded out, in degrees
+};
@@ -0,0 +1,553 @@
+#include "LightClusters.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include "Simd.h"
+#include "HeadlessContext.h"
+#include "Scene.h"
+#include "Model.h"
+#include "Camera.h"
+#include "GlApi.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <random>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+
+// Below this many lights, binning on the calling thread beats waking the pool
+constexpr size_t PARALLEL_LIGHT_COUNT = 64;
+
+// Far plane distance in near plane units for projections with an infinite far plane
+constexpr float INFINITE_FAR_RATIO = 10000.0f;
+
+// Depth slice of a view distance, clamped to the grid
+uint32_t SliceOfDepth(float depth, float scale, float bias)
+{
+    float slice = std::floor(std::log(std::max(depth, 1e-6f)) * scale + bias);
+    return static_cast<uint32_t>(std::clamp(slice, 0.0f, static_cast<float>(LightClusters::SLICES - 1)));
+}
+
+// Squared distance from a point to a box, 0 inside
+float DistanceSquared(const glm::vec3& point, const glm::vec3& min, const glm::vec3& max)
+{
+    glm::vec3 d = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+    return glm::dot(d, d);
+}
+
+// Call fn(i) for each candidate sphere overlapping a box, in candidate order, 4 at a time
+template <typename Candidates, typename Fn>
+void ForEachOverlap(const glm::vec3& min, const glm::vec3& max, const Candidates& candidates, Fn&& fn)
+{
+    size_t count = candidates.light.size();
+    size_t i = 0;
+
+#if defined(SNAPENGINE_SSE)
+    const __m128 minX = _mm_set1_ps(min.x);
+    const __m128 minY = _mm_set1_ps(min.y);
+    const __m128 minZ = _mm_set1_ps(min.z);
+    const __m128 maxX = _mm_set1_ps(max.x);
+    const __m128 maxY = _mm_set1_ps(max.y);
+    const __m128 maxZ = _mm_set1_ps(max.z);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(candidates.x.data() + i);
+        __m128 cy = _mm_loadu_ps(candidates.y.data() + i);
+        __m128 cz = _mm_loadu_ps(candidates.z.data() + i);
+
+        // Distance from the sphere center to the box along each axis, 0 inside
+        __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minX, cx), _mm_sub_ps(cx, maxX)), zero);
+        __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minY, cy), _mm_sub_ps(cy, maxY)), zero);
+        __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(minZ, cz), _mm_sub_ps(cz, maxZ)), zero);
+        __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+        unsigned mask = static_cast<unsigned>(_mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_loadu_ps(candidates.radiusSquared.data() + i))));
+        for (; mask != 0; mask &= mask - 1)
+            fn(i + std::countr_zero(mask));
+    }
+#endif
+
+    // Remainder (or everything, without SIMD)
+    for (; i < count; ++i)
+    {
+        glm::vec3 center(candidates.x[i], candidates.y[i], candidates.z[i]);
+        if (DistanceSquared(center, min, max) <= candidates.radiusSquared[i])
+            fn(i);
+    }
+}
+
+// A white floor quad facing up, for the frame-time benchmark
+Mesh MakeFloor(float halfSize, float height, float centerZ)
+{
+    std::vector<Vertex> vertices;
+    const glm::vec2 corners[4] = { { -1.0f, 1.0f }, { 1.0f, 1.0f }, { 1.0f, -1.0f }, { -1.0f, -1.0f } };
+    for (const glm::vec2& corner : corners)
+        vertices.push_back({ glm::vec3(corner.x * halfSize, height, centerZ + corner.y * halfSize), glm::vec3(0.0f, 1.0f, 0.0f), corner * 0.5f + 0.5f });
+    return Mesh(vertices, { 0, 1, 2, 0, 2, 3 }, std::make_shared<Material>(std::vector<Texture>(), MaterialParameters()));
+}
+
+} // namespace
+
+LightClusters::LightClusters()
+    : m_projection(0.0f)
+    , m_near(0.0f)
+    , m_far(0.0f)
+    , m_depthScale(0.0f)
+    , m_depthBias(0.0f)
+{
+}
+
+void LightClusters::UpdateClusterBounds(const glm::mat4& projection)
+{
+    m_projection = projection;
+
+    // Plane distances of an OpenGL perspective projection
+    const glm::mat4& p = projection;
+    m_near = p[3][2] / (p[2][2] - 1.0f);
+    m_far = std::abs(p[2][2] + 1.0f) > 1e-6f ? p[3][2] / (p[2][2] + 1.0f) : m_near * INFINITE_FAR_RATIO;
+
+    float logRatio = std::log(m_far / m_near);
+    m_depthScale = static_cast<float>(SLICES) / logRatio;
+    m_depthBias = -static_cast<float>(SLICES) * std::log(m_near) / logRatio;
+
+    m_minX.resize(CLUSTER_COUNT);
+    m_minY.resize(CLUSTER_COUNT);
+    m_minZ.resize(CLUSTER_COUNT);
+    m_maxX.resize(CLUSTER_COUNT);
+    m_maxY.resize(CLUSTER_COUNT);
+    m_maxZ.resize(CLUSTER_COUNT);
+
+    // A view point at distance z projects to ndc = (P00 * x - P20 * z) / z, likewise for y
+    for (uint32_t slice = 0; slice < SLICES; ++slice)
+    {
+        float depths[2] = {
+            m_near * std::pow(m_far / m_near, static_cast<float>(slice) / SLICES),
+            m_near * std::pow(m_far / m_near, static_cast<float>(slice + 1) / SLICES)
+        };
+        for (uint32_t y = 0; y < TILES_Y; ++y)
+        {
+            float ndcY[2] = { -1.0f + 2.0f * y / TILES_Y, -1.0f + 2.0f * (y + 1) / TILES_Y };
+            for (uint32_t x = 0; x < TILES_X; ++x)
+            {
+                float ndcX[2] = { -1.0f + 2.0f * x / TILES_X, -1.0f + 2.0f * (x + 1) / TILES_X };
+                glm::vec3 min(std::numeric_limits<float>::max());
+                glm::vec3 max(-std::numeric_limits<float>::max());
+                for (float depth : depths)
+                {
+                    for (int corner = 0; corner < 4; ++corner)
+                    {
+                        glm::vec3 point((ndcX[corner & 1] + p[2][0]) * depth / p[0][0], (ndcY[corner >> 1] + p[2][1]) * depth / p[1][1], depth);
+                        min = glm::min(min, point);
+                        max = glm::max(max, point);
+                    }
+                }
+
+                uint32_t cluster = GetClusterIndex(x, y, slice);
+                m_minX[cluster] = min.x;
+                m_minY[cluster] = min.y;
+                m_minZ[cluster] = min.z;
+                m_maxX[cluster] = max.x;
+                m_maxY[cluster] = max.y;
+                m_maxZ[cluster] = max.z;
+            }
+        }
+    }
+}
+
+void LightClusters::GetClusterBounds(uint32_t cluster, glm::vec3& min, glm::vec3& max) const
+{
+    min = glm::vec3(m_minX[cluster], m_minY[cluster], m_minZ[cluster]);
+    max = glm::vec3(m_maxX[cluster], m_maxY[cluster], m_maxZ[cluster]);
+}
+
+void LightClusters::Build(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection, LightGrid& grid, ThreadPool* pool)
+{
+    PROFILE_SCOPE("LightClusters::Build");
+    using Clock = std::chrono::high_resolution_clock;
+    auto start = Clock::now();
+
+    if (m_minX.empty() || projection != m_projection)
+        UpdateClusterBounds(projection);
+
+    m_stats = LightClusterStats();
+    m_stats.lights = lights.size();
+    grid.depthScale = m_depthScale;
+    grid.depthBias = m_depthBias;
+    grid.lights.resize(lights.size());
+    grid.cells.assign(CLUSTER_COUNT, glm::uvec2(0));
+    grid.indices.clear();
+
+    // Find the depth slices each light reaches, one slice wider on each side to absorb
+    // rounding between the slice formula and the slice bounds
+    m_viewSpheres.resize(lights.size());
+    m_firstSlice.resize(lights.size());
+    m_lastSlice.resize(lights.size());
+    for (size_t i = 0; i < lights.size(); ++i)
+    {
+        const Light& light = lights[i];
+        grid.lights[i] = Pack(light);
+
+        glm::vec4 center = view * glm::vec4(light.position, 1.0f);
+        float depth = -center.z;
+        m_viewSpheres[i] = glm::vec4(center.x, center.y, depth, light.range);
+        if (light.range <= 0.0f || depth + light.range < m_near || depth - light.range > m_far)
+        {
+            m_firstSlice[i] = 1;
+            m_lastSlice[i] = 0;
+            continue;
+        }
+        uint32_t first = SliceOfDepth(depth - light.range, m_depthScale, m_depthBias);
+        uint32_t last = SliceOfDepth(depth + light.range, m_depthScale, m_depthBias);
+        m_firstSlice[i] = first > 0 ? first - 1 : 0;
+        m_lastSlice[i] = std::min(last + 1, SLICES - 1);
+        ++m_stats.visibleLights;
+    }
+
+    // Bin each depth slice into its own index list
+    m_sliceIndices.resize(SLICES);
+    bool parallel = pool != nullptr && lights.size() >= PARALLEL_LIGHT_COUNT;
+    m_scratch.resize(std::max(m_scratch.size(), parallel ? pool->GetThreadCount() : size_t(1)));
+    auto binSlices = [this, &grid](size_t begin, size_t end, size_t worker)
+    {
+        for (size_t slice = begin; slice < end; ++slice)
+            BinSlice(static_cast<uint32_t>(slice), m_scratch[worker], grid);
+    };
+    if (parallel)
+        pool->ParallelFor(SLICES, 1, binSlices);
+    else
+        binSlices(0, SLICES, 0);
+
+    // Concatenate the slices and make the cell offsets absolute
+    size_t total = 0;
+    for (const auto& indices : m_sliceIndices)
+        total += indices.size();
+    grid.indices.resize(total);
+    uint32_t offset = 0;
+    for (uint32_t slice = 0; slice < SLICES; ++slice)
+    {
+        const auto& indices = m_sliceIndices[slice];
+        if (!indices.empty())
+            std::memcpy(grid.indices.data() + offset, indices.data(), indices.size() * sizeof(uint32_t));
+        for (uint32_t cluster = GetClusterIndex(0, 0, slice); cluster < GetClusterIndex(0, 0, slice + 1); ++cluster)
+        {
+            grid.cells[cluster].x += offset;
+            m_stats.maxPerCluster = std::max(m_stats.maxPerCluster, static_cast<size_t>(grid.cells[cluster].y));
+        }
+        offset += static_cast<uint32_t>(indices.size());
+    }
+    m_stats.assignments = total;
+
+    m_stats.buildTimeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void LightClusters::BinSlice(uint32_t slice, Scratch& scratch, LightGrid& grid)
+{
+    // Gather the lights reaching the slice
+    Candidates& candidates = scratch.slice;
+    candidates.Clear();
+    for (size_t i = 0; i < m_viewSpheres.size(); ++i)
+    {
+        if (slice < m_firstSlice[i] || slice > m_lastSlice[i])
+            continue;
+        const glm::vec4& sphere = m_viewSpheres[i];
+        candidates.Add(sphere.x, sphere.y, sphere.z, sphere.w * sphere.w, static_cast<uint32_t>(i));
+    }
+    candidates.Pad();
+
+    std::vector<uint32_t>& indices = m_sliceIndices[slice];
+    indices.clear();
+    for (uint32_t y = 0; y < TILES_Y; ++y)
+    {
+        // Narrow the slice's lights down to the row, so each cluster only tests its neighbours
+        uint32_t rowBegin = GetClusterIndex(0, y, slice);
+        uint32_t rowEnd = GetClusterIndex(0, y + 1, slice);
+        glm::vec3 rowMin(std::numeric_limits<float>::max());
+        glm::vec3 rowMax(std::numeric_limits<float>::lowest());
+        for (uint32_t cluster = rowBegin; cluster < rowEnd; ++cluster)
+        {
+            glm::vec3 min, max;
+            GetClusterBounds(cluster, min, max);
+            rowMin = glm::min(rowMin, min);
+            rowMax = glm::max(rowMax, max);
+        }
+        SelectCandidates(rowMin, rowMax, candidates, scratch.row);
+
+        for (uint32_t cluster = rowBegin; cluster < rowEnd; ++cluster)
+        {
+            uint32_t first = static_cast<uint32_t>(indices.size());
+            if (!scratch.row.light.empty())
+            {
+                glm::vec3 min, max;
+                GetClusterBounds(cluster, min, max);
+                CollectLights(min, max, scratch.row, indices);
+            }
+            grid.cells[cluster] = glm::uvec2(first, static_cast<uint32_t>(indices.size()) - first);
+        }
+    }
+}
+
+void LightClusters::SelectCandidates(const glm::vec3& min, const glm::vec3& max, const Candidates& candidates, Candidates& out)
+{
+    out.Clear();
+    ForEachOverlap(min, max, candidates, [&candidates, &out](size_t i)
+    {
+        out.Add(candidates.x[i], candidates.y[i], candidates.z[i], candidates.radiusSquared[i], candidates.light[i]);
+    });
+    out.Pad();
+}
+
+void LightClusters::CollectLights(const glm::vec3& min, const glm::vec3& max, const Candidates& candidates, std::vector<uint32_t>& out)
+{
+    ForEachOverlap(min, max, candidates, [&candidates, &out](size_t i) { out.push_back(candidates.light[i]); });
+}
+
+PackedLight LightClusters::Pack(const Light& light)
+{
+    // Spot factor = clamp(cos(angle to axis) * scale + offset, 0, 1): 1 inside the inner
+    // cone, 0 outside the outer one; point lights are 1 everywhere
+    float scale = 0.0f;
+    float offset = 1.0f;
+    if (light.type == SPOT_LIGHT)
+    {
+        float cosInner = std::cos(glm::radians(light.innerConeAngle));
+        float cosOuter = std::cos(glm::radians(std::max(light.outerConeAngle, light.innerConeAngle)));
+        scale = 1.0f / std::max(cosInner - cosOuter, 1e-4f);
+        offset = -cosOuter * scale;
+    }
+
+    PackedLight packed;
+    packed.positionRange = glm::vec4(light.position, light.range);
+    packed.colorSpotScale = glm::vec4(light.color * light.intensity, scale);
+    packed.directionSpotOffset = glm::vec4(light.direction, offset);
+    return packed;
+}
+
+void LightClusters::test()
+{
+    std::cout << "[LightClusters] Running tests...\n";
+
+    static_assert(sizeof(PackedLight) == 48, "PackedLight must match the std430 struct");
+
+    const float nearPlane = 0.1f;
+    const float farPlane = 100.0f;
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, nearPlane, farPlane);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 5.0f), glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // Test the grid layout
+    {
+        LightClusters clusters;
+        LightGrid grid;
+        clusters.Build({}, view, projection, grid);
+        assert(grid.cells.size() == CLUSTER_COUNT && grid.indices.empty() && "Empty grid should have empty cells");
+
+        glm::vec3 min, max;
+        clusters.GetClusterBounds(GetClusterIndex(0, 0, 0), min, max);
+        assert(std::abs(min.z - nearPlane) < 1e-4f && "First slice should start at the near plane");
+        clusters.GetClusterBounds(GetClusterIndex(TILES_X - 1, TILES_Y - 1, SLICES - 1), min, max);
+        assert(std::abs(max.z - farPlane) < 1e-2f && max.x > 0.0f && max.y > 0.0f && "Last cluster should end at the far plane, top right");
+
+        // The shader's slice formula agrees with the slice bounds
+        for (uint32_t slice = 0; slice < SLICES; ++slice)
+        {
+            clusters.GetClusterBounds(GetClusterIndex(0, 0, slice), min, max);
+            float middle = std::sqrt(min.z * max.z);
+            assert(SliceOfDepth(middle, grid.depthScale, grid.depthBias) == slice && "Depth slice formula wrong");
+        }
+    }
+
+    // Test single lights
+    {
+        LightClusters clusters;
+        LightGrid grid;
+        Light front;
+        front.position = glm::vec3(0.0f, 2.0f, -5.0f);
+        front.range = 0.5f;
+        Light behind;
+        behind.position = glm::vec3(0.0f, 2.0f, 10.0f);
+        behind.range = 2.0f;
+        clusters.Build({ behind, front }, view, projection, grid);
+        assert(clusters.GetStats().visibleLights == 1 && "Light behind the camera should not be binned");
+
+        // The cluster at the centre of the screen, 10 units away, holds the front light
+        uint32_t slice = SliceOfDepth(10.0f, grid.depthScale, grid.depthBias);
+        glm::uvec2 cell = grid.cells[GetClusterIndex(TILES_X / 2, TILES_Y / 2, slice)];
+        assert(cell.y == 1 && grid.indices[cell.x] == 1 && "Light should be in the cluster around it");
+        assert(grid.cells[GetClusterIndex(0, 0, slice)].y == 0 && grid.cells[GetClusterIndex(TILES_X / 2, TILES_Y / 2, 0)].y == 0 &&
+               "Light should not reach distant clusters");
+        assert(clusters.GetStats().assignments < 64 && "A small light should touch few clusters");
+    }
+
+    // Test packing
+    {
+        Light spot;
+        spot.type = SPOT_LIGHT;
+        spot.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+        spot.color = glm::vec3(1.0f, 0.5f, 0.0f);
+        spot.intensity = 2.0f;
+        PackedLight packed = Pack(spot);
+        auto spotFactor = [&packed](float degrees)
+        {
+            return glm::clamp(std::cos(glm::radians(degrees)) * packed.colorSpotScale.w + packed.directionSpotOffset.w, 0.0f, 1.0f);
+        };
+        assert(packed.colorSpotScale.x == 2.0f && packed.colorSpotScale.y == 1.0f && "Color should include intensity");
+        assert(spotFactor(0.0f) == 1.0f && spotFactor(spot.innerConeAngle - 1.0f) == 1.0f && spotFactor(spot.outerConeAngle + 1.0f) == 0.0f &&
+               "Spot cone factors wrong");
+        float halfway = spotFactor(0.5f * (spot.innerConeAngle + spot.outerConeAngle));
+        assert(halfway > 0.0f && halfway < 1.0f && "Spot cone should fade between the angles");
+        assert(Pack(Light()).colorSpotScale.w == 0.0f && Pack(Light()).directionSpotOffset.w == 1.0f && "Point lights should have no cone");
+    }
+
+    // Test many lights against a brute-force reference, serial and parallel
+    {
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<float> coordinate(-40.0f, 40.0f);
+        std::uniform_real_distribution<float> range(0.5f, 8.0f);
+        std::vector<Light> lights(1003);
+        for (Light& light : lights)
+        {
+            light.position = glm::vec3(coordinate(rng), coordinate(rng) * 0.25f, coordinate(rng) - 40.0f);
+            light.range = range(rng);
+        }
+
+        LightClusters clusters;
+        LightGrid grid;
+        clusters.Build(lights, view, projection, grid);
+
+        bool matches = true;
+        size_t assignments = 0;
+        std::vector<uint32_t> expected;
+        for (uint32_t cluster = 0; cluster < CLUSTER_COUNT; ++cluster)
+        {
+            glm::vec3 min, max;
+            clusters.GetClusterBounds(cluster, min, max);
+            expected.clear();
+            for (uint32_t i = 0; i < lights.size(); ++i)
+            {
+                glm::vec4 center = view * glm::vec4(lights[i].position, 1.0f);
+                if (DistanceSquared(glm::vec3(center.x, center.y, -center.z), min, max) <= lights[i].range * lights[i].range)
+                    expected.push_back(i);
+            }
+            glm::uvec2 cell = grid.cells[cluster];
+            matches = matches && cell.y == expected.size() && std::equal(expected.begin(), expected.end(), grid.indices.begin() + cell.x);
+            assignments += expected.size();
+        }
+        assert(matches && assignments == grid.indices.size() && "Clusters should hold exactly the overlapping lights");
+
+        ThreadPool pool(3);
+        LightGrid parallelGrid;
+        clusters.Build(lights, view, projection, parallelGrid, &pool);
+        assert(parallelGrid.cells == grid.cells && parallelGrid.indices == grid.indices && "Parallel binning should match serial");
+        assert(clusters.GetStats().assignments == assignments && clusters.GetStats().maxPerCluster > 0 && "Counters wrong");
+    }
+
+    std::cout << "[LightClusters] Tests passed!\n";
+}
+
+void LightClusters::benchmark()
+{
+    std::cout << "\nRunning LightClusters benchmarks...\n";
+
+    using Clock = std::chrono::high_resolution_clock;
+    ThreadPool& pool = ThreadPool::Get();
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+
+    // The scene camera's initial pose, at (0, 0, 3) looking down -z
+    Camera camera;
+    glm::mat4 view = glm::lookAt(camera.GetPosition(), camera.GetPosition() + camera.GetFront(), camera.GetUp());
+
+    // Lights scattered over a floor in front of the camera
+    auto makeLights = [](size_t count)
+    {
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> x(-40.0f, 40.0f);
+        std::uniform_real_distribution<float> y(-1.0f, 2.0f);
+        std::uniform_real_distribution<float> z(-80.0f, 0.0f);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<Light> lights(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            Light& light = lights[i];
+            light.type = i % 4 == 3 ? SPOT_LIGHT : POINT_LIGHT;
+            light.position = glm::vec3(x(rng), y(rng), z(rng));
+            light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+            light.color = glm::vec3(unit(rng), unit(rng), unit(rng));
+            light.range = 2.0f + 4.0f * unit(rng);
+        }
+        return lights;
+    };
+
+    std::cout << "  lights   serial(ms)   " << pool.GetThreadCount() << " threads(ms)   assignments   max/cluster\n";
+    for (size_t count = 64; count <= 16384; count *= 4)
+    {
+        std::vector<Light> lights = makeLights(count);
+        LightClusters clusters;
+        LightGrid grid;
+        const int iterations = 50;
+        auto time = [&](ThreadPool* threads)
+        {
+            clusters.Build(lights, view, projection, grid, threads);
+            auto start = Clock::now();
+            for (int it = 0; it < iterations; ++it)
+                clusters.Build(lights, view, projection, grid, threads);
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+        };
+        double serialMs = time(nullptr);
+        double parallelMs = time(&pool);
+        const LightClusterStats& stats = clusters.GetStats();
+        std::cout << "  " << count << "\t" << serialMs << "\t" << parallelMs << "\t" << stats.assignments << "\t" << stats.maxPerCluster << "\n";
+    }
+
+    // Frame time of a lit floor as lights are added
+    bool sceneTestMode = Scene::IsTestMode();
+    bool modelTestMode = Model::IsTestMode();
+    try
+    {
+        HeadlessContext context(960, 540);
+        Scene::SetTestMode(false);
+        Model::SetTestMode(false);
+        {
+            Scene scene;
+            scene.SetProjectionMatrix(projection);
+            auto floor = std::make_shared<Model>();
+            floor->AddMesh(MakeFloor(40.0f, -1.5f, -40.0f));
+            scene.AddModel(floor);
+
+            std::cout << "  " << context.GetRenderer() << ", " << context.GetWidth() << "x" << context.GetHeight() << "\n";
+            std::cout << "  lights   ms/frame   binning(ms)   assignments\n";
+            for (size_t count : { size_t(0), size_t(16), size_t(64), size_t(256), size_t(1024), size_t(4096) })
+            {
+                while (scene.GetLightCount() > 0)
+                    scene.RemoveLight(scene.GetLightCount() - 1);
+                for (const Light& light : makeLights(count))
+                    scene.AddLight(light);
+
+                const int frames = 10;
+                context.Render(scene);
+                GlApi::Finish();
+                auto start = Clock::now();
+                for (int frame = 0; frame < frames; ++frame)
+                {
+                    context.Render(scene);
+                    GlApi::Finish();
+                }
+                double frameMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+                const LightClusterStats& stats = scene.GetLightClusterStats();
+                std::cout << "  " << count << "\t" << frameMs << "\t" << stats.buildTimeMs << "\t" << stats.assignments << "\n";
+            }
+        }
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << "  " << e.what() << ", frame times skipped\n";
+    }
+    Scene::SetTestMode(sceneTestMode);
+    Model::SetTestMode(modelTestMode);
+}
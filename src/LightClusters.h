@@ -0,0 +1,239 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <GL/glew.h>
+#include "Light.h"
+
+class ThreadPool;
+
+/**
+ * \struct PackedLight
+ * \brief A light in std430 layout, as the ClusterLights buffer in basic.frag declares it.
+ */
+struct PackedLight
+{
+    glm::vec4 positionRange;        ///< World position, range in w
+    glm::vec4 colorSpotScale;       ///< Color times intensity, spot cone scale in w (0 for point lights)
+    glm::vec4 directionSpotOffset;  ///< Spot axis, spot cone offset in w (1 for point lights)
+};
+
+/**
+ * \struct LightGrid
+ * \brief The lights of one frame binned into view clusters, ready to upload.
+ *
+ * Vectors are cleared, not freed, between frames.
+ */
+struct LightGrid
+{
+    std::vector<PackedLight> lights;    ///< Every light of the frame
+    std::vector<glm::uvec2> cells;      ///< Per cluster: first entry in indices, light count
+    std::vector<uint32_t> indices;      ///< Light indices, cluster after cluster
+    float depthScale = 0.0f;            ///< Slice of view depth z is floor(log(z) * depthScale + depthBias)
+    float depthBias = 0.0f;             ///< See depthScale
+};
+
+/**
+ * \struct LightClusterStats
+ * \brief Counters of the last LightClusters::Build().
+ */
+struct LightClusterStats
+{
+    size_t lights = 0;          ///< Lights binned
+    size_t visibleLights = 0;   ///< Lights overlapping at least one depth slice
+    size_t assignments = 0;     ///< Light indices written, over all clusters
+    size_t maxPerCluster = 0;   ///< Most lights in one cluster
+    double buildTimeMs = 0.0;   ///< Time spent in Build()
+};
+
+/**
+ * \class LightClusters
+ * \brief Assigns lights to the clusters of the view frustum for clustered forward shading.
+ *
+ * The frustum is cut into TILES_X * TILES_Y screen tiles and SLICES depth slices, spaced
+ * exponentially between the near and far planes so clusters stay roughly cubic. Each
+ * frame every light's range sphere is tested against the view-space bounds of the
+ * clusters it can reach: depth slices are binned independently on a ThreadPool, and
+ * within a slice the lights are narrowed down to each tile row, then to each cluster,
+ * 4 at a time with SSE. The fragment shader finds its cluster from its view position and
+ * loops over that cluster's lights only.
+ *
+ * Spot lights are binned by their range sphere, which is conservative for their cone.
+ * Needs no GL context, so Build() runs while the snapshot is built.
+ */
+class LightClusters
+{
+public:
+    static constexpr uint32_t TILES_X = 16;     ///< Screen tiles across; must match basic.frag
+    static constexpr uint32_t TILES_Y = 9;      ///< Screen tiles down; must match basic.frag
+    static constexpr uint32_t SLICES = 24;      ///< Depth slices; must match basic.frag
+    static constexpr uint32_t CLUSTER_COUNT = TILES_X * TILES_Y * SLICES; ///< Clusters in the grid
+
+    static constexpr GLuint LIGHTS_BINDING = 0;     ///< Shader storage binding of LightGrid::lights
+    static constexpr GLuint CELLS_BINDING = 1;      ///< Shader storage binding of LightGrid::cells
+    static constexpr GLuint INDICES_BINDING = 2;    ///< Shader storage binding of LightGrid::indices
+
+    /**
+     * \brief Constructor.
+     */
+    LightClusters();
+
+    /**
+     * \brief Bin the lights of a frame.
+     *
+     * The cluster bounds are recomputed only when the projection changes.
+     *
+     * \param lights The lights.
+     * \param view Camera view matrix.
+     * \param projection Perspective projection matrix.
+     * \param grid Grid to fill; its previous contents are replaced.
+     * \param pool Pool to bin depth slices on, or nullptr to bin on the calling thread.
+     */
+    void Build(const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection, LightGrid& grid, ThreadPool* pool = nullptr);
+
+    /**
+     * \brief Get the index of a cluster.
+     * \param x Tile column, 0 at the left.
+     * \param y Tile row, 0 at the bottom.
+     * \param slice Depth slice, 0 at the near plane.
+     * \return Index into LightGrid::cells.
+     */
+    static uint32_t GetClusterIndex(uint32_t x, uint32_t y, uint32_t slice) { return (slice * TILES_Y + y) * TILES_X + x; }
+
+    /**
+     * \brief Get the view-space bounds of a cluster, for the current projection.
+     * \param cluster Cluster index.
+     * \param min Receives the minimum corner, with z as positive distance from the camera.
+     * \param max Receives the maximum corner.
+     */
+    void GetClusterBounds(uint32_t cluster, glm::vec3& min, glm::vec3& max) const;
+
+    /**
+     * \brief Get the counters of the last Build().
+     * \return Statistics.
+     */
+    const LightClusterStats& GetStats() const { return m_stats; }
+
+    /**
+     * \brief Convert a light to its shader layout.
+     * \param light The light.
+     * \return The packed light.
+     */
+    static PackedLight Pack(const Light& light);
+
+    /**
+     * \brief Run unit tests for the LightClusters class.
+     */
+    static void test();
+
+    /**
+     * \brief Measure binning cost and frame time as the light count grows.
+     */
+    static void benchmark();
+
+private:
+    /**
+     * \struct Candidates
+     * \brief View-space range spheres of the lights that may reach a part of the grid, as arrays.
+     *
+     * Padded to a multiple of 4 with spheres that never pass.
+     */
+    struct Candidates
+    {
+        std::vector<float> x;           ///< View-space center x
+        std::vector<float> y;           ///< View-space center y
+        std::vector<float> z;           ///< Distance of the center in front of the camera
+        std::vector<float> radiusSquared;   ///< Squared range
+        std::vector<uint32_t> light;    ///< Light index
+
+        void Clear()
+        {
+            x.clear();
+            y.clear();
+            z.clear();
+            radiusSquared.clear();
+            light.clear();
+        }
+
+        void Add(float cx, float cy, float cz, float r2, uint32_t index)
+        {
+            x.push_back(cx);
+            y.push_back(cy);
+            z.push_back(cz);
+            radiusSquared.push_back(r2);
+            light.push_back(index);
+        }
+
+        void Pad()
+        {
+            while (light.size() % 4 != 0)
+                Add(0.0f, 0.0f, 0.0f, -1.0f, 0);
+        }
+    };
+
+    /**
+     * \struct Scratch
+     * \brief Candidate arrays of one worker.
+     */
+    struct Scratch
+    {
+        Candidates slice;   ///< Lights reaching the depth slice
+        Candidates row;     ///< Lights reaching one tile row of it
+    };
+
+    /**
+     * \brief Recompute the slice depths and cluster bounds for a projection.
+     * \param projection Perspective projection matrix.
+     */
+    void UpdateClusterBounds(const glm::mat4& projection);
+
+    /**
+     * \brief Bin the lights reaching one depth slice into its clusters.
+     * \param slice Depth slice.
+     * \param scratch Scratch arrays of the calling worker.
+     * \param grid Grid whose cells of the slice are written, with offsets relative to the slice.
+     */
+    void BinSlice(uint32_t slice, Scratch& scratch, LightGrid& grid);
+
+    /**
+     * \brief Keep the candidates whose sphere overlaps a box, 4 at a time.
+     * \param min Minimum corner, z as distance.
+     * \param max Maximum corner.
+     * \param candidates Candidate spheres.
+     * \param out Receives the overlapping candidates, padded.
+     */
+    static void SelectCandidates(const glm::vec3& min, const glm::vec3& max, const Candidates& candidates, Candidates& out);
+
+    /**
+     * \brief Append the lights whose sphere overlaps a box, 4 at a time.
+     * \param min Minimum corner, z as distance.
+     * \param max Maximum corner.
+     * \param candidates Candidate spheres.
+     * \param out Receives light indices, in candidate order.
+     */
+    static void CollectLights(const glm::vec3& min, const glm::vec3& max, const Candidates& candidates, std::vector<uint32_t>& out);
+
+    glm::mat4 m_projection;                     ///< Projection the bounds were computed for
+    float m_near;                               ///< Near plane distance
+    float m_far;                                ///< Far plane distance
+    float m_depthScale;                         ///< Slice = floor(log(z) * m_depthScale + m_depthBias)
+    float m_depthBias;                          ///< See m_depthScale
+
+    // Per cluster view-space bounds, z as positive distance
+    std::vector<float> m_minX;
+    std::vector<float> m_minY;
+    std::vector<float> m_minZ;
+    std::vector<float> m_maxX;
+    std::vector<float> m_maxY;
+    std::vector<float> m_maxZ;
+
+    // Per light, for the current Build()
+    std::vector<glm::vec4> m_viewSpheres;       ///< View-space center (z as distance) and radius
+    std::vector<uint32_t> m_firstSlice;         ///< First depth slice reached
+    std::vector<uint32_t> m_lastSlice;          ///< Last depth slice reached, below m_firstSlice if none
+
+    std::vector<Scratch> m_scratch;             ///< Scratch per worker
+    std::vector<std::vector<uint32_t>> m_sliceIndices;  ///< Light indices per depth slice
+    LightClusterStats m_stats;                  ///< Counters of the last Build()
+};
@@ -20,6 +20,11 @@ public:
 		jsonObjects.push_back(jsonObject);
 	}
 
+	// Function to add a JSON object to the manager without copying it.
+	void addJsonObject(nlohmann::json&& jsonObject) {
+		jsonObjects.push_back(std::move(jsonObject));
+	}
+
 	// Function to retrieve all stored JSON objects.
 	const std::vector<nlohmann::json>& getJsonObjects() const {
 		return jsonObjects;
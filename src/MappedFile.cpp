@@ -0,0 +1,144 @@
+#include "MappedFile.h"
+#include <iostream>
+#include <fstream>
+#include <cassert>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    m_file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        Close();
+        return false;
+    }
+    if (size.QuadPart == 0)
+        return true;
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        Close();
+        return false;
+    }
+    m_mapping = mapping;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr)
+    {
+        Close();
+        return false;
+    }
+    m_data = static_cast<const char*>(data);
+    m_size = static_cast<size_t>(size.QuadPart);
+#else
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || !S_ISREG(status.st_mode))
+    {
+        close(file);
+        return false;
+    }
+    if (status.st_size == 0)
+    {
+        close(file);
+        return true;
+    }
+
+    // The mapping keeps its own reference to the file
+    void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+        return false;
+
+    // Read front to back: let the kernel read ahead and drop pages behind
+    madvise(data, static_cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(data);
+    m_size = static_cast<size_t>(status.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr)
+        CloseHandle(static_cast<HANDLE>(m_mapping));
+    if (m_file != nullptr)
+        CloseHandle(static_cast<HANDLE>(m_file));
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    if (m_data != nullptr)
+        munmap(const_cast<char*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+void MappedFile::test()
+{
+    std::cout << "[MappedFile] Running tests...\n";
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "snapengine_mapped_file_test";
+    std::filesystem::create_directories(directory);
+    std::filesystem::path path = directory / "contents.txt";
+    std::filesystem::path empty = directory / "empty.txt";
+    const std::string contents = "[{\"class\": \"window\"}]";
+    {
+        std::ofstream(path, std::ios::binary) << contents;
+        std::ofstream(empty, std::ios::binary);
+    }
+
+    // The mapping shows the file's bytes
+    MappedFile file;
+    bool opened = file.Open(path.string());
+    assert(opened && "Failed to map file");
+    assert(file.GetSize() == contents.size() && std::memcmp(file.GetData(), contents.data(), contents.size()) == 0 &&
+           "Mapping should show the file contents");
+
+    // Reopening replaces the mapping; empty files map to nothing
+    opened = file.Open(empty.string());
+    assert(opened && file.GetData() == nullptr && file.GetSize() == 0 && "Empty file should map to nothing");
+    opened = file.Open((directory / "missing.txt").string());
+    assert(!opened && file.GetData() == nullptr && "Missing file should fail");
+
+    file.Close();
+    assert(file.GetData() == nullptr && file.GetSize() == 0 && "Close should unmap");
+
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+
+    std::cout << "[MappedFile] Tests passed!\n";
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * \class MappedFile
+ * \brief A file mapped read-only into memory.
+ *
+ * The operating system pages the contents in as they are read and can drop them again
+ * under memory pressure, so a parser streaming through a large file never holds a copy
+ * of it. Empty files open successfully with a null data pointer.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+
+    /**
+     * \brief Destructor. Unmaps the file.
+     */
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * \brief Map a file, unmapping the previous one.
+     * \param path File to map.
+     * \return True on success.
+     */
+    bool Open(const std::string& path);
+
+    /**
+     * \brief Unmap the file.
+     */
+    void Close();
+
+    /**
+     * \brief Get the file contents.
+     * \return First byte; nullptr if nothing is mapped or the file is empty.
+     */
+    const char* GetData() const { return m_data; }
+
+    /**
+     * \brief Get the file size.
+     * \return Size in bytes.
+     */
+    size_t GetSize() const { return m_size; }
+
+    /**
+     * \brief Run unit tests for the MappedFile class.
+     */
+    static void test();
+
+private:
+    const char* m_data = nullptr;   ///< Mapped contents
+    size_t m_size = 0;              ///< Mapped size
+#ifdef _WIN32
+    void* m_file = nullptr;         ///< File HANDLE
+    void* m_mapping = nullptr;      ///< File mapping HANDLE
+#endif
+};
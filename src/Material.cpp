@@ -0,0 +1,159 @@
+#include "Material.h"
+#include "GlApi.h"
+#include "Mesh.h"
+#include "AllocationCounter.h"
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// Parameters in std140 layout, as the MaterialConstants block in basic.frag declares them
+struct MaterialConstants
+{
+    glm::vec4 diffuseColor;     // Opacity in w
+    float specularStrength;
+    float shininess;
+    float alphaCutoff;
+    uint32_t textureMask;       // Bit per filled MaterialTextureSlot
+};
+static_assert(sizeof(MaterialConstants) == 32, "MaterialConstants must match the std140 block");
+
+// Texture type names by slot, as Model assigns them
+const char* const SLOT_TYPES[MATERIAL_TEXTURE_SLOTS] = { "texture_diffuse", "texture_specular" };
+
+} // namespace
+
+Material::Material(const std::vector<Texture>& textures, const MaterialParameters& parameters)
+    : m_bindingCount(0)
+    , m_parameters(parameters)
+    , m_constants(0)
+{
+    ResolveTextures(textures, m_textures);
+
+    MaterialConstants constants;
+    constants.diffuseColor = glm::vec4(parameters.diffuseColor, parameters.opacity);
+    constants.specularStrength = parameters.specularStrength;
+    constants.shininess = parameters.shininess;
+    constants.alphaCutoff = parameters.alphaCutoff;
+    constants.textureMask = 0;
+    for (int slot = 0; slot < MATERIAL_TEXTURE_SLOTS; ++slot)
+    {
+        if (m_textures[slot] == 0)
+            continue;
+        m_bindings[m_bindingCount].unit = static_cast<GLuint>(slot);
+        m_bindings[m_bindingCount].texture = m_textures[slot];
+        ++m_bindingCount;
+        constants.textureMask |= 1u << slot;
+    }
+
+    GlApi::CreateBuffers(1, &m_constants);
+    GlApi::NamedBufferStorage(m_constants, sizeof(constants), &constants, 0);
+}
+
+Material::~Material()
+{
+    if (m_constants != 0)
+        GlApi::DeleteBuffers(1, &m_constants);
+}
+
+void Material::Bind() const
+{
+    for (size_t i = 0; i < m_bindingCount; ++i)
+        GlApi::BindTextureUnit(m_bindings[i].unit, m_bindings[i].texture);
+    GlApi::BindBufferRange(GL_UNIFORM_BUFFER, CONSTANTS_BINDING, m_constants, 0, sizeof(MaterialConstants));
+}
+
+bool Material::Matches(const std::vector<Texture>& textures, const MaterialParameters& parameters) const
+{
+    if (!(parameters == m_parameters))
+        return false;
+
+    GLuint slots[MATERIAL_TEXTURE_SLOTS];
+    ResolveTextures(textures, slots);
+    return std::equal(std::begin(slots), std::end(slots), std::begin(m_textures));
+}
+
+MaterialTextureSlot Material::GetSlot(const std::string& type)
+{
+    for (int slot = 0; slot < MATERIAL_TEXTURE_SLOTS; ++slot)
+    {
+        if (type == SLOT_TYPES[slot])
+            return static_cast<MaterialTextureSlot>(slot);
+    }
+    return MATERIAL_TEXTURE_SLOTS;
+}
+
+void Material::ResolveTextures(const std::vector<Texture>& textures, GLuint (&slots)[MATERIAL_TEXTURE_SLOTS])
+{
+    std::fill(std::begin(slots), std::end(slots), 0u);
+    for (const Texture& texture : textures)
+    {
+        MaterialTextureSlot slot = GetSlot(texture.type);
+        if (slot != MATERIAL_TEXTURE_SLOTS && slots[slot] == 0)
+            slots[slot] = texture.id;
+    }
+}
+
+void Material::test()
+{
+    std::cout << "[Material] Running tests...\n";
+
+    bool testMode = GlApi::IsTestMode();
+    GlApi::SetTestMode(true);
+
+    // Test slot resolution
+    assert(GetSlot("texture_diffuse") == DIFFUSE_TEXTURE_SLOT && GetSlot("texture_specular") == SPECULAR_TEXTURE_SLOT &&
+           GetSlot("texture_normal") == MATERIAL_TEXTURE_SLOTS && "Slot names wrong");
+
+    std::vector<Texture> textures = {
+        { 7, "texture_specular", "specular.png" },
+        { 5, "texture_diffuse", "diffuse.png" },
+        { 6, "texture_diffuse", "diffuse2.png" },
+        { 8, "texture_normal", "normal.png" },
+    };
+    MaterialParameters parameters;
+    parameters.diffuseColor = glm::vec3(0.5f, 0.25f, 1.0f);
+
+    Material material(textures, parameters);
+    assert(material.GetTexture(DIFFUSE_TEXTURE_SLOT) == 5 && material.GetTexture(SPECULAR_TEXTURE_SLOT) == 7 &&
+           "The first texture of each type should fill its slot");
+    assert(material.GetTextureCount() == 2 && "Textures without a slot should be dropped");
+
+    // Test deduplication
+    assert(material.Matches(textures, parameters) && "Same inputs should match");
+    assert(material.Matches({ textures[1], textures[0] }, parameters) && "Texture order within slots should not matter");
+    assert(!material.Matches({ textures[0] }, parameters) && "Different textures should not match");
+    MaterialParameters shinier = parameters;
+    shinier.shininess = 64.0f;
+    assert(!material.Matches(textures, shinier) && "Different parameters should not match");
+
+    // Binding issues one bind per texture and one for the parameters, nothing else
+    GlApi::BeginFrame();
+    material.Bind();
+    GlFrameStats stats = GlApi::GetCurrentStats();
+    assert(stats.calls == 3 && stats.stateChanges == 3 && stats.uniformLookups == 0 && "Bind should issue exactly the needed binds");
+
+    // Test a steady-state draw: no heap allocations and a fixed number of calls
+    {
+        auto shared = std::make_shared<Material>(textures, parameters);
+        Mesh mesh({ Vertex(), Vertex(), Vertex() }, { 0, 1, 2 }, shared);
+        mesh.Draw();
+
+        GlApi::BeginFrame();
+        uint64_t allocations = AllocationCounter::GetCount();
+        const int draws = 100;
+        for (int i = 0; i < draws; ++i)
+            mesh.Draw();
+        assert((!AllocationCounter::IsEnabled() || AllocationCounter::GetCount() == allocations) && "Drawing a mesh should not allocate");
+
+        stats = GlApi::GetCurrentStats();
+        assert(stats.drawCalls == draws && stats.calls == draws * 5 && "A draw should be 2 texture binds, 1 buffer bind, 1 VAO bind, 1 draw");
+    }
+    GlApi::BeginFrame();
+
+    GlApi::SetTestMode(testMode);
+
+    std::cout << "[Material] Tests passed!\n";
+}
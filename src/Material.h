@@ -0,0 +1,137 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "Texture.h"
+
+/**
+ * \enum MaterialTextureSlot
+ * \brief Texture slots of a material; each slot is bound to the texture unit of the same number.
+ *
+ * basic.frag declares its samplers with matching layout bindings, so no sampler uniform
+ * has to be set at draw time.
+ */
+enum MaterialTextureSlot
+{
+    DIFFUSE_TEXTURE_SLOT = 0,   ///< "texture_diffuse", sampled by texture_diffuse1
+    SPECULAR_TEXTURE_SLOT,      ///< "texture_specular", sampled by texture_specular1
+    MATERIAL_TEXTURE_SLOTS
+};
+
+/**
+ * \struct MaterialParameters
+ * \brief Shading parameters of a material.
+ */
+struct MaterialParameters
+{
+    glm::vec3 diffuseColor = glm::vec3(1.0f);   ///< Multiplies the diffuse texture
+    float opacity = 1.0f;                       ///< Alpha before the diffuse texture's
+    float specularStrength = 0.5f;              ///< Multiplies the specular texture
+    float shininess = 32.0f;                    ///< Specular exponent
+    float alphaCutoff = 0.5f;                   ///< Alpha below which ALPHA_TEST variants discard
+    bool alphaTest = false;                     ///< Whether the material needs an ALPHA_TEST variant
+    bool depthPrePass = true;                   ///< Whether meshes may be drawn in a depth pre-pass; never when alpha tested
+
+    bool operator==(const MaterialParameters& other) const = default;
+};
+
+/**
+ * \class Material
+ * \brief Textures and shading parameters shared by the meshes that look alike.
+ *
+ * Everything a draw needs is resolved when the material is created: each texture is
+ * assigned the unit of its slot from its type name, and the parameters are uploaded once
+ * into an immutable uniform buffer. Bind() then only issues one bind per texture and one
+ * for the parameters, and never allocates.
+ */
+class Material
+{
+public:
+    static constexpr GLuint CONSTANTS_BINDING = 1; ///< Uniform block binding of MaterialConstants in basic.frag
+
+    /**
+     * \brief Constructor. Creates the parameter buffer.
+     * \param textures Loaded textures; the first one of each slot's type is used, the rest are ignored.
+     * \param parameters Shading parameters.
+     */
+    Material(const std::vector<Texture>& textures, const MaterialParameters& parameters);
+
+    /**
+     * \brief Destructor. Deletes the parameter buffer; the textures belong to whoever loaded them.
+     */
+    ~Material();
+
+    Material(const Material&) = delete;
+    Material& operator=(const Material&) = delete;
+
+    /**
+     * \brief Bind the textures to their units and the parameters to CONSTANTS_BINDING.
+     */
+    void Bind() const;
+
+    /**
+     * \brief Check whether this material would be created from the same textures and parameters.
+     * \param textures Loaded textures.
+     * \param parameters Shading parameters.
+     * \return True if sharing this material gives the same result.
+     */
+    bool Matches(const std::vector<Texture>& textures, const MaterialParameters& parameters) const;
+
+    /**
+     * \brief Get the texture of a slot.
+     * \param slot Texture slot.
+     * \return Texture name; 0 if the slot is empty.
+     */
+    GLuint GetTexture(MaterialTextureSlot slot) const { return m_textures[slot]; }
+
+    /**
+     * \brief Get the number of textures Bind() binds.
+     * \return Filled slots.
+     */
+    size_t GetTextureCount() const { return m_bindingCount; }
+
+    /**
+     * \brief Get the shading parameters.
+     * \return The parameters.
+     */
+    const MaterialParameters& GetParameters() const { return m_parameters; }
+
+    /**
+     * \brief Map a texture type name to its slot.
+     * \param type Type name, e.g. "texture_diffuse".
+     * \return Slot; MATERIAL_TEXTURE_SLOTS if the type has none.
+     */
+    static MaterialTextureSlot GetSlot(const std::string& type);
+
+    /**
+     * \brief Run unit tests for the Material class.
+     */
+    static void test();
+
+private:
+    /**
+     * \struct TextureBinding
+     * \brief A texture and the unit it is bound to.
+     */
+    struct TextureBinding
+    {
+        GLuint unit = 0;    ///< Texture unit
+        GLuint texture = 0; ///< Texture name
+    };
+
+    /**
+     * \brief Resolve the texture of every slot.
+     * \param textures Loaded textures.
+     * \param slots Receives the texture name per slot.
+     */
+    static void ResolveTextures(const std::vector<Texture>& textures, GLuint (&slots)[MATERIAL_TEXTURE_SLOTS]);
+
+    GLuint m_textures[MATERIAL_TEXTURE_SLOTS];                  ///< Texture per slot, 0 if empty
+    TextureBinding m_bindings[MATERIAL_TEXTURE_SLOTS];          ///< Filled slots, in unit order
+    size_t m_bindingCount;                                      ///< Entries of m_bindings in use
+    MaterialParameters m_parameters;                            ///< Shading parameters
+    GLuint m_constants;                                         ///< Uniform buffer holding the parameters
+};
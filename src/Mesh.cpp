@@ -1,73 +1,67 @@
 #include "Mesh.h"
-#include <string>
-#include <iostream>
+#include "VertexArrayCache.h"
+#include "ShaderPermutations.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// Last Mesh::id handed out; meshes may be created on several loading threads
+std::atomic<uint64_t> s_lastId{ 0 };
+
+} // namespace
 
 void Mesh::setupMesh()
 {
-    // Create buffers/arrays
-    glGenVertexArrays(1, &vao);
-    glGenBuffers(1, &vbo);
-    glGenBuffers(1, &ebo);
+    // Immutable buffers filled at creation; GL rejects zero-sized storage
+    GlApi::CreateBuffers(1, &vbo);
+    GlApi::NamedBufferStorage(vbo, std::max<GLsizeiptr>(vertices.size() * sizeof(Vertex), 1), vertices.empty() ? nullptr : vertices.data(), 0);
 
-    // Bind vertex array object
-    glBindVertexArray(vao);
+    GlApi::CreateBuffers(1, &ebo);
+    GlApi::NamedBufferStorage(ebo, std::max<GLsizeiptr>(indices.size() * sizeof(unsigned int), 1), indices.empty() ? nullptr : indices.data(), 0);
 
-    // Load data into vertex buffers
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    id = ++s_lastId;
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+void Mesh::SetupVertexArray(GLuint vao, GLuint vbo, GLuint ebo)
+{
+    // One interleaved vertex buffer at binding 0, edited without binding the vertex array
+    GlApi::VertexArrayVertexBuffer(vao, 0, vbo, 0, sizeof(Vertex));
+    GlApi::VertexArrayElementBuffer(vao, ebo);
 
-    // Set the vertex attribute pointers
     // Vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    GlApi::EnableVertexArrayAttrib(vao, 0);
+    GlApi::VertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
+    GlApi::VertexArrayAttribBinding(vao, 0, 0);
 
     // Vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    GlApi::EnableVertexArrayAttrib(vao, 1);
+    GlApi::VertexArrayAttribFormat(vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
+    GlApi::VertexArrayAttribBinding(vao, 1, 0);
 
     // Vertex texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
-
-    // Unbind VAO
-    glBindVertexArray(0);
+    GlApi::EnableVertexArrayAttrib(vao, 2);
+    GlApi::VertexArrayAttribFormat(vao, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texCoord));
+    GlApi::VertexArrayAttribBinding(vao, 2, 0);
 }
 
-void Mesh::Draw() const
+void Mesh::Draw(DrawPass pass) const
 {
-    // Bind appropriate textures
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
+    PROFILE_SCOPE("Mesh::Draw");
 
-    for (unsigned int i = 0; i < textures.size(); i++)
+    if (pass == COLOR_PASS)
     {
-        // Activate proper texture unit before binding
-        glActiveTexture(GL_TEXTURE0 + i);
-
-        // Retrieve texture number (the N in diffuse_textureN)
-        std::string number;
-        std::string name = textures[i].type;
-        if (name == "texture_diffuse")
-            number = std::to_string(diffuseNr++);
-        else if (name == "texture_specular")
-            number = std::to_string(specularNr++);
-
-        // Bind the texture
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        ShaderPermutations::UseForMaterial(material->GetParameters());
+        material->Bind();
     }
-
-    // Draw mesh
-    glBindVertexArray(vao);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, nullptr);
-    glBindVertexArray(0);
-
-    // Reset texture binding
-    for (unsigned int i = 0; i < textures.size(); i++)
+    VertexArrayCache* vertexArrays = VertexArrayCache::GetCurrent();
+    if (vertexArrays == nullptr && vao == 0)
     {
-        glActiveTexture(GL_TEXTURE0 + i);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        // Shared meshes always draw through a cache and never get a vertex array of their own
+        GlApi::CreateVertexArrays(1, &vao);
+        SetupVertexArray(vao, vbo, ebo);
     }
+    GlApi::BindVertexArray(vertexArrays != nullptr ? vertexArrays->Get(*this) : vao);
+    GlApi::DrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, nullptr);
 }
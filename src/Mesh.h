@@ -3,8 +3,22 @@
 #include <GL/glew.h>
 #include <vector>
 #include <string>
+#include <memory>
 #include "Vertex.h"
-#include "Texture.h"
+#include "Material.h"
+#include "BoundingBox.h"
+#include "GlApi.h"
+#include "VertexArrayCache.h"
+
+/**
+ * \enum DrawPass
+ * \brief What a draw writes.
+ */
+enum DrawPass
+{
+    COLOR_PASS,     ///< Shaded with the mesh's material
+    DEPTH_PASS      ///< Depth only; the material is not bound
+};
 
 /**
  * \struct Mesh
@@ -14,12 +28,14 @@ struct Mesh
 {
     std::vector<Vertex> vertices;      ///< Vertex data
     std::vector<unsigned int> indices; ///< Index data
-    std::vector<Texture> textures;     ///< Texture data
+    std::shared_ptr<Material> material; ///< Textures and shading parameters, shared with meshes that look alike
+    BoundingBox bounds;                ///< Object-space bounds of the vertices
 
     // OpenGL buffer handles
-    mutable GLuint vao = 0;  ///< Vertex Array Object
+    mutable GLuint vao = 0;  ///< Own Vertex Array Object, created by the first Draw() without a VertexArrayCache
     mutable GLuint vbo = 0;  ///< Vertex Buffer Object
     mutable GLuint ebo = 0;  ///< Element Buffer Object
+    uint64_t id = 0;         ///< Unique among meshes ever created, keys VertexArrayCache entries
 
     /**
      * \brief Default constructor.
@@ -30,11 +46,15 @@ struct Mesh
      * \brief Constructor.
      * \param vertices Vector of vertices.
      * \param indices Vector of indices.
-     * \param textures Vector of textures.
+     * \param material Material to draw with.
      */
-    Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& textures)
-        : vertices(vertices), indices(indices), textures(textures)
+    Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, std::shared_ptr<Material> material)
+        : vertices(vertices), indices(indices), material(std::move(material))
     {
+        for (const auto& vertex : vertices)
+        {
+            bounds.Expand(vertex.position);
+        }
         setupMesh();
     }
 
@@ -44,10 +64,12 @@ struct Mesh
     Mesh(Mesh&& other) noexcept
         : vertices(std::move(other.vertices))
         , indices(std::move(other.indices))
-        , textures(std::move(other.textures))
+        , material(std::move(other.material))
+        , bounds(other.bounds)
         , vao(other.vao)
         , vbo(other.vbo)
         , ebo(other.ebo)
+        , id(other.id)
     {
         other.vao = 0;
         other.vbo = 0;
@@ -67,10 +89,12 @@ struct Mesh
             // Move resources
             vertices = std::move(other.vertices);
             indices = std::move(other.indices);
-            textures = std::move(other.textures);
+            material = std::move(other.material);
+            bounds = other.bounds;
             vao = other.vao;
             vbo = other.vbo;
             ebo = other.ebo;
+            id = other.id;
 
             // Clear other's resources
             other.vao = 0;
@@ -93,9 +117,25 @@ struct Mesh
     Mesh& operator=(const Mesh&) = delete;
 
     /**
-     * \brief Draw the mesh.
+     * \brief Draw the mesh with its material.
+     *
+     * Binds what the draw needs and nothing else, and does not allocate once the current
+     * VertexArrayCache, if any, holds the mesh. Without a cache, the first draw creates the
+     * mesh's own vertex array in the current context, which must then also be current when
+     * the mesh is destroyed. In the colour pass the current ShaderPermutations, if any,
+     * switches to the variant of the material.
+     *
+     * \param pass COLOR_PASS to bind the material, DEPTH_PASS for the geometry only.
+     */
+    void Draw(DrawPass pass = COLOR_PASS) const;
+
+    /**
+     * \brief Describe the Vertex layout in a vertex array, reading from the given buffers.
+     * \param vao Vertex array to set up.
+     * \param vbo Vertex buffer.
+     * \param ebo Element buffer.
      */
-    void Draw() const;
+    static void SetupVertexArray(GLuint vao, GLuint vbo, GLuint ebo);
 
 private:
     /**
@@ -103,9 +143,10 @@ private:
      */
     void cleanup()
     {
-        if (vao != 0) glDeleteVertexArrays(1, &vao);
-        if (vbo != 0) glDeleteBuffers(1, &vbo);
-        if (ebo != 0) glDeleteBuffers(1, &ebo);
+        if (vao != 0) GlApi::DeleteVertexArrays(1, &vao);
+        if (vbo != 0) VertexArrayCache::Release(id);   // Other contexts' vertex arrays over these buffers
+        if (vbo != 0) GlApi::DeleteBuffers(1, &vbo);
+        if (ebo != 0) GlApi::DeleteBuffers(1, &ebo);
     }
 
     /**
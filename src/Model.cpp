@@ -1,4 +1,6 @@
 #include "Model.h"
+#include "Profiler.h"
+#include "GlApi.h"
 #include <iostream>
 #include <filesystem>
 #include <GL/glew.h>
@@ -7,8 +9,23 @@
 // Initialize static members
 bool Model::s_testMode = true;
 
+namespace {
+
+// Assimp matrices are row-major, glm matrices column-major
+glm::mat4 ToGlm(const aiMatrix4x4& m)
+{
+    return glm::mat4(glm::vec4(m.a1, m.b1, m.c1, m.d1),
+                     glm::vec4(m.a2, m.b2, m.c2, m.d2),
+                     glm::vec4(m.a3, m.b3, m.c3, m.d3),
+                     glm::vec4(m.a4, m.b4, m.c4, m.d4));
+}
+
+} // namespace
+
 bool Model::LoadFromFile(const std::string& filePath)
 {
+    PROFILE_SCOPE("Model::LoadFromFile");
+
     if (s_testMode)
     {
         return true;
@@ -34,24 +51,35 @@ bool Model::LoadFromFile(const std::string& filePath)
     m_directory = std::filesystem::path(filePath).parent_path().string();
 
     // Process ASSIMP's root node recursively
-    processNode(scene->mRootNode, scene);
+    processNode(scene->mRootNode, scene, -1, glm::mat4(1.0f));
 
     return true;
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+void Model::processNode(aiNode* node, const aiScene* scene, int parent, const glm::mat4& parentTransform)
 {
+    // Record the node, keeping its transform relative to the parent
+    int index = static_cast<int>(m_nodes.size());
+    ModelNode modelNode;
+    modelNode.name = node->mName.C_Str();
+    modelNode.transform = ToGlm(node->mTransformation);
+    modelNode.parent = parent;
+    m_nodes.push_back(modelNode);
+    glm::mat4 transform = parentTransform * m_nodes.back().transform;
+
     // Process all the node's meshes (if any)
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
         aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
         m_meshes.push_back(processMesh(mesh, scene));
+        m_nodes[index].meshes.push_back(static_cast<unsigned int>(m_meshes.size() - 1));
+        m_bounds.Expand(m_meshes.back().bounds.Transformed(transform));
     }
 
     // Then do the same for each of its children
     for (unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], scene, index, transform);
     }
 }
 
@@ -102,22 +130,30 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
     }
 
     // Process material
-    if (mesh->mMaterialIndex >= 0)
-    {
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-
-        // 1. Diffuse maps
-        std::vector<Texture> diffuseMaps = loadMaterialTextures(material,
-            aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-
-        // 2. Specular maps
-        std::vector<Texture> specularMaps = loadMaterialTextures(material,
-            aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-    }
-
-    return Mesh(vertices, indices, textures);
+    aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+
+    // 1. Diffuse maps
+    std::vector<Texture> diffuseMaps = loadMaterialTextures(material,
+        aiTextureType_DIFFUSE, "texture_diffuse");
+    textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+
+    // 2. Specular maps
+    std::vector<Texture> specularMaps = loadMaterialTextures(material,
+        aiTextureType_SPECULAR, "texture_specular");
+    textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+
+    // 3. Shading parameters, keeping the defaults for what the file leaves out
+    MaterialParameters parameters;
+    aiColor3D color;
+    if (material->Get(AI_MATKEY_COLOR_DIFFUSE, color) == aiReturn_SUCCESS)
+        parameters.diffuseColor = glm::vec3(color.r, color.g, color.b);
+    float value = 0.0f;
+    if (material->Get(AI_MATKEY_OPACITY, value) == aiReturn_SUCCESS)
+        parameters.opacity = value;
+    if (material->Get(AI_MATKEY_SHININESS, value) == aiReturn_SUCCESS && value > 0.0f)
+        parameters.shininess = value;
+
+    return Mesh(vertices, indices, getMaterial(textures, parameters));
 }
 
 std::vector<Texture> Model::loadMaterialTextures(aiMaterial* material, aiTextureType type, const std::string& typeName)
@@ -155,12 +191,62 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* material, aiTexture
     return textures;
 }
 
-void Model::Draw() const
+std::shared_ptr<Material> Model::getMaterial(const std::vector<Texture>& textures, const MaterialParameters& parameters)
+{
+    for (const auto& material : m_materials)
+    {
+        if (material->Matches(textures, parameters))
+            return material;
+    }
+    m_materials.push_back(std::make_shared<Material>(textures, parameters));
+    return m_materials.back();
+}
+
+void Model::Draw(DrawPass pass) const
+{
+    for (const auto& mesh : m_meshes)
+    {
+        mesh.Draw(pass);
+    }
+}
+
+void Model::Draw(const Frustum& frustum, const glm::mat4& modelMatrix, DrawPass pass) const
+{
+    if (m_meshes.size() < 2)
+    {
+        Draw(pass);
+        return;
+    }
+
+    for (const auto& mesh : m_meshes)
+    {
+        if (frustum.TestAABB(mesh.bounds.Transformed(modelMatrix)))
+        {
+            mesh.Draw(pass);
+        }
+    }
+}
+
+void Model::DrawNode(size_t node, const Frustum* frustum, const glm::mat4& worldMatrix, DrawPass pass) const
+{
+    for (unsigned int meshIndex : m_nodes[node].meshes)
+    {
+        const Mesh& mesh = m_meshes[meshIndex];
+        if (frustum && !frustum->TestAABB(mesh.bounds.Transformed(worldMatrix)))
+            continue;
+        mesh.Draw(pass);
+    }
+}
+
+bool Model::SupportsDepthPrePass() const
 {
     for (const auto& mesh : m_meshes)
     {
-        mesh.Draw();
+        const MaterialParameters& parameters = mesh.material->GetParameters();
+        if (!parameters.depthPrePass || parameters.alphaTest)
+            return false;
     }
+    return true;
 }
 
 unsigned int Model::TextureFromFile(const char* path, const std::string& directory)
@@ -168,46 +254,61 @@ unsigned int Model::TextureFromFile(const char* path, const std::string& directo
     std::string filename = std::string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
+    unsigned int textureID = 0;
     int width, height, nrComponents;
     unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
     if (data)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-        else
-        {
+        textureID = CreateTexture(data, width, height, nrComponents);
+        if (textureID == 0)
             std::cerr << "Texture format not supported: " << filename << std::endl;
-            stbi_image_free(data);
-            return 0;
-        }
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    else
+    {
+        std::cerr << "Texture failed to load at path: " << filename << std::endl;
+    }
 
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    stbi_image_free(data);
+    return textureID;
+}
 
-        stbi_image_free(data);
+unsigned int Model::CreateTexture(const unsigned char* pixels, int width, int height, int components)
+{
+    // Immutable storage needs a sized internal format
+    GLenum format, internalFormat;
+    if (components == 1)
+    {
+        format = GL_RED;
+        internalFormat = GL_R8;
+    }
+    else if (components == 3)
+    {
+        format = GL_RGB;
+        internalFormat = GL_RGB8;
+    }
+    else if (components == 4)
+    {
+        format = GL_RGBA;
+        internalFormat = GL_RGBA8;
     }
     else
     {
-        std::cerr << "Texture failed to load at path: " << filename << std::endl;
-        stbi_image_free(data);
         return 0;
     }
 
-    return textureID;
+    GLuint texture = 0;
+    GlApi::CreateTextures(GL_TEXTURE_2D, 1, &texture);
+    GlApi::TextureStorage2D(texture, GlApi::GetMipLevelCount(width, height), internalFormat, width, height);
+    // Rows are tightly packed, which matters for 1 and 3 components
+    GlApi::PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    GlApi::TextureSubImage2D(texture, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, pixels);
+    GlApi::GenerateTextureMipmap(texture);
+
+    GlApi::TextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    GlApi::TextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    GlApi::TextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    GlApi::TextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
 }
 
 void Model::test()
@@ -225,6 +326,43 @@ void Model::test()
 
     // Test drawing (should not crash in test mode)
     model.Draw();
+    model.Draw(Frustum(), glm::mat4(1.0f));
+
+    // Test bounds
+    assert(!model.GetBounds().IsValid() && "Model without meshes should have empty bounds");
+    model.SetBounds(BoundingBox(glm::vec3(-1.0f), glm::vec3(1.0f)));
+    assert(model.GetBounds().IsValid() && "SetBounds failed");
+
+    // Test occluder geometry
+    assert(model.GetMeshes().empty() && model.GetOccluderIndices().empty() && "Model should start without geometry");
+    model.SetOccluderGeometry({ glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) }, { 0, 1, 2 });
+    assert(model.GetOccluderPositions().size() == 3 && model.GetOccluderIndices().size() == 3 && "SetOccluderGeometry failed");
+
+    // Test node hierarchy
+    assert(model.GetNodes().empty() && "Model should start without nodes");
+    model.SetNodes({ { "root", glm::mat4(1.0f), -1, {} }, { "child", glm::mat4(2.0f), 0, {} } });
+    assert(model.GetNodes().size() == 2 && model.GetNodes()[1].parent == 0 && "SetNodes failed");
+    model.DrawNode(1, nullptr, glm::mat4(1.0f));
+
+    // Test texture creation: immutable storage filled without binding anything
+    {
+        bool glTestMode = GlApi::IsTestMode();
+        GlApi::SetTestMode(true);
+        GlApi::BeginFrame();
+        std::vector<unsigned char> pixels(5 * 3 * 3, 128);
+        GLuint texture = CreateTexture(pixels.data(), 5, 3, 3);
+        assert(texture != 0 && "CreateTexture failed");
+        GlFrameStats stats = GlApi::GetCurrentStats();
+        assert(stats.calls == 9 && stats.stateChanges == 1 && "Only the unpack alignment should change");
+        assert(stats.bytesUploaded == pixels.size() && "Tightly packed rows should be uploaded");
+
+        GlApi::BeginFrame();
+        texture = CreateTexture(pixels.data(), 5, 3, 2);
+        assert(texture == 0 && GlApi::GetCurrentStats().calls == 0 &&
+               "Unsupported component counts should be rejected before creating anything");
+        GlApi::ResetStateCache();
+        GlApi::SetTestMode(glTestMode);
+    }
 
     // Disable test mode
     SetTestMode(false);
@@ -11,6 +11,20 @@
 #include "Vertex.h"
 #include "Mesh.h"
 #include "Texture.h"
+#include "BoundingBox.h"
+#include "Frustum.h"
+
+/**
+ * \struct ModelNode
+ * \brief A node of a model's transform hierarchy, as imported from the file.
+ */
+struct ModelNode
+{
+    std::string name;                   ///< Node name from the file
+    glm::mat4 transform;                ///< Transform relative to the parent node
+    int parent;                         ///< Index of the parent node, -1 for the root
+    std::vector<unsigned int> meshes;   ///< Indices into the model's meshes
+};
 
 /**
  * \class Model
@@ -38,8 +52,121 @@ public:
 
     /**
      * \brief Draw the model.
+     * \param pass Whether to shade or write depth only.
+     */
+    void Draw(DrawPass pass = COLOR_PASS) const;
+
+    /**
+     * \brief Draw the meshes of the model that intersect a frustum.
+     *
+     * Models with a single mesh skip the per-mesh test, since the caller has already
+     * tested the whole model.
+     *
+     * \param frustum The view frustum.
+     * \param modelMatrix The model's world transform.
+     * \param pass Whether to shade or write depth only.
+     */
+    void Draw(const Frustum& frustum, const glm::mat4& modelMatrix, DrawPass pass = COLOR_PASS) const;
+
+    /**
+     * \brief Draw the meshes attached to one node.
+     * \param node Index into GetNodes().
+     * \param frustum Optional view frustum to test each mesh against. May be nullptr.
+     * \param worldMatrix The node's world transform.
+     * \param pass Whether to shade or write depth only.
+     */
+    void DrawNode(size_t node, const Frustum* frustum, const glm::mat4& worldMatrix, DrawPass pass = COLOR_PASS) const;
+
+    /**
+     * \brief Check whether the model may be drawn in a depth pre-pass.
+     * \return False if any mesh's material opts out, e.g. because it is alpha tested.
+     */
+    bool SupportsDepthPrePass() const;
+
+    /**
+     * \brief Get the object-space bounds of all meshes.
+     * \return Model bounds. Invalid if the model has no geometry.
+     */
+    const BoundingBox& GetBounds() const { return m_bounds; }
+
+    /**
+     * \brief Override the object-space bounds, e.g. for placeholder or procedural models.
+     * \param bounds The new bounds.
+     */
+    void SetBounds(const BoundingBox& bounds) { m_bounds = bounds; }
+
+    /**
+     * \brief Get the meshes of the model.
+     * \return The meshes.
      */
-    void Draw() const;
+    const std::vector<Mesh>& GetMeshes() const { return m_meshes; }
+
+    /**
+     * \brief Append a mesh, e.g. for procedural models, and grow the bounds to contain it.
+     * \param mesh The mesh.
+     */
+    void AddMesh(Mesh mesh)
+    {
+        m_bounds.Expand(mesh.bounds);
+        m_meshes.push_back(std::move(mesh));
+    }
+
+    /**
+     * \brief Get the node hierarchy of the model.
+     *
+     * Parents precede their children. Models without nodes draw all meshes with the
+     * object's transform.
+     *
+     * \return The nodes.
+     */
+    const std::vector<ModelNode>& GetNodes() const { return m_nodes; }
+
+    /**
+     * \brief Replace the node hierarchy, e.g. for procedural models.
+     * \param nodes The nodes; parents must precede their children.
+     */
+    void SetNodes(std::vector<ModelNode> nodes) { m_nodes = std::move(nodes); }
+
+    /**
+     * \brief Set simplified geometry to rasterize when the model is used as an occluder.
+     *
+     * Without it the render meshes are rasterized. The geometry should stay inside the
+     * rendered surface, so it never hides anything the model itself would not.
+     *
+     * \param positions Object-space vertex positions.
+     * \param indices Triangle list indices.
+     */
+    void SetOccluderGeometry(std::vector<glm::vec3> positions, std::vector<unsigned int> indices)
+    {
+        m_occluderPositions = std::move(positions);
+        m_occluderIndices = std::move(indices);
+    }
+
+    /**
+     * \brief Get the occluder vertex positions.
+     * \return Positions, empty if no occluder geometry was set.
+     */
+    const std::vector<glm::vec3>& GetOccluderPositions() const { return m_occluderPositions; }
+
+    /**
+     * \brief Get the occluder triangle indices.
+     * \return Indices, empty if no occluder geometry was set.
+     */
+    const std::vector<unsigned int>& GetOccluderIndices() const { return m_occluderIndices; }
+
+    /**
+     * \brief Create a mipmapped, repeating texture with immutable storage.
+     *
+     * The texture is created and filled through direct state access, so no texture
+     * binding changes.
+     *
+     * \param pixels Tightly packed rows of 8-bit components.
+     * \param width Width in pixels.
+     * \param height Height in pixels.
+     * \param components Components per pixel: 1, 3 or 4.
+     * \return OpenGL texture ID; 0 if the component count is not supported.
+     */
+    static unsigned int CreateTexture(const unsigned char* pixels, int width, int height, int components);
 
     /**
      * \brief Run unit tests for Model class.
@@ -63,8 +190,10 @@ private:
      * \brief Process an Assimp node.
      * \param node The node to process.
      * \param scene The Assimp scene.
+     * \param parent Index of the parent in m_nodes, -1 for the root.
+     * \param parentTransform Transform from the parent node to model space.
      */
-    void processNode(aiNode* node, const aiScene* scene);
+    void processNode(aiNode* node, const aiScene* scene, int parent, const glm::mat4& parentTransform);
 
     /**
      * \brief Process an Assimp mesh.
@@ -83,6 +212,14 @@ private:
      */
     std::vector<Texture> loadMaterialTextures(aiMaterial* material, aiTextureType type, const std::string& typeName);
 
+    /**
+     * \brief Get a material, sharing one already created with the same textures and parameters.
+     * \param textures Loaded textures.
+     * \param parameters Shading parameters.
+     * \return The material.
+     */
+    std::shared_ptr<Material> getMaterial(const std::vector<Texture>& textures, const MaterialParameters& parameters);
+
     /**
      * \brief Load texture from file.
      * \param path Path to texture file.
@@ -93,7 +230,12 @@ private:
 
     std::string m_directory;                  ///< Directory containing model files
     std::vector<Mesh> m_meshes;              ///< Model meshes
+    std::vector<ModelNode> m_nodes;          ///< Node hierarchy, parents first
     std::vector<Texture> m_loadedTextures;    ///< Loaded textures
+    std::vector<std::shared_ptr<Material>> m_materials; ///< Materials of the meshes, one per distinct look
+    BoundingBox m_bounds;                     ///< Model-space bounds of all meshes, node transforms applied
+    std::vector<glm::vec3> m_occluderPositions;   ///< Simplified occluder vertices
+    std::vector<unsigned int> m_occluderIndices;  ///< Simplified occluder triangles
 
     static bool s_testMode;                   ///< Test mode flag
 };
@@ -0,0 +1,727 @@
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+#include "Simd.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+
+// Triangles set up per parallel batch; large occluders are split into chunks of this size
+constexpr size_t SETUP_BATCH_TRIANGLES = 1024;
+
+// Triangles with a smaller doubled area in pixels cover no pixel centers worth testing
+constexpr float MIN_TRIANGLE_AREA = 1e-8f;
+
+} // namespace
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+    : m_width((std::max(width, 8) + 7) & ~7)
+    , m_height(std::max(height, 1))
+    , m_viewProjection(1.0f)
+{
+    // Level sizes halve (rounding up) down to a single texel
+    glm::ivec2 size(m_width, m_height);
+    m_levelSizes.push_back(size);
+    while (size.x > 1 || size.y > 1)
+    {
+        size = glm::ivec2((size.x + 1) / 2, (size.y + 1) / 2);
+        m_levelSizes.push_back(size);
+    }
+
+    m_levels.resize(m_levelSizes.size());
+    for (size_t level = 0; level < m_levels.size(); ++level)
+    {
+        m_levels[level].assign(static_cast<size_t>(m_levelSizes[level].x) * m_levelSizes[level].y, 1.0f);
+    }
+
+    m_bins.resize(static_cast<size_t>((m_height + BAND_HEIGHT - 1) / BAND_HEIGHT));
+}
+
+void OcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+{
+    m_viewProjection = viewProjection;
+    m_occluders.clear();
+    m_triangles.clear();
+    for (auto& level : m_levels)
+    {
+        std::fill(level.begin(), level.end(), 1.0f);
+    }
+}
+
+void OcclusionCuller::AddOccluder(const glm::vec3* positions, size_t stride, size_t vertexCount,
+                                  const unsigned int* indices, size_t indexCount, const glm::mat4& world)
+{
+    glm::mat4 clipMatrix = m_viewProjection * world;
+    const size_t chunk = SETUP_BATCH_TRIANGLES * 3;
+    for (size_t first = 0; first + 3 <= indexCount; first += chunk)
+    {
+        size_t count = std::min(chunk, indexCount - first) / 3 * 3;
+        m_occluders.push_back({ positions, stride, vertexCount, indices + first, count, clipMatrix });
+    }
+}
+
+void OcclusionCuller::Rasterize(ThreadPool* pool)
+{
+    size_t threadCount = pool != nullptr ? pool->GetThreadCount() : 1;
+    if (m_workerTriangles.size() < threadCount)
+        m_workerTriangles.resize(threadCount);
+    for (auto& triangles : m_workerTriangles)
+    {
+        triangles.clear();
+    }
+
+    // Transform, clip and set up triangles into per-thread lists
+    auto setup = [this](size_t begin, size_t end, size_t worker)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            SetupOccluder(m_occluders[i], m_workerTriangles[worker]);
+        }
+    };
+    if (pool != nullptr)
+        pool->ParallelFor(m_occluders.size(), 1, setup);
+    else
+        setup(0, m_occluders.size(), 0);
+
+    m_triangles.clear();
+    for (const auto& triangles : m_workerTriangles)
+    {
+        m_triangles.insert(m_triangles.end(), triangles.begin(), triangles.end());
+    }
+
+    // Bin triangles into the bands their rows touch
+    for (auto& bin : m_bins)
+    {
+        bin.clear();
+    }
+    for (size_t t = 0; t < m_triangles.size(); ++t)
+    {
+        int firstBand = m_triangles[t].minY / BAND_HEIGHT;
+        int lastBand = m_triangles[t].maxY / BAND_HEIGHT;
+        for (int band = firstBand; band <= lastBand; ++band)
+        {
+            m_bins[band].push_back(static_cast<uint32_t>(t));
+        }
+    }
+
+    // Bands own disjoint rows, so they rasterize without synchronization
+    auto raster = [this](size_t begin, size_t end, size_t)
+    {
+        for (size_t band = begin; band < end; ++band)
+        {
+            RasterizeBand(band);
+        }
+    };
+    if (pool != nullptr)
+        pool->ParallelFor(m_bins.size(), 1, raster);
+    else
+        raster(0, m_bins.size(), 0);
+
+    BuildHierarchy();
+    m_occluders.clear();
+}
+
+void OcclusionCuller::SetupOccluder(const Occluder& occluder, std::vector<ScreenTriangle>& out) const
+{
+    const char* base = reinterpret_cast<const char*>(occluder.positions);
+    for (size_t i = 0; i + 3 <= occluder.indexCount; i += 3)
+    {
+        glm::vec4 clip[3];
+        bool valid = true;
+        for (int v = 0; v < 3; ++v)
+        {
+            unsigned int index = occluder.indices[i + v];
+            if (index >= occluder.vertexCount)
+            {
+                valid = false;
+                break;
+            }
+            const glm::vec3& position = *reinterpret_cast<const glm::vec3*>(base + index * occluder.stride);
+            clip[v] = occluder.clipMatrix * glm::vec4(position, 1.0f);
+        }
+        if (!valid)
+            continue;
+
+        // Trivially reject triangles entirely outside one side of the frustum
+        if ((clip[0].x > clip[0].w && clip[1].x > clip[1].w && clip[2].x > clip[2].w) ||
+            (clip[0].x < -clip[0].w && clip[1].x < -clip[1].w && clip[2].x < -clip[2].w) ||
+            (clip[0].y > clip[0].w && clip[1].y > clip[1].w && clip[2].y > clip[2].w) ||
+            (clip[0].y < -clip[0].w && clip[1].y < -clip[1].w && clip[2].y < -clip[2].w))
+            continue;
+
+        // Signed distance to the near plane (z >= -w in OpenGL clip space)
+        float distance[3] = { clip[0].z + clip[0].w, clip[1].z + clip[1].w, clip[2].z + clip[2].w };
+        int insideCount = (distance[0] >= 0.0f) + (distance[1] >= 0.0f) + (distance[2] >= 0.0f);
+        if (insideCount == 0)
+            continue;
+        if (insideCount == 3)
+        {
+            SetupTriangle(clip, out);
+            continue;
+        }
+
+        // Clip against the near plane: one vertex in front gives a triangle, two give a quad
+        glm::vec4 polygon[4];
+        int polygonSize = 0;
+        for (int v = 0; v < 3; ++v)
+        {
+            int next = (v + 1) % 3;
+            if (distance[v] >= 0.0f)
+                polygon[polygonSize++] = clip[v];
+            if ((distance[v] >= 0.0f) != (distance[next] >= 0.0f))
+            {
+                float t = distance[v] / (distance[v] - distance[next]);
+                polygon[polygonSize++] = clip[v] + (clip[next] - clip[v]) * t;
+            }
+        }
+
+        for (int v = 1; v + 1 < polygonSize; ++v)
+        {
+            glm::vec4 triangle[3] = { polygon[0], polygon[v], polygon[v + 1] };
+            SetupTriangle(triangle, out);
+        }
+    }
+}
+
+void OcclusionCuller::SetupTriangle(const glm::vec4 clip[3], std::vector<ScreenTriangle>& out) const
+{
+    float x[3], y[3], z[3];
+    for (int v = 0; v < 3; ++v)
+    {
+        // Near-plane clipping guarantees w > 0
+        float invW = 1.0f / clip[v].w;
+        x[v] = (clip[v].x * invW * 0.5f + 0.5f) * static_cast<float>(m_width);
+        y[v] = (clip[v].y * invW * 0.5f + 0.5f) * static_cast<float>(m_height);
+        z[v] = clip[v].z * invW * 0.5f + 0.5f;
+    }
+
+    // Occluders are rasterized regardless of facing: make the winding counter-clockwise
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area < 0.0f)
+    {
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        area = -area;
+    }
+    if (!(area > MIN_TRIANGLE_AREA))
+        return;
+
+    ScreenTriangle triangle;
+
+    // Pixels whose centers (i + 0.5) fall inside the bounding rectangle
+    float minX = std::min({ x[0], x[1], x[2] });
+    float maxX = std::max({ x[0], x[1], x[2] });
+    float minY = std::min({ y[0], y[1], y[2] });
+    float maxY = std::max({ y[0], y[1], y[2] });
+    triangle.minX = static_cast<int>(std::ceil(std::max(minX - 0.5f, 0.0f)));
+    triangle.maxX = static_cast<int>(std::floor(std::min(maxX - 0.5f, static_cast<float>(m_width - 1))));
+    triangle.minY = static_cast<int>(std::ceil(std::max(minY - 0.5f, 0.0f)));
+    triangle.maxY = static_cast<int>(std::floor(std::min(maxY - 0.5f, static_cast<float>(m_height - 1))));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return;
+
+    // Evaluate every edge from its lexicographically smaller vertex and negate for the other
+    // direction, so triangles sharing an edge get exactly opposite values and leave no cracks
+    for (int e = 0; e < 3; ++e)
+    {
+        int from = e;
+        int to = (e + 1) % 3;
+        bool reversed = x[to] < x[from] || (x[to] == x[from] && y[to] < y[from]);
+        if (reversed)
+            std::swap(from, to);
+
+        float a = y[from] - y[to];
+        float b = x[to] - x[from];
+        float c = -(a * x[from] + b * y[from]);
+        triangle.a[e] = reversed ? -a : a;
+        triangle.b[e] = reversed ? -b : b;
+        triangle.c[e] = reversed ? -c : c;
+    }
+
+    triangle.zA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    triangle.zB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+    triangle.zC = z[0] - triangle.zA * x[0] - triangle.zB * y[0];
+
+    out.push_back(triangle);
+}
+
+void OcclusionCuller::RasterizeBand(size_t band)
+{
+    const int bandMinY = static_cast<int>(band) * BAND_HEIGHT;
+    const int bandMaxY = std::min(bandMinY + BAND_HEIGHT, m_height) - 1;
+    float* depth = m_levels[0].data();
+
+    for (uint32_t t : m_bins[band])
+    {
+        const ScreenTriangle& tri = m_triangles[t];
+        const int minY = std::max(tri.minY, bandMinY);
+        const int maxY = std::min(tri.maxY, bandMaxY);
+
+#if defined(SNAPENGINE_AVX)
+        const int startX = tri.minX & ~7;
+        const __m256 laneX = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 a0 = _mm256_set1_ps(tri.a[0]), a1 = _mm256_set1_ps(tri.a[1]), a2 = _mm256_set1_ps(tri.a[2]);
+        const __m256 zA = _mm256_set1_ps(tri.zA);
+
+        for (int py = minY; py <= maxY; ++py)
+        {
+            const float centerY = static_cast<float>(py) + 0.5f;
+            const __m256 row0 = _mm256_set1_ps(tri.b[0] * centerY + tri.c[0]);
+            const __m256 row1 = _mm256_set1_ps(tri.b[1] * centerY + tri.c[1]);
+            const __m256 row2 = _mm256_set1_ps(tri.b[2] * centerY + tri.c[2]);
+            const __m256 rowZ = _mm256_set1_ps(tri.zB * centerY + tri.zC);
+            float* row = depth + static_cast<size_t>(py) * m_width;
+
+            for (int px = startX; px <= tri.maxX; px += 8)
+            {
+                __m256 centerX = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(px)), laneX);
+                __m256 inside = _mm256_and_ps(
+                    _mm256_and_ps(_mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a0, centerX), row0), zero, _CMP_GE_OQ),
+                                  _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a1, centerX), row1), zero, _CMP_GE_OQ)),
+                    _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(a2, centerX), row2), zero, _CMP_GE_OQ));
+                if (_mm256_movemask_ps(inside) == 0)
+                    continue;
+
+                __m256 z = _mm256_add_ps(_mm256_mul_ps(zA, centerX), rowZ);
+                __m256 current = _mm256_loadu_ps(row + px);
+                _mm256_storeu_ps(row + px, _mm256_blendv_ps(current, _mm256_min_ps(current, z), inside));
+            }
+        }
+#elif defined(SNAPENGINE_SSE)
+        const int startX = tri.minX & ~3;
+        const __m128 laneX = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 a0 = _mm_set1_ps(tri.a[0]), a1 = _mm_set1_ps(tri.a[1]), a2 = _mm_set1_ps(tri.a[2]);
+        const __m128 zA = _mm_set1_ps(tri.zA);
+
+        for (int py = minY; py <= maxY; ++py)
+        {
+            const float centerY = static_cast<float>(py) + 0.5f;
+            const __m128 row0 = _mm_set1_ps(tri.b[0] * centerY + tri.c[0]);
+            const __m128 row1 = _mm_set1_ps(tri.b[1] * centerY + tri.c[1]);
+            const __m128 row2 = _mm_set1_ps(tri.b[2] * centerY + tri.c[2]);
+            const __m128 rowZ = _mm_set1_ps(tri.zB * centerY + tri.zC);
+            float* row = depth + static_cast<size_t>(py) * m_width;
+
+            for (int px = startX; px <= tri.maxX; px += 4)
+            {
+                __m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(px)), laneX);
+                __m128 inside = _mm_and_ps(
+                    _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a0, centerX), row0), zero),
+                               _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a1, centerX), row1), zero)),
+                    _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a2, centerX), row2), zero));
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+
+                __m128 z = _mm_add_ps(_mm_mul_ps(zA, centerX), rowZ);
+                __m128 current = _mm_loadu_ps(row + px);
+                __m128 closer = _mm_min_ps(current, z);
+                _mm_storeu_ps(row + px, _mm_or_ps(_mm_and_ps(inside, closer), _mm_andnot_ps(inside, current)));
+            }
+        }
+#else
+        for (int py = minY; py <= maxY; ++py)
+        {
+            const float centerY = static_cast<float>(py) + 0.5f;
+            float* row = depth + static_cast<size_t>(py) * m_width;
+            for (int px = tri.minX; px <= tri.maxX; ++px)
+            {
+                const float centerX = static_cast<float>(px) + 0.5f;
+                if (tri.a[0] * centerX + tri.b[0] * centerY + tri.c[0] >= 0.0f &&
+                    tri.a[1] * centerX + tri.b[1] * centerY + tri.c[1] >= 0.0f &&
+                    tri.a[2] * centerX + tri.b[2] * centerY + tri.c[2] >= 0.0f)
+                {
+                    row[px] = std::min(row[px], tri.zA * centerX + tri.zB * centerY + tri.zC);
+                }
+            }
+        }
+#endif
+    }
+}
+
+void OcclusionCuller::BuildHierarchy()
+{
+    for (size_t level = 1; level < m_levels.size(); ++level)
+    {
+        const glm::ivec2 srcSize = m_levelSizes[level - 1];
+        const glm::ivec2 dstSize = m_levelSizes[level];
+        const float* src = m_levels[level - 1].data();
+        float* dst = m_levels[level].data();
+
+        for (int y = 0; y < dstSize.y; ++y)
+        {
+            const float* row0 = src + static_cast<size_t>(2 * y) * srcSize.x;
+            const float* row1 = src + static_cast<size_t>(std::min(2 * y + 1, srcSize.y - 1)) * srcSize.x;
+            float* out = dst + static_cast<size_t>(y) * dstSize.x;
+            int x = 0;
+
+#if defined(SNAPENGINE_SSE)
+            // Four outputs from eight inputs per row: max vertically, then max even/odd lanes
+            for (; 2 * x + 8 <= srcSize.x; x += 4)
+            {
+                __m128 lo = _mm_max_ps(_mm_loadu_ps(row0 + 2 * x), _mm_loadu_ps(row1 + 2 * x));
+                __m128 hi = _mm_max_ps(_mm_loadu_ps(row0 + 2 * x + 4), _mm_loadu_ps(row1 + 2 * x + 4));
+                __m128 even = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 odd = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+                _mm_storeu_ps(out + x, _mm_max_ps(even, odd));
+            }
+#endif
+            for (; x < dstSize.x; ++x)
+            {
+                int x0 = 2 * x;
+                int x1 = std::min(2 * x + 1, srcSize.x - 1);
+                out[x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::IsOccluded(const BoundingBox& bounds) const
+{
+    if (!bounds.IsValid() || m_triangles.empty())
+        return false;
+
+    float minX = std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max();
+    float maxX = -std::numeric_limits<float>::max();
+    float maxY = -std::numeric_limits<float>::max();
+    float nearestDepth = std::numeric_limits<float>::max();
+
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        glm::vec3 position((corner & 1) ? bounds.max.x : bounds.min.x,
+                           (corner & 2) ? bounds.max.y : bounds.min.y,
+                           (corner & 4) ? bounds.max.z : bounds.min.z);
+        glm::vec4 clip = m_viewProjection * glm::vec4(position, 1.0f);
+
+        // Boxes reaching past the near plane are right in front of the camera
+        if (clip.w <= 0.0f || clip.z < -clip.w)
+            return false;
+
+        float invW = 1.0f / clip.w;
+        float x = (clip.x * invW * 0.5f + 0.5f) * static_cast<float>(m_width);
+        float y = (clip.y * invW * 0.5f + 0.5f) * static_cast<float>(m_height);
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearestDepth = std::min(nearestDepth, clip.z * invW * 0.5f + 0.5f);
+    }
+
+    // Off screen: that is for the frustum test to decide
+    if (maxX < 0.0f || maxY < 0.0f || minX >= static_cast<float>(m_width) || minY >= static_cast<float>(m_height))
+        return false;
+
+    // Every pixel the rectangle touches
+    int x0 = static_cast<int>(std::max(minX, 0.0f));
+    int y0 = static_cast<int>(std::max(minY, 0.0f));
+    int x1 = static_cast<int>(std::min(maxX, static_cast<float>(m_width - 1)));
+    int y1 = static_cast<int>(std::min(maxY, static_cast<float>(m_height - 1)));
+
+    // Coarsest level at which the rectangle spans at most 2x2 texels
+    int level = 0;
+    while (level + 1 < static_cast<int>(m_levels.size()) &&
+           ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+    {
+        ++level;
+    }
+
+    const std::vector<float>& depth = m_levels[level];
+    const int levelWidth = m_levelSizes[level].x;
+    float farthest = 0.0f;
+    for (int y = y0 >> level; y <= (y1 >> level); ++y)
+    {
+        for (int x = x0 >> level; x <= (x1 >> level); ++x)
+        {
+            farthest = std::max(farthest, depth[static_cast<size_t>(y) * levelWidth + x]);
+        }
+    }
+
+    return nearestDepth > farthest;
+}
+
+size_t OcclusionCuller::CullOccluded(const BoundingBox* bounds, const uint32_t* indices, size_t count,
+                                     uint8_t* visible, ThreadPool* pool) const
+{
+    auto cull = [&](size_t begin, size_t end)
+    {
+        size_t occluded = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (IsOccluded(bounds[indices[i]]))
+            {
+                visible[indices[i]] = 0;
+                ++occluded;
+            }
+        }
+        return occluded;
+    };
+
+    if (pool == nullptr || count < 2 * PARALLEL_BATCH_SIZE || m_triangles.empty())
+    {
+        return cull(0, count);
+    }
+
+    std::atomic<size_t> occludedCount{0};
+    pool->ParallelFor(count, PARALLEL_BATCH_SIZE, [&](size_t begin, size_t end, size_t)
+    {
+        occludedCount.fetch_add(cull(begin, end), std::memory_order_relaxed);
+    });
+    return occludedCount.load();
+}
+
+namespace {
+
+// A closed axis-aligned box as 8 positions and 12 triangles
+void AppendBox(const glm::vec3& center, const glm::vec3& halfSize,
+               std::vector<glm::vec3>& positions, std::vector<unsigned int>& indices)
+{
+    unsigned int base = static_cast<unsigned int>(positions.size());
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        positions.push_back(center + glm::vec3((corner & 1) ? halfSize.x : -halfSize.x,
+                                               (corner & 2) ? halfSize.y : -halfSize.y,
+                                               (corner & 4) ? halfSize.z : -halfSize.z));
+    }
+
+    static const unsigned int faces[36] = {
+        0, 2, 1, 1, 2, 3,   4, 5, 6, 5, 7, 6,   0, 1, 4, 1, 5, 4,
+        2, 6, 3, 3, 6, 7,   0, 4, 2, 2, 4, 6,   1, 3, 5, 3, 7, 5
+    };
+    for (unsigned int index : faces)
+    {
+        indices.push_back(base + index);
+    }
+}
+
+BoundingBox MakeBox(const glm::vec3& center, float halfSize)
+{
+    return BoundingBox(center - glm::vec3(halfSize), center + glm::vec3(halfSize));
+}
+
+} // namespace
+
+void OcclusionCuller::test()
+{
+    std::cout << "[OcclusionCuller] Running tests...\n";
+
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 2.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * view;
+
+    // Test buffer and hierarchy sizes
+    {
+        OcclusionCuller culler(100, 50);
+        assert(culler.GetWidth() == 104 && culler.GetHeight() == 50 && "Width should round up to a multiple of 8");
+
+        OcclusionCuller defaults;
+        assert(defaults.GetWidth() == DEFAULT_WIDTH && defaults.GetHeight() == DEFAULT_HEIGHT && "Wrong default size");
+        assert(defaults.GetLevelCount() == 9 && "256x128 should have 9 levels");
+    }
+
+    // A 4x4 wall 10 units in front of the camera
+    std::vector<glm::vec3> wall = {
+        glm::vec3(-2.0f, -2.0f, -10.0f), glm::vec3(2.0f, -2.0f, -10.0f),
+        glm::vec3(2.0f, 2.0f, -10.0f), glm::vec3(-2.0f, 2.0f, -10.0f)
+    };
+    std::vector<unsigned int> wallIndices = { 0, 1, 2, 0, 2, 3 };
+
+    // Test rasterized depth and occlusion queries
+    {
+        OcclusionCuller culler;
+        culler.BeginFrame(viewProjection);
+        assert(!culler.IsOccluded(MakeBox(glm::vec3(0.0f, 0.0f, -20.0f), 0.5f)) && "Nothing is occluded without occluders");
+
+        culler.AddOccluder(wall.data(), sizeof(glm::vec3), wall.size(), wallIndices.data(), wallIndices.size(), glm::mat4(1.0f));
+        culler.Rasterize();
+        assert(culler.GetTriangleCount() == 2 && "Wall should produce two triangles");
+
+        glm::vec4 clip = viewProjection * glm::vec4(0.0f, 0.0f, -10.0f, 1.0f);
+        float expected = clip.z / clip.w * 0.5f + 0.5f;
+        float center = culler.GetDepth(culler.GetWidth() / 2, culler.GetHeight() / 2);
+        assert(std::abs(center - expected) < 1e-4f && "Wall depth incorrect");
+        assert(culler.GetDepth(0, 0) == 1.0f && "Corner should stay at the far plane");
+
+        assert(culler.IsOccluded(MakeBox(glm::vec3(0.0f, 0.0f, -20.0f), 0.5f)) && "Box behind the wall should be occluded");
+        assert(!culler.IsOccluded(MakeBox(glm::vec3(0.0f, 0.0f, -5.0f), 0.5f)) && "Box in front of the wall should be visible");
+        assert(!culler.IsOccluded(MakeBox(glm::vec3(10.0f, 0.0f, -20.0f), 0.5f)) && "Box beside the wall should be visible");
+        assert(!culler.IsOccluded(MakeBox(glm::vec3(1.9f, 0.0f, -20.0f), 1.0f)) && "Box peeking past the edge should be visible");
+        assert(!culler.IsOccluded(MakeBox(glm::vec3(0.0f, 0.0f, -10.0f), 0.5f)) && "Box through the wall should be visible");
+        assert(!culler.IsOccluded(MakeBox(glm::vec3(0.0f, 0.0f, 0.0f), 0.5f)) && "Box around the camera should be visible");
+        assert(!culler.IsOccluded(BoundingBox()) && "Invalid box should be visible");
+
+        // Reversed winding rasterizes the same
+        std::vector<unsigned int> reversed = { 0, 2, 1, 0, 3, 2 };
+        OcclusionCuller other;
+        other.BeginFrame(viewProjection);
+        other.AddOccluder(wall.data(), sizeof(glm::vec3), wall.size(), reversed.data(), reversed.size(), glm::mat4(1.0f));
+        other.Rasterize();
+        for (int y = 0; y < culler.GetHeight(); ++y)
+        {
+            for (int x = 0; x < culler.GetWidth(); ++x)
+            {
+                assert(culler.GetDepth(x, y) == other.GetDepth(x, y) && "Winding should not matter");
+            }
+        }
+
+        // A new frame forgets the occluders
+        culler.BeginFrame(viewProjection);
+        culler.Rasterize();
+        assert(culler.GetTriangleCount() == 0 && culler.GetDepth(culler.GetWidth() / 2, culler.GetHeight() / 2) == 1.0f && "BeginFrame should clear");
+        assert(!culler.IsOccluded(MakeBox(glm::vec3(0.0f, 0.0f, -20.0f), 0.5f)) && "Cleared buffer should occlude nothing");
+    }
+
+    // Test near-plane clipping: a floor that extends behind the camera
+    {
+        std::vector<glm::vec3> floor = {
+            glm::vec3(-50.0f, -1.0f, 5.0f), glm::vec3(50.0f, -1.0f, 5.0f),
+            glm::vec3(50.0f, -1.0f, -50.0f), glm::vec3(-50.0f, -1.0f, -50.0f)
+        };
+        OcclusionCuller culler;
+        culler.BeginFrame(viewProjection);
+        culler.AddOccluder(floor.data(), sizeof(glm::vec3), floor.size(), wallIndices.data(), wallIndices.size(), glm::mat4(1.0f));
+        culler.Rasterize();
+        assert(culler.GetTriangleCount() >= 2 && "Clipped floor should still rasterize");
+        assert(culler.GetDepth(culler.GetWidth() / 2, 0) < 1.0f && "Floor should cover the bottom of the screen");
+        assert(culler.GetDepth(culler.GetWidth() / 2, culler.GetHeight() - 1) == 1.0f && "Floor should not cover the sky");
+        assert(culler.IsOccluded(MakeBox(glm::vec3(0.0f, -5.0f, -20.0f), 0.5f)) && "Box under the floor should be occluded");
+        assert(!culler.IsOccluded(MakeBox(glm::vec3(0.0f, 0.0f, -20.0f), 0.5f)) && "Box above the floor should be visible");
+    }
+
+    // Test that threaded rasterization and culling match the serial path
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<unsigned int> indices;
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<float> spread(-30.0f, 30.0f);
+        std::uniform_real_distribution<float> depth(-60.0f, -10.0f);
+        for (int i = 0; i < 400; ++i)
+        {
+            AppendBox(glm::vec3(spread(rng), spread(rng) * 0.3f, depth(rng)), glm::vec3(1.5f), positions, indices);
+        }
+
+        std::vector<BoundingBox> bounds;
+        std::vector<uint32_t> candidates;
+        for (int i = 0; i < 20000; ++i)
+        {
+            bounds.push_back(MakeBox(glm::vec3(spread(rng), spread(rng) * 0.3f, depth(rng) - 20.0f), 0.3f));
+            candidates.push_back(static_cast<uint32_t>(i));
+        }
+
+        OcclusionCuller serial;
+        serial.BeginFrame(viewProjection);
+        serial.AddOccluder(positions.data(), sizeof(glm::vec3), positions.size(), indices.data(), indices.size(), glm::mat4(1.0f));
+        serial.Rasterize();
+
+        ThreadPool pool(3);
+        OcclusionCuller threaded;
+        threaded.BeginFrame(viewProjection);
+        threaded.AddOccluder(positions.data(), sizeof(glm::vec3), positions.size(), indices.data(), indices.size(), glm::mat4(1.0f));
+        threaded.Rasterize(&pool);
+
+        assert(serial.GetTriangleCount() == threaded.GetTriangleCount() && "Triangle counts differ");
+        for (int y = 0; y < serial.GetHeight(); ++y)
+        {
+            for (int x = 0; x < serial.GetWidth(); ++x)
+            {
+                assert(serial.GetDepth(x, y) == threaded.GetDepth(x, y) && "Threaded depth buffer differs");
+            }
+        }
+
+        std::vector<uint8_t> serialVisible(bounds.size(), 1), threadedVisible(bounds.size(), 1);
+        size_t serialOccluded = serial.CullOccluded(bounds.data(), candidates.data(), candidates.size(), serialVisible.data());
+        size_t threadedOccluded = threaded.CullOccluded(bounds.data(), candidates.data(), candidates.size(), threadedVisible.data(), &pool);
+        assert(serialOccluded == threadedOccluded && serialVisible == threadedVisible && "Threaded culling differs");
+        assert(serialOccluded > 0 && serialOccluded < bounds.size() && "Expected some but not all objects occluded");
+
+        // Occluded boxes must really be behind the buffer at every pixel they touch
+        for (size_t i = 0; i < bounds.size(); ++i)
+        {
+            assert((serialVisible[i] == 0) == serial.IsOccluded(bounds[i]) && "CullOccluded disagrees with IsOccluded");
+        }
+    }
+
+    std::cout << "[OcclusionCuller] Tests passed!\n";
+}
+
+void OcclusionCuller::benchmark()
+{
+    std::cout << "\nRunning OcclusionCuller benchmarks...\n";
+
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 2.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * view;
+    ThreadPool& pool = ThreadPool::Get();
+
+    using Clock = std::chrono::high_resolution_clock;
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> spread(-150.0f, 150.0f);
+    std::uniform_real_distribution<float> depth(-300.0f, -5.0f);
+    std::uniform_real_distribution<float> height(2.0f, 20.0f);
+
+    // A city block: buildings as occluders, many small props as occludees
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+    for (int i = 0; i < 2000; ++i)
+    {
+        float h = height(rng);
+        AppendBox(glm::vec3(spread(rng), h * 0.5f, depth(rng)), glm::vec3(4.0f, h * 0.5f, 4.0f), positions, indices);
+    }
+
+    const size_t objectCount = 100000;
+    std::vector<BoundingBox> bounds;
+    std::vector<uint32_t> candidates;
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        bounds.push_back(MakeBox(glm::vec3(spread(rng), 0.5f, depth(rng)), 0.5f));
+        candidates.push_back(static_cast<uint32_t>(i));
+    }
+    std::vector<uint8_t> visible(objectCount);
+
+    const int iterations = 20;
+    auto time = [&](auto&& body)
+    {
+        auto start = Clock::now();
+        for (int it = 0; it < iterations; ++it)
+            body();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+    };
+
+    OcclusionCuller culler;
+    auto rasterize = [&](ThreadPool* rasterPool)
+    {
+        culler.BeginFrame(viewProjection);
+        culler.AddOccluder(positions.data(), sizeof(glm::vec3), positions.size(), indices.data(), indices.size(), glm::mat4(1.0f));
+        culler.Rasterize(rasterPool);
+    };
+
+    double serialRasterMs = time([&] { rasterize(nullptr); });
+    double parallelRasterMs = time([&] { rasterize(&pool); });
+
+    size_t occluded = 0;
+    double serialTestMs = time([&]
+    {
+        std::fill(visible.begin(), visible.end(), uint8_t(1));
+        occluded = culler.CullOccluded(bounds.data(), candidates.data(), candidates.size(), visible.data());
+    });
+    double parallelTestMs = time([&]
+    {
+        std::fill(visible.begin(), visible.end(), uint8_t(1));
+        culler.CullOccluded(bounds.data(), candidates.data(), candidates.size(), visible.data(), &pool);
+    });
+
+    std::cout << "  " << culler.GetWidth() << "x" << culler.GetHeight() << " buffer, "
+              << indices.size() / 3 << " occluder triangles (" << culler.GetTriangleCount() << " set up)\n";
+    std::cout << "  rasterize: " << serialRasterMs << " ms, " << parallelRasterMs << " ms with " << pool.GetThreadCount() << " threads\n";
+    std::cout << "  test " << objectCount << " boxes: " << serialTestMs << " ms, " << parallelTestMs << " ms with "
+              << pool.GetThreadCount() << " threads, " << occluded << " occluded\n";
+}
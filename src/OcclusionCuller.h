@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "BoundingBox.h"
+
+class ThreadPool;
+
+/**
+ * \class OcclusionCuller
+ * \brief Software occlusion culling against a low-resolution CPU depth buffer.
+ *
+ * Each frame, occluder triangles are transformed, clipped against the near plane and
+ * rasterized into a small depth buffer holding post-projection depth in [0, 1], with
+ * row 0 at the bottom of the screen like OpenGL. The screen is split into horizontal
+ * bands that are rasterized in parallel, shading 4 (SSE) or 8 (AVX) pixels per step.
+ *
+ * A max-depth pyramid (HiZ) is then built over the buffer, so a bounding box is tested
+ * with at most four texel reads: it is occluded when its nearest depth lies behind the
+ * farthest occluder depth over its screen rectangle. Coverage is sampled at pixel centers,
+ * so objects peeking out by less than a pixel of the low-resolution buffer may be culled.
+ */
+class OcclusionCuller
+{
+public:
+    /**
+     * \brief Constructor.
+     * \param width Depth buffer width in pixels. Rounded up to a multiple of 8.
+     * \param height Depth buffer height in pixels.
+     */
+    explicit OcclusionCuller(int width = DEFAULT_WIDTH, int height = DEFAULT_HEIGHT);
+
+    /**
+     * \brief Clear the depth buffer and drop the occluders of the previous frame.
+     * \param viewProjection Combined projection * view matrix.
+     */
+    void BeginFrame(const glm::mat4& viewProjection);
+
+    /**
+     * \brief Queue an indexed triangle mesh as an occluder.
+     *
+     * The geometry is only referenced, and must stay alive until Rasterize() returns.
+     *
+     * \param positions First vertex position.
+     * \param stride Distance in bytes between consecutive positions.
+     * \param vertexCount Number of vertices.
+     * \param indices Triangle list indices.
+     * \param indexCount Number of indices.
+     * \param world World transform of the mesh.
+     */
+    void AddOccluder(const glm::vec3* positions, size_t stride, size_t vertexCount,
+                     const unsigned int* indices, size_t indexCount, const glm::mat4& world);
+
+    /**
+     * \brief Rasterize the queued occluders and build the depth hierarchy.
+     * \param pool Optional pool to spread triangle setup and rasterization across. May be nullptr.
+     */
+    void Rasterize(ThreadPool* pool = nullptr);
+
+    /**
+     * \brief Test a world-space box against the rasterized occluders.
+     * \param bounds World bounds. Invalid boxes are never occluded.
+     * \return True if the box is hidden behind the occluders.
+     */
+    bool IsOccluded(const BoundingBox& bounds) const;
+
+    /**
+     * \brief Test a list of objects and clear the visibility of the occluded ones.
+     * \param bounds World bounds of all objects.
+     * \param indices Indices into bounds of the objects to test.
+     * \param count Number of indices.
+     * \param visible Per-object visibility bytes, set to 0 for occluded objects.
+     * \param pool Optional pool to split large lists across. May be nullptr.
+     * \return Number of occluded objects.
+     */
+    size_t CullOccluded(const BoundingBox* bounds, const uint32_t* indices, size_t count,
+                        uint8_t* visible, ThreadPool* pool = nullptr) const;
+
+    /**
+     * \brief Get the depth buffer width.
+     * \return Width in pixels.
+     */
+    int GetWidth() const { return m_width; }
+
+    /**
+     * \brief Get the depth buffer height.
+     * \return Height in pixels.
+     */
+    int GetHeight() const { return m_height; }
+
+    /**
+     * \brief Read a depth buffer pixel.
+     * \param x Column.
+     * \param y Row, 0 at the bottom.
+     * \return Depth in [0, 1], 1 where nothing was drawn.
+     */
+    float GetDepth(int x, int y) const { return m_levels[0][static_cast<size_t>(y) * m_width + x]; }
+
+    /**
+     * \brief Get the number of triangles rasterized by the last Rasterize().
+     * \return Triangle count after near-plane clipping and back-facing/degenerate removal.
+     */
+    size_t GetTriangleCount() const { return m_triangles.size(); }
+
+    /**
+     * \brief Get the number of levels in the depth hierarchy.
+     * \return Level count, including the full-resolution buffer.
+     */
+    int GetLevelCount() const { return static_cast<int>(m_levels.size()); }
+
+    /**
+     * \brief Run unit tests for the OcclusionCuller class.
+     */
+    static void test();
+
+    /**
+     * \brief Run performance benchmarks for the OcclusionCuller class.
+     */
+    static void benchmark();
+
+    static constexpr int DEFAULT_WIDTH = 256;       ///< Default depth buffer width
+    static constexpr int DEFAULT_HEIGHT = 128;      ///< Default depth buffer height
+    static constexpr int BAND_HEIGHT = 8;           ///< Rows per parallel rasterization band
+
+    /// Lists shorter than this are tested on the calling thread.
+    static constexpr size_t PARALLEL_BATCH_SIZE = 4096;
+
+private:
+    /**
+     * \struct Occluder
+     * \brief A queued occluder mesh.
+     */
+    struct Occluder
+    {
+        const glm::vec3* positions;     ///< First position
+        size_t stride;                  ///< Bytes between positions
+        size_t vertexCount;             ///< Number of vertices
+        const unsigned int* indices;    ///< Triangle list indices
+        size_t indexCount;              ///< Number of indices
+        glm::mat4 clipMatrix;           ///< viewProjection * world
+    };
+
+    /**
+     * \struct ScreenTriangle
+     * \brief A set-up triangle: edge functions and depth plane in pixel coordinates.
+     *
+     * A pixel center (x, y) is inside when a[i] * x + b[i] * y + c[i] >= 0 for all edges;
+     * its depth is zA * x + zB * y + zC.
+     */
+    struct ScreenTriangle
+    {
+        float a[3], b[3], c[3];         ///< Edge function coefficients
+        float zA, zB, zC;               ///< Depth plane
+        int minX, maxX, minY, maxY;     ///< Covered pixel rectangle, inclusive
+    };
+
+    /**
+     * \brief Transform, clip and set up the triangles of one occluder.
+     * \param occluder The occluder.
+     * \param out Output triangles.
+     */
+    void SetupOccluder(const Occluder& occluder, std::vector<ScreenTriangle>& out) const;
+
+    /**
+     * \brief Set up one clip-space triangle that lies in front of the near plane.
+     * \param clip Clip-space vertices.
+     * \param out Output triangle list.
+     */
+    void SetupTriangle(const glm::vec4 clip[3], std::vector<ScreenTriangle>& out) const;
+
+    /**
+     * \brief Rasterize the triangles binned to one band.
+     * \param band Band index.
+     */
+    void RasterizeBand(size_t band);
+
+    /**
+     * \brief Build the max-depth pyramid from the full-resolution buffer.
+     */
+    void BuildHierarchy();
+
+    int m_width;                                        ///< Buffer width, a multiple of 8
+    int m_height;                                       ///< Buffer height
+    glm::mat4 m_viewProjection;                         ///< Camera of the current frame
+    std::vector<std::vector<float>> m_levels;           ///< Level 0 is the depth buffer, then max-reduced levels
+    std::vector<glm::ivec2> m_levelSizes;               ///< Size of each level
+    std::vector<Occluder> m_occluders;                  ///< Occluders queued this frame
+    std::vector<std::vector<ScreenTriangle>> m_workerTriangles; ///< Per-thread setup output
+    std::vector<ScreenTriangle> m_triangles;            ///< Triangles of the current frame
+    std::vector<std::vector<uint32_t>> m_bins;          ///< Triangle indices per band
+};
@@ -0,0 +1,385 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <cstdint>
+#include <GL/glew.h>
+#include "SpscQueue.h"
+
+/**
+ * \enum ProfileScopeType
+ * \brief Clock a profiled scope was measured on.
+ */
+enum ProfileScopeType
+{
+    CPU_SCOPE,  ///< Wall-clock time on the recording thread
+    GPU_SCOPE   ///< GPU time between two GL timestamp queries
+};
+
+/**
+ * \struct ProfileEvent
+ * \brief One completed scope.
+ */
+struct ProfileEvent
+{
+    const char* name;       ///< Scope name, a string with static storage duration
+    uint64_t start;         ///< Start in nanoseconds since the profiler epoch
+    uint64_t duration;      ///< Duration in nanoseconds
+    uint32_t thread;        ///< Index of the recording thread
+    uint16_t depth;         ///< Nesting depth on the recording thread, per clock
+    uint16_t type;          ///< ProfileScopeType
+};
+
+/**
+ * \struct ProfileScopeStats
+ * \brief Rolling statistics of one named scope.
+ */
+struct ProfileScopeStats
+{
+    std::string name;       ///< Scope name
+    ProfileScopeType type;  ///< Clock the scope was measured on
+    uint64_t calls;         ///< Completed scopes since the last Clear()
+    double lastMs;          ///< Duration of the most recent scope
+    double averageMs;       ///< Mean over the last samples
+    double minMs;           ///< Minimum over the last samples
+    double maxMs;           ///< Maximum over the last samples
+};
+
+/**
+ * \struct ProfileThreadBuffer
+ * \brief Events recorded by one thread, waiting to be collected.
+ *
+ * The owning thread is the only producer and Profiler::Collect() the only consumer, so
+ * recording never takes a lock. When the ring is full new events are dropped and counted.
+ * The GPU members are only touched by the owning thread.
+ */
+struct ProfileThreadBuffer
+{
+    /**
+     * \struct PendingGpuScope
+     * \brief GPU scope whose timestamp queries have not been read back yet.
+     */
+    struct PendingGpuScope
+    {
+        const char* name;   ///< Scope name
+        GLuint begin;       ///< Timestamp query issued when the scope opened
+        GLuint end;         ///< Timestamp query issued when the scope closed, 0 while open
+        uint16_t depth;     ///< GPU nesting depth
+    };
+
+    static constexpr size_t CAPACITY = 1 << 15;  ///< Events buffered between two Collect() calls
+
+    SpscQueue<ProfileEvent, CAPACITY> events;   ///< Completed scopes
+    std::atomic<uint64_t> dropped{ 0 };          ///< Events lost to a full ring
+    uint32_t index = 0;                          ///< Thread index used in events
+    uint16_t depth = 0;                          ///< Open CPU scopes
+    uint16_t gpuDepth = 0;                       ///< Open GPU scopes
+    std::string name;                            ///< Thread name for the trace, guarded by the profiler mutex
+    std::vector<GLuint> freeQueries;             ///< Query objects ready for reuse
+    std::vector<PendingGpuScope> pendingGpu;     ///< GPU scopes in the order they opened
+    int64_t gpuOffset = 0;                       ///< Profiler time minus GL_TIMESTAMP, in nanoseconds
+    bool gpuCalibrated = false;                  ///< Whether gpuOffset has been measured
+
+    /**
+     * \brief Append a completed scope, or count it as dropped if the ring is full.
+     * \param event The scope.
+     */
+    void Push(const ProfileEvent& event)
+    {
+        if (!events.TryPush(event))
+            dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+/**
+ * \class Profiler
+ * \brief Hierarchical CPU/GPU frame profiler.
+ *
+ * Code is instrumented with PROFILE_SCOPE and PROFILE_GPU_SCOPE, which expand to nothing
+ * unless SNAPENGINE_ENABLE_PROFILER is defined, and record nothing until SetEnabled(true).
+ * Each thread records into its own lock-free ring; Collect(), called once per frame,
+ * moves the events into a bounded history and updates the per-scope statistics. The
+ * history can be written as a Chrome trace_event JSON file for chrome://tracing or
+ * Perfetto.
+ *
+ * GPU scopes bracket their commands with glQueryCounter(GL_TIMESTAMP) rather than
+ * GL_TIME_ELAPSED queries, which cannot nest. The queries belong to the context current
+ * on the recording thread; ResolveGpuQueries() reads back the finished ones without
+ * stalling and must be called on that thread, as must ReleaseGpuQueries() before the
+ * context is destroyed.
+ */
+class Profiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * \brief Get the engine-wide profiler.
+     * \return The profiler instance.
+     */
+    static Profiler& Get();
+
+    /**
+     * \brief Start or stop recording.
+     * \param enabled Whether scopes are recorded.
+     */
+    static void SetEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+
+    /**
+     * \brief Check whether scopes are recorded.
+     * \return True if recording.
+     */
+    static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * \brief Get the current time on the profiler clock.
+     * \return Nanoseconds since the profiler epoch.
+     */
+    static uint64_t Now()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - s_epoch).count());
+    }
+
+    /**
+     * \brief Get the calling thread's event buffer, creating it on first use.
+     * \return The buffer, owned by the profiler.
+     */
+    ProfileThreadBuffer& GetThreadBuffer()
+    {
+        if (t_buffer == nullptr)
+            t_buffer = &CreateThreadBuffer();
+        return *t_buffer;
+    }
+
+    /**
+     * \brief Name the calling thread in exported traces.
+     * \param name Thread name, e.g. "Main" or "Render".
+     */
+    void SetThreadName(const std::string& name);
+
+    /**
+     * \brief Open a GPU scope on the calling thread's context.
+     * \param name Scope name.
+     * \return False if the scope is not recorded, e.g. too many scopes are unresolved.
+     */
+    bool BeginGpuScope(const char* name);
+
+    /**
+     * \brief Close the innermost open GPU scope of the calling thread.
+     */
+    void EndGpuScope();
+
+    /**
+     * \brief Read back the finished GPU scopes of the calling thread without waiting.
+     * \param wait Block until every closed scope has finished, e.g. before shutdown.
+     */
+    void ResolveGpuQueries(bool wait = false);
+
+    /**
+     * \brief Delete the calling thread's query objects and drop its unresolved GPU scopes.
+     */
+    void ReleaseGpuQueries();
+
+    /**
+     * \brief Move recorded events of all threads into the history and statistics.
+     *
+     * Safe to call from any thread; typically called once per frame.
+     */
+    void Collect();
+
+    /**
+     * \brief Discard the history, statistics and drop counts.
+     */
+    void Clear();
+
+    /**
+     * \brief Get the collected events, oldest first.
+     * \return The history, at most MAX_HISTORY_EVENTS long.
+     */
+    std::vector<ProfileEvent> GetEvents() const;
+
+    /**
+     * \brief Get the rolling statistics of every scope seen since the last Clear().
+     * \return Statistics, most expensive average first.
+     */
+    std::vector<ProfileScopeStats> GetStatistics() const;
+
+    /**
+     * \brief Format the statistics as a text table.
+     * \return One line per scope.
+     */
+    std::string FormatStatistics() const;
+
+    /**
+     * \brief Get the number of events lost to full thread buffers.
+     * \return Dropped events since the last Clear().
+     */
+    uint64_t GetDroppedEvents() const;
+
+    /**
+     * \brief Build the history as a Chrome trace_event document.
+     * \return JSON text.
+     */
+    std::string GetChromeTrace() const;
+
+    /**
+     * \brief Write the history as a Chrome trace_event file.
+     * \param path File to write.
+     * \return True on success.
+     */
+    bool WriteChromeTrace(const std::string& path) const;
+
+    /**
+     * \brief Run unit tests for the Profiler class.
+     */
+    static void test();
+
+    /**
+     * \brief Measure the cost of recording a scope.
+     */
+    static void benchmark();
+
+    static constexpr size_t MAX_HISTORY_EVENTS = 1 << 18;  ///< Events kept for export
+    static constexpr size_t STATS_WINDOW = 128;            ///< Samples per scope in the rolling statistics
+
+private:
+    /**
+     * \struct ScopeHistory
+     * \brief Recent durations of one named scope.
+     */
+    struct ScopeHistory
+    {
+        std::string name;               ///< Scope name
+        ProfileScopeType type;          ///< Clock
+        uint64_t calls = 0;             ///< Completed scopes
+        std::vector<float> samples;     ///< Ring of the last STATS_WINDOW durations in ms
+    };
+
+    Profiler() = default;
+
+    /**
+     * \brief Create and register a buffer for the calling thread.
+     * \return The buffer.
+     */
+    ProfileThreadBuffer& CreateThreadBuffer();
+
+    /**
+     * \brief Add one event to the history and statistics. Requires m_mutex.
+     * \param event The event.
+     */
+    void Record(const ProfileEvent& event);
+
+    mutable std::mutex m_mutex;                                     ///< Guards everything below
+    std::vector<std::unique_ptr<ProfileThreadBuffer>> m_threads;    ///< One buffer per recording thread, never freed
+    std::deque<ProfileEvent> m_history;                             ///< Collected events, oldest first
+    std::unordered_map<std::string, ScopeHistory> m_scopes;         ///< Statistics by type and name
+    std::unordered_map<const char*, ScopeHistory*> m_scopeLookup[2]; ///< m_scopes entries by name pointer, per ProfileScopeType
+    uint64_t m_droppedBase = 0;                                     ///< Dropped events before the last Clear()
+
+    static std::atomic<bool> s_enabled;                             ///< Recording switch
+    static const Clock::time_point s_epoch;                         ///< Time zero of events
+    static thread_local ProfileThreadBuffer* t_buffer;              ///< Calling thread's buffer
+};
+
+/**
+ * \class ProfileScope
+ * \brief Records the CPU time between construction and destruction.
+ */
+class ProfileScope
+{
+public:
+    /**
+     * \brief Constructor. Opens the scope if the profiler is enabled.
+     * \param name Scope name, a string with static storage duration.
+     */
+    explicit ProfileScope(const char* name)
+        : m_name(nullptr)
+        , m_buffer(nullptr)
+        , m_start(0)
+        , m_depth(0)
+    {
+        if (!Profiler::IsEnabled())
+            return;
+
+        m_name = name;
+        m_buffer = &Profiler::Get().GetThreadBuffer();
+        m_depth = m_buffer->depth++;
+        m_start = Profiler::Now();
+    }
+
+    /**
+     * \brief Destructor. Closes the scope.
+     */
+    ~ProfileScope()
+    {
+        if (m_name == nullptr)
+            return;
+
+        uint64_t end = Profiler::Now();
+        --m_buffer->depth;
+        m_buffer->Push({ m_name, m_start, end - m_start, m_buffer->index, m_depth, CPU_SCOPE });
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* m_name;                 ///< Scope name, nullptr if not recording
+    ProfileThreadBuffer* m_buffer;      ///< Recording thread's buffer
+    uint64_t m_start;                   ///< Start time
+    uint16_t m_depth;                   ///< Nesting depth
+};
+
+/**
+ * \class GpuProfileScope
+ * \brief Records the GPU time of the commands issued between construction and destruction.
+ */
+class GpuProfileScope
+{
+public:
+    /**
+     * \brief Constructor. Opens the scope if the profiler is enabled.
+     * \param name Scope name, a string with static storage duration.
+     */
+    explicit GpuProfileScope(const char* name)
+        : m_recording(Profiler::IsEnabled() && Profiler::Get().BeginGpuScope(name))
+    {
+    }
+
+    /**
+     * \brief Destructor. Closes the scope.
+     */
+    ~GpuProfileScope()
+    {
+        if (m_recording)
+            Profiler::Get().EndGpuScope();
+    }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    bool m_recording;                   ///< Whether the scope was opened
+};
+
+#define SNAPENGINE_PROFILE_CONCAT_INNER(a, b) a##b
+#define SNAPENGINE_PROFILE_CONCAT(a, b) SNAPENGINE_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef SNAPENGINE_ENABLE_PROFILER
+/// Record the CPU time of the enclosing block
+#define PROFILE_SCOPE(name) ProfileScope SNAPENGINE_PROFILE_CONCAT(profileScope, __LINE__)(name)
+/// Record the GPU time of the GL commands issued in the enclosing block
+#define PROFILE_GPU_SCOPE(name) GpuProfileScope SNAPENGINE_PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+/// Run a profiler call, e.g. Profiler::Get().Collect()
+#define PROFILE_CALL(call) call
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_GPU_SCOPE(name) ((void)0)
+#define PROFILE_CALL(call) ((void)0)
+#endif
@@ -0,0 +1,416 @@
+#include "ProgramCache.h"
+#include "GlApi.h"
+#include "Shader.h"
+#include "HeadlessContext.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cassert>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <functional>
+
+namespace {
+
+// File signature of cache entries
+const char ENTRY_MAGIC[8] = { 'S', 'N', 'A', 'P', 'P', 'R', 'G', '1' };
+
+// Magic, key, binary format and binary size precede the binary
+constexpr size_t ENTRY_HEADER_SIZE = sizeof(ENTRY_MAGIC) + sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint64_t);
+
+// Entries larger than this are treated as corrupt
+constexpr uint64_t MAX_BINARY_SIZE = 64ull << 20;
+
+// 64-bit FNV-1a
+constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t hash)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// Hashes the length first, so consecutive strings cannot run into each other
+uint64_t HashString(const std::string& text, uint64_t hash)
+{
+    uint64_t size = text.size();
+    hash = HashBytes(&size, sizeof(size), hash);
+    return HashBytes(text.data(), text.size(), hash);
+}
+
+const char* GetString(GLenum name)
+{
+    const GLubyte* value = glGetString(name);
+    return value != nullptr ? reinterpret_cast<const char*>(value) : "";
+}
+
+bool WriteEntry(const std::filesystem::path& path, uint64_t key, GLenum format, const std::vector<uint8_t>& binary)
+{
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    // Write a file of this thread's own, then move it into place in one step
+    std::filesystem::path temporary = path;
+    temporary += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+        uint32_t storedFormat = format;
+        uint64_t size = binary.size();
+        file.write(ENTRY_MAGIC, sizeof(ENTRY_MAGIC));
+        file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+        file.write(reinterpret_cast<const char*>(&storedFormat), sizeof(storedFormat));
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        file.write(reinterpret_cast<const char*>(binary.data()), static_cast<std::streamsize>(binary.size()));
+        if (!file)
+        {
+            file.close();
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+bool ReadEntry(const std::filesystem::path& path, uint64_t key, GLenum& format, std::vector<uint8_t>& binary)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    char magic[sizeof(ENTRY_MAGIC)];
+    uint64_t storedKey = 0;
+    uint32_t storedFormat = 0;
+    uint64_t size = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+    file.read(reinterpret_cast<char*>(&storedFormat), sizeof(storedFormat));
+    file.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if (!file || std::memcmp(magic, ENTRY_MAGIC, sizeof(magic)) != 0 || storedKey != key || size == 0 || size > MAX_BINARY_SIZE)
+        return false;
+
+    binary.resize(static_cast<size_t>(size));
+    file.read(reinterpret_cast<char*>(binary.data()), static_cast<std::streamsize>(size));
+    if (!file || file.peek() != std::ifstream::traits_type::eof())
+        return false;
+    format = storedFormat;
+    return true;
+}
+
+} // namespace
+
+ProgramCache& ProgramCache::Get()
+{
+    static ProgramCache cache;
+    return cache;
+}
+
+ProgramCache::ProgramCache()
+    : m_directory("shader_cache")
+{
+}
+
+void ProgramCache::SetDirectory(const std::filesystem::path& directory)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_directory = directory;
+}
+
+std::filesystem::path ProgramCache::GetDirectory() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_directory;
+}
+
+std::filesystem::path ProgramCache::GetPath(uint64_t key) const
+{
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+    return GetDirectory() / name.str();
+}
+
+uint64_t ProgramCache::ComputeKey(const std::vector<std::string>& sources, const std::string& defines, const std::string& driver)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    uint64_t count = sources.size();
+    hash = HashBytes(&count, sizeof(count), hash);
+    for (const std::string& source : sources)
+        hash = HashString(source, hash);
+    hash = HashString(defines, hash);
+    hash = HashString(driver, hash);
+    return hash != 0 ? hash : 1;
+}
+
+std::string ProgramCache::GetDriverSignature()
+{
+    GLint formatCount = 0;
+    GlApi::GetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount <= 0)
+        return "";
+
+    std::vector<GLint> formats(static_cast<size_t>(formatCount));
+    GlApi::GetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+
+    std::ostringstream signature;
+    signature << GetString(GL_VENDOR) << '\n' << GetString(GL_RENDERER) << '\n' << GetString(GL_VERSION) << '\n';
+    for (GLint format : formats)
+        signature << format << ' ';
+    return signature.str();
+}
+
+uint64_t ProgramCache::GetKey(const std::vector<std::string>& sources, const std::string& defines) const
+{
+    if (GetDirectory().empty() || GlApi::IsCapturing())
+        return 0;
+
+    std::string driver = GetDriverSignature();
+    return driver.empty() ? 0 : ComputeKey(sources, defines, driver);
+}
+
+bool ProgramCache::Load(uint64_t key, GLuint& program)
+{
+    if (key == 0)
+        return false;
+
+    using Clock = std::chrono::high_resolution_clock;
+    auto start = Clock::now();
+
+    std::filesystem::path path = GetPath(key);
+    GLenum format = 0;
+    std::vector<uint8_t> binary;
+    std::error_code error;
+    if (!ReadEntry(path, key, format, binary))
+    {
+        // Drop unreadable entries so the next Store() replaces them
+        if (std::filesystem::exists(path, error))
+            std::filesystem::remove(path, error);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.misses;
+        return false;
+    }
+
+    GLuint candidate = GlApi::CreateProgram();
+    GlApi::ProgramBinary(candidate, format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint success = GL_FALSE;
+    GlApi::GetProgramiv(candidate, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        // Typically a driver update that kept the version string
+        GlApi::DeleteProgram(candidate);
+        std::filesystem::remove(path, error);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.misses;
+        ++m_stats.rejected;
+        return false;
+    }
+
+    program = candidate;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.hits;
+    m_stats.loadMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return true;
+}
+
+bool ProgramCache::Store(uint64_t key, GLuint program)
+{
+    if (key == 0 || program == 0)
+        return false;
+
+    GLint length = 0;
+    GlApi::GetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    std::vector<uint8_t> binary(static_cast<size_t>(length));
+    GLsizei written = 0;
+    GLenum format = 0;
+    GlApi::GetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0)
+        return false;
+    binary.resize(static_cast<size_t>(written));
+
+    if (!WriteEntry(GetPath(key), key, format, binary))
+    {
+        std::cerr << "Failed to write shader cache entry " << GetPath(key) << std::endl;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.stores;
+    return true;
+}
+
+ProgramCacheStats ProgramCache::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void ProgramCache::test()
+{
+    std::cout << "[ProgramCache] Running tests...\n";
+
+    ProgramCache& cache = Get();
+    std::filesystem::path previousDirectory = cache.GetDirectory();
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "snapengine_program_cache_test";
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    cache.SetDirectory(directory);
+
+    // Test keys
+    {
+        std::vector<std::string> sources = { "vertex", "fragment" };
+        uint64_t key = ComputeKey(sources, "", "driver");
+        assert(key != 0 && key == ComputeKey(sources, "", "driver") && "Keys should be deterministic");
+        assert(key != ComputeKey({ "vertex", "fragment2" }, "", "driver") && "Keys should depend on the sources");
+        assert(key != ComputeKey({ "vertexf", "ragment" }, "", "driver") && "Keys should depend on stage boundaries");
+        assert(key != ComputeKey(sources, "#define SKINNED\n", "driver") && "Keys should depend on the defines");
+        assert(key != ComputeKey(sources, "", "driver 2") && "Keys should depend on the driver");
+    }
+
+    // Test entry files
+    {
+        std::vector<uint8_t> binary = { 1, 2, 3, 4, 5 };
+        std::filesystem::path path = cache.GetPath(42);
+        assert(path.parent_path() == directory && path.extension() == ".bin" && "Entries should live in the directory");
+        bool written = WriteEntry(path, 42, 7, binary);
+        assert(written && "WriteEntry failed");
+
+        GLenum format = 0;
+        std::vector<uint8_t> loaded;
+        bool read = ReadEntry(path, 42, format, loaded);
+        assert(read && format == 7 && loaded == binary && "Entry round trip failed");
+        read = ReadEntry(path, 43, format, loaded);
+        assert(!read && "An entry under another key should be rejected");
+
+        // A truncated entry is rejected, and Load() deletes it without touching GL
+        std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+        read = ReadEntry(path, 42, format, loaded);
+        assert(!read && "Truncated entry should be rejected");
+        GLuint program = 0;
+        ProgramCacheStats before = cache.GetStats();
+        bool hit = cache.Load(42, program);
+        assert(!hit && program == 0 && "Load should miss on a corrupt entry");
+        assert(!std::filesystem::exists(path) && "Corrupt entry should be deleted");
+        hit = cache.Load(42, program);
+        assert(!hit && "Load should miss without an entry");
+        hit = cache.Load(0, program);
+        bool stored = cache.Store(0, 1);
+        assert(!hit && !stored && "Key 0 should disable the cache");
+        ProgramCacheStats after = cache.GetStats();
+        assert(after.misses == before.misses + 2 && after.hits == before.hits && "Miss counters wrong");
+    }
+
+    // Test the real cache if a context can be created
+    try
+    {
+        HeadlessContext context(16, 16);
+        if (GetDriverSignature().empty())
+        {
+            std::cout << "[ProgramCache] Driver has no program binary formats, skipping GL tests\n";
+        }
+        else
+        {
+            ProgramCacheStats before = cache.GetStats();
+            Shader cold;
+            bool loaded = cold.LoadFromFiles("shaders/basic.vert", "shaders/basic.frag");
+            assert(loaded && "Cold load failed");
+            ProgramCacheStats stored = cache.GetStats();
+            assert(stored.misses == before.misses + 1 && stored.stores == before.stores + 1 && "Cold load should store");
+
+            Shader warm;
+            loaded = warm.LoadFromFiles("shaders/basic.vert", "shaders/basic.frag");
+            assert(loaded && "Warm load failed");
+            assert(cache.GetStats().hits == before.hits + 1 && "Warm load should hit");
+            assert(warm.GetUniformLocation("texture_diffuse1") != -1 && "Cached program should have its uniforms");
+
+            // A damaged binary is rejected by the driver and replaced by a source compile
+            for (const auto& entry : std::filesystem::directory_iterator(directory))
+            {
+                std::fstream file(entry.path(), std::ios::in | std::ios::out | std::ios::binary);
+                file.seekp(static_cast<std::streamoff>(ENTRY_HEADER_SIZE + 16));
+                const char garbage[32] = { 'x' };
+                file.write(garbage, sizeof(garbage));
+            }
+            Shader fallback;
+            loaded = fallback.LoadFromFiles("shaders/basic.vert", "shaders/basic.frag");
+            assert(loaded && fallback.IsValid() && "Fallback compile failed");
+            ProgramCacheStats after = cache.GetStats();
+            assert(after.rejected + after.hits == before.rejected + before.hits + 2 && "Damaged binary should be rejected or still load");
+            assert(glGetError() == GL_NO_ERROR && "GL error in program cache test");
+            std::cout << "[ProgramCache] " << after.hits << " hits, " << after.misses << " misses, " << after.rejected
+                      << " rejected, " << after.stores << " stores\n";
+        }
+    }
+    catch (const std::runtime_error&)
+    {
+        std::cout << "[ProgramCache] Failed to create headless GL context, skipping GL tests\n";
+    }
+
+    std::filesystem::remove_all(directory, error);
+    cache.SetDirectory(previousDirectory);
+
+    std::cout << "[ProgramCache] Tests passed!\n";
+}
+
+void ProgramCache::benchmark()
+{
+    std::cout << "\nRunning ProgramCache benchmarks...\n";
+
+    ProgramCache& cache = Get();
+    std::filesystem::path previousDirectory = cache.GetDirectory();
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "snapengine_program_cache_benchmark";
+    std::error_code error;
+
+    try
+    {
+        HeadlessContext context(16, 16);
+        if (GetDriverSignature().empty())
+            throw std::runtime_error("no program binary formats");
+
+        using BenchClock = std::chrono::high_resolution_clock;
+        const int runs = 5;
+        auto time = [&](bool clearCache)
+        {
+            double totalMs = 0.0;
+            for (int i = 0; i < runs; ++i)
+            {
+                if (clearCache)
+                    std::filesystem::remove_all(directory, error);
+                auto start = BenchClock::now();
+                Shader shader("shaders/basic.vert", "shaders/basic.frag");
+                GlApi::Finish();
+                totalMs += std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+            }
+            return totalMs / runs;
+        };
+
+        cache.SetDirectory("");
+        double uncachedMs = time(false);
+        cache.SetDirectory(directory);
+        double coldMs = time(true);
+        double warmMs = time(false);
+        std::cout << "  basic shader: no cache " << uncachedMs << " ms, cold cache " << coldMs << " ms, warm cache " << warmMs << " ms\n";
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << "  Skipping: " << e.what() << "\n";
+    }
+
+    std::filesystem::remove_all(directory, error);
+    cache.SetDirectory(previousDirectory);
+}
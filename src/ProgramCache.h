@@ -0,0 +1,134 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <cstdint>
+#include <filesystem>
+#include <GL/glew.h>
+
+/**
+ * \struct ProgramCacheStats
+ * \brief Counters of a ProgramCache.
+ */
+struct ProgramCacheStats
+{
+    uint64_t hits = 0;          ///< Programs created from a cached binary
+    uint64_t misses = 0;        ///< Lookups without a usable cache entry
+    uint64_t rejected = 0;      ///< Cached binaries the driver refused, counted in misses too
+    uint64_t stores = 0;        ///< Binaries written to the cache
+    double loadMs = 0.0;        ///< Time spent creating programs from binaries
+};
+
+/**
+ * \class ProgramCache
+ * \brief On-disk cache of linked shader program binaries.
+ *
+ * Entries are keyed by a hash of the shader sources, the preprocessor defines and the
+ * driver: vendor, renderer, version and the program binary formats it accepts. Any of
+ * these changing therefore misses instead of loading a stale binary, and a binary the
+ * driver still rejects is deleted so the caller can compile from source and store a
+ * fresh one.
+ *
+ * The cache is bypassed while a GlApi capture is recording, so captures contain source
+ * compiles that replay on any driver.
+ */
+class ProgramCache
+{
+public:
+    /**
+     * \brief Get the process-wide cache.
+     * \return The cache, in "shader_cache" until SetDirectory() is called.
+     */
+    static ProgramCache& Get();
+
+    /**
+     * \brief Set where entries are stored.
+     * \param directory Cache directory, created when the first entry is stored; empty to disable the cache.
+     */
+    void SetDirectory(const std::filesystem::path& directory);
+
+    /**
+     * \brief Get the cache directory.
+     * \return Directory; empty if the cache is disabled.
+     */
+    std::filesystem::path GetDirectory() const;
+
+    /**
+     * \brief Compute the key of a program for the current context.
+     *
+     * Requires a current context.
+     *
+     * \param sources Source text of every stage, in a fixed order.
+     * \param defines Preprocessor defines the sources are compiled with.
+     * \return Key; 0 if the cache is disabled, capturing, or the driver has no binary formats.
+     */
+    uint64_t GetKey(const std::vector<std::string>& sources, const std::string& defines) const;
+
+    /**
+     * \brief Create a program from a cached binary.
+     * \param key Key from GetKey().
+     * \param program Receives the linked program on success.
+     * \return True on a hit; false if there is no entry or the driver rejected it.
+     */
+    bool Load(uint64_t key, GLuint& program);
+
+    /**
+     * \brief Store the binary of a linked program.
+     *
+     * The program should have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+     *
+     * \param key Key from GetKey(); 0 stores nothing.
+     * \param program Linked program.
+     * \return True if an entry was written.
+     */
+    bool Store(uint64_t key, GLuint program);
+
+    /**
+     * \brief Get the counters.
+     * \return A copy of the counters.
+     */
+    ProgramCacheStats GetStats() const;
+
+    /**
+     * \brief Hash shader sources, defines and a driver description into a key.
+     * \param sources Source text of every stage.
+     * \param defines Preprocessor defines.
+     * \param driver Driver description from GetDriverSignature().
+     * \return Non-zero key.
+     */
+    static uint64_t ComputeKey(const std::vector<std::string>& sources, const std::string& defines, const std::string& driver);
+
+    /**
+     * \brief Describe the current context's driver for keys.
+     * \return Vendor, renderer, version and binary formats; empty if no binary formats are supported.
+     */
+    static std::string GetDriverSignature();
+
+    /**
+     * \brief Run unit tests for the ProgramCache class.
+     */
+    static void test();
+
+    /**
+     * \brief Measure shader startup without the cache, with a cold cache and with a warm one.
+     */
+    static void benchmark();
+
+private:
+    /**
+     * \brief Constructor.
+     */
+    ProgramCache();
+
+    /**
+     * \brief Get the file of an entry.
+     * \param key Entry key.
+     * \return Path in the cache directory.
+     */
+    std::filesystem::path GetPath(uint64_t key) const;
+
+    mutable std::mutex m_mutex;         ///< Guards the members below
+    std::filesystem::path m_directory;  ///< Cache directory, empty if disabled
+    ProgramCacheStats m_stats;          ///< Counters
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+#include "LightClusters.h"
+
+class Model;
+
+/**
+ * \struct DrawItem
+ * \brief One model (or one node of a model's hierarchy) to draw, with its resolved transforms.
+ */
+struct DrawItem
+{
+    const Model* model;         ///< Model to draw; kept alive by the scene until the snapshot is rendered
+    int node;                   ///< Index into the model's GetNodes(), -1 to draw every mesh
+    glm::mat4 world;            ///< World matrix
+    glm::mat3 normalMatrix;     ///< Normal matrix for world
+    uint64_t sortKey;           ///< Submission order: model in the high bits, front-to-back depth in the low bits
+    bool depthPrePass;          ///< Drawn in the depth pre-pass when the snapshot uses one
+};
+
+/**
+ * \struct RenderSnapshot
+ * \brief Everything needed to render one frame, decoupled from the live scene.
+ *
+ * Built by Scene::BuildSnapshot() on the simulation thread and consumed by
+ * Scene::Submit() on the thread owning the GL context, so the scene can be changed
+ * while a previous frame is still being rendered. Vectors are cleared, not freed,
+ * between frames, so a reused snapshot stops allocating once it has warmed up.
+ * Draws are sorted by DrawItem::sortKey.
+ */
+struct RenderSnapshot
+{
+    uint64_t frame = 0;                 ///< Frame number
+    glm::mat4 view = glm::mat4(1.0f);   ///< Camera view matrix
+    glm::mat4 projection = glm::mat4(1.0f); ///< Camera projection matrix
+    glm::vec3 cameraPosition = glm::vec3(0.0f); ///< Camera position in world space
+    int viewportWidth = 0;              ///< Framebuffer width, 0 to keep the current viewport
+    int viewportHeight = 0;             ///< Framebuffer height
+    bool frustumCulling = false;        ///< Test each mesh of multi-mesh models against frustum
+    bool depthPrePass = false;          ///< Lay down depth for the pre-passed draws before shading them
+    Frustum frustum;                    ///< View frustum of the frame
+    std::vector<DrawItem> draws;        ///< Visible draws
+    LightGrid lightGrid;                ///< Dynamic lights binned into view clusters
+    std::vector<std::shared_ptr<Model>> released;   ///< Models removed from the scene, released after rendering
+    double buildTimeMs = 0.0;           ///< Time spent building the snapshot
+};
@@ -0,0 +1,299 @@
+#include "RenderThread.h"
+#include "Model.h"
+#include "Profiler.h"
+#include "GlApi.h"
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double ElapsedMs(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void Accumulate(std::atomic<double>& total, double value)
+{
+    // Only the render thread writes, so load + store is enough
+    total.store(total.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+} // namespace
+
+RenderThread::RenderThread(GLFWwindow* window, RenderFunction render, std::atomic<uint64_t>* presented)
+    : m_window(window)
+    , m_render(std::move(render))
+    , m_presented(presented)
+{
+    m_free.TryPush(&m_snapshots[0]);
+    m_free.TryPush(&m_snapshots[1]);
+    m_thread = std::thread(&RenderThread::ThreadMain, this);
+}
+
+RenderThread::~RenderThread()
+{
+    Stop();
+}
+
+RenderSnapshot& RenderThread::AcquireSnapshot()
+{
+    assert(m_acquired == nullptr && "AcquireSnapshot: previous snapshot not submitted");
+
+    auto start = Clock::now();
+    m_free.Pop(m_acquired);
+    m_waitTotalMs += ElapsedMs(start, Clock::now());
+    return *m_acquired;
+}
+
+RenderSnapshot* RenderThread::TryAcquireSnapshot()
+{
+    assert(m_acquired == nullptr && "TryAcquireSnapshot: previous snapshot not submitted");
+
+    if (!m_free.TryPop(m_acquired))
+    {
+        ++m_skipped;
+        return nullptr;
+    }
+    return m_acquired;
+}
+
+void RenderThread::SubmitSnapshot()
+{
+    assert(m_acquired != nullptr && "SubmitSnapshot: no snapshot acquired");
+
+    auto now = Clock::now();
+    if (m_submitted > 0)
+        m_simulateTotalMs += ElapsedMs(m_lastSubmit, now);
+    m_lastSubmit = now;
+    ++m_submitted;
+
+    m_filled.Push(m_acquired);
+    m_acquired = nullptr;
+}
+
+void RenderThread::Stop()
+{
+    if (!m_thread.joinable())
+        return;
+
+    m_filled.Push(nullptr);
+    m_thread.join();
+}
+
+FrameTimings RenderThread::GetTimings() const
+{
+    FrameTimings timings;
+    timings.frames = m_rendered.load(std::memory_order_relaxed);
+    timings.skipped = m_skipped;
+    if (m_submitted > 1)
+    {
+        // Frame-to-frame time includes the wait, which is reported on its own
+        double frames = static_cast<double>(m_submitted - 1);
+        timings.waitMs = m_waitTotalMs / static_cast<double>(m_submitted);
+        timings.simulateMs = std::max(0.0, m_simulateTotalMs / frames - timings.waitMs);
+    }
+    if (timings.frames > 0)
+    {
+        double frames = static_cast<double>(timings.frames);
+        timings.renderMs = m_renderTotalMs.load(std::memory_order_relaxed) / frames;
+        timings.presentMs = m_presentTotalMs.load(std::memory_order_relaxed) / frames;
+        timings.idleMs = m_idleTotalMs.load(std::memory_order_relaxed) / frames;
+        timings.frameMs = timings.renderMs + timings.presentMs + timings.idleMs;
+    }
+    return timings;
+}
+
+void RenderThread::ThreadMain()
+{
+    if (m_window != nullptr)
+        glfwMakeContextCurrent(m_window);
+    PROFILE_CALL(Profiler::Get().SetThreadName("Render"));
+
+    for (;;)
+    {
+        auto idleStart = Clock::now();
+        RenderSnapshot* snapshot = nullptr;
+        m_filled.Pop(snapshot);
+        if (snapshot == nullptr)
+            break;
+
+        auto renderStart = Clock::now();
+        GlApi::BeginFrame();
+        {
+            PROFILE_SCOPE("RenderThread::Render");
+            m_render(*snapshot);
+            // Last references to removed models drop here, where their GL objects can be deleted
+            snapshot->released.clear();
+        }
+
+        auto presentStart = Clock::now();
+        if (m_window != nullptr)
+        {
+            PROFILE_SCOPE("RenderThread::SwapBuffers");
+            glfwSwapBuffers(m_window);
+        }
+        GlApi::EndFrame();
+        auto end = Clock::now();
+        PROFILE_CALL(Profiler::Get().ResolveGpuQueries());
+
+        Accumulate(m_idleTotalMs, ElapsedMs(idleStart, renderStart));
+        Accumulate(m_renderTotalMs, ElapsedMs(renderStart, presentStart));
+        Accumulate(m_presentTotalMs, ElapsedMs(presentStart, end));
+        m_rendered.fetch_add(1, std::memory_order_relaxed);
+
+        m_free.Push(snapshot);
+        if (m_presented != nullptr)
+        {
+            m_presented->fetch_add(1, std::memory_order_release);
+            m_presented->notify_all();
+        }
+    }
+
+    if (m_window != nullptr)
+    {
+        PROFILE_CALL(Profiler::Get().ReleaseGpuQueries());
+        glfwMakeContextCurrent(nullptr);
+    }
+}
+
+void RenderThread::test()
+{
+    std::cout << "[RenderThread] Running tests...\n";
+
+    // Test the queue on one thread
+    {
+        SpscQueue<int, 4> queue;
+        for (int i = 0; i < 4; ++i)
+        {
+            bool pushed = queue.TryPush(i);
+            assert(pushed && "TryPush should succeed until full");
+        }
+        bool pushed = queue.TryPush(4);
+        assert(!pushed && queue.GetSize() == 4 && "TryPush should fail when full");
+        int value = -1;
+        bool popped = queue.TryPop(value);
+        assert(popped && value == 0 && "TryPop should return the oldest element");
+        pushed = queue.TryPush(4);
+        assert(pushed && "Popping should free a slot");
+        for (int i = 1; i <= 4; ++i)
+        {
+            popped = queue.TryPop(value);
+            assert(popped && value == i && "Elements should come out in order");
+        }
+        popped = queue.TryPop(value);
+        assert(!popped && queue.GetSize() == 0 && "TryPop should fail when empty");
+    }
+
+    // Test the queue across threads
+    {
+        SpscQueue<int, 8> queue;
+        const int count = 100000;
+        std::thread producer([&queue, count]
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                queue.Push(i);
+            }
+        });
+        bool ordered = true;
+        for (int i = 0; i < count; ++i)
+        {
+            int value;
+            queue.Pop(value);
+            ordered = ordered && value == i;
+        }
+        producer.join();
+        assert(ordered && "Elements should cross threads in order");
+    }
+
+    // Test snapshots flowing through the render thread
+    {
+        std::vector<uint64_t> renderedFrames;
+        size_t maxDraws = 0;
+        std::weak_ptr<Model> released;
+        {
+            RenderThread renderThread(nullptr, [&](const RenderSnapshot& snapshot)
+            {
+                renderedFrames.push_back(snapshot.frame);
+                maxDraws = std::max(maxDraws, snapshot.draws.size());
+            });
+
+            const uint64_t frameCount = 64;
+            for (uint64_t frame = 0; frame < frameCount; ++frame)
+            {
+                RenderSnapshot& snapshot = renderThread.AcquireSnapshot();
+                snapshot.frame = frame;
+                snapshot.draws.assign(static_cast<size_t>(frame % 5), DrawItem{ nullptr, -1, glm::mat4(1.0f), glm::mat3(1.0f), 0, false });
+                if (frame == 10)
+                {
+                    // Only the snapshot keeps this model alive
+                    auto model = std::make_shared<Model>();
+                    released = model;
+                    snapshot.released.push_back(std::move(model));
+                }
+                renderThread.SubmitSnapshot();
+            }
+            renderThread.Stop();
+            assert(released.expired() && "Released models should be dropped once rendered");
+
+            FrameTimings timings = renderThread.GetTimings();
+            assert(timings.frames == frameCount && "Every submitted snapshot should be rendered");
+            assert(timings.renderMs >= 0.0 && timings.simulateMs >= 0.0 && timings.waitMs >= 0.0 && "Timings should be non-negative");
+        }
+
+        bool ordered = renderedFrames.size() == 64;
+        for (size_t i = 0; ordered && i < renderedFrames.size(); ++i)
+        {
+            ordered = renderedFrames[i] == i;
+        }
+        assert(ordered && "Snapshots should be rendered once each, in order");
+        assert(maxDraws == 4 && "Draws should reach the render thread");
+    }
+
+    // Test a slow render thread only skipping its own frames
+    {
+        std::atomic<uint64_t> presented{ 0 };
+        std::atomic<bool> unblocked{ false };
+        RenderThread slow(nullptr, [&unblocked](const RenderSnapshot&)
+        {
+            unblocked.wait(false);
+        }, &presented);
+        RenderThread fast(nullptr, [](const RenderSnapshot&) {}, &presented);
+
+        // Two frames in flight on the slow thread, the third is skipped instead of waited for
+        for (int i = 0; i < 2; ++i)
+        {
+            RenderSnapshot* snapshot = slow.TryAcquireSnapshot();
+            assert(snapshot != nullptr && "A free snapshot should be handed out");
+            slow.SubmitSnapshot();
+        }
+        RenderSnapshot* skipped = slow.TryAcquireSnapshot();
+        assert(skipped == nullptr && "No snapshot should be free while both are in flight");
+
+        // The other thread keeps presenting, and wakes waiters on the shared counter
+        const uint64_t fastFrames = 16;
+        for (uint64_t i = 0; i < fastFrames; ++i)
+        {
+            fast.AcquireSnapshot();
+            fast.SubmitSnapshot();
+        }
+        for (uint64_t seen = presented.load(); seen < fastFrames; seen = presented.load())
+            presented.wait(seen);
+        assert(slow.GetTimings().frames == 0 && "The slow thread should still be blocked");
+
+        unblocked = true;
+        unblocked.notify_all();
+        slow.Stop();
+        fast.Stop();
+        FrameTimings timings = slow.GetTimings();
+        assert(timings.frames == 2 && timings.skipped == 1 && "The skipped frame should be counted");
+        assert(presented.load() == fastFrames + 2 && "Every frame should be counted once");
+    }
+
+    std::cout << "[RenderThread] Tests passed!\n";
+}
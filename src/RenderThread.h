@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include "RenderSnapshot.h"
+#include "SpscQueue.h"
+
+struct GLFWwindow;
+
+/**
+ * \struct FrameTimings
+ * \brief Average per-frame timings of the simulation and render threads.
+ */
+struct FrameTimings
+{
+    uint64_t frames = 0;            ///< Frames rendered
+    uint64_t skipped = 0;           ///< Frames not handed over because the render thread was behind
+    double simulateMs = 0.0;        ///< Simulation thread: input, update and snapshot building
+    double waitMs = 0.0;            ///< Simulation thread: blocked on a free snapshot (render thread behind)
+    double renderMs = 0.0;          ///< Render thread: GL submission
+    double presentMs = 0.0;         ///< Render thread: buffer swap
+    double idleMs = 0.0;            ///< Render thread: blocked on a snapshot (simulation behind)
+    double frameMs = 0.0;           ///< Render thread: time from one frame to the next
+};
+
+/**
+ * \class RenderThread
+ * \brief A thread that owns a window's GL context and renders snapshots handed to it.
+ *
+ * Two snapshots circulate between the threads through a pair of lock-free queues: the
+ * simulation thread fills one while the render thread draws the other, so simulating
+ * frame N + 1 overlaps with rendering frame N. When both are in flight the simulation
+ * thread waits, which bounds latency to one frame.
+ *
+ * The context must not be current on any other thread while the render thread runs.
+ * GL objects created beforehand (meshes, textures, shaders) are shared by the context;
+ * models removed from the scene meanwhile are released on the render thread through
+ * RenderSnapshot::released.
+ *
+ * A simulation thread feeding several render threads uses TryAcquireSnapshot() so that a
+ * slow window only skips frames instead of stalling the others, and sleeps on a counter
+ * the render threads share when every one of them is behind.
+ */
+class RenderThread
+{
+public:
+    /// Renders one snapshot with the GL context current.
+    using RenderFunction = std::function<void(const RenderSnapshot& snapshot)>;
+
+    /**
+     * \brief Constructor. Starts the thread.
+     * \param window Window whose context the thread makes current and whose buffers it swaps. May be nullptr.
+     * \param render Function called for each snapshot.
+     * \param presented Counter incremented and notified after each frame, or nullptr. Must
+     *                  outlive the thread.
+     */
+    RenderThread(GLFWwindow* window, RenderFunction render, std::atomic<uint64_t>* presented = nullptr);
+
+    /**
+     * \brief Destructor. Stops the thread.
+     */
+    ~RenderThread();
+
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    /**
+     * \brief Get a snapshot to fill, waiting while both are in flight. Simulation thread only.
+     * \return The snapshot, owned by the caller until SubmitSnapshot().
+     */
+    RenderSnapshot& AcquireSnapshot();
+
+    /**
+     * \brief Get a snapshot to fill without waiting. Simulation thread only.
+     * \return The snapshot, owned by the caller until SubmitSnapshot(); nullptr if both
+     *         are in flight, which counts as a skipped frame.
+     */
+    RenderSnapshot* TryAcquireSnapshot();
+
+    /**
+     * \brief Hand the acquired snapshot to the render thread. Simulation thread only.
+     */
+    void SubmitSnapshot();
+
+    /**
+     * \brief Render the queued snapshots, then stop the thread and release the context.
+     */
+    void Stop();
+
+    /**
+     * \brief Get the average frame timings so far.
+     * \return Timings; render-thread values are exact after Stop().
+     */
+    FrameTimings GetTimings() const;
+
+    /**
+     * \brief Run unit tests for the RenderThread class.
+     */
+    static void test();
+
+private:
+    /**
+     * \brief Render thread entry point.
+     */
+    void ThreadMain();
+
+    GLFWwindow* m_window;                       ///< Window owning the context, may be nullptr
+    RenderFunction m_render;                    ///< Called for each snapshot
+    std::atomic<uint64_t>* m_presented;         ///< Shared frame counter, may be nullptr
+    RenderSnapshot m_snapshots[2];              ///< Double buffer
+    SpscQueue<RenderSnapshot*, 2> m_free;       ///< Render -> simulation: snapshots to fill
+    SpscQueue<RenderSnapshot*, 2> m_filled;     ///< Simulation -> render: snapshots to draw, nullptr stops
+    RenderSnapshot* m_acquired = nullptr;       ///< Snapshot being filled
+    std::thread m_thread;                       ///< The render thread
+
+    // Simulation thread totals
+    double m_simulateTotalMs = 0.0;             ///< Time between consecutive submits
+    double m_waitTotalMs = 0.0;                 ///< Time spent in AcquireSnapshot()
+    std::chrono::steady_clock::time_point m_lastSubmit; ///< Time of the previous SubmitSnapshot()
+    uint64_t m_submitted = 0;                   ///< Snapshots submitted
+    uint64_t m_skipped = 0;                     ///< TryAcquireSnapshot() calls that found none free
+
+    // Render thread totals
+    std::atomic<double> m_renderTotalMs{ 0.0 };     ///< Time in the render function
+    std::atomic<double> m_presentTotalMs{ 0.0 };    ///< Time swapping buffers
+    std::atomic<double> m_idleTotalMs{ 0.0 };       ///< Time waiting for snapshots
+    std::atomic<uint64_t> m_rendered{ 0 };          ///< Snapshots rendered
+};
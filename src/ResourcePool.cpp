@@ -0,0 +1,83 @@
+#include "ResourcePool.h"
+#include "Shader.h"
+#include "ShaderPermutations.h"
+#include "Model.h"
+#include "GlApi.h"
+#include "Profiler.h"
+#include <iostream>
+#include <cassert>
+
+std::shared_ptr<ShaderPermutations> ResourcePool::GetShaderPermutations(const std::string& vertexPath, const std::string& fragmentPath,
+                                                                        const std::vector<std::string>& features)
+{
+    std::string key = vertexPath + '\n' + fragmentPath;
+    for (const std::string& feature : features)
+        key += '\n' + feature;
+
+    std::shared_ptr<ShaderPermutations>& permutations = m_permutations[key];
+    if (!permutations)
+        permutations = std::make_shared<ShaderPermutations>(vertexPath, fragmentPath, features);
+    return permutations;
+}
+
+std::shared_ptr<Shader> ResourcePool::GetShader(const std::string& vertexPath, const std::string& fragmentPath)
+{
+    std::shared_ptr<Shader>& shader = m_shaders[vertexPath + '\n' + fragmentPath];
+    if (!shader)
+        shader = std::make_shared<Shader>(vertexPath, fragmentPath);
+    return shader;
+}
+
+std::shared_ptr<Model> ResourcePool::LoadModel(const std::string& path)
+{
+    PROFILE_SCOPE("ResourcePool::LoadModel");
+
+    auto it = m_models.find(path);
+    if (it != m_models.end())
+        return it->second;
+
+    auto model = std::make_shared<Model>();
+    if (!model->LoadFromFile(path))
+        return nullptr;
+    m_models.emplace(path, model);
+    return model;
+}
+
+void ResourcePool::test()
+{
+    std::cout << "[ResourcePool] Running tests...\n";
+
+    bool glTestMode = GlApi::IsTestMode();
+    bool modelTestMode = Model::IsTestMode();
+    GlApi::SetTestMode(true);
+    Model::SetTestMode(true);
+
+    ResourcePool pool;
+
+    // Shaders are compiled once per source pair
+    auto depth = pool.GetShader("shaders/depth.vert", "shaders/depth.frag");
+    auto sameDepth = pool.GetShader("shaders/depth.vert", "shaders/depth.frag");
+    auto basicShader = pool.GetShader("shaders/basic.vert", "shaders/basic.frag");
+    assert(depth && sameDepth == depth && "Same sources should share a shader");
+    assert(basicShader != depth && "Different sources should not");
+
+    // Permutation sets are keyed by their features too
+    auto basic = pool.GetShaderPermutations("shaders/basic.vert", "shaders/basic.frag", { "ALPHA_TEST" });
+    auto sameBasic = pool.GetShaderPermutations("shaders/basic.vert", "shaders/basic.frag", { "ALPHA_TEST" });
+    auto featureless = pool.GetShaderPermutations("shaders/basic.vert", "shaders/basic.frag", {});
+    assert(sameBasic == basic && "Same sources and features should share permutations");
+    assert(featureless != basic && "Different features should not");
+    assert(pool.GetShaderCount() == 4 && "Wrong shader count");
+
+    // Models are loaded once per path
+    auto model = pool.LoadModel("test.obj");
+    auto sameModel = pool.LoadModel("test.obj");
+    assert(model && sameModel == model && pool.GetModelCount() == 1 && "Same path should share a model");
+    auto other = pool.LoadModel("other.obj");
+    assert(other != model && pool.GetModelCount() == 2 && "Different paths should not");
+
+    Model::SetTestMode(modelTestMode);
+    GlApi::SetTestMode(glTestMode);
+
+    std::cout << "[ResourcePool] Tests passed!\n";
+}
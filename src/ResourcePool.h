@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+class Shader;
+class ShaderPermutations;
+class Model;
+
+/**
+ * \class ResourcePool
+ * \brief Shaders and models loaded once and shared by every scene of a GL share group.
+ *
+ * Programs, buffers and textures are visible to every context sharing objects with the
+ * one they were created in, so windows created with a shared context draw from one pool
+ * instead of loading their own copies. Only vertex arrays, framebuffers and the other
+ * container objects stay per context; see VertexArrayCache.
+ *
+ * Resources are created in the context current when they are first requested and are
+ * deleted with the pool, so that context (or another of its share group) must be current
+ * when the last reference goes away. Not thread-safe: request resources from the thread
+ * that loads.
+ */
+class ResourcePool
+{
+public:
+    /**
+     * \brief Get a shader pair with its preprocessor variants, compiling it on first request.
+     * \param vertexPath Path to vertex shader file.
+     * \param fragmentPath Path to fragment shader file.
+     * \param features Define names of the variants, as ShaderPermutations takes them.
+     * \return The shared permutations.
+     */
+    std::shared_ptr<ShaderPermutations> GetShaderPermutations(const std::string& vertexPath, const std::string& fragmentPath,
+                                                              const std::vector<std::string>& features);
+
+    /**
+     * \brief Get a shader, compiling it on first request.
+     * \param vertexPath Path to vertex shader file.
+     * \param fragmentPath Path to fragment shader file.
+     * \return The shared shader.
+     */
+    std::shared_ptr<Shader> GetShader(const std::string& vertexPath, const std::string& fragmentPath);
+
+    /**
+     * \brief Get a model, loading it on first request.
+     *
+     * A model that fails to load is not remembered, so a later request tries again.
+     *
+     * \param path Model file.
+     * \return The shared model; nullptr if loading failed.
+     */
+    std::shared_ptr<Model> LoadModel(const std::string& path);
+
+    /**
+     * \brief Get the number of shaders and shader permutation sets loaded.
+     * \return Loaded shaders.
+     */
+    size_t GetShaderCount() const { return m_shaders.size() + m_permutations.size(); }
+
+    /**
+     * \brief Get the number of models loaded.
+     * \return Loaded models.
+     */
+    size_t GetModelCount() const { return m_models.size(); }
+
+    /**
+     * \brief Run unit tests for the ResourcePool class.
+     */
+    static void test();
+
+private:
+    std::unordered_map<std::string, std::shared_ptr<ShaderPermutations>> m_permutations;   ///< By source paths and features
+    std::unordered_map<std::string, std::shared_ptr<Shader>> m_shaders;     ///< By source paths
+    std::unordered_map<std::string, std::shared_ptr<Model>> m_models;       ///< By file path
+};
@@ -1,24 +1,95 @@
 #include "Scene.h"
+#include "ThreadPool.h"
+#include "GlApi.h"
+#include "Profiler.h"
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <cstring>
+#include <thread>
 #include <GLFW/glfw3.h>
 #include <glm/gtc/matrix_transform.hpp>
 
 // Initialize static members
 bool Scene::s_testMode = false;
 
-Scene::Scene()
+namespace {
+
+// Moved objects per batch when bounds are recomputed on the thread pool
+constexpr size_t TRANSFORM_BATCH_SIZE = 2048;
+
+// Visible objects per batch when draw packets are prepared on the thread pool
+constexpr size_t PREPARE_BATCH_SIZE = 1024;
+
+// Uniform block binding of the per-object constants in basic.vert
+constexpr GLuint OBJECT_CONSTANTS_BINDING = 0;
+
+// Uniform block binding of the per-frame constants in the basic and depth shaders
+constexpr GLuint FRAME_CONSTANTS_BINDING = 2;
+
+// Preprocessor features of the basic shaders, by feature bit
+const std::vector<std::string> SHADER_FEATURES = { "ALPHA_TEST" };
+
+// Per-object constants in std140 layout, as the ObjectConstants block declares them
+struct ObjectConstants
+{
+    glm::mat4 model;
+    glm::vec4 normalMatrix[3];  // mat3 columns, each padded to a vec4
+};
+
+// Per-frame constants in std140 layout, as the FrameConstants block declares them
+struct FrameConstants
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 viewPos;
+    int32_t lightCount;
+    glm::vec3 lightPos;
+    float clusterDepthScale;
+    glm::vec3 lightColor;
+    float clusterDepthBias;
+};
+static_assert(sizeof(FrameConstants) == 176, "FrameConstants must match the std140 block");
+
+// One struct per object, as objects were stored before the split into arrays; only
+// used by benchmark() as the baseline layout
+struct LegacyObject
+{
+    std::shared_ptr<Model> model;
+    glm::vec3 position;
+    glm::vec3 scale;
+    glm::vec3 rotation;
+    glm::quat orientation;
+    glm::mat4 world;
+    BoundingBox bounds;
+    glm::vec4 sphere;
+};
+
+} // namespace
+
+Scene::Scene(std::shared_ptr<ResourcePool> resources)
     : m_camera(std::make_unique<Camera>())
-    , m_shader(std::make_unique<Shader>("shaders/basic.vert", "shaders/basic.frag"))
+    , m_resources(resources ? resources : std::make_shared<ResourcePool>())
+    , m_shaders(m_resources->GetShaderPermutations("shaders/basic.vert", "shaders/basic.frag", SHADER_FEATURES))
+    , m_depthShader(m_resources->GetShader("shaders/depth.vert", "shaders/depth.frag"))
     , m_firstMouse(true)
     , m_lastX(0.0)
     , m_lastY(0.0)
+    , m_keysDown{}
+    , m_previousCameraPosition(m_camera->GetPosition())
+    , m_interpolationAlpha(1.0f)
+    , m_dirty(true)
+    , m_continuousRequests(0)
+    , m_projection(glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f))
+    , m_frustumCulling(true)
+    , m_cullingMethod(BVH_CULLING)
+    , m_occlusionCulling(true)
+    , m_depthPrePass(false)
+    , m_frameCount(0)
 {
-    if (!s_testMode)
-    {
-        m_shader->Use();
-        m_shader->SetMat4("projection", glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f));
-    }
 }
 
 Scene::~Scene()
@@ -27,10 +98,36 @@ Scene::~Scene()
 
 void Scene::Update(float deltaTime)
 {
-    if (s_testMode)
-        return;
+    m_previousCameraPosition = m_camera->GetPosition();
+
+    // Move at the camera's speed for as long as a key is held
+    if (m_keysDown[GLFW_KEY_W])
+        m_camera->ProcessKeyboard(Camera::FORWARD, deltaTime);
+    if (m_keysDown[GLFW_KEY_S])
+        m_camera->ProcessKeyboard(Camera::BACKWARD, deltaTime);
+    if (m_keysDown[GLFW_KEY_A])
+        m_camera->ProcessKeyboard(Camera::LEFT, deltaTime);
+    if (m_keysDown[GLFW_KEY_D])
+        m_camera->ProcessKeyboard(Camera::RIGHT, deltaTime);
+}
 
-    // Update any scene logic here
+bool Scene::NeedsRedraw() const
+{
+    if (m_dirty || m_camera->IsDirty() || m_continuousRequests > 0)
+        return true;
+
+    // Held keys move the camera on every step
+    if (m_keysDown[GLFW_KEY_W] || m_keysDown[GLFW_KEY_S] || m_keysDown[GLFW_KEY_A] || m_keysDown[GLFW_KEY_D])
+        return true;
+
+    // The last frame was interpolated short of the latest step
+    return m_previousCameraPosition != m_camera->GetPosition();
+}
+
+void Scene::EndContinuousRendering()
+{
+    assert(m_continuousRequests > 0 && "EndContinuousRendering without BeginContinuousRendering");
+    --m_continuousRequests;
 }
 
 void Scene::Render()
@@ -38,66 +135,826 @@ void Scene::Render()
     if (s_testMode)
         return;
 
-    // Clear buffers
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    PROFILE_SCOPE("Scene::Render");
+
+    BuildSnapshot(m_snapshot);
+    Submit(m_snapshot);
+    m_snapshot.released.clear();
+}
+
+void Scene::BuildSnapshot(RenderSnapshot& snapshot)
+{
+    PROFILE_SCOPE("Scene::BuildSnapshot");
+    using Clock = std::chrono::high_resolution_clock;
+    auto start = Clock::now();
 
-    // Use shader and set common uniforms
-    m_shader->Use();
-    m_shader->SetMat4("view", m_camera->GetViewMatrix());
+    // The snapshot reflects every edit made so far; a MarkDirty() from another thread
+    // from here on asks for the next frame
+    m_dirty = false;
 
-    // Render each object
-    for (const auto& obj : m_objects)
+    // Place the camera between the last two simulation steps
+    glm::vec3 cameraPosition = glm::mix(m_previousCameraPosition, m_camera->GetPosition(), m_interpolationAlpha);
+    glm::mat4 view = glm::lookAt(cameraPosition, cameraPosition + m_camera->GetFront(), m_camera->GetUp());
+
+    // Drop everything outside the view frustum
+    Cull(m_projection * view);
+
+    snapshot.frame = m_frameCount++;
+    snapshot.view = view;
+    snapshot.projection = m_projection;
+    snapshot.cameraPosition = cameraPosition;
+    snapshot.frustumCulling = m_frustumCulling;
+    snapshot.frustum = m_frustum;
+    snapshot.depthPrePass = m_depthPrePass;
+
+    // Bin the lights into the clusters of this view
+    m_lightClusters.Build(m_lights, view, m_projection, snapshot.lightGrid, &ThreadPool::Get());
+
+    // Prepare draw packets in parallel, each thread into its own sorted buffer
+    ThreadPool& pool = ThreadPool::Get();
+    m_drawPackets.resize(pool.GetThreadCount());
+    for (auto& packets : m_drawPackets)
     {
-        // Calculate model matrix
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, obj.position);
-        model = glm::scale(model, obj.scale);
-        model = glm::rotate(model, glm::radians(obj.rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(obj.rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(obj.rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+        packets.clear();
+    }
+    pool.ParallelFor(m_visibleList.size(), PREPARE_BATCH_SIZE, [this, &cameraPosition](size_t begin, size_t end, size_t worker)
+    {
+        PrepareDraws(m_visibleList.data() + begin, end - begin, cameraPosition, m_drawPackets[worker]);
+    });
+    pool.ParallelFor(m_drawPackets.size(), 1, [this](size_t begin, size_t end, size_t)
+    {
+        for (size_t t = begin; t < end; ++t)
+        {
+            std::sort(m_drawPackets[t].begin(), m_drawPackets[t].end(),
+                      [](const DrawItem& a, const DrawItem& b) { return a.sortKey < b.sortKey; });
+        }
+    });
 
-        m_shader->SetMat4("model", model);
-        obj.model->Draw();
+    // Merge the sorted buffers; there is one per thread, so a linear scan of the heads is enough
+    snapshot.draws.clear();
+    m_packetHeads.assign(m_drawPackets.size(), 0);
+    for (;;)
+    {
+        size_t best = m_drawPackets.size();
+        for (size_t t = 0; t < m_drawPackets.size(); ++t)
+        {
+            if (m_packetHeads[t] < m_drawPackets[t].size() &&
+                (best == m_drawPackets.size() || m_drawPackets[t][m_packetHeads[t]].sortKey < m_drawPackets[best][m_packetHeads[best]].sortKey))
+                best = t;
+        }
+        if (best == m_drawPackets.size())
+            break;
+        snapshot.draws.push_back(m_drawPackets[best][m_packetHeads[best]++]);
+    }
+
+    // Removed models are released by whoever renders this snapshot
+    for (auto& model : m_releasedModels)
+    {
+        snapshot.released.push_back(std::move(model));
     }
+    m_releasedModels.clear();
+
+    m_camera->ClearDirty();
+
+    snapshot.buildTimeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
 }
 
-void Scene::AddModel(std::shared_ptr<Model> model, const glm::vec3& position, const glm::vec3& scale, const glm::vec3& rotation)
+void Scene::PrepareDraws(const uint32_t* indices, size_t count, const glm::vec3& cameraPosition, std::vector<DrawItem>& draws) const
 {
-    SceneObject obj;
-    obj.model = model;
-    obj.position = position;
-    obj.scale = scale;
-    obj.rotation = rotation;
-    m_objects.push_back(obj);
+    for (size_t n = 0; n < count; ++n)
+    {
+        uint32_t i = indices[n];
+        const Model* model = m_models[i].get();
+        if (model == nullptr)
+            continue;
+        bool prePassed = m_prePassed[i] && model->SupportsDepthPrePass();
+
+        if (!m_modelNodes[i].empty())
+        {
+            // Imported hierarchy: each node draws its meshes with its own world matrix
+            const auto& nodes = model->GetNodes();
+            for (size_t k = 0; k < nodes.size(); ++k)
+            {
+                if (nodes[k].meshes.empty())
+                    continue;
+                const glm::mat4& world = m_hierarchy.GetWorldMatrix(m_modelNodes[i][k]);
+                draws.push_back({ model, static_cast<int>(k), world, ComputeNormalMatrix(world), ComputeSortKey(model, world, cameraPosition), prePassed });
+            }
+            continue;
+        }
+
+        // The object's own scale only describes the world matrix of root objects
+        const glm::mat4& world = m_worldMatrices[i];
+        bool root = GetParent(i) == NO_PARENT;
+        draws.push_back({ model, -1, world, root ? ComputeNormalMatrix(world, m_scales[i]) : ComputeNormalMatrix(world),
+                          ComputeSortKey(model, world, cameraPosition), prePassed });
+    }
 }
 
-void Scene::OnKeyInput(int key, int scancode, int action, int mods)
+uint64_t Scene::ComputeSortKey(const Model* model, const glm::mat4& world, const glm::vec3& cameraPosition)
+{
+    // Consecutive draws of the same model share buffers and textures
+    uint64_t modelBits = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(model) >> 4);
+
+    // Non-negative floats order like their bit patterns; nearer draws first reject more fragments
+    glm::vec3 offset = glm::vec3(world[3]) - cameraPosition;
+    float distanceSquared = glm::dot(offset, offset);
+    uint32_t depthBits;
+    std::memcpy(&depthBits, &distanceSquared, sizeof(depthBits));
+
+    return (modelBits << 32) | depthBits;
+}
+
+void Scene::Submit(const RenderSnapshot& snapshot)
 {
     if (s_testMode)
         return;
 
-    if (key >= 0 && key < 1024)
+    PROFILE_SCOPE("Scene::Submit");
+    PROFILE_GPU_SCOPE("Scene::Submit");
+
+    if (snapshot.viewportWidth > 0 && snapshot.viewportHeight > 0)
+        GlApi::Viewport(0, 0, snapshot.viewportWidth, snapshot.viewportHeight);
+
+    // Clear buffers
+    GlApi::ClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    GlApi::Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Draw with this context's vertex arrays, dropping those of destroyed meshes
+    VertexArrayCache::Scope vertexArrays(&m_vertexArrays);
+    m_vertexArrays.DeleteReleased();
+
+    // Pick up shader variants the driver finished since the last frame
+    m_shaders->Poll();
+
+    // Stream the per-object constants, one aligned slice of the current region per draw;
+    // both passes of a pre-passed draw read the same slice. The frame's camera and
+    // lighting constants go first.
+    if (!m_objectConstants)
+        m_objectConstants = std::make_unique<StreamBuffer>(GL_UNIFORM_BUFFER, 0);
+    m_objectConstants->Reserve(m_objectConstants->GetAlignedSize(sizeof(ObjectConstants)) * snapshot.draws.size() +
+                               m_objectConstants->GetAlignedSize(sizeof(FrameConstants)));
+    m_objectConstants->BeginFrame();
+
+    // Camera, a white headlight at the camera, and the dynamic lights looked up per
+    // fragment through its cluster
+    const LightGrid& lightGrid = snapshot.lightGrid;
     {
-        if (action == GLFW_PRESS)
+        FrameConstants constants;
+        constants.view = snapshot.view;
+        constants.projection = snapshot.projection;
+        constants.viewPos = snapshot.cameraPosition;
+        constants.lightCount = static_cast<int32_t>(lightGrid.lights.size());
+        constants.lightPos = snapshot.cameraPosition;
+        constants.clusterDepthScale = lightGrid.depthScale;
+        constants.lightColor = glm::vec3(1.0f);
+        constants.clusterDepthBias = lightGrid.depthBias;
+        StreamAllocation slice = m_objectConstants->Allocate(sizeof(FrameConstants));
+        std::memcpy(slice.pointer, &constants, sizeof(FrameConstants));
+        m_objectConstants->Commit(slice);
+        GlApi::BindBufferRange(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, m_objectConstants->GetBuffer(), slice.offset, slice.size);
+    }
+    if (!lightGrid.lights.empty())
+        UploadLightGrid(lightGrid);
+
+    m_drawConstants.resize(snapshot.draws.size());
+    bool prePass = false;
+    for (size_t n = 0; n < snapshot.draws.size(); ++n)
+    {
+        const DrawItem& draw = snapshot.draws[n];
+        ObjectConstants constants;
+        constants.model = draw.world;
+        for (int i = 0; i < 3; ++i)
+            constants.normalMatrix[i] = glm::vec4(draw.normalMatrix[i], 0.0f);
+        StreamAllocation slice = m_objectConstants->Allocate(sizeof(ObjectConstants));
+        std::memcpy(slice.pointer, &constants, sizeof(ObjectConstants));
+        m_objectConstants->Commit(slice);
+        m_drawConstants[n] = slice;
+        prePass = prePass || (snapshot.depthPrePass && draw.depthPrePass);
+    }
+
+    const Frustum* frustum = snapshot.frustumCulling ? &snapshot.frustum : nullptr;
+
+    // Lay down the depth of the pre-passed draws without shading them
+    if (prePass)
+    {
+        PROFILE_SCOPE("Scene::DepthPrePass");
+        m_depthShader->Use();
+        GlApi::ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        for (size_t n = 0; n < snapshot.draws.size(); ++n)
+        {
+            if (snapshot.draws[n].depthPrePass)
+                SubmitDraw(snapshot.draws[n], m_drawConstants[n], frustum, DEPTH_PASS);
+        }
+        GlApi::ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    // Shade with the scene shader, each mesh with the variant its material needs
+    ShaderPermutations::Scope shaders(m_shaders.get());
+
+    // Render the draws outside the pre-pass as usual
+    for (size_t n = 0; n < snapshot.draws.size(); ++n)
+    {
+        if (!prePass || !snapshot.draws[n].depthPrePass)
+            SubmitDraw(snapshot.draws[n], m_drawConstants[n], frustum, COLOR_PASS);
+    }
+
+    // Shade only the nearest fragment of each pre-passed pixel; the depth is already final
+    if (prePass)
+    {
+        PROFILE_SCOPE("Scene::ShadePrePassed");
+        GlApi::DepthFunc(GL_EQUAL);
+        GlApi::DepthMask(GL_FALSE);
+        for (size_t n = 0; n < snapshot.draws.size(); ++n)
+        {
+            if (snapshot.draws[n].depthPrePass)
+                SubmitDraw(snapshot.draws[n], m_drawConstants[n], frustum, COLOR_PASS);
+        }
+        GlApi::DepthMask(GL_TRUE);
+        GlApi::DepthFunc(GL_LESS);
+    }
+    m_objectConstants->EndFrame();
+}
+
+void Scene::UploadLightGrid(const LightGrid& grid)
+{
+    PROFILE_SCOPE("Scene::UploadLightGrid");
+
+    if (!m_lightData)
+        m_lightData = std::make_unique<StreamBuffer>(GL_SHADER_STORAGE_BUFFER, 0);
+    size_t indicesSize = std::max(grid.indices.size(), size_t(1)) * sizeof(uint32_t);
+    m_lightData->Reserve(m_lightData->GetAlignedSize(grid.lights.size() * sizeof(PackedLight)) +
+                         m_lightData->GetAlignedSize(grid.cells.size() * sizeof(glm::uvec2)) + m_lightData->GetAlignedSize(indicesSize));
+    m_lightData->BeginFrame();
+
+    // Empty ranges cannot be bound; when no cluster holds a light the index list gets a dummy entry
+    auto stream = [this](GLuint binding, const void* data, size_t size)
+    {
+        StreamAllocation slice = m_lightData->Allocate(std::max(size, sizeof(uint32_t)));
+        if (size > 0)
+            std::memcpy(slice.pointer, data, size);
+        m_lightData->Commit(slice);
+        GlApi::BindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, m_lightData->GetBuffer(), slice.offset, slice.size);
+    };
+    stream(LightClusters::LIGHTS_BINDING, grid.lights.data(), grid.lights.size() * sizeof(PackedLight));
+    stream(LightClusters::CELLS_BINDING, grid.cells.data(), grid.cells.size() * sizeof(glm::uvec2));
+    stream(LightClusters::INDICES_BINDING, grid.indices.data(), grid.indices.size() * sizeof(uint32_t));
+    m_lightData->EndFrame();
+}
+
+void Scene::SubmitDraw(const DrawItem& draw, const StreamAllocation& constants, const Frustum* frustum, DrawPass pass) const
+{
+    GlApi::BindBufferRange(GL_UNIFORM_BUFFER, OBJECT_CONSTANTS_BINDING, m_objectConstants->GetBuffer(), constants.offset, constants.size);
+
+    if (draw.node >= 0)
+        draw.model->DrawNode(static_cast<size_t>(draw.node), frustum, draw.world, pass);
+    else if (frustum)
+        draw.model->Draw(*frustum, draw.world, pass);
+    else
+        draw.model->Draw(pass);
+}
+
+void Scene::Cull(const glm::mat4& viewProjection)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    auto start = Clock::now();
+
+    m_cullStats = CullStats();
+    UpdateTransforms();
+    m_cullStats.transformed = m_updatedObjects.size();
+    m_cullStats.transformTimeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    const size_t count = m_models.size();
+    m_visible.assign(count, 0);
+    m_visibleList.clear();
+
+    if (!m_frustumCulling)
+    {
+        m_frustum = Frustum();
+        std::fill(m_visible.begin(), m_visible.end(), uint8_t(1));
+        for (size_t i = 0; i < count; ++i)
+            m_visibleList.push_back(static_cast<uint32_t>(i));
+    }
+    else if (m_cullingMethod == LINEAR_CULLING)
+    {
+        m_frustum.Update(viewProjection);
+        m_frustum.CullSpheres(m_boundsX.data(), m_boundsY.data(), m_boundsZ.data(), m_boundsRadius.data(),
+                              count, m_visible.data(), &ThreadPool::Get());
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (m_visible[i])
+                m_visibleList.push_back(static_cast<uint32_t>(i));
+        }
+        m_cullStats.tested = count;
+    }
+    else
+    {
+        m_frustum.Update(viewProjection);
+
+        // The hierarchy reports candidates by their fat boxes; confirm with the exact sphere
+        m_bvh.QueryFrustum(m_frustum, [this](uint32_t i)
         {
-            switch (key)
+            ++m_cullStats.tested;
+            if (m_frustum.TestSphere(glm::vec3(m_boundsX[i], m_boundsY[i], m_boundsZ[i]), m_boundsRadius[i]))
             {
-            case GLFW_KEY_W:
-                m_camera->ProcessKeyboard(Camera::FORWARD, 0.1f);
-                break;
-            case GLFW_KEY_S:
-                m_camera->ProcessKeyboard(Camera::BACKWARD, 0.1f);
-                break;
-            case GLFW_KEY_A:
-                m_camera->ProcessKeyboard(Camera::LEFT, 0.1f);
-                break;
-            case GLFW_KEY_D:
-                m_camera->ProcessKeyboard(Camera::RIGHT, 0.1f);
-                break;
+                m_visible[i] = 1;
+                m_visibleList.push_back(i);
             }
+            return true;
+        });
+
+        m_cullStats.tested += m_unboundedObjects.size();
+        for (uint32_t i : m_unboundedObjects)
+        {
+            m_visible[i] = 1;
+            m_visibleList.push_back(i);
         }
     }
+    m_cullStats.culled = count - m_visibleList.size();
+
+    if (m_occlusionCulling)
+    {
+        auto occlusionStart = Clock::now();
+        CullOccluded(viewProjection);
+        m_cullStats.occlusionTimeMs = std::chrono::duration<double, std::milli>(Clock::now() - occlusionStart).count();
+    }
+
+    m_cullStats.drawn = m_visibleList.size();
+    m_cullStats.cullTimeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void Scene::CullOccluded(const glm::mat4& viewProjection)
+{
+    m_occlusionCuller.BeginFrame(viewProjection);
+    m_occludees.clear();
+
+    for (uint32_t i : m_visibleList)
+    {
+        if (!m_occluders[i] || !m_models[i])
+        {
+            m_occludees.push_back(i);
+            continue;
+        }
+
+        ++m_cullStats.occluders;
+        const Model& model = *m_models[i];
+        if (!model.GetOccluderIndices().empty())
+        {
+            const auto& positions = model.GetOccluderPositions();
+            const auto& indices = model.GetOccluderIndices();
+            m_occlusionCuller.AddOccluder(positions.data(), sizeof(glm::vec3), positions.size(),
+                                          indices.data(), indices.size(), m_worldMatrices[i]);
+            continue;
+        }
+
+        const auto& meshes = model.GetMeshes();
+        if (m_modelNodes[i].empty())
+        {
+            for (const Mesh& mesh : meshes)
+            {
+                if (mesh.vertices.empty())
+                    continue;
+                m_occlusionCuller.AddOccluder(&mesh.vertices.data()->position, sizeof(Vertex), mesh.vertices.size(),
+                                              mesh.indices.data(), mesh.indices.size(), m_worldMatrices[i]);
+            }
+            continue;
+        }
+
+        const auto& nodes = model.GetNodes();
+        for (size_t k = 0; k < nodes.size(); ++k)
+        {
+            for (unsigned int meshIndex : nodes[k].meshes)
+            {
+                const Mesh& mesh = meshes[meshIndex];
+                if (mesh.vertices.empty())
+                    continue;
+                m_occlusionCuller.AddOccluder(&mesh.vertices.data()->position, sizeof(Vertex), mesh.vertices.size(),
+                                              mesh.indices.data(), mesh.indices.size(),
+                                              m_hierarchy.GetWorldMatrix(m_modelNodes[i][k]));
+            }
+        }
+    }
+
+    // Nothing to hide behind this frame
+    if (m_cullStats.occluders == 0)
+        return;
+
+    ThreadPool& pool = ThreadPool::Get();
+    m_occlusionCuller.Rasterize(&pool);
+    m_cullStats.occluded = m_occlusionCuller.CullOccluded(m_worldBounds.data(), m_occludees.data(), m_occludees.size(),
+                                                          m_visible.data(), &pool);
+    if (m_cullStats.occluded > 0)
+    {
+        m_visibleList.erase(std::remove_if(m_visibleList.begin(), m_visibleList.end(),
+                                           [this](uint32_t i) { return m_visible[i] == 0; }),
+                            m_visibleList.end());
+    }
+}
+
+glm::mat4 Scene::BuildModelMatrix(const glm::vec3& position, const glm::vec3& scale, const glm::vec3& rotation)
+{
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, position);
+    model = glm::scale(model, scale);
+    model = glm::rotate(model, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::rotate(model, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+    return model;
+}
+
+glm::quat Scene::EulerToQuaternion(const glm::vec3& degrees)
+{
+    glm::vec3 radians = glm::radians(degrees);
+    return glm::angleAxis(radians.x, glm::vec3(1.0f, 0.0f, 0.0f)) *
+           glm::angleAxis(radians.y, glm::vec3(0.0f, 1.0f, 0.0f)) *
+           glm::angleAxis(radians.z, glm::vec3(0.0f, 0.0f, 1.0f));
+}
+
+size_t Scene::AddLight(const Light& light)
+{
+    m_lights.push_back(light);
+    m_dirty = true;
+    return m_lights.size() - 1;
+}
+
+void Scene::SetLight(size_t index, const Light& light)
+{
+    m_lights[index] = light;
+    m_dirty = true;
+}
+
+void Scene::RemoveLight(size_t index)
+{
+    assert(index < m_lights.size() && "RemoveLight index out of range");
+    m_lights[index] = m_lights.back();
+    m_lights.pop_back();
+    m_dirty = true;
+}
+
+size_t Scene::AddModel(std::shared_ptr<Model> model, const glm::vec3& position, const glm::vec3& scale,
+                       const glm::vec3& rotation, size_t parent)
+{
+    assert((parent == NO_PARENT || parent < m_models.size()) && "AddModel parent out of range");
+    uint32_t index = static_cast<uint32_t>(m_models.size());
+    m_dirty = true;
+
+    TransformHierarchy::NodeId node = m_hierarchy.CreateNode(parent != NO_PARENT ? m_nodes[parent] : TransformHierarchy::INVALID_NODE, index);
+    m_hierarchy.SetLocalTransform(node, position, EulerToQuaternion(rotation), scale);
+
+    // Keep the imported hierarchy as a subtree, so moving the object costs O(subtree)
+    std::vector<TransformHierarchy::NodeId> modelNodes;
+    if (model)
+    {
+        for (const ModelNode& modelNode : model->GetNodes())
+        {
+            TransformHierarchy::NodeId parentNode = modelNode.parent < 0 ? node : modelNodes[modelNode.parent];
+            TransformHierarchy::NodeId child = m_hierarchy.CreateNode(parentNode);
+            m_hierarchy.SetLocalMatrix(child, modelNode.transform);
+            modelNodes.push_back(child);
+        }
+    }
+
+    // Bounded objects get their BVH proxy once UpdateTransforms() knows where they are
+    bool bounded = model && model->GetBounds().IsValid();
+    m_unboundedSlots.push_back(bounded ? UINT32_MAX : static_cast<uint32_t>(m_unboundedObjects.size()));
+    if (!bounded)
+        m_unboundedObjects.push_back(index);
+
+    uint32_t slot;
+    if (!m_freeSlots.empty())
+    {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(m_slotIndices.size());
+        m_slotIndices.push_back(0);
+        m_slotGenerations.push_back(0);
+    }
+    m_slotIndices[slot] = index;
+
+    m_models.push_back(std::move(model));
+    m_positions.push_back(position);
+    m_scales.push_back(scale);
+    m_rotations.push_back(rotation);
+    m_proxyIds.push_back(DynamicBvh::NULL_NODE);
+    m_occluders.push_back(0);
+    m_prePassed.push_back(1);
+    m_nodes.push_back(node);
+    m_modelNodes.push_back(std::move(modelNodes));
+    m_handleSlots.push_back(slot);
+    m_worldMatrices.emplace_back(1.0f);
+    m_worldBounds.emplace_back();
+    m_boundsX.push_back(0.0f);
+    m_boundsY.push_back(0.0f);
+    m_boundsZ.push_back(0.0f);
+    m_boundsRadius.push_back(0.0f);
+
+    return index;
+}
+
+void Scene::RemoveModel(ObjectHandle handle)
+{
+    assert(IsValid(handle) && "RemoveModel: stale handle");
+    RemoveModel(GetIndex(handle));
+}
+
+void Scene::RemoveModel(size_t index)
+{
+    assert(index < m_models.size() && "RemoveModel index out of range");
+
+    // Settle pending moves so the BVH and world data are current
+    UpdateTransforms();
+    m_dirty = true;
+
+    // The model may still be drawn by a snapshot in flight; it is released after the next one
+    if (m_models[index])
+        m_releasedModels.push_back(m_models[index]);
+
+    // Child objects move up to the removed object's parent; its model nodes go with it
+    TransformHierarchy::NodeId node = m_nodes[index];
+    TransformHierarchy::NodeId parentNode = m_hierarchy.GetParent(node);
+    for (TransformHierarchy::NodeId child : m_hierarchy.GetChildren(node))
+    {
+        if (m_hierarchy.GetUserData(child) != TransformHierarchy::NO_USER_DATA)
+            m_hierarchy.SetParent(child, parentNode);
+    }
+    m_hierarchy.DestroyNode(node);
+
+    if (m_proxyIds[index] != DynamicBvh::NULL_NODE)
+    {
+        m_bvh.DestroyProxy(m_proxyIds[index]);
+    }
+    else if (m_unboundedSlots[index] != UINT32_MAX)
+    {
+        // Swap-remove from the unbounded list too
+        uint32_t position = m_unboundedSlots[index];
+        uint32_t moved = m_unboundedObjects.back();
+        m_unboundedObjects[position] = moved;
+        m_unboundedSlots[moved] = position;
+        m_unboundedObjects.pop_back();
+    }
+
+    // Retire the handle
+    uint32_t slot = m_handleSlots[index];
+    ++m_slotGenerations[slot];
+    m_freeSlots.push_back(slot);
+
+    // Move the last object into the hole
+    size_t last = m_models.size() - 1;
+    if (index != last)
+    {
+        m_models[index] = std::move(m_models[last]);
+        m_positions[index] = m_positions[last];
+        m_scales[index] = m_scales[last];
+        m_rotations[index] = m_rotations[last];
+        m_proxyIds[index] = m_proxyIds[last];
+        m_occluders[index] = m_occluders[last];
+        m_prePassed[index] = m_prePassed[last];
+        m_nodes[index] = m_nodes[last];
+        m_modelNodes[index] = std::move(m_modelNodes[last]);
+        m_handleSlots[index] = m_handleSlots[last];
+        m_unboundedSlots[index] = m_unboundedSlots[last];
+        m_worldMatrices[index] = m_worldMatrices[last];
+        m_worldBounds[index] = m_worldBounds[last];
+        m_boundsX[index] = m_boundsX[last];
+        m_boundsY[index] = m_boundsY[last];
+        m_boundsZ[index] = m_boundsZ[last];
+        m_boundsRadius[index] = m_boundsRadius[last];
+
+        uint32_t newIndex = static_cast<uint32_t>(index);
+        m_slotIndices[m_handleSlots[index]] = newIndex;
+        m_hierarchy.SetUserData(m_nodes[index], newIndex);
+        if (m_proxyIds[index] != DynamicBvh::NULL_NODE)
+            m_bvh.SetUserData(m_proxyIds[index], newIndex);
+        else if (m_unboundedSlots[index] != UINT32_MAX)
+            m_unboundedObjects[m_unboundedSlots[index]] = newIndex;
+    }
+
+    m_models.pop_back();
+    m_positions.pop_back();
+    m_scales.pop_back();
+    m_rotations.pop_back();
+    m_proxyIds.pop_back();
+    m_occluders.pop_back();
+    m_prePassed.pop_back();
+    m_nodes.pop_back();
+    m_modelNodes.pop_back();
+    m_handleSlots.pop_back();
+    m_unboundedSlots.pop_back();
+    m_worldMatrices.pop_back();
+    m_worldBounds.pop_back();
+    m_boundsX.pop_back();
+    m_boundsY.pop_back();
+    m_boundsZ.pop_back();
+    m_boundsRadius.pop_back();
+}
+
+void Scene::SetParent(size_t index, size_t parent)
+{
+    assert(index < m_models.size() && (parent == NO_PARENT || parent < m_models.size()) && "SetParent index out of range");
+    m_hierarchy.SetParent(m_nodes[index], parent != NO_PARENT ? m_nodes[parent] : TransformHierarchy::INVALID_NODE);
+    m_dirty = true;
+}
+
+size_t Scene::GetParent(size_t index) const
+{
+    TransformHierarchy::NodeId parent = m_hierarchy.GetParent(m_nodes[index]);
+    return parent != TransformHierarchy::INVALID_NODE ? m_hierarchy.GetUserData(parent) : NO_PARENT;
+}
+
+void Scene::SetPosition(size_t index, const glm::vec3& position)
+{
+    m_positions[index] = position;
+    m_hierarchy.SetLocalPosition(m_nodes[index], position);
+    m_dirty = true;
+}
+
+void Scene::SetScale(size_t index, const glm::vec3& scale)
+{
+    m_scales[index] = scale;
+    m_hierarchy.SetLocalScale(m_nodes[index], scale);
+    m_dirty = true;
+}
+
+void Scene::SetRotation(size_t index, const glm::vec3& rotation)
+{
+    m_rotations[index] = rotation;
+    m_hierarchy.SetLocalOrientation(m_nodes[index], EulerToQuaternion(rotation));
+    m_dirty = true;
+}
+
+void Scene::SetTransform(size_t index, const glm::vec3& position, const glm::vec3& scale, const glm::vec3& rotation)
+{
+    m_positions[index] = position;
+    m_scales[index] = scale;
+    m_rotations[index] = rotation;
+    m_hierarchy.SetLocalTransform(m_nodes[index], position, EulerToQuaternion(rotation), scale);
+    m_dirty = true;
+}
+
+void Scene::UpdateTransforms()
+{
+    m_updatedObjects.clear();
+    m_hierarchy.Update(&m_updatedObjects);
+    if (m_updatedObjects.empty())
+        return;
+
+    ThreadPool::Get().ParallelFor(m_updatedObjects.size(), TRANSFORM_BATCH_SIZE, [this](size_t begin, size_t end, size_t)
+    {
+        ComputeWorldTransforms(m_updatedObjects.data() + begin, end - begin);
+    });
+
+    // The BVH is not thread-safe: refit serially
+    for (uint32_t i : m_updatedObjects)
+    {
+        if (m_proxyIds[i] != DynamicBvh::NULL_NODE)
+            m_bvh.MoveProxy(m_proxyIds[i], m_worldBounds[i]);
+        else if (m_worldBounds[i].IsValid())
+            m_proxyIds[i] = m_bvh.CreateProxy(m_worldBounds[i], i);
+    }
+}
+
+void Scene::ComputeWorldTransforms(const uint32_t* indices, size_t count)
+{
+    for (size_t k = 0; k < count; ++k)
+    {
+        m_worldMatrices[indices[k]] = m_hierarchy.GetWorldMatrix(m_nodes[indices[k]]);
+        ComputeWorldBounds(indices[k]);
+    }
+}
+
+void Scene::ComputeWorldBounds(size_t index)
+{
+    const Model* model = m_models[index].get();
+    const glm::mat4& world = m_worldMatrices[index];
+
+    if (!model || !model->GetBounds().IsValid())
+    {
+        // Unknown extent: never cull
+        m_worldBounds[index] = BoundingBox();
+        m_boundsX[index] = world[3].x;
+        m_boundsY[index] = world[3].y;
+        m_boundsZ[index] = world[3].z;
+        m_boundsRadius[index] = std::numeric_limits<float>::infinity();
+        return;
+    }
+
+    const BoundingBox& local = model->GetBounds();
+    m_worldBounds[index] = local.Transformed(world);
+
+    glm::vec3 center = glm::vec3(world * glm::vec4(local.GetCenter(), 1.0f));
+    float maxScale = std::max({ glm::length(glm::vec3(world[0])),
+                                glm::length(glm::vec3(world[1])),
+                                glm::length(glm::vec3(world[2])) });
+    m_boundsX[index] = center.x;
+    m_boundsY[index] = center.y;
+    m_boundsZ[index] = center.z;
+    m_boundsRadius[index] = local.GetRadius() * maxScale;
+}
+
+std::vector<size_t> Scene::QueryAABB(const BoundingBox& box)
+{
+    UpdateTransforms();
+
+    std::vector<size_t> result;
+    m_bvh.QueryAABB(box, [&](uint32_t i)
+    {
+        if (m_worldBounds[i].Intersects(box))
+            result.push_back(i);
+        return true;
+    });
+    return result;
+}
+
+std::vector<size_t> Scene::QuerySphere(const glm::vec3& center, float radius)
+{
+    UpdateTransforms();
+
+    std::vector<size_t> result;
+    m_bvh.QuerySphere(center, radius, [&](uint32_t i)
+    {
+        const BoundingBox& bounds = m_worldBounds[i];
+        glm::vec3 offset = glm::clamp(center, bounds.min, bounds.max) - center;
+        if (glm::dot(offset, offset) <= radius * radius)
+            result.push_back(i);
+        return true;
+    });
+    return result;
+}
+
+bool Scene::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                    size_t& hitIndex, float& hitDistance)
+{
+    UpdateTransforms();
+
+    const float inf = std::numeric_limits<float>::infinity();
+    glm::vec3 inverseDirection(direction.x != 0.0f ? 1.0f / direction.x : inf,
+                               direction.y != 0.0f ? 1.0f / direction.y : inf,
+                               direction.z != 0.0f ? 1.0f / direction.z : inf);
+
+    bool hit = false;
+    m_bvh.Raycast(origin, direction, maxDistance, [&](uint32_t i, float currentMax)
+    {
+        float distance;
+        if (DynamicBvh::RayIntersectsBox(origin, inverseDirection, m_worldBounds[i], currentMax, distance))
+        {
+            hit = true;
+            hitIndex = i;
+            hitDistance = distance;
+            // Keep a non-zero limit so a hit at the origin does not end the search early
+            return std::max(distance, std::numeric_limits<float>::min());
+        }
+        return currentMax;
+    });
+    return hit;
+}
+
+glm::mat3 Scene::ComputeNormalMatrix(const glm::mat4& model, const glm::vec3& scale)
+{
+    const glm::mat3 upper(model);
+
+    // With uniform scale the upper 3x3 is a rotation times s, so its inverse-transpose
+    // is the same matrix divided by s^2. Dividing by |s| keeps normals unit length
+    // without flipping them when s is negative.
+    const float eps = 1e-5f * std::max(std::abs(scale.x), 1.0f);
+    if (std::abs(scale.x - scale.y) <= eps && std::abs(scale.x - scale.z) <= eps && scale.x != 0.0f)
+    {
+        return upper * (1.0f / std::abs(scale.x));
+    }
+
+    return glm::transpose(glm::inverse(upper));
+}
+
+glm::mat3 Scene::ComputeNormalMatrix(const glm::mat4& model)
+{
+    const glm::mat3 upper(model);
+
+    // A rotation times s has orthogonal columns of length s
+    float lengthSq = glm::dot(upper[0], upper[0]);
+    const float eps = 1e-5f * std::max(lengthSq, 1.0f);
+    if (lengthSq > 0.0f &&
+        std::abs(glm::dot(upper[1], upper[1]) - lengthSq) <= eps && std::abs(glm::dot(upper[2], upper[2]) - lengthSq) <= eps &&
+        std::abs(glm::dot(upper[0], upper[1])) <= eps && std::abs(glm::dot(upper[0], upper[2])) <= eps &&
+        std::abs(glm::dot(upper[1], upper[2])) <= eps)
+    {
+        return upper * (1.0f / std::sqrt(lengthSq));
+    }
+
+    return glm::transpose(glm::inverse(upper));
+}
+
+void Scene::OnKeyInput(int key, int scancode, int action, int mods)
+{
+    // Movement is applied by Update() while the key is held
+    if (key >= 0 && key < static_cast<int>(m_keysDown.size()))
+    {
+        if (action == GLFW_PRESS)
+            m_keysDown[key] = true;
+        else if (action == GLFW_RELEASE)
+            m_keysDown[key] = false;
+    }
 }
 
 void Scene::OnMouseMove(double xpos, double ypos)
@@ -145,7 +1002,7 @@ void Scene::test()
     auto model = std::make_shared<Model>();
     scene.AddModel(model);
     assert(scene.GetModels().size() == 1 && "Failed to add model to scene");
-    assert(scene.GetModels()[0].model == model && "Wrong model in scene");
+    assert(scene.GetModels()[0] == model && "Wrong model in scene");
 
     // Test model transform
     glm::vec3 position(1.0f, 2.0f, 3.0f);
@@ -153,13 +1010,759 @@ void Scene::test()
     glm::vec3 rotation(45.0f, 90.0f, 180.0f);
     scene.AddModel(model, position, scale, rotation);
     
-    const auto& obj = scene.GetModels().back();
-    assert(obj.position == position && "Wrong position");
-    assert(obj.scale == scale && "Wrong scale");
-    assert(obj.rotation == rotation && "Wrong rotation");
+    assert(scene.GetPositions().back() == position && "Wrong position");
+    assert(scene.GetScales().back() == scale && "Wrong scale");
+    assert(scene.GetRotations().back() == rotation && "Wrong rotation");
+
+    // Test normal matrix: uniform fast path must match the general inverse-transpose,
+    // also for a negative (mirroring) scale
+    for (float s : { 3.0f, -3.0f })
+    {
+        glm::mat4 m(1.0f);
+        m = glm::translate(m, glm::vec3(4.0f, -2.0f, 1.0f));
+        m = glm::scale(m, glm::vec3(s));
+        m = glm::rotate(m, glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat3 fast = ComputeNormalMatrix(m, glm::vec3(s));
+        glm::mat3 reference = glm::transpose(glm::inverse(glm::mat3(m))) * std::abs(s);
+        for (int c = 0; c < 3; ++c)
+            for (int r = 0; r < 3; ++r)
+                assert(std::abs(fast[c][r] - reference[c][r]) < 1e-4f && "Uniform-scale normal matrix mismatch");
+    }
+
+    // Test normal matrix: non-uniform scale keeps normals perpendicular to surfaces
+    {
+        glm::mat4 m = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 4.0f, 1.0f));
+        glm::mat3 normalMatrix = ComputeNormalMatrix(m, glm::vec3(1.0f, 4.0f, 1.0f));
+        glm::vec3 tangent = glm::mat3(m) * glm::vec3(1.0f, -1.0f, 0.0f);
+        glm::vec3 normal = normalMatrix * glm::vec3(1.0f, 1.0f, 0.0f);
+        assert(std::abs(glm::dot(tangent, normal)) < 1e-4f && "Non-uniform normal matrix incorrect");
+    }
+
+    // Test frustum culling with both methods
+    for (CullingMethod method : { LINEAR_CULLING, BVH_CULLING })
+    {
+        Scene cullScene;
+        cullScene.SetCullingMethod(method);
+        auto box = std::make_shared<Model>();
+        box->SetBounds(BoundingBox(glm::vec3(-1.0f), glm::vec3(1.0f)));
+        cullScene.AddModel(box, glm::vec3(0.0f, 0.0f, -10.0f));   // In front of the camera
+        cullScene.AddModel(box, glm::vec3(0.0f, 0.0f, 20.0f));    // Behind the camera
+        cullScene.AddModel(std::make_shared<Model>(), glm::vec3(0.0f, 0.0f, 20.0f)); // No bounds, never culled
+
+        glm::mat4 viewProjection = cullScene.GetProjectionMatrix() * cullScene.GetCamera()->GetViewMatrix();
+        cullScene.Cull(viewProjection);
+        // The hierarchy may reject the hidden object without testing it individually
+        assert(cullScene.GetCullStats().tested == (method == LINEAR_CULLING ? 3u : 2u) && "Wrong tested count");
+        assert(cullScene.GetCullStats().culled == 1 && "Wrong culled count");
+        assert(cullScene.GetCullStats().drawn == 2 && "Wrong drawn count");
+        assert(cullScene.IsVisible(0) && !cullScene.IsVisible(1) && cullScene.IsVisible(2) && "Wrong visibility");
+
+        // Moving an object updates its bounds in the hierarchy
+        cullScene.SetPosition(1, glm::vec3(0.0f, 0.0f, -20.0f));
+        cullScene.Cull(viewProjection);
+        assert(cullScene.IsVisible(1) && cullScene.GetCullStats().drawn == 3 && "Moved object should be visible");
+
+        cullScene.SetFrustumCulling(false);
+        cullScene.Cull(viewProjection);
+        assert(cullScene.GetCullStats().drawn == 3 && cullScene.IsVisible(1) && "Disabled culling should draw everything");
+    }
+
+    // Test cached world transforms and dirty tracking
+    {
+        Scene transformScene;
+        auto box = std::make_shared<Model>();
+        box->SetBounds(BoundingBox(glm::vec3(-1.0f), glm::vec3(1.0f)));
+
+        // Enough objects for both the 4-wide kernel and the scalar tail
+        for (int i = 0; i < 11; ++i)
+        {
+            float f = static_cast<float>(i);
+            transformScene.AddModel(box, glm::vec3(f, -2.0f * f, 0.5f * f), glm::vec3(1.0f + 0.1f * f, 2.0f, 0.5f),
+                                    glm::vec3(17.0f * f, -31.0f * f, 45.0f + 7.0f * f));
+        }
+        assert(transformScene.GetDirtyCount() == 11 && "AddModel should defer the transform");
+        transformScene.UpdateTransforms();
+        assert(transformScene.GetDirtyCount() == 0 && transformScene.GetBvh().GetProxyCount() == 11 && "UpdateTransforms should place new objects");
+
+        auto matches = [&transformScene](size_t i)
+        {
+            glm::mat4 expected = BuildModelMatrix(transformScene.GetPositions()[i], transformScene.GetScales()[i],
+                                                  transformScene.GetRotations()[i]);
+            const glm::mat4& actual = transformScene.GetWorldMatrix(i);
+            for (int c = 0; c < 4; ++c)
+                for (int r = 0; r < 4; ++r)
+                    if (std::abs(expected[c][r] - actual[c][r]) > 1e-4f)
+                        return false;
+            return true;
+        };
+        for (size_t i = 0; i < 11; ++i)
+        {
+            assert(matches(i) && "Quaternion transform should match the Euler matrix");
+        }
+
+        // Setters only mark objects dirty, once each
+        transformScene.SetPosition(3, glm::vec3(5.0f, 6.0f, 7.0f));
+        transformScene.SetRotation(3, glm::vec3(10.0f, 20.0f, 30.0f));
+        for (size_t i = 4; i < 10; ++i)
+        {
+            transformScene.SetTransform(i, glm::vec3(static_cast<float>(i)), glm::vec3(0.5f), glm::vec3(90.0f, 0.0f, -45.0f));
+        }
+        transformScene.SetScale(10, glm::vec3(3.0f));
+        assert(transformScene.GetDirtyCount() == 8 && "Each moved object should be dirty once");
+        assert(transformScene.GetWorldMatrix(3)[3].x == 3.0f && "Dirty transforms should not update before UpdateTransforms");
+
+        glm::mat4 viewProjection = transformScene.GetProjectionMatrix() * transformScene.GetCamera()->GetViewMatrix();
+        transformScene.Cull(viewProjection);
+        assert(transformScene.GetCullStats().transformed == 8 && transformScene.GetDirtyCount() == 0 && "Cull should flush dirty transforms");
+        for (size_t i = 0; i < 11; ++i)
+        {
+            assert(matches(i) && "Updated transform should match the Euler matrix");
+        }
+        assert(transformScene.GetWorldBounds(10).max.x > 3.0f && transformScene.GetBvh().Validate() && "Bounds should follow the new scale");
+
+        // A static scene recomputes nothing
+        transformScene.Cull(viewProjection);
+        assert(transformScene.GetCullStats().transformed == 0 && "Static scene should not recompute transforms");
+
+        // Removal settles pending moves first
+        transformScene.SetPosition(10, glm::vec3(100.0f, 0.0f, 0.0f));
+        transformScene.RemoveModel(0);
+        assert(transformScene.GetDirtyCount() == 0 && transformScene.GetWorldMatrix(0)[3].x == 100.0f && "Moved object should be settled");
+    }
+
+    // Test parent/child objects and imported node hierarchies
+    {
+        Scene hierarchyScene;
+        auto box = std::make_shared<Model>();
+        box->SetBounds(BoundingBox(glm::vec3(-1.0f), glm::vec3(1.0f)));
+        auto imported = std::make_shared<Model>();
+        imported->SetBounds(BoundingBox(glm::vec3(-1.0f), glm::vec3(1.0f, 1.0f, 3.0f)));
+        imported->SetNodes({ { "root", glm::mat4(1.0f), -1, {} },
+                             { "arm", glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 2.0f)), 0, {} } });
+
+        size_t parent = hierarchyScene.AddModel(box, glm::vec3(10.0f, 0.0f, 0.0f), glm::vec3(2.0f));
+        size_t child = hierarchyScene.AddModel(imported, glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f), glm::vec3(0.0f), parent);
+        size_t other = hierarchyScene.AddModel(box, glm::vec3(-10.0f, 0.0f, 0.0f));
+        assert(hierarchyScene.GetParent(child) == parent && hierarchyScene.GetParent(parent) == NO_PARENT && "Wrong parents");
+        assert(hierarchyScene.GetModelNodes(child).size() == 2 && "Model nodes should be instantiated");
+
+        hierarchyScene.UpdateTransforms();
+        assert(hierarchyScene.GetWorldMatrix(child)[3].x == 12.0f && "Child should inherit the parent's transform");
+        assert(hierarchyScene.GetModelNodeWorldMatrix(child, 1)[3].z == 4.0f && "Model node should inherit the object's transform");
+        assert(hierarchyScene.GetWorldBounds(child).max.z == 6.0f && "Child bounds should include the parent's scale");
+        assert(hierarchyScene.GetTransformHierarchy().Validate() && "Hierarchy invalid");
+
+        // Moving the parent recomputes its subtree only
+        hierarchyScene.SetPosition(parent, glm::vec3(20.0f, 0.0f, 0.0f));
+        glm::mat4 viewProjection = hierarchyScene.GetProjectionMatrix() * hierarchyScene.GetCamera()->GetViewMatrix();
+        hierarchyScene.Cull(viewProjection);
+        assert(hierarchyScene.GetCullStats().transformed == 2 && "Parent and child should be recomputed");
+        assert(hierarchyScene.GetWorldMatrix(child)[3].x == 22.0f && hierarchyScene.GetWorldMatrix(other)[3].x == -10.0f && "Wrong world after move");
+        auto hits = hierarchyScene.QueryAABB(BoundingBox(glm::vec3(21.5f, -0.5f, -0.5f), glm::vec3(22.5f, 0.5f, 0.5f)));
+        std::sort(hits.begin(), hits.end());
+        assert(hits == std::vector<size_t>({ parent, child }) && "Child proxy should follow the parent");
+
+        // Reparenting keeps the local transform
+        hierarchyScene.SetParent(child, other);
+        hierarchyScene.UpdateTransforms();
+        assert(hierarchyScene.GetWorldMatrix(child)[3].x == -9.0f && hierarchyScene.GetParent(child) == other && "Reparented world incorrect");
+
+        // Removing a parent moves its children up
+        hierarchyScene.RemoveModel(other);
+        assert(hierarchyScene.GetModels().size() == 2 && hierarchyScene.GetParent(child) == NO_PARENT && "Child should become a root");
+        hierarchyScene.UpdateTransforms();
+        assert(hierarchyScene.GetWorldMatrix(child)[3].x == 1.0f && "Orphaned child should keep its local transform");
+        assert(hierarchyScene.GetTransformHierarchy().GetNodeCount() == 4 && hierarchyScene.GetBvh().Validate() && "Wrong node count after removal");
+
+        // Normal matrix of a general world matrix
+        glm::mat4 sheared = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f, 3.0f, 1.0f)) *
+                            glm::rotate(glm::mat4(1.0f), glm::radians(45.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        glm::mat3 reference = glm::transpose(glm::inverse(glm::mat3(sheared)));
+        glm::mat3 general = ComputeNormalMatrix(sheared);
+        glm::mat3 uniform = ComputeNormalMatrix(glm::scale(glm::mat4(1.0f), glm::vec3(2.0f)) * glm::rotate(glm::mat4(1.0f), 1.0f, glm::vec3(0.0f, 1.0f, 0.0f)));
+        for (int c = 0; c < 3; ++c)
+            for (int r = 0; r < 3; ++r)
+                assert(std::abs(general[c][r] - reference[c][r]) < 1e-4f && "General normal matrix mismatch");
+        assert(std::abs(glm::length(uniform * glm::vec3(0.0f, 0.0f, 1.0f)) - 1.0f) < 1e-4f && "Uniform normal matrix should keep unit length");
+    }
+
+    // Test occlusion culling
+    {
+        Scene occlusionScene;
+        auto wall = std::make_shared<Model>();
+        wall->SetBounds(BoundingBox(glm::vec3(-3.0f, -3.0f, -0.1f), glm::vec3(3.0f, 3.0f, 0.1f)));
+        wall->SetOccluderGeometry({ glm::vec3(-3.0f, -3.0f, 0.0f), glm::vec3(3.0f, -3.0f, 0.0f),
+                                    glm::vec3(3.0f, 3.0f, 0.0f), glm::vec3(-3.0f, 3.0f, 0.0f) },
+                                  { 0, 1, 2, 0, 2, 3 });
+        auto box = std::make_shared<Model>();
+        box->SetBounds(BoundingBox(glm::vec3(-0.5f), glm::vec3(0.5f)));
+
+        size_t wallIndex = occlusionScene.AddModel(wall, glm::vec3(0.0f, 0.0f, -5.0f));
+        occlusionScene.AddModel(box, glm::vec3(0.0f, 0.0f, -15.0f));   // Hidden behind the wall
+        occlusionScene.AddModel(box, glm::vec3(0.0f, 0.0f, -2.0f));    // In front of the wall
+        glm::mat4 viewProjection = occlusionScene.GetProjectionMatrix() * occlusionScene.GetCamera()->GetViewMatrix();
+
+        // Without occluders nothing is hidden
+        occlusionScene.Cull(viewProjection);
+        assert(occlusionScene.GetCullStats().occluded == 0 && occlusionScene.GetCullStats().drawn == 3 && "No occluders yet");
+
+        occlusionScene.SetOccluder(wallIndex, true);
+        occlusionScene.Cull(viewProjection);
+        const CullStats& stats = occlusionScene.GetCullStats();
+        assert(stats.occluders == 1 && stats.occluded == 1 && stats.culled == 0 && stats.drawn == 2 && "Wrong occlusion counts");
+        assert(occlusionScene.IsVisible(0) && !occlusionScene.IsVisible(1) && occlusionScene.IsVisible(2) && "Wrong occlusion visibility");
+        assert(stats.cullTimeMs >= stats.occlusionTimeMs && stats.occlusionTimeMs >= 0.0 && "Wrong cull timings");
+
+        occlusionScene.SetOcclusionCulling(false);
+        occlusionScene.Cull(viewProjection);
+        assert(occlusionScene.IsVisible(1) && occlusionScene.GetCullStats().drawn == 3 && "Disabled occlusion culling should draw everything");
+    }
+
+    // Test spatial queries and removal
+    {
+        Scene queryScene;
+        auto box = std::make_shared<Model>();
+        box->SetBounds(BoundingBox(glm::vec3(-1.0f), glm::vec3(1.0f)));
+        for (int i = 0; i < 10; ++i)
+        {
+            size_t index = queryScene.AddModel(box, glm::vec3(static_cast<float>(i) * 10.0f, 0.0f, 0.0f));
+            assert(index == static_cast<size_t>(i) && "AddModel should return the new index");
+        }
+
+        // The first query places the new objects without a frame in between
+        auto hits = queryScene.QueryAABB(BoundingBox(glm::vec3(15.0f, -1.0f, -1.0f), glm::vec3(31.0f, 1.0f, 1.0f)));
+        std::sort(hits.begin(), hits.end());
+        assert(hits == std::vector<size_t>({ 2, 3 }) && "QueryAABB returned wrong objects");
+        assert(queryScene.GetBvh().GetProxyCount() == 10 && queryScene.GetBvh().Validate() && "BVH not populated");
+
+        hits = queryScene.QuerySphere(glm::vec3(45.0f, 0.0f, 0.0f), 4.5f);
+        std::sort(hits.begin(), hits.end());
+        assert(hits == std::vector<size_t>({ 4, 5 }) && "QuerySphere returned wrong objects");
+
+        size_t hitIndex = 0;
+        float hitDistance = 0.0f;
+        bool hit = queryScene.Raycast(glm::vec3(-50.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 1000.0f, hitIndex, hitDistance);
+        assert(hit && hitIndex == 0 && std::abs(hitDistance - 49.0f) < 1e-4f && "Raycast should hit the first object");
+
+        // Removing object 0 moves object 9 into index 0
+        queryScene.RemoveModel(0);
+        assert(queryScene.GetModels().size() == 9 && queryScene.GetBvh().GetProxyCount() == 9 && "RemoveModel failed");
+        assert(queryScene.GetPositions()[0].x == 90.0f && "Last object should take the removed index");
+        hit = queryScene.Raycast(glm::vec3(-50.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 1000.0f, hitIndex, hitDistance);
+        assert(hit && hitIndex == 1 && "Raycast should skip the removed object");
+        hits = queryScene.QueryAABB(BoundingBox(glm::vec3(85.0f, 10.0f, -1.0f), glm::vec3(95.0f, 12.0f, 1.0f)));
+        assert(hits.empty() && "Query box misses everything");
+        hits = queryScene.QueryAABB(BoundingBox(glm::vec3(85.0f, -1.0f, -1.0f), glm::vec3(95.0f, 1.0f, 1.0f)));
+        assert(hits == std::vector<size_t>({ 0 }) && "Moved object should be reported under its new index");
+        assert(queryScene.GetBvh().Validate() && "BVH invalid after removal");
+
+        // Queries see objects added or moved since the last frame
+        size_t added = queryScene.AddModel(box, glm::vec3(200.0f, 0.0f, 0.0f));
+        hits = queryScene.QueryAABB(BoundingBox(glm::vec3(199.0f, -1.0f, -1.0f), glm::vec3(201.0f, 1.0f, 1.0f)));
+        assert(hits == std::vector<size_t>({ added }) && "A new object should be found at once");
+        queryScene.SetPosition(added, glm::vec3(300.0f, 0.0f, 0.0f));
+        hits = queryScene.QuerySphere(glm::vec3(200.0f, 0.0f, 0.0f), 2.0f);
+        assert(hits.empty() && "A moved object should not be found where it was");
+        hit = queryScene.Raycast(glm::vec3(250.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 1000.0f, hitIndex, hitDistance);
+        assert(hit && hitIndex == added && std::abs(hitDistance - 49.0f) < 1e-4f && "A moved object should be hit where it is");
+        queryScene.SetScale(added, glm::vec3(10.0f));
+        hit = queryScene.Raycast(glm::vec3(250.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 1000.0f, hitIndex, hitDistance);
+        assert(hit && hitIndex == added && std::abs(hitDistance - 40.0f) < 1e-4f && "A scaled object should be hit at its new size");
+        assert(queryScene.GetDirtyCount() == 0 && queryScene.GetBvh().Validate() && "Queries should leave the BVH up to date");
+    }
+
+    // Test generational handles and removal of unbounded objects
+    {
+        Scene handleScene;
+        auto box = std::make_shared<Model>();
+        box->SetBounds(BoundingBox(glm::vec3(-1.0f), glm::vec3(1.0f)));
+        auto empty = std::make_shared<Model>();
+
+        std::vector<ObjectHandle> handles;
+        for (int i = 0; i < 6; ++i)
+        {
+            size_t index = handleScene.AddModel(i % 2 == 0 ? box : empty, glm::vec3(static_cast<float>(i), 0.0f, 0.0f));
+            handles.push_back(handleScene.GetHandle(index));
+        }
+        assert(!handleScene.IsValid(ObjectHandle()) && "Default handle should be invalid");
+
+        // Removing by handle moves the last object; its handle follows it
+        handleScene.RemoveModel(handles[1]);
+        assert(!handleScene.IsValid(handles[1]) && handleScene.IsValid(handles[5]) && "Wrong handle validity after removal");
+        assert(handleScene.GetIndex(handles[5]) == 1 && handleScene.GetPositions()[1].x == 5.0f && "Handle should follow the moved object");
+        for (size_t h : { 0, 2, 3, 4, 5 })
+        {
+            size_t index = handleScene.GetIndex(handles[h]);
+            assert(handleScene.GetPositions()[index].x == static_cast<float>(h) && "Handle resolves to the wrong object");
+        }
+
+        // A reused slot gets a new generation
+        size_t index = handleScene.AddModel(empty);
+        ObjectHandle reused = handleScene.GetHandle(index);
+        assert(reused.slot == handles[1].slot && reused != handles[1] && !handleScene.IsValid(handles[1]) && "Stale handle should stay invalid");
+
+        // Unbounded objects are still drawn after their neighbours are removed
+        handleScene.RemoveModel(handles[3]);
+        handleScene.RemoveModel(handles[0]);
+        glm::mat4 viewProjection = handleScene.GetProjectionMatrix() * handleScene.GetCamera()->GetViewMatrix();
+        handleScene.Cull(viewProjection);
+        assert(handleScene.GetObjectCount() == 4 && handleScene.GetBvh().GetProxyCount() == 2 && "Wrong counts after removal");
+        assert(handleScene.IsVisible(handleScene.GetIndex(handles[5])) && handleScene.IsVisible(handleScene.GetIndex(reused)) &&
+               "Unbounded objects should never be culled");
+    }
+
+    // Test render snapshots
+    {
+        Scene snapshotScene;
+        auto box = std::make_shared<Model>();
+        box->SetBounds(BoundingBox(glm::vec3(-1.0f), glm::vec3(1.0f)));
+        auto imported = std::make_shared<Model>();
+        imported->SetBounds(BoundingBox(glm::vec3(-1.0f), glm::vec3(1.0f, 1.0f, 3.0f)));
+        imported->SetNodes({ { "root", glm::mat4(1.0f), -1, {} },
+                             { "arm", glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 2.0f)), 0, { 0 } } });
+
+        size_t first = snapshotScene.AddModel(box, glm::vec3(1.0f, 0.0f, 0.0f));
+        snapshotScene.AddModel(imported, glm::vec3(-1.0f, 0.0f, 0.0f));
+        ObjectHandle far = snapshotScene.GetHandle(snapshotScene.AddModel(box, glm::vec3(1000.0f, 0.0f, 0.0f)));
+
+        RenderSnapshot snapshot;
+        snapshotScene.BuildSnapshot(snapshot);
+        assert(snapshot.frame == 0 && snapshot.draws.size() == 2 && "Snapshot should hold the visible draws");
+        const DrawItem& whole = snapshot.draws[0].node == -1 ? snapshot.draws[0] : snapshot.draws[1];
+        const DrawItem& node = snapshot.draws[0].node == -1 ? snapshot.draws[1] : snapshot.draws[0];
+        assert(whole.model == box.get() && whole.world[3].x == 1.0f && "Wrong whole-model draw");
+        assert(node.model == imported.get() && node.node == 1 && node.world[3].z == 2.0f && "Only model nodes with meshes should be drawn");
+        assert(snapshot.released.empty() && "Nothing removed yet");
+
+        // Removed models stay alive until a snapshot has carried them to the renderer
+        std::weak_ptr<Model> removed = box;
+        box.reset();
+        snapshotScene.RemoveModel(first);
+        snapshotScene.RemoveModel(far);
+        assert(!removed.expired() && "Removed model should be kept for the next snapshot");
+        snapshotScene.BuildSnapshot(snapshot);
+        assert(snapshot.frame == 1 && snapshot.draws.size() == 1 && snapshot.released.size() == 2 && "Snapshot should carry removed models");
+        snapshot.released.clear();
+        assert(removed.expired() && "Removed model should be released with the snapshot");
+    }
+
+    // Test fixed-step camera movement and interpolated rendering
+    {
+        Scene stepScene;
+        glm::vec3 start = stepScene.GetCamera()->GetPosition();
+        stepScene.OnKeyInput(GLFW_KEY_W, 0, GLFW_PRESS, 0);
+        stepScene.Update(0.1f);
+        stepScene.Update(0.1f);
+        glm::vec3 moved = stepScene.GetCamera()->GetPosition();
+        assert(moved.z < start.z && "Held key should move the camera every step");
+        stepScene.OnKeyInput(GLFW_KEY_W, 0, GLFW_RELEASE, 0);
+        stepScene.Update(0.1f);
+        assert(stepScene.GetCamera()->GetPosition() == moved && "Released key should stop the camera");
+        stepScene.OnKeyInput(GLFW_KEY_W, 0, GLFW_PRESS, 0);
+        stepScene.Update(0.1f);
+        glm::vec3 previous = moved;
+        glm::vec3 current = stepScene.GetCamera()->GetPosition();
+
+        RenderSnapshot snapshot;
+        stepScene.SetInterpolationAlpha(0.5f);
+        stepScene.BuildSnapshot(snapshot);
+        assert(glm::length(snapshot.cameraPosition - (previous + current) * 0.5f) < 1e-5f && "Rendering should interpolate the camera");
+        stepScene.SetInterpolationAlpha(1.0f);
+        stepScene.BuildSnapshot(snapshot);
+        assert(snapshot.cameraPosition == current && "Alpha 1 should render the latest step");
+    }
+
+    // Test on-demand redraw tracking
+    {
+        Scene idleScene;
+        RenderSnapshot snapshot;
+        size_t index = idleScene.AddModel(std::make_shared<Model>());
+        assert(idleScene.NeedsRedraw() && "New objects should need a redraw");
+        idleScene.BuildSnapshot(snapshot);
+        assert(!idleScene.NeedsRedraw() && "Static scene should not need a redraw");
+
+        idleScene.SetPosition(index, glm::vec3(1.0f));
+        assert(idleScene.NeedsRedraw() && "Transform edits should need a redraw");
+        idleScene.BuildSnapshot(snapshot);
+        idleScene.GetCamera()->ProcessMouseScroll(1.0f);
+        assert(idleScene.NeedsRedraw() && "Camera changes should need a redraw");
+        idleScene.BuildSnapshot(snapshot);
+
+        // A held key keeps redrawing; after release, until a step has caught up
+        idleScene.OnKeyInput(GLFW_KEY_D, 0, GLFW_PRESS, 0);
+        assert(idleScene.NeedsRedraw() && "Held keys should need a redraw");
+        idleScene.Update(0.1f);
+        idleScene.OnKeyInput(GLFW_KEY_D, 0, GLFW_RELEASE, 0);
+        idleScene.BuildSnapshot(snapshot);
+        assert(idleScene.NeedsRedraw() && "Interpolated camera should catch up");
+        idleScene.Update(0.1f);
+        idleScene.BuildSnapshot(snapshot);
+        assert(!idleScene.NeedsRedraw() && "Camera at rest should not need a redraw");
+
+        idleScene.BeginContinuousRendering();
+        idleScene.BeginContinuousRendering();
+        idleScene.EndContinuousRendering();
+        idleScene.BuildSnapshot(snapshot);
+        assert(idleScene.NeedsRedraw() && "Continuous requests should keep redrawing");
+        idleScene.EndContinuousRendering();
+        assert(!idleScene.NeedsRedraw() && "Released requests should stop redrawing");
+
+        // Other threads wake the scene while the loop builds snapshots
+        std::atomic<bool> stop{ false };
+        std::thread editor([&idleScene, &stop]()
+        {
+            while (!stop)
+            {
+                idleScene.BeginContinuousRendering();
+                idleScene.MarkDirty();
+                idleScene.EndContinuousRendering();
+            }
+            idleScene.MarkDirty();
+        });
+        for (int i = 0; i < 100; ++i)
+            idleScene.BuildSnapshot(snapshot);
+        stop = true;
+        editor.join();
+        assert(idleScene.NeedsRedraw() && "A MarkDirty from another thread should be seen");
+        idleScene.BuildSnapshot(snapshot);
+        assert(!idleScene.NeedsRedraw() && "Balanced requests from another thread should leave no redraw");
+    }
+
+    // Test parallel draw preparation over several batches
+    {
+        Scene packetScene;
+        auto first = std::make_shared<Model>();
+        first->SetBounds(BoundingBox(glm::vec3(-0.1f), glm::vec3(0.1f)));
+        auto second = std::make_shared<Model>();
+        second->SetBounds(BoundingBox(glm::vec3(-0.1f), glm::vec3(0.1f)));
+        const size_t count = 5000;
+        for (size_t i = 0; i < count; ++i)
+        {
+            // A grid in front of the camera, models interleaved
+            glm::vec3 position(static_cast<float>(i % 50) * 0.2f - 5.0f, static_cast<float>(i / 50 % 10) * 0.2f - 1.0f, -5.0f - static_cast<float>(i / 500));
+            packetScene.AddModel(i % 2 == 0 ? first : second, position);
+        }
+
+        RenderSnapshot snapshot;
+        packetScene.BuildSnapshot(snapshot);
+        size_t visible = packetScene.GetCullStats().drawn;
+        assert(visible > 2 * PREPARE_BATCH_SIZE && snapshot.draws.size() == visible && "Every visible object should get one packet");
+
+        // Sorted by key: each model forms one run, drawn front to back
+        size_t modelChanges = 0;
+        bool sorted = true;
+        for (size_t d = 1; d < snapshot.draws.size(); ++d)
+        {
+            const DrawItem& previous = snapshot.draws[d - 1];
+            const DrawItem& current = snapshot.draws[d];
+            sorted = sorted && previous.sortKey <= current.sortKey;
+            if (previous.model != current.model)
+                ++modelChanges;
+            else
+                sorted = sorted && glm::length(glm::vec3(previous.world[3]) - snapshot.cameraPosition) <=
+                                   glm::length(glm::vec3(current.world[3]) - snapshot.cameraPosition) + 1e-4f;
+        }
+        assert(sorted && "Draws should be sorted by model, then front to back");
+        assert(modelChanges == 1 && "Draws of one model should be contiguous");
+    }
+
+    // Test selecting draws for the depth pre-pass, per object and per material
+    {
+        bool glTestMode = GlApi::IsTestMode();
+        GlApi::SetTestMode(true);
+
+        MaterialParameters alphaTested;
+        alphaTested.alphaTest = true;
+        MaterialParameters optedOut;
+        optedOut.depthPrePass = false;
+        auto makeModel = [](const MaterialParameters& parameters)
+        {
+            auto model = std::make_shared<Model>();
+            model->AddMesh(Mesh({ Vertex(), Vertex(), Vertex() }, { 0, 1, 2 }, std::make_shared<Material>(std::vector<Texture>(), parameters)));
+            model->SetBounds(BoundingBox(glm::vec3(-0.5f), glm::vec3(0.5f)));
+            return model;
+        };
+        auto opaque = makeModel(MaterialParameters());
+        assert(opaque->SupportsDepthPrePass() && !makeModel(alphaTested)->SupportsDepthPrePass() &&
+               !makeModel(optedOut)->SupportsDepthPrePass() && "Alpha-tested and opted-out materials should veto the pre-pass");
+
+        Scene prePassScene;
+        assert(!prePassScene.IsDepthPrePassEnabled() && "The pre-pass should be off by default");
+        size_t kept = prePassScene.AddModel(opaque, glm::vec3(0.0f, 0.0f, -5.0f));
+        size_t excluded = prePassScene.AddModel(opaque, glm::vec3(1.0f, 0.0f, -5.0f));
+        prePassScene.AddModel(makeModel(alphaTested), glm::vec3(-1.0f, 0.0f, -5.0f));
+        assert(prePassScene.IsPrePassed(kept) && "Objects should be pre-passed by default");
+        prePassScene.SetPrePassed(excluded, false);
+        prePassScene.SetDepthPrePass(true);
+
+        RenderSnapshot snapshot;
+        prePassScene.BuildSnapshot(snapshot);
+        assert(snapshot.depthPrePass && snapshot.draws.size() == 3 && "Snapshot should carry the pre-pass flag");
+        size_t prePassed = 0;
+        for (const DrawItem& draw : snapshot.draws)
+        {
+            if (draw.depthPrePass)
+            {
+                assert(draw.world[3].x == 0.0f && "Only the included opaque object should be pre-passed");
+                ++prePassed;
+            }
+        }
+        assert(prePassed == 1 && "Exactly one draw should be pre-passed");
+
+        // The last object's flag moves with it into the freed index
+        prePassScene.RemoveModel(excluded);
+        assert(prePassScene.IsPrePassed(excluded) && "Pre-pass flag should move with its object");
+
+        GlApi::SetTestMode(glTestMode);
+    }
 
     // Disable test mode
     SetTestMode(false);
 
     std::cout << "Scene tests passed!\n";
 }
+
+void Scene::benchmark()
+{
+    std::cout << "\nRunning Scene benchmarks...\n";
+
+    // Emulate the vertex stage on the CPU (as a software rasterizer would run it) to
+    // compare the old per-vertex inverse against a per-object normal matrix.
+    const size_t vertexCount = 1 << 20;
+    std::vector<glm::vec3> normals(vertexCount, glm::normalize(glm::vec3(0.3f, 0.8f, 0.5f)));
+    std::vector<glm::vec3> out(vertexCount);
+
+    glm::mat4 model(1.0f);
+    model = glm::translate(model, glm::vec3(0.0f, -1.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(0.1f));
+    model = glm::rotate(model, glm::radians(180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    using Clock = std::chrono::high_resolution_clock;
+    auto report = [vertexCount](const char* label, Clock::duration elapsed, float checksum)
+    {
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        std::cout << "  " << label << ": " << seconds * 1000.0 << " ms, "
+                  << (vertexCount / seconds) / 1.0e6 << " Mverts/s (checksum " << checksum << ")\n";
+    };
+
+    // Before: mat3(transpose(inverse(model))) evaluated for every vertex
+    auto start = Clock::now();
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        out[i] = glm::mat3(glm::transpose(glm::inverse(model))) * normals[i];
+    }
+    report("per-vertex inverse", Clock::now() - start, out[vertexCount / 2].x);
+
+    // After: normal matrix computed once, one mat3 * vec3 per vertex
+    start = Clock::now();
+    glm::mat3 normalMatrix = ComputeNormalMatrix(model, glm::vec3(0.1f));
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        out[i] = normalMatrix * normals[i];
+    }
+    report("per-object normal matrix", Clock::now() - start, out[vertexCount / 2].x);
+
+    // World transforms: rebuilding every object's matrix each frame from Euler angles versus
+    // recomputing only the dirty ones from cached quaternions
+    const size_t objectCount = 100000;
+    Scene scene;
+    auto box = std::make_shared<Model>();
+    box->SetBounds(BoundingBox(glm::vec3(-0.5f), glm::vec3(0.5f)));
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        float f = static_cast<float>(i);
+        scene.AddModel(box, glm::vec3(std::fmod(f, 100.0f), 0.0f, -f * 0.01f), glm::vec3(1.0f), glm::vec3(f, f * 0.5f, 0.0f));
+    }
+
+    auto timeMs = [](auto&& body)
+    {
+        auto begin = Clock::now();
+        body();
+        return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    };
+
+    std::vector<glm::mat4> rebuilt(objectCount);
+    double rebuildMs = timeMs([&]
+    {
+        for (size_t i = 0; i < objectCount; ++i)
+        {
+            rebuilt[i] = BuildModelMatrix(scene.GetPositions()[i], scene.GetScales()[i], scene.GetRotations()[i]);
+        }
+    });
+
+    double initialMs = timeMs([&] { scene.UpdateTransforms(); });
+    double staticMs = timeMs([&] { scene.UpdateTransforms(); });
+
+    for (size_t i = 0; i < objectCount; i += 100)
+    {
+        scene.SetPosition(i, scene.GetPositions()[i] + glm::vec3(0.01f));
+    }
+    double onePercentMs = timeMs([&] { scene.UpdateTransforms(); });
+
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        scene.SetPosition(i, scene.GetPositions()[i] + glm::vec3(0.01f));
+    }
+    double allMs = timeMs([&] { scene.UpdateTransforms(); });
+
+    std::cout << "  " << objectCount << " objects, rebuild all matrices from Euler angles: " << rebuildMs << " ms"
+              << " (checksum " << rebuilt[objectCount / 2][0][0] << ")\n";
+    std::cout << "  UpdateTransforms, first (proxies created): " << initialMs << " ms, static: " << staticMs
+              << " ms, 1% dirty: " << onePercentMs << " ms, all dirty (matrices, bounds, BVH refit): " << allMs << " ms\n";
+
+    // Object layout: the same update and cull code over one struct per object versus
+    // separate arrays, then the full Scene pipeline over the same objects
+    const size_t layoutCount = 1000000;
+    const BoundingBox localBounds = box->GetBounds();
+    const glm::vec3 step(0.01f, 0.0f, 0.0f);
+    auto placement = [](size_t i)
+    {
+        return glm::vec3(static_cast<float>(i % 1000) - 500.0f, static_cast<float>((i / 1000) % 10), -static_cast<float>(i / 10000) * 10.0f);
+    };
+    auto compose = [](const glm::vec3& position, const glm::quat& orientation, const glm::vec3& scale)
+    {
+        glm::mat3 rotation = glm::mat3_cast(orientation);
+        glm::mat4 world;
+        for (int column = 0; column < 3; ++column)
+        {
+            world[column] = glm::vec4(rotation[column] * scale, 0.0f);
+        }
+        world[3] = glm::vec4(position, 1.0f);
+        return world;
+    };
+    auto sphereOf = [&localBounds](const glm::mat4& world)
+    {
+        glm::vec3 center = glm::vec3(world * glm::vec4(localBounds.GetCenter(), 1.0f));
+        return glm::vec4(center, localBounds.GetRadius() * glm::length(glm::vec3(world[0])));
+    };
+    Frustum frustum(scene.GetProjectionMatrix() * scene.GetCamera()->GetViewMatrix());
+
+    double aosUpdateMs, aosCullMs, soaUpdateMs, soaCullMs, soaSimdCullMs;
+    size_t aosVisible = 0, soaVisible = 0;
+    {
+        std::vector<LegacyObject> objects(layoutCount);
+        for (size_t i = 0; i < layoutCount; ++i)
+        {
+            LegacyObject& obj = objects[i];
+            obj.model = box;
+            obj.position = placement(i);
+            obj.scale = glm::vec3(1.0f);
+            obj.rotation = glm::vec3(0.0f, static_cast<float>(i % 360), 0.0f);
+            obj.orientation = EulerToQuaternion(obj.rotation);
+        }
+
+        aosUpdateMs = timeMs([&]
+        {
+            for (LegacyObject& obj : objects)
+            {
+                obj.position += step;
+                obj.world = compose(obj.position, obj.orientation, obj.scale);
+                obj.bounds = localBounds.Transformed(obj.world);
+                obj.sphere = sphereOf(obj.world);
+            }
+        });
+        aosCullMs = timeMs([&]
+        {
+            for (const LegacyObject& obj : objects)
+            {
+                aosVisible += frustum.TestSphere(glm::vec3(obj.sphere), obj.sphere.w) ? 1 : 0;
+            }
+        });
+    }
+    {
+        std::vector<glm::vec3> positions(layoutCount), scales(layoutCount, glm::vec3(1.0f));
+        std::vector<glm::quat> orientations(layoutCount);
+        std::vector<glm::mat4> worlds(layoutCount);
+        std::vector<BoundingBox> bounds(layoutCount);
+        std::vector<float> x(layoutCount), y(layoutCount), z(layoutCount), radius(layoutCount);
+        std::vector<uint8_t> visible(layoutCount);
+        for (size_t i = 0; i < layoutCount; ++i)
+        {
+            positions[i] = placement(i);
+            orientations[i] = EulerToQuaternion(glm::vec3(0.0f, static_cast<float>(i % 360), 0.0f));
+        }
+
+        soaUpdateMs = timeMs([&]
+        {
+            for (size_t i = 0; i < layoutCount; ++i)
+            {
+                positions[i] += step;
+            }
+            for (size_t i = 0; i < layoutCount; ++i)
+            {
+                worlds[i] = compose(positions[i], orientations[i], scales[i]);
+                bounds[i] = localBounds.Transformed(worlds[i]);
+                glm::vec4 sphere = sphereOf(worlds[i]);
+                x[i] = sphere.x;
+                y[i] = sphere.y;
+                z[i] = sphere.z;
+                radius[i] = sphere.w;
+            }
+        });
+        soaCullMs = timeMs([&]
+        {
+            for (size_t i = 0; i < layoutCount; ++i)
+            {
+                soaVisible += frustum.TestSphere(glm::vec3(x[i], y[i], z[i]), radius[i]) ? 1 : 0;
+            }
+        });
+        soaSimdCullMs = timeMs([&]
+        {
+            frustum.CullSpheres(x.data(), y.data(), z.data(), radius.data(), layoutCount, visible.data());
+        });
+    }
+
+    double sceneUpdateMs, sceneLinearMs, sceneBvhMs;
+    size_t sceneVisible;
+    {
+        Scene large;
+        for (size_t i = 0; i < layoutCount; ++i)
+        {
+            large.AddModel(box, placement(i), glm::vec3(1.0f), glm::vec3(0.0f, static_cast<float>(i % 360), 0.0f));
+        }
+        large.UpdateTransforms();
+        glm::mat4 viewProjection = large.GetProjectionMatrix() * large.GetCamera()->GetViewMatrix();
+
+        sceneUpdateMs = timeMs([&]
+        {
+            const std::vector<glm::vec3>& positions = large.GetPositions();
+            for (size_t i = 0; i < layoutCount; ++i)
+            {
+                large.SetPosition(i, positions[i] + step);
+            }
+            large.UpdateTransforms();
+        });
+        large.SetCullingMethod(LINEAR_CULLING);
+        sceneLinearMs = timeMs([&] { large.Cull(viewProjection); });
+        large.SetCullingMethod(BVH_CULLING);
+        sceneBvhMs = timeMs([&] { large.Cull(viewProjection); });
+        sceneVisible = large.GetCullStats().drawn;
+    }
+
+    // Snapshot building: culling plus parallel draw packet preparation
+    double snapshotMs;
+    size_t snapshotDraws;
+    {
+        Scene large;
+        for (size_t i = 0; i < layoutCount / 10; ++i)
+        {
+            // Spread in front of the camera so that most objects are visible
+            glm::vec3 position(static_cast<float>(i % 100) - 50.0f, static_cast<float>(i / 100 % 100) - 50.0f, -60.0f - static_cast<float>(i / 10000) * 5.0f);
+            large.AddModel(box, position, glm::vec3(0.2f));
+        }
+        large.UpdateTransforms();
+        RenderSnapshot snapshot;
+        large.BuildSnapshot(snapshot);
+        snapshotMs = timeMs([&] { large.BuildSnapshot(snapshot); });
+        snapshotDraws = snapshot.draws.size();
+    }
+
+    std::cout << "  " << layoutCount << " objects, struct per object (" << sizeof(LegacyObject) << " bytes) vs arrays:\n";
+    std::cout << "    update (move, matrix, bounds): " << aosUpdateMs << " ms vs " << soaUpdateMs << " ms\n";
+    std::cout << "    cull (scalar sphere test): " << aosCullMs << " ms vs " << soaCullMs << " ms, SIMD kernel over arrays: "
+              << soaSimdCullMs << " ms (visible " << aosVisible << "/" << soaVisible << ")\n";
+    std::cout << "    Scene: move all + UpdateTransforms " << sceneUpdateMs << " ms, Cull linear " << sceneLinearMs
+              << " ms, Cull BVH " << sceneBvhMs << " ms (drawn " << sceneVisible << ")\n";
+    std::cout << "  BuildSnapshot with " << ThreadPool::Get().GetThreadCount() << " threads: " << snapshotMs << " ms for "
+              << snapshotDraws << " sorted draw packets\n";
+}
@@ -2,34 +2,89 @@
 
 #include <memory>
 #include <vector>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include "Model.h"
 #include "Camera.h"
-#include "Shader.h"
+#include "ShaderPermutations.h"
+#include "Frustum.h"
+#include "DynamicBvh.h"
+#include "OcclusionCuller.h"
+#include "TransformHierarchy.h"
+#include "RenderSnapshot.h"
+#include "StreamBuffer.h"
+#include "LightClusters.h"
+#include "ResourcePool.h"
+#include "VertexArrayCache.h"
 
 /**
- * \struct SceneObject
- * \brief A structure to hold a model and its transform data.
+ * \struct ObjectHandle
+ * \brief Stable reference to a scene object.
+ *
+ * Object indices are dense and change when other objects are removed; handles do not,
+ * and a handle to a removed object is recognized by its stale generation.
  */
-struct SceneObject
+struct ObjectHandle
 {
-    std::shared_ptr<Model> model;
-    glm::vec3 position;
-    glm::vec3 scale;
-    glm::vec3 rotation;
+    uint32_t slot = 0xFFFFFFFFu;    ///< Slot in the scene's handle table
+    uint32_t generation = 0;        ///< Generation of the slot when the handle was issued
+
+    bool operator==(const ObjectHandle& other) const = default;
+};
+
+/**
+ * \struct CullStats
+ * \brief Per-frame visibility culling counters.
+ */
+struct CullStats
+{
+    size_t tested = 0;          ///< Objects whose bounds were tested individually
+    size_t culled = 0;          ///< Objects outside the frustum
+    size_t occluders = 0;       ///< Visible occluders rasterized
+    size_t occluded = 0;        ///< Objects inside the frustum hidden behind occluders
+    size_t drawn = 0;           ///< Objects submitted for drawing
+    size_t transformed = 0;     ///< Objects whose world transforms were recomputed, moved or below a moved parent
+    double transformTimeMs = 0.0;   ///< Part of cullTimeMs spent recomputing dirty transforms
+    double cullTimeMs = 0.0;        ///< Total time spent in Cull()
+    double occlusionTimeMs = 0.0;   ///< Part of cullTimeMs spent on occlusion culling
 };
 
 /**
  * \class Scene
  * \brief A 3D scene containing models and a camera.
+ *
+ * Objects are stored as parallel arrays (structure of arrays) indexed by a dense object
+ * index, so each system streams over only the components it reads: culling touches
+ * bounding spheres, transform updates touch matrices and bounds. Removal moves the last
+ * object into the hole; ObjectHandle gives references that survive that.
  */
 class Scene
 {
 public:
     /**
-     * \brief Constructor.
+     * \brief How Cull() finds the objects inside the frustum.
      */
-    Scene();
+    enum CullingMethod
+    {
+        LINEAR_CULLING,     ///< Test every object's bounding sphere with the SIMD kernel
+        BVH_CULLING         ///< Walk the bounding volume hierarchy
+    };
+
+    /**
+     * \brief Constructor. Gets the scene shaders from a resource pool.
+     *
+     * A scene given a pool renders in a context that shares it with the context the pool's
+     * models were loaded in, e.g. a second window. Without a pool the scene makes a private
+     * one. Either way the scene keeps its own vertex arrays for the meshes it draws, so
+     * meshes never create vertex arrays in a context that may not be current when they
+     * are destroyed.
+     *
+     * \param resources Pool shared with other scenes, or nullptr.
+     */
+    explicit Scene(std::shared_ptr<ResourcePool> resources = nullptr);
 
     /**
      * \brief Destructor.
@@ -37,25 +92,482 @@ public:
     ~Scene();
 
     /**
-     * \brief Update the scene.
-     * \param deltaTime Time elapsed since last frame.
+     * \brief Advance the simulation by one step.
+     *
+     * Moves the camera for the keys held down and keeps the previous camera position
+     * for interpolated rendering.
+     *
+     * \param deltaTime Simulation step in seconds.
      */
     void Update(float deltaTime);
 
+    /**
+     * \brief Set where rendering falls between the last two simulation steps.
+     * \param alpha 0 renders the state before the last Update(), 1 the state after it.
+     */
+    void SetInterpolationAlpha(float alpha) { m_interpolationAlpha = alpha; }
+
+    /**
+     * \brief Get where rendering falls between the last two simulation steps.
+     * \return Interpolation factor in [0, 1].
+     */
+    float GetInterpolationAlpha() const { return m_interpolationAlpha; }
+
+    /**
+     * \brief Check whether the next frame would differ from the last snapshot.
+     *
+     * True after object or camera edits, while movement keys are held, until the
+     * interpolated camera has caught up with the simulation, and while continuous
+     * rendering is requested. BuildSnapshot() clears the edit flags.
+     *
+     * \return True if a frame should be rendered.
+     */
+    bool NeedsRedraw() const;
+
+    /**
+     * \brief Force a redraw, e.g. after a resize or an external change.
+     *
+     * Safe to call from any thread.
+     */
+    void MarkDirty() { m_dirty = true; }
+
+    /**
+     * \brief Keep rendering every frame, e.g. while an animation or streaming runs.
+     *
+     * Calls nest; each must be matched by EndContinuousRendering(). Safe to call from
+     * any thread.
+     */
+    void BeginContinuousRendering() { ++m_continuousRequests; }
+
+    /**
+     * \brief Release a BeginContinuousRendering() request. Safe to call from any thread.
+     */
+    void EndContinuousRendering();
+
     /**
      * \brief Render the scene.
+     *
+     * Same as BuildSnapshot() followed by Submit() on the calling thread.
      */
     void Render();
 
+    /**
+     * \brief Cull the scene and record the visible draws of one frame.
+     *
+     * Needs no GL context, so it can run on a simulation thread while another thread
+     * submits the previous snapshot. Draw packets (transforms, normal matrices and sort
+     * keys) are prepared on the thread pool and merged in sort-key order.
+     *
+     * \param snapshot Snapshot to fill; its previous contents are replaced.
+     */
+    void BuildSnapshot(RenderSnapshot& snapshot);
+
+    /**
+     * \brief Issue the GL calls for a snapshot.
+     *
+     * Must run on the thread where the GL context is current. Reads only the snapshot
+     * and the scene's shader, never the live objects.
+     *
+     * \param snapshot The snapshot to draw.
+     */
+    void Submit(const RenderSnapshot& snapshot);
+
+    /**
+     * \brief Find the objects inside a view frustum.
+     *
+     * Called by Render(); exposed so visibility can be computed without a GL context.
+     * Starts with UpdateTransforms(), so only objects moved since the last call pay for
+     * their transforms.
+     *
+     * \param viewProjection Combined projection * view matrix.
+     */
+    void Cull(const glm::mat4& viewProjection);
+
+    /**
+     * \brief Check whether an object survived the last Cull().
+     * \param index Object index.
+     * \return True if the object will be drawn.
+     */
+    bool IsVisible(size_t index) const { return index < m_visible.size() && m_visible[index] != 0; }
+
+    /**
+     * \brief Get the culling counters of the last Cull().
+     * \return Culling statistics.
+     */
+    const CullStats& GetCullStats() const { return m_cullStats; }
+
+    /**
+     * \brief Get the usage counters of the ring buffer that per-object constants are streamed through.
+     *
+     * Read them on the thread that calls Submit(), or after it stopped.
+     *
+     * \return Ring statistics; all zero before the first Submit().
+     */
+    StreamBufferStats GetObjectConstantStats() const { return m_objectConstants ? m_objectConstants->GetStats() : StreamBufferStats(); }
+
+    /**
+     * \brief Enable or disable frustum culling.
+     * \param enabled Whether to cull objects outside the view frustum.
+     */
+    void SetFrustumCulling(bool enabled) { m_frustumCulling = enabled; }
+
+    /**
+     * \brief Check if frustum culling is enabled.
+     * \return Whether frustum culling is enabled.
+     */
+    bool IsFrustumCullingEnabled() const { return m_frustumCulling; }
+
+    /**
+     * \brief Enable or disable occlusion culling.
+     *
+     * Only has an effect once objects are marked with SetOccluder().
+     *
+     * \param enabled Whether to cull objects hidden behind occluders.
+     */
+    void SetOcclusionCulling(bool enabled) { m_occlusionCulling = enabled; }
+
+    /**
+     * \brief Check if occlusion culling is enabled.
+     * \return Whether occlusion culling is enabled.
+     */
+    bool IsOcclusionCullingEnabled() const { return m_occlusionCulling; }
+
+    /**
+     * \brief Mark an object as an occluder.
+     *
+     * Visible occluders are rasterized into a low-resolution depth buffer each frame, and
+     * other objects whose bounds are hidden behind it are not drawn. Use large, solid objects
+     * such as walls and buildings; the model's occluder geometry is used when it has any.
+     *
+     * \param index Object index.
+     * \param occluder Whether the object occludes.
+     */
+    void SetOccluder(size_t index, bool occluder) { m_occluders[index] = occluder ? 1 : 0; }
+
+    /**
+     * \brief Check whether an object is an occluder.
+     * \param index Object index.
+     * \return True if the object occludes.
+     */
+    bool IsOccluder(size_t index) const { return m_occluders[index] != 0; }
+
+    /**
+     * \brief Enable or disable the depth pre-pass.
+     *
+     * The pre-passed objects are first drawn with a depth-only shader and then shaded with
+     * GL_EQUAL depth testing and depth writes off, so each of their pixels is shaded once
+     * however they overlap. Worth it when fragments are expensive and overdraw is high; it
+     * doubles the vertex work of those objects.
+     *
+     * \param enabled Whether to use a depth pre-pass.
+     */
+    void SetDepthPrePass(bool enabled) { m_depthPrePass = enabled; }
+
+    /**
+     * \brief Check if the depth pre-pass is enabled.
+     * \return Whether the depth pre-pass is enabled.
+     */
+    bool IsDepthPrePassEnabled() const { return m_depthPrePass; }
+
+    /**
+     * \brief Include or exclude an object from the depth pre-pass.
+     *
+     * Objects are included by default. Models with a material that opts out, or that is
+     * alpha tested, are never pre-passed.
+     *
+     * \param index Object index.
+     * \param prePassed Whether the object is drawn in the pre-pass.
+     */
+    void SetPrePassed(size_t index, bool prePassed) { m_prePassed[index] = prePassed ? 1 : 0; }
+
+    /**
+     * \brief Check whether an object is included in the depth pre-pass.
+     * \param index Object index.
+     * \return True unless excluded with SetPrePassed().
+     */
+    bool IsPrePassed(size_t index) const { return m_prePassed[index] != 0; }
+
+    /**
+     * \brief Add a dynamic light.
+     *
+     * Lights are binned into view clusters every frame, so any number can move freely.
+     *
+     * \param light The light.
+     * \return Index of the new light.
+     */
+    size_t AddLight(const Light& light);
+
+    /**
+     * \brief Replace a light, e.g. to move it.
+     * \param index Light index.
+     * \param light The new light.
+     */
+    void SetLight(size_t index, const Light& light);
+
+    /**
+     * \brief Remove a light; the last light is moved into the freed index.
+     * \param index Light index.
+     */
+    void RemoveLight(size_t index);
+
+    /**
+     * \brief Get a light.
+     * \param index Light index.
+     * \return The light.
+     */
+    const Light& GetLight(size_t index) const { return m_lights[index]; }
+
+    /**
+     * \brief Get the number of dynamic lights.
+     * \return Light count; valid indices are [0, count).
+     */
+    size_t GetLightCount() const { return m_lights.size(); }
+
+    /**
+     * \brief Get the binning counters of the last BuildSnapshot().
+     * \return Light clustering statistics.
+     */
+    const LightClusterStats& GetLightClusterStats() const { return m_lightClusters.GetStats(); }
+
+    /**
+     * \brief Get the software occlusion culler.
+     * \return The occlusion culler, holding the depth buffer of the last Cull().
+     */
+    const OcclusionCuller& GetOcclusionCuller() const { return m_occlusionCuller; }
+
+    /**
+     * \brief Select how Cull() finds visible objects.
+     * \param method The culling method.
+     */
+    void SetCullingMethod(CullingMethod method) { m_cullingMethod = method; }
+
+    /**
+     * \brief Get the culling method.
+     * \return The culling method.
+     */
+    CullingMethod GetCullingMethod() const { return m_cullingMethod; }
+
+    /// Parent index of root objects.
+    static constexpr size_t NO_PARENT = SIZE_MAX;
+
+    /**
+     * \brief Get the projection matrix used for rendering.
+     * \return Projection matrix.
+     */
+    const glm::mat4& GetProjectionMatrix() const { return m_projection; }
+
+    /**
+     * \brief Set the projection matrix used for rendering, e.g. for a new aspect ratio or depth range.
+     * \param projection Projection matrix.
+     */
+    void SetProjectionMatrix(const glm::mat4& projection)
+    {
+        m_projection = projection;
+        m_dirty = true;
+    }
+
     /**
      * \brief Add a model to the scene.
+     *
+     * The model's node hierarchy, if any, is instantiated below the object so its meshes
+     * follow it. The world transform is computed by the next UpdateTransforms().
+     *
      * \param model The model to add.
      * \param position The position of the model.
      * \param scale The scale of the model.
      * \param rotation The rotation of the model.
+     * \param parent Index of the parent object, or NO_PARENT.
+     * \return Index of the new object.
+     */
+    size_t AddModel(std::shared_ptr<Model> model, const glm::vec3& position = glm::vec3(0.0f),
+                    const glm::vec3& scale = glm::vec3(1.0f), const glm::vec3& rotation = glm::vec3(0.0f),
+                    size_t parent = NO_PARENT);
+
+    /**
+     * \brief Remove an object from the scene.
+     *
+     * The last object is moved into the freed index, so indices of other objects
+     * are stable except for the last one. Child objects are attached to the removed
+     * object's parent, keeping their local transforms.
+     *
+     * \param index Index of the object to remove.
      */
-    void AddModel(std::shared_ptr<Model> model, const glm::vec3& position = glm::vec3(0.0f),
-                 const glm::vec3& scale = glm::vec3(1.0f), const glm::vec3& rotation = glm::vec3(0.0f));
+    void RemoveModel(size_t index);
+
+    /**
+     * \brief Remove an object from the scene by handle.
+     * \param handle Handle of the object; must be valid.
+     */
+    void RemoveModel(ObjectHandle handle);
+
+    /**
+     * \brief Get a stable handle to an object.
+     * \param index Object index.
+     * \return Handle that stays valid until the object is removed.
+     */
+    ObjectHandle GetHandle(size_t index) const
+    {
+        uint32_t slot = m_handleSlots[index];
+        return ObjectHandle{ slot, m_slotGenerations[slot] };
+    }
+
+    /**
+     * \brief Check whether a handle refers to an object still in the scene.
+     * \param handle The handle.
+     * \return True if the object exists.
+     */
+    bool IsValid(ObjectHandle handle) const
+    {
+        return handle.slot < m_slotGenerations.size() && m_slotGenerations[handle.slot] == handle.generation;
+    }
+
+    /**
+     * \brief Get the current index of an object.
+     * \param handle Handle of the object; must be valid.
+     * \return Object index.
+     */
+    size_t GetIndex(ObjectHandle handle) const { return m_slotIndices[handle.slot]; }
+
+    /**
+     * \brief Attach an object to a parent object, keeping its local transform.
+     * \param index Object index.
+     * \param parent Index of the new parent, or NO_PARENT. Must not be a descendant of the object.
+     */
+    void SetParent(size_t index, size_t parent);
+
+    /**
+     * \brief Get the parent of an object.
+     * \param index Object index.
+     * \return Parent index, or NO_PARENT.
+     */
+    size_t GetParent(size_t index) const;
+
+    /**
+     * \brief Set the position of an object.
+     * \param index Object index.
+     * \param position New position.
+     */
+    void SetPosition(size_t index, const glm::vec3& position);
+
+    /**
+     * \brief Set the scale of an object.
+     * \param index Object index.
+     * \param scale New scale.
+     */
+    void SetScale(size_t index, const glm::vec3& scale);
+
+    /**
+     * \brief Set the rotation of an object.
+     * \param index Object index.
+     * \param rotation New Euler rotation in degrees.
+     */
+    void SetRotation(size_t index, const glm::vec3& rotation);
+
+    /**
+     * \brief Set the position, scale and rotation of an object at once.
+     * \param index Object index.
+     * \param position New position.
+     * \param scale New scale.
+     * \param rotation New Euler rotation in degrees.
+     */
+    void SetTransform(size_t index, const glm::vec3& position, const glm::vec3& scale, const glm::vec3& rotation);
+
+    /**
+     * \brief Recompute the world matrices and bounds of objects moved since the last call.
+     *
+     * Setters only mark objects dirty; this propagates them through the transform
+     * hierarchy in one pass, so moving an object also moves its children and model nodes,
+     * then recomputes the bounds of every moved object and refits their BVH proxies.
+     * Called by Cull() and by the spatial queries; call it directly before reading world
+     * matrices or bounds if objects were added or moved.
+     */
+    void UpdateTransforms();
+
+    /**
+     * \brief Get the number of objects and nodes waiting for UpdateTransforms().
+     * \return Dirty count, not counting descendants of dirty objects.
+     */
+    size_t GetDirtyCount() const { return m_hierarchy.GetDirtyCount(); }
+
+    /**
+     * \brief Get the world matrix of an object.
+     * \param index Object index.
+     * \return World matrix as of the last UpdateTransforms().
+     */
+    const glm::mat4& GetWorldMatrix(size_t index) const { return m_worldMatrices[index]; }
+
+    /**
+     * \brief Get the world matrices of all objects, by object index.
+     * \return World matrices as of the last UpdateTransforms().
+     */
+    const std::vector<glm::mat4>& GetWorldMatrices() const { return m_worldMatrices; }
+
+    /**
+     * \brief Get the world bounds of all objects, by object index.
+     * \return World bounds as of the last UpdateTransforms().
+     */
+    const std::vector<BoundingBox>& GetWorldBounds() const { return m_worldBounds; }
+
+    /**
+     * \brief Get the world matrix of one of an object's model nodes.
+     * \param index Object index.
+     * \param node Index into the model's GetNodes().
+     * \return World matrix as of the last UpdateTransforms().
+     */
+    const glm::mat4& GetModelNodeWorldMatrix(size_t index, size_t node) const
+    {
+        return m_hierarchy.GetWorldMatrix(m_modelNodes[index][node]);
+    }
+
+    /**
+     * \brief Get the transform hierarchy of the objects and their model nodes.
+     * \return The hierarchy.
+     */
+    const TransformHierarchy& GetTransformHierarchy() const { return m_hierarchy; }
+
+    /**
+     * \brief Get the world-space bounds of an object.
+     * \param index Object index.
+     * \return World bounds as of the last UpdateTransforms(), invalid if the model has no bounds.
+     */
+    const BoundingBox& GetWorldBounds(size_t index) const { return m_worldBounds[index]; }
+
+    /**
+     * \brief Find the objects whose world bounds overlap a box.
+     *
+     * Like the other spatial queries, starts with UpdateTransforms(), so objects added or
+     * moved since the last frame are found where they are now.
+     *
+     * \param box Query box.
+     * \return Indices of the overlapping objects.
+     */
+    std::vector<size_t> QueryAABB(const BoundingBox& box);
+
+    /**
+     * \brief Find the objects whose world bounds overlap a sphere.
+     * \param center Sphere center.
+     * \param radius Sphere radius.
+     * \return Indices of the overlapping objects.
+     */
+    std::vector<size_t> QuerySphere(const glm::vec3& center, float radius);
+
+    /**
+     * \brief Find the nearest object whose world bounds are hit by a ray.
+     * \param origin Ray origin.
+     * \param direction Ray direction (distances are in its units).
+     * \param maxDistance Maximum ray distance.
+     * \param hitIndex Output index of the hit object.
+     * \param hitDistance Output distance to the hit.
+     * \return True if an object was hit.
+     */
+    bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                 size_t& hitIndex, float& hitDistance);
+
+    /**
+     * \brief Get the bounding volume hierarchy over the objects' world bounds.
+     * \return The BVH.
+     */
+    const DynamicBvh& GetBvh() const { return m_bvh; }
 
     /**
      * \brief Handle keyboard input.
@@ -81,10 +593,41 @@ public:
     void OnMouseScroll(double xoffset, double yoffset);
 
     /**
-     * \brief Get all models in the scene.
-     * \return Vector of scene objects.
+     * \brief Get the number of objects in the scene.
+     * \return Object count; valid indices are [0, count).
      */
-    const std::vector<SceneObject>& GetModels() const { return m_objects; }
+    size_t GetObjectCount() const { return m_models.size(); }
+
+    /**
+     * \brief Get the model of every object, by object index.
+     * \return Model references.
+     */
+    const std::vector<std::shared_ptr<Model>>& GetModels() const { return m_models; }
+
+    /**
+     * \brief Get the position of every object relative to its parent, by object index.
+     * \return Positions.
+     */
+    const std::vector<glm::vec3>& GetPositions() const { return m_positions; }
+
+    /**
+     * \brief Get the scale of every object, by object index.
+     * \return Scales.
+     */
+    const std::vector<glm::vec3>& GetScales() const { return m_scales; }
+
+    /**
+     * \brief Get the Euler rotation of every object in degrees, by object index.
+     * \return Rotations.
+     */
+    const std::vector<glm::vec3>& GetRotations() const { return m_rotations; }
+
+    /**
+     * \brief Get the transform nodes instantiated for an object's model hierarchy.
+     * \param index Object index.
+     * \return One node per entry of the model's GetNodes(), empty if the model has none.
+     */
+    const std::vector<TransformHierarchy::NodeId>& GetModelNodes(size_t index) const { return m_modelNodes[index]; }
 
     /**
      * \brief Get the scene's camera.
@@ -92,11 +635,71 @@ public:
      */
     Camera* GetCamera() const { return m_camera.get(); }
 
+    /**
+     * \brief Get the pool the scene's shaders come from, to share with other scenes.
+     * \return The resource pool.
+     */
+    const std::shared_ptr<ResourcePool>& GetResources() const { return m_resources; }
+
+    /**
+     * \brief Get the vertex arrays the scene made for the meshes it draws.
+     * \return The cache of the scene's context.
+     */
+    const VertexArrayCache* GetVertexArrays() const { return &m_vertexArrays; }
+
+    /**
+     * \brief Compute the matrix that transforms object-space normals to world space.
+     *
+     * Objects with uniform scale take a fast path that only rescales the upper 3x3 of
+     * the model matrix; everything else falls back to a 3x3 inverse-transpose.
+     *
+     * \param model The object's model matrix.
+     * \param scale The object's scale, used to detect the uniform-scale fast path.
+     * \return The normal matrix.
+     */
+    static glm::mat3 ComputeNormalMatrix(const glm::mat4& model, const glm::vec3& scale);
+
+    /**
+     * \brief Compute the normal matrix of an arbitrary world matrix, e.g. below a parent.
+     *
+     * Takes the uniform-scale fast path when the upper 3x3 columns are orthogonal and of
+     * equal length.
+     *
+     * \param model The world matrix.
+     * \return The normal matrix.
+     */
+    static glm::mat3 ComputeNormalMatrix(const glm::mat4& model);
+
+    /**
+     * \brief Build a model matrix from position, scale and rotation.
+     *
+     * Reference implementation of translate * scale * rotateX * rotateY * rotateZ;
+     * UpdateTransforms() computes the same local matrix from a cached quaternion.
+     *
+     * \param position Translation.
+     * \param scale Scale.
+     * \param rotation Euler rotation in degrees.
+     * \return Model matrix.
+     */
+    static glm::mat4 BuildModelMatrix(const glm::vec3& position, const glm::vec3& scale, const glm::vec3& rotation);
+
+    /**
+     * \brief Convert Euler angles to the quaternion of rotateX * rotateY * rotateZ.
+     * \param degrees Euler rotation in degrees.
+     * \return Unit quaternion.
+     */
+    static glm::quat EulerToQuaternion(const glm::vec3& degrees);
+
     /**
      * \brief Run unit tests for Scene class.
      */
     static void test();
 
+    /**
+     * \brief Run performance benchmarks for Scene class.
+     */
+    static void benchmark();
+
     /**
      * \brief Enable or disable test mode.
      * \param enabled Whether to enable test mode.
@@ -110,12 +713,127 @@ public:
     static bool IsTestMode() { return s_testMode; }
 
 private:
+    /**
+     * \brief Rasterize the visible occluders and drop the objects they hide from the visible list.
+     * \param viewProjection Combined projection * view matrix.
+     */
+    void CullOccluded(const glm::mat4& viewProjection);
+
+    /**
+     * \brief Copy world matrices from the hierarchy and recompute bounds and bounding spheres.
+     *
+     * Does not touch the BVH, so it can run on several threads.
+     *
+     * \param indices Object indices.
+     * \param count Number of indices.
+     */
+    void ComputeWorldTransforms(const uint32_t* indices, size_t count);
+
+    /**
+     * \brief Build the draw packets of visible objects and sort them by key.
+     *
+     * Reads the scene only, so slices of the visible list can be prepared on several
+     * threads, each into its own buffer.
+     *
+     * \param indices Visible object indices.
+     * \param count Number of indices.
+     * \param cameraPosition Camera position used for the depth part of sort keys.
+     * \param draws Buffer the packets are appended to.
+     */
+    void PrepareDraws(const uint32_t* indices, size_t count, const glm::vec3& cameraPosition, std::vector<DrawItem>& draws) const;
+
+    /**
+     * \brief Compute the sort key of a draw.
+     * \param model Model drawn.
+     * \param world World matrix of the draw.
+     * \param cameraPosition Camera position.
+     * \return Key grouping draws by model, then front to back.
+     */
+    static uint64_t ComputeSortKey(const Model* model, const glm::mat4& world, const glm::vec3& cameraPosition);
+
+    /**
+     * \brief Stream a light grid into shader storage and bind it for basic.frag.
+     * \param grid The light grid; must hold at least one light.
+     */
+    void UploadLightGrid(const LightGrid& grid);
+
+    /**
+     * \brief Bind the streamed constants of a draw and issue it.
+     * \param draw The draw.
+     * \param constants Slice holding the draw's ObjectConstants.
+     * \param frustum Frustum to test each mesh against, or nullptr.
+     * \param pass Whether to shade or write depth only.
+     */
+    void SubmitDraw(const DrawItem& draw, const StreamAllocation& constants, const Frustum* frustum, DrawPass pass) const;
+
+    /**
+     * \brief Recompute the world bounds and bounding sphere of an object from its world matrix.
+     * \param index Object index.
+     */
+    void ComputeWorldBounds(size_t index);
+
     std::unique_ptr<Camera> m_camera;           ///< Scene camera
-    std::unique_ptr<Shader> m_shader;           ///< Scene shader
-    std::vector<SceneObject> m_objects;         ///< Scene objects
+    std::shared_ptr<ResourcePool> m_resources;  ///< Pool the shaders come from
+    std::shared_ptr<ShaderPermutations> m_shaders;  ///< Variants of the scene shader
+    std::shared_ptr<Shader> m_depthShader;      ///< Depth-only shader of the pre-pass
+    VertexArrayCache m_vertexArrays;            ///< Vertex arrays of this context
+    std::unique_ptr<StreamBuffer> m_objectConstants;    ///< Ring of per-object constants, created by the first Submit()
+    std::vector<StreamAllocation> m_drawConstants;      ///< Slice of m_objectConstants per draw of the submitted snapshot
+    std::unique_ptr<StreamBuffer> m_lightData;  ///< Ring of light grids, created by the first Submit() with lights
+    std::vector<Light> m_lights;                ///< Dynamic lights
+    LightClusters m_lightClusters;              ///< Bins m_lights into the snapshot's light grid
     bool m_firstMouse;                          ///< First mouse movement flag
     double m_lastX;                             ///< Last mouse X position
     double m_lastY;                             ///< Last mouse Y position
+    std::array<bool, 1024> m_keysDown;          ///< Keys currently held, by GLFW key code
+    glm::vec3 m_previousCameraPosition;         ///< Camera position before the last Update()
+    float m_interpolationAlpha;                 ///< Render position between the last two simulation steps
+    std::atomic<bool> m_dirty;                  ///< Objects changed since the last snapshot; set from any thread
+    std::atomic<int> m_continuousRequests;      ///< Outstanding BeginContinuousRendering() calls, from any thread
+    glm::mat4 m_projection;                     ///< Projection matrix
+    Frustum m_frustum;                          ///< Frustum of the last Cull()
+    bool m_frustumCulling;                      ///< Frustum culling flag
+    CullingMethod m_cullingMethod;              ///< How Cull() finds visible objects
+    bool m_occlusionCulling;                    ///< Occlusion culling flag
+    bool m_depthPrePass;                        ///< Depth pre-pass flag
+    CullStats m_cullStats;                      ///< Counters of the last Cull()
+    DynamicBvh m_bvh;                           ///< Hierarchy over world bounds of bounded objects
+    std::vector<uint32_t> m_unboundedObjects;   ///< Objects without bounds, never culled
+    std::vector<uint32_t> m_unboundedSlots;     ///< Per object: position in m_unboundedObjects, or UINT32_MAX
+
+    // Per object, by dense object index
+    std::vector<std::shared_ptr<Model>> m_models;   ///< Model of each object
+    std::vector<glm::vec3> m_positions;         ///< Position relative to the parent
+    std::vector<glm::vec3> m_scales;            ///< Scale
+    std::vector<glm::vec3> m_rotations;         ///< Euler rotation in degrees
+    std::vector<int> m_proxyIds;                ///< BVH proxy, NULL_NODE until bounds are known or if the model has none
+    std::vector<uint8_t> m_occluders;           ///< Rasterized into the occlusion buffer when visible
+    std::vector<uint8_t> m_prePassed;           ///< Drawn in the depth pre-pass when it is enabled
+    std::vector<TransformHierarchy::NodeId> m_nodes;    ///< Transform node of each object
+    std::vector<std::vector<TransformHierarchy::NodeId>> m_modelNodes;  ///< Nodes of the model hierarchy, children of m_nodes
+    std::vector<uint32_t> m_handleSlots;        ///< Handle slot of each object
+    TransformHierarchy m_hierarchy;             ///< Object and model node transforms, user data is the object index
+    std::vector<uint32_t> m_updatedObjects;     ///< Objects moved by the last UpdateTransforms()
+    std::vector<glm::mat4> m_worldMatrices;     ///< World transform per object
+    std::vector<BoundingBox> m_worldBounds;     ///< World bounds per object
+    std::vector<float> m_boundsX;               ///< World bounding sphere center x per object
+    std::vector<float> m_boundsY;               ///< World bounding sphere center y per object
+    std::vector<float> m_boundsZ;               ///< World bounding sphere center z per object
+    std::vector<float> m_boundsRadius;          ///< World bounding sphere radius per object
+    std::vector<uint8_t> m_visible;             ///< Visibility flag per object
+    std::vector<uint32_t> m_visibleList;        ///< Indices of visible objects
+    OcclusionCuller m_occlusionCuller;          ///< CPU depth buffer of visible occluders
+    std::vector<uint32_t> m_occludees;          ///< Visible non-occluders tested against the depth buffer
+    RenderSnapshot m_snapshot;                  ///< Snapshot reused by Render()
+    std::vector<std::vector<DrawItem>> m_drawPackets;   ///< Per-thread draw packets, merged into the snapshot
+    std::vector<size_t> m_packetHeads;          ///< Per-thread merge positions
+    std::vector<std::shared_ptr<Model>> m_releasedModels;  ///< Removed models, handed to the next snapshot
+    uint64_t m_frameCount;                      ///< Snapshots built so far
+
+    // Per handle slot
+    std::vector<uint32_t> m_slotIndices;        ///< Object index of each slot
+    std::vector<uint32_t> m_slotGenerations;    ///< Incremented when the slot's object is removed
+    std::vector<uint32_t> m_freeSlots;          ///< Slots available for reuse
 
     static bool s_testMode;                     ///< Test mode flag
 };
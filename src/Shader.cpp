@@ -1,7 +1,11 @@
 #include "Shader.h"
+#include "GlApi.h"
+#include "ProgramCache.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cassert>
+#include <algorithm>
 #include <GL/glew.h>
 #include <glm/gtc/type_ptr.hpp>
 
@@ -10,24 +14,43 @@ bool Shader::s_testMode = false;
 
 Shader::Shader()
     : m_program(0)
+    , m_pendingProgram(0)
+    , m_pendingVertexShader(0)
+    , m_pendingFragmentShader(0)
+    , m_pendingKey(0)
 {
 }
 
 Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath)
     : m_program(0)
+    , m_pendingProgram(0)
+    , m_pendingVertexShader(0)
+    , m_pendingFragmentShader(0)
+    , m_pendingKey(0)
 {
     LoadFromFiles(vertexPath, fragmentPath);
 }
 
 Shader::~Shader()
 {
+    CancelLoad();
     if (m_program != 0)
     {
-        glDeleteProgram(m_program);
+        GlApi::DeleteProgram(m_program);
     }
 }
 
 bool Shader::LoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath)
+{
+    if (!BeginLoadFromFiles(vertexPath, fragmentPath, ""))
+    {
+        return false;
+    }
+
+    return Wait();
+}
+
+bool Shader::BeginLoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines)
 {
     // Read shader source files
     std::string vertexCode = ReadFile(vertexPath);
@@ -37,113 +60,214 @@ bool Shader::LoadFromFiles(const std::string& vertexPath, const std::string& fra
         return false;
     }
 
-    GLuint vertexShader = 0, fragmentShader = 0;
+    CancelLoad();
 
-    // Compile shaders
-    if (!CompileShader(vertexCode, GL_VERTEX_SHADER, vertexShader) ||
-        !CompileShader(fragmentCode, GL_FRAGMENT_SHADER, fragmentShader))
+    // Reuse the binary linked by an earlier run if the driver still accepts it
+    ProgramCache& cache = ProgramCache::Get();
+    uint64_t key = cache.GetKey({ vertexCode, fragmentCode }, defines);
+    GLuint cachedProgram = 0;
+    if (cache.Load(key, cachedProgram))
     {
-        return false;
+        if (m_program != 0)
+        {
+            GlApi::DeleteProgram(m_program);
+        }
+        m_program = cachedProgram;
+        return true;
     }
 
-    // Link program
-    if (!LinkProgram(vertexShader, fragmentShader))
+    // Issue compile and link without querying their status, so a driver compiling in parallel returns at once
+    m_pendingVertexShader = CompileShader(AddDefines(vertexCode, defines), GL_VERTEX_SHADER);
+    m_pendingFragmentShader = CompileShader(AddDefines(fragmentCode, defines), GL_FRAGMENT_SHADER);
+    m_pendingProgram = LinkProgram(m_pendingVertexShader, m_pendingFragmentShader, key != 0);
+    m_pendingKey = key;
+    return true;
+}
+
+bool Shader::Poll()
+{
+    if (!IsPending())
     {
-        return false;
+        return true;
     }
 
-    // Delete shaders as they're linked into our program now and no longer necessary
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    if (IsParallelCompileSupported())
+    {
+        GLint completed = GL_FALSE;
+        GlApi::GetProgramiv(m_pendingProgram, GL_COMPLETION_STATUS_KHR, &completed);
+        if (!completed)
+        {
+            return false;
+        }
+    }
 
+    FinishLoad();
     return true;
 }
 
+bool Shader::Wait()
+{
+    // Querying the link status waits for a compile that is still running
+    return !IsPending() || FinishLoad();
+}
+
+bool Shader::IsParallelCompileSupported()
+{
+    return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+}
+
+std::string Shader::AddDefines(const std::string& source, const std::string& defines)
+{
+    if (defines.empty())
+    {
+        return source;
+    }
+
+    // Defines must follow #version; #line keeps compiler messages pointing at the file's own lines
+    size_t version = source.find("#version");
+    if (version == std::string::npos)
+    {
+        return defines + "#line 1\n" + source;
+    }
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos)
+    {
+        return source + "\n" + defines;
+    }
+    size_t nextLine = std::count(source.begin(), source.begin() + lineEnd, '\n') + 2;
+    return source.substr(0, lineEnd + 1) + defines + "#line " + std::to_string(nextLine) + "\n" + source.substr(lineEnd + 1);
+}
+
 void Shader::Use() const
 {
-    glUseProgram(m_program);
+    GlApi::UseProgram(m_program);
 }
 
 GLint Shader::GetUniformLocation(const std::string& name) const
 {
-    return glGetUniformLocation(m_program, name.c_str());
+    return GlApi::GetUniformLocation(m_program, name.c_str());
 }
 
 void Shader::SetBool(const std::string& name, bool value) const
 {
-    glUniform1i(GetUniformLocation(name), (int)value);
+    GlApi::Uniform1i(GetUniformLocation(name), (int)value);
 }
 
 void Shader::SetInt(const std::string& name, int value) const
 {
-    glUniform1i(GetUniformLocation(name), value);
+    GlApi::Uniform1i(GetUniformLocation(name), value);
 }
 
 void Shader::SetFloat(const std::string& name, float value) const
 {
-    glUniform1f(GetUniformLocation(name), value);
+    GlApi::Uniform1f(GetUniformLocation(name), value);
 }
 
 void Shader::SetVec3(const std::string& name, const glm::vec3& value) const
 {
-    glUniform3fv(GetUniformLocation(name), 1, glm::value_ptr(value));
+    GlApi::Uniform3fv(GetUniformLocation(name), 1, glm::value_ptr(value));
+}
+
+void Shader::SetMat3(const std::string& name, const glm::mat3& value) const
+{
+    GlApi::UniformMatrix3fv(GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
 }
 
 void Shader::SetMat4(const std::string& name, const glm::mat4& value) const
 {
-    glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+    GlApi::UniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
 }
 
-bool Shader::CompileShader(const std::string& source, GLenum type, GLuint& shader)
+GLuint Shader::CompileShader(const std::string& source, GLenum type)
 {
-    shader = glCreateShader(type);
+    GLuint shader = GlApi::CreateShader(type);
     const char* sourcePtr = source.c_str();
-    glShaderSource(shader, 1, &sourcePtr, NULL);
-    glCompileShader(shader);
+    GlApi::ShaderSource(shader, 1, &sourcePtr, NULL);
+    GlApi::CompileShader(shader);
+    return shader;
+}
 
+bool Shader::CheckCompileStatus(GLuint shader, GLenum type)
+{
     GLint success;
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    GlApi::GetShaderiv(shader, GL_COMPILE_STATUS, &success);
     if (!success)
     {
         GLchar infoLog[1024];
-        glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+        GlApi::GetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
         std::cerr << "Shader compilation error (" 
                   << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") 
                   << "): " << infoLog << std::endl;
-        glDeleteShader(shader);
         return false;
     }
     return true;
 }
 
-bool Shader::LinkProgram(GLuint vertexShader, GLuint fragmentShader)
+GLuint Shader::LinkProgram(GLuint vertexShader, GLuint fragmentShader, bool retrievable)
 {
-    // Delete old program if it exists
-    if (m_program != 0)
+    GLuint program = GlApi::CreateProgram();
+    GlApi::AttachShader(program, vertexShader);
+    GlApi::AttachShader(program, fragmentShader);
+    if (retrievable)
     {
-        glDeleteProgram(m_program);
+        GlApi::ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     }
+    GlApi::LinkProgram(program);
+    return program;
+}
 
-    // Create and link new program
-    m_program = glCreateProgram();
-    glAttachShader(m_program, vertexShader);
-    glAttachShader(m_program, fragmentShader);
-    glLinkProgram(m_program);
-
+bool Shader::FinishLoad()
+{
     GLint success;
-    glGetProgramiv(m_program, GL_LINK_STATUS, &success);
+    GlApi::GetProgramiv(m_pendingProgram, GL_LINK_STATUS, &success);
     if (!success)
     {
-        GLchar infoLog[1024];
-        glGetProgramInfoLog(m_program, sizeof(infoLog), NULL, infoLog);
-        std::cerr << "Shader program linking error: " << infoLog << std::endl;
-        glDeleteProgram(m_program);
-        m_program = 0;
+        // A failed compile also fails the link; report the compiler's message rather than the linker's
+        bool compiled = CheckCompileStatus(m_pendingVertexShader, GL_VERTEX_SHADER);
+        compiled = CheckCompileStatus(m_pendingFragmentShader, GL_FRAGMENT_SHADER) && compiled;
+        if (compiled)
+        {
+            GLchar infoLog[1024];
+            GlApi::GetProgramInfoLog(m_pendingProgram, sizeof(infoLog), NULL, infoLog);
+            std::cerr << "Shader program linking error: " << infoLog << std::endl;
+        }
+        CancelLoad();
         return false;
     }
+
+    // Replace the old program
+    if (m_program != 0)
+    {
+        GlApi::DeleteProgram(m_program);
+    }
+    m_program = m_pendingProgram;
+    m_pendingProgram = 0;
+    ProgramCache::Get().Store(m_pendingKey, m_program);
+    CancelLoad();
     return true;
 }
 
+void Shader::CancelLoad()
+{
+    // Delete shaders as they're linked into the program and no longer necessary
+    if (m_pendingVertexShader != 0)
+    {
+        GlApi::DeleteShader(m_pendingVertexShader);
+    }
+    if (m_pendingFragmentShader != 0)
+    {
+        GlApi::DeleteShader(m_pendingFragmentShader);
+    }
+    if (m_pendingProgram != 0)
+    {
+        GlApi::DeleteProgram(m_pendingProgram);
+    }
+    m_pendingVertexShader = 0;
+    m_pendingFragmentShader = 0;
+    m_pendingProgram = 0;
+    m_pendingKey = 0;
+}
+
 std::string Shader::ReadFile(const std::string& path)
 {
     std::string code;
@@ -169,6 +293,14 @@ void Shader::test()
 {
     std::cout << "\nRunning Shader tests...\n";
 
+    // Test define injection
+    const std::string source = "// header\n#version 450 core\nvoid main() {}\n";
+    assert(AddDefines(source, "") == source && "No defines should leave the source unchanged");
+    assert(AddDefines(source, "#define A\n") == "// header\n#version 450 core\n#define A\n#line 3\nvoid main() {}\n" &&
+           "Defines should follow #version and keep line numbers");
+    assert(AddDefines("void main() {}\n", "#define A\n") == "#define A\n#line 1\nvoid main() {}\n" &&
+           "Defines should lead a source without #version");
+
     // Skip shader compilation in test mode
     if (s_testMode)
     {
@@ -183,7 +315,7 @@ void Shader::test()
 
     // Test uniform operations
     shader.Use();
-    GLint location = shader.GetUniformLocation("model");
+    GLint location = shader.GetUniformLocation("texture_diffuse1");
     assert(location != -1 && "Failed to get uniform location");
 
     std::cout << "Shader tests passed!\n";
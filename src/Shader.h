@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
@@ -38,9 +39,46 @@ public:
      * \param vertexPath Path to vertex shader file.
      * \param fragmentPath Path to fragment shader file.
      * \return True if loading succeeded.
+     *
+     * The linked program comes from the ProgramCache when it has a binary for these sources.
      */
     bool LoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath);
 
+    /**
+     * \brief Start loading a shader without waiting for the driver to compile it.
+     *
+     * The current program stays in use until Poll() finds the new one linked; a load
+     * that fails keeps it. Starting another load cancels a pending one.
+     *
+     * \param vertexPath Path to vertex shader file.
+     * \param fragmentPath Path to fragment shader file.
+     * \param defines Preprocessor lines inserted after #version, e.g. "#define ALPHA_TEST\n".
+     * \return True if the sources were read; compile errors are reported by Poll().
+     */
+    bool BeginLoadFromFiles(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines);
+
+    /**
+     * \brief Finish a pending load if the driver is done with it.
+     *
+     * Never waits when IsParallelCompileSupported(); otherwise the first call waits for
+     * the compile.
+     *
+     * \return True if no load is pending any more.
+     */
+    bool Poll();
+
+    /**
+     * \brief Finish a pending load, waiting for the driver.
+     * \return False if the pending load failed.
+     */
+    bool Wait();
+
+    /**
+     * \brief Check whether a load started by BeginLoadFromFiles() is still compiling.
+     * \return True if a load is pending.
+     */
+    bool IsPending() const { return m_pendingProgram != 0; }
+
     /**
      * \brief Activate the shader program.
      */
@@ -81,6 +119,13 @@ public:
      */
     void SetVec3(const std::string& name, const glm::vec3& value) const;
 
+    /**
+     * \brief Set a mat3 uniform.
+     * \param name Uniform name.
+     * \param value Matrix value.
+     */
+    void SetMat3(const std::string& name, const glm::mat3& value) const;
+
     /**
      * \brief Set a mat4 uniform.
      * \param name Uniform name.
@@ -100,6 +145,20 @@ public:
      */
     bool IsValid() const { return m_program != 0; }
 
+    /**
+     * \brief Check whether the driver compiles in the background and reports completion.
+     * \return True if KHR_parallel_shader_compile or ARB_parallel_shader_compile is available.
+     */
+    static bool IsParallelCompileSupported();
+
+    /**
+     * \brief Insert preprocessor lines into a source after its #version line.
+     * \param source Shader source.
+     * \param defines Lines to insert, each ending in a newline.
+     * \return The source with the defines and a #line directive restoring its line numbers.
+     */
+    static std::string AddDefines(const std::string& source, const std::string& defines);
+
     /**
      * \brief Run unit tests for the Shader class.
      */
@@ -119,21 +178,40 @@ public:
 
 private:
     /**
-     * \brief Compile shader.
+     * \brief Start compiling a shader.
      * \param source Shader source code.
      * \param type Type of shader.
+     * \return Shader ID.
+     */
+    GLuint CompileShader(const std::string& source, GLenum type);
+
+    /**
+     * \brief Report a shader's compile errors.
      * \param shader Shader ID.
+     * \param type Type of shader.
      * \return True if compilation succeeded.
      */
-    bool CompileShader(const std::string& source, GLenum type, GLuint& shader);
+    bool CheckCompileStatus(GLuint shader, GLenum type);
 
     /**
-     * \brief Link program.
+     * \brief Start linking a program.
      * \param vertexShader Vertex shader ID.
      * \param fragmentShader Fragment shader ID.
+     * \param retrievable Whether to keep the program binary available for the ProgramCache.
+     * \return Program ID.
+     */
+    GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader, bool retrievable);
+
+    /**
+     * \brief Wait for the pending load, then replace the program with it if it linked.
      * \return True if linking succeeded.
      */
-    bool LinkProgram(GLuint vertexShader, GLuint fragmentShader);
+    bool FinishLoad();
+
+    /**
+     * \brief Delete the objects of the pending load.
+     */
+    void CancelLoad();
 
     /**
      * \brief Read file.
@@ -143,5 +221,9 @@ private:
     std::string ReadFile(const std::string& path);
 
     GLuint m_program;  ///< OpenGL shader program ID
+    GLuint m_pendingProgram;  ///< Program of the load in progress, 0 if none
+    GLuint m_pendingVertexShader;  ///< Vertex shader of the load in progress
+    GLuint m_pendingFragmentShader;  ///< Fragment shader of the load in progress
+    uint64_t m_pendingKey;  ///< ProgramCache key of the load in progress, 0 if not cached
     static bool s_testMode;  ///< Test mode flag
 };
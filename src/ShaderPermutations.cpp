@@ -0,0 +1,439 @@
+#include "ShaderPermutations.h"
+#include "GlApi.h"
+#include "ProgramCache.h"
+#include "HeadlessContext.h"
+#include "Material.h"
+#include "Mesh.h"
+#include <iostream>
+#include <fstream>
+#include <cassert>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+
+namespace {
+
+// Let the driver use as many compiler threads as it likes
+constexpr GLuint MAX_COMPILER_THREADS = 0xFFFFFFFFu;
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool WriteText(const std::filesystem::path& path, const std::string& text)
+{
+    std::ofstream file(path, std::ios::trunc);
+    file << text;
+    return static_cast<bool>(file);
+}
+
+} // namespace
+
+ShaderPermutations::ShaderPermutations(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& features)
+    : m_vertexPath(vertexPath)
+    , m_fragmentPath(fragmentPath)
+    , m_features(features)
+    , m_featureMask(0)
+    , m_alphaTestFeature(0)
+{
+    if (features.size() > MAX_FEATURES)
+        throw std::runtime_error("Too many shader features");
+    for (size_t i = 0; i < features.size(); ++i)
+        m_featureMask |= 1u << i;
+    m_alphaTestFeature = GetFeatureMask("ALPHA_TEST");
+
+    if (Shader::IsParallelCompileSupported())
+        GlApi::MaxShaderCompilerThreads(MAX_COMPILER_THREADS);
+
+    m_fallback = std::make_unique<Shader>(vertexPath, fragmentPath);
+}
+
+void ShaderPermutations::Request(uint32_t features)
+{
+    features &= m_featureMask;
+    if (features == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Start(features);
+}
+
+void ShaderPermutations::Start(uint32_t features)
+{
+    if (m_variants.count(features) != 0)
+        return;
+
+    Variant& variant = m_variants[features];
+    variant.shader = std::make_unique<Shader>();
+    variant.requestTime = std::chrono::steady_clock::now();
+    ++m_stats.requested;
+
+    if (!variant.shader->BeginLoadFromFiles(m_vertexPath, m_fragmentPath, GetDefines(features)))
+    {
+        variant.failed = true;
+        ++m_stats.failed;
+    }
+    else if (variant.shader->IsPending())
+    {
+        m_pending.push_back(features);
+    }
+    else
+    {
+        // Loaded from the ProgramCache
+        Complete(variant);
+    }
+}
+
+const Shader& ShaderPermutations::Get(uint32_t features)
+{
+    features &= m_featureMask;
+    if (features == 0)
+        return *m_fallback;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_variants.find(features);
+    if (it == m_variants.end())
+    {
+        Start(features);
+        it = m_variants.find(features);
+    }
+
+    const Variant& variant = it->second;
+    if (!variant.failed && !variant.shader->IsPending())
+        return *variant.shader;
+
+    ++m_stats.fallbackUses;
+    return *m_fallback;
+}
+
+bool ShaderPermutations::IsReady(uint32_t features) const
+{
+    features &= m_featureMask;
+    if (features == 0)
+        return m_fallback->IsValid();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_variants.find(features);
+    return it != m_variants.end() && !it->second.failed && !it->second.shader->IsPending();
+}
+
+void ShaderPermutations::Poll()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending.empty())
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Polling never waits with parallel compile; without it, finish one variant per frame
+    const bool parallel = Shader::IsParallelCompileSupported();
+    bool mayWait = true;
+    size_t kept = 0;
+    for (uint32_t features : m_pending)
+    {
+        Variant& variant = m_variants.at(features);
+        if (parallel || mayWait)
+        {
+            mayWait = false;
+            if (variant.shader->Poll())
+            {
+                Complete(variant);
+                continue;
+            }
+        }
+        m_pending[kept++] = features;
+    }
+    m_pending.resize(kept);
+
+    m_stats.pollMs += MillisecondsSince(start);
+}
+
+void ShaderPermutations::WaitAll()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (uint32_t features : m_pending)
+    {
+        Variant& variant = m_variants.at(features);
+        variant.shader->Wait();
+        Complete(variant);
+    }
+    m_pending.clear();
+}
+
+void ShaderPermutations::Complete(Variant& variant)
+{
+    if (variant.shader->IsValid())
+    {
+        ++m_stats.ready;
+        m_stats.compileMs += MillisecondsSince(variant.requestTime);
+    }
+    else
+    {
+        variant.failed = true;
+        ++m_stats.failed;
+    }
+}
+
+ShaderPermutationStats ShaderPermutations::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+uint32_t ShaderPermutations::GetFeatureMask(const std::string& name) const
+{
+    auto it = std::find(m_features.begin(), m_features.end(), name);
+    return it != m_features.end() ? 1u << (it - m_features.begin()) : 0;
+}
+
+uint32_t ShaderPermutations::GetMaterialFeatures(const MaterialParameters& parameters) const
+{
+    return parameters.alphaTest ? m_alphaTestFeature : 0;
+}
+
+void ShaderPermutations::UseForMaterial(const MaterialParameters& parameters)
+{
+    if (t_current == nullptr)
+        return;
+
+    uint32_t features = t_current->GetMaterialFeatures(parameters);
+    if (t_inUse && t_inUseFeatures == features)
+        return;
+
+    // Variants only become ready in Poll() or WaitAll(), so a pending one keeps the
+    // fallback until the next scope
+    t_current->Get(features).Use();
+    t_inUse = true;
+    t_inUseFeatures = features;
+}
+
+std::string ShaderPermutations::GetDefines(uint32_t features) const
+{
+    std::string defines;
+    for (size_t i = 0; i < m_features.size(); ++i)
+    {
+        if (features & (1u << i))
+            defines += "#define " + m_features[i] + "\n";
+    }
+    return defines;
+}
+
+void ShaderPermutations::test()
+{
+    std::cout << "[ShaderPermutations] Running tests...\n";
+
+    // Compiles must reach the driver, not the binary cache
+    ProgramCache& cache = ProgramCache::Get();
+    std::filesystem::path previousDirectory = cache.GetDirectory();
+    cache.SetDirectory("");
+
+    // Test feature masks and defines
+    {
+        ShaderPermutations permutations("shaders/basic.vert", "shaders/basic.frag", { "ALPHA_TEST", "SKINNED" });
+        uint32_t alphaTest = permutations.GetFeatureMask("ALPHA_TEST");
+        uint32_t skinned = permutations.GetFeatureMask("SKINNED");
+        assert(alphaTest == 1u && skinned == 2u && "Features should map to bits in order");
+        assert(permutations.GetFeatureMask("INSTANCED") == 0 && "Unknown features should have no bit");
+        assert(permutations.GetDefines(alphaTest | skinned) == "#define ALPHA_TEST\n#define SKINNED\n" && "Defines wrong");
+        assert(permutations.GetDefines(0).empty() && "The fallback should have no defines");
+
+        assert(&permutations.Get(0) == &permutations.GetFallback() && "Mask 0 should be the fallback");
+        assert(&permutations.Get(4u) == &permutations.GetFallback() && "Bits without a feature should be ignored");
+        assert(permutations.GetStats().requested == 0 && "Nothing should have been requested");
+
+        permutations.Request(alphaTest);
+        permutations.Request(alphaTest);
+        permutations.Get(alphaTest | 4u);
+        assert(permutations.GetStats().requested == 1 && "A variant should be requested once");
+        permutations.WaitAll();
+        ShaderPermutationStats stats = permutations.GetStats();
+        assert(stats.ready + stats.failed == 1 && "WaitAll should finish every variant");
+    }
+
+    // Test compiling real variants if a context can be created
+    try
+    {
+        HeadlessContext context(16, 16);
+
+        std::filesystem::path directory = std::filesystem::temp_directory_path() / "snapengine_permutations_test";
+        std::filesystem::create_directories(directory);
+        std::filesystem::path vertexPath = directory / "variant.vert";
+        std::filesystem::path fragmentPath = directory / "variant.frag";
+        bool written = WriteText(vertexPath,
+            "#version 450 core\n"
+            "layout (location = 0) in vec3 aPos;\n"
+            "#ifdef BROKEN\n"
+            "this does not compile\n"
+            "#endif\n"
+            "void main() { gl_Position = vec4(aPos, 1.0); }\n");
+        written = WriteText(fragmentPath,
+            "#version 450 core\n"
+            "out vec4 FragColor;\n"
+            "uniform vec4 tint;\n"
+            "void main()\n"
+            "{\n"
+            "#ifdef TINTED\n"
+            "    FragColor = tint;\n"
+            "#else\n"
+            "    FragColor = vec4(1.0);\n"
+            "#endif\n"
+            "}\n") && written;
+        assert(written && "Failed to write test shaders");
+
+        ShaderPermutations permutations(vertexPath.string(), fragmentPath.string(), { "TINTED", "BROKEN" });
+        const uint32_t tinted = permutations.GetFeatureMask("TINTED");
+        const uint32_t broken = permutations.GetFeatureMask("BROKEN");
+        const Shader& fallback = permutations.GetFallback();
+        assert(fallback.IsValid() && fallback.GetUniformLocation("tint") == -1 && "Fallback should compile without TINTED");
+
+        // The first Get() answers at once, with the variant only if the driver was already done
+        const Shader& first = permutations.Get(tinted);
+        assert((&first == &fallback) != permutations.IsReady(tinted) && "Get should return the fallback until ready");
+        while (!permutations.IsReady(tinted))
+            permutations.Poll();
+        const Shader& variant = permutations.Get(tinted);
+        assert(&variant != &fallback && variant.GetUniformLocation("tint") != -1 && "Variant should be compiled with its define");
+
+        // A variant that does not compile falls back for good
+        std::cout << "[ShaderPermutations] Expecting a compilation error:\n";
+        permutations.Request(tinted | broken);
+        permutations.WaitAll();
+        assert(!permutations.IsReady(tinted | broken) && &permutations.Get(tinted | broken) == &fallback && "Broken variant should fall back");
+
+        ShaderPermutationStats stats = permutations.GetStats();
+        assert(stats.requested == 2 && stats.ready == 1 && stats.failed == 1 && "Variant counters wrong");
+        assert(glGetError() == GL_NO_ERROR && "GL error in permutation test");
+        std::cout << "[ShaderPermutations] Parallel compile " << (Shader::IsParallelCompileSupported() ? "supported" : "not supported")
+                  << ", variant ready after " << stats.compileMs << " ms\n";
+
+        std::error_code error;
+        std::filesystem::remove_all(directory, error);
+
+        // Meshes pick the variant of their material, switching programs only when it changes
+        ShaderPermutations scene("shaders/basic.vert", "shaders/basic.frag", { "ALPHA_TEST" });
+        const uint32_t alphaTest = scene.GetFeatureMask("ALPHA_TEST");
+        MaterialParameters alphaTested;
+        alphaTested.alphaTest = true;
+        assert(scene.GetMaterialFeatures(alphaTested) == alphaTest && scene.GetMaterialFeatures(MaterialParameters()) == 0 &&
+               "Alpha-tested materials should need the ALPHA_TEST variant");
+        assert(permutations.GetMaterialFeatures(alphaTested) == 0 && "A set without ALPHA_TEST should use its fallback");
+
+        Mesh opaqueMesh({ Vertex(), Vertex(), Vertex() }, { 0, 1, 2 }, std::make_shared<Material>(std::vector<Texture>(), MaterialParameters()));
+        Mesh cutoutMesh({ Vertex(), Vertex(), Vertex() }, { 0, 1, 2 }, std::make_shared<Material>(std::vector<Texture>(), alphaTested));
+        auto currentProgram = []()
+        {
+            GLint program = 0;
+            glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+            return static_cast<GLuint>(program);
+        };
+        {
+            ShaderPermutations::Scope scope(&scene);
+            assert(ShaderPermutations::GetCurrent() == &scene && "Scope should install the set");
+            cutoutMesh.Draw();
+            assert(scene.GetStats().requested == 1 && "Drawing an alpha-tested mesh should request its variant");
+        }
+        assert(ShaderPermutations::GetCurrent() == nullptr && "Leaving the scope should uninstall the set");
+        scene.WaitAll();
+        assert(scene.IsReady(alphaTest) && "ALPHA_TEST variant should compile");
+
+        GlApi::BeginFrame();
+        opaqueMesh.Draw();
+        const uint64_t drawStateChanges = GlApi::GetCurrentStats().stateChanges;
+        {
+            ShaderPermutations::Scope scope(&scene);
+            GlApi::BeginFrame();
+            cutoutMesh.Draw();
+            assert(currentProgram() == scene.Get(alphaTest).GetProgram() && currentProgram() != scene.GetFallback().GetProgram() &&
+                   "An alpha-tested material should draw with the ALPHA_TEST program");
+            cutoutMesh.Draw();
+            opaqueMesh.Draw();
+            assert(currentProgram() == scene.GetFallback().GetProgram() && "An opaque material should draw with the fallback");
+            opaqueMesh.Draw();
+            assert(GlApi::GetCurrentStats().stateChanges == 4 * drawStateChanges + 2 && "Programs should only be bound when the variant changes");
+            GlApi::BeginFrame();
+        }
+
+        // Without a scope, meshes leave the program alone
+        scene.Get(alphaTest).Use();
+        opaqueMesh.Draw();
+        assert(currentProgram() == scene.Get(alphaTest).GetProgram() && "Draws without a scope should not change the program");
+        assert(glGetError() == GL_NO_ERROR && "GL error in material variant test");
+    }
+    catch (const std::runtime_error&)
+    {
+        std::cout << "[ShaderPermutations] Failed to create headless GL context, skipping GL tests\n";
+    }
+
+    cache.SetDirectory(previousDirectory);
+
+    std::cout << "[ShaderPermutations] Tests passed!\n";
+}
+
+void ShaderPermutations::benchmark()
+{
+    std::cout << "\nRunning ShaderPermutations benchmarks...\n";
+
+    ProgramCache& cache = ProgramCache::Get();
+    std::filesystem::path previousDirectory = cache.GetDirectory();
+    cache.SetDirectory("");
+
+    try
+    {
+        HeadlessContext context(16, 16);
+
+        // The basic shaders ignore these defines, but each variant is still a distinct compile
+        auto features = [](const std::string& prefix)
+        {
+            return std::vector<std::string>{ "ALPHA_TEST", prefix + "_1", prefix + "_2", prefix + "_3" };
+        };
+        const uint32_t variantCount = 15;
+
+        // One variant after another, as a frame that needs them all would compile them
+        ShaderPermutations serial("shaders/basic.vert", "shaders/basic.frag", features("SERIAL"));
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t mask = 1; mask <= variantCount; ++mask)
+        {
+            Shader shader;
+            shader.BeginLoadFromFiles("shaders/basic.vert", "shaders/basic.frag", serial.GetDefines(mask));
+            shader.Wait();
+        }
+        double serialMs = MillisecondsSince(start);
+
+        // Draw with every variant each frame, using whatever is ready; the first frame requests them
+        ShaderPermutations parallel("shaders/basic.vert", "shaders/basic.frag", features("PARALLEL"));
+        start = std::chrono::steady_clock::now();
+        double firstFrameMs = 0.0;
+        double worstFrameMs = 0.0;
+        int frames = 0;
+        for (bool pending = true; pending; ++frames)
+        {
+            auto frameStart = std::chrono::steady_clock::now();
+            parallel.Poll();
+            pending = false;
+            for (uint32_t mask = 1; mask <= variantCount; ++mask)
+            {
+                parallel.Get(mask).Use();
+                pending = pending || !parallel.IsReady(mask);
+            }
+            if (frames == 0)
+                firstFrameMs = MillisecondsSince(frameStart);
+            else
+                worstFrameMs = std::max(worstFrameMs, MillisecondsSince(frameStart));
+        }
+        double parallelMs = MillisecondsSince(start);
+
+        ShaderPermutationStats stats = parallel.GetStats();
+        std::cout << "  " << variantCount << " variants: serial " << serialMs << " ms, requested together " << parallelMs
+                  << " ms over " << frames << " frames (parallel compile "
+                  << (Shader::IsParallelCompileSupported() ? "on" : "off") << ")\n";
+        std::cout << "  Requesting frame " << firstFrameMs << " ms, longest later frame " << worstFrameMs << " ms, " << stats.fallbackUses << " fallback draws, "
+                  << stats.pollMs << " ms polling\n";
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << "  Skipping: " << e.what() << "\n";
+    }
+
+    cache.SetDirectory(previousDirectory);
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include "Shader.h"
+
+struct MaterialParameters;
+
+/**
+ * \struct ShaderPermutationStats
+ * \brief Counters of a ShaderPermutations set.
+ */
+struct ShaderPermutationStats
+{
+    size_t requested = 0;       ///< Variants requested, the fallback excluded
+    size_t ready = 0;           ///< Requested variants that linked
+    size_t failed = 0;          ///< Requested variants that failed to compile or link
+    uint64_t fallbackUses = 0;  ///< Get() calls answered with the fallback while a variant was not ready
+    double compileMs = 0.0;     ///< Summed time from request to ready of the linked variants
+    double pollMs = 0.0;        ///< Time spent in Poll()
+};
+
+/**
+ * \class ShaderPermutations
+ * \brief Variants of one vertex/fragment shader pair, selected by preprocessor features.
+ *
+ * Each feature is a define name, e.g. "ALPHA_TEST"; a variant is identified by a bit mask
+ * over the features and compiled with "#define <name>" for every bit set. Variants are
+ * compiled on first use by Get(), or ahead of time by Request(), and never block a frame:
+ * until a variant has linked Get() returns the fallback, the variant without features,
+ * which the constructor compiles up front.
+ *
+ * With KHR_parallel_shader_compile the driver compiles requested variants concurrently on
+ * its own threads and Poll() only checks for completion. Without it Poll() finishes at
+ * most one variant per call, which bounds the stall to a single compile.
+ *
+ * Calls may come from any thread whose current context shares objects with the one that
+ * created the set, e.g. the render threads of several windows; they are serialized.
+ *
+ * While a Scope is installed, Mesh::Draw() uses the variant its material needs for the
+ * colour pass, switching programs only when the variant changes between draws.
+ */
+class ShaderPermutations
+{
+public:
+    static constexpr size_t MAX_FEATURES = 32; ///< Bits in a feature mask
+
+    /**
+     * \class Scope
+     * \brief Makes a set the calling thread's current one for its lifetime.
+     *
+     * The program in use is only tracked by the scope, so nothing else may change it
+     * while the scope is installed.
+     */
+    class Scope
+    {
+    public:
+        /**
+         * \brief Constructor.
+         * \param permutations The set; nullptr to leave the program to the caller.
+         */
+        explicit Scope(ShaderPermutations* permutations) : m_previous(t_current)
+        {
+            t_current = permutations;
+            t_inUse = false;
+        }
+
+        /**
+         * \brief Destructor. Restores the previous set; its next draw binds its program again.
+         */
+        ~Scope()
+        {
+            t_current = m_previous;
+            t_inUse = false;
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        ShaderPermutations* m_previous; ///< Set current before this scope
+    };
+
+    /**
+     * \brief Constructor. Compiles the fallback variant, waiting for it.
+     * \param vertexPath Path to vertex shader file.
+     * \param fragmentPath Path to fragment shader file.
+     * \param features Define names; feature i is bit i of a mask. At most MAX_FEATURES.
+     */
+    ShaderPermutations(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& features);
+
+    /**
+     * \brief Start compiling a variant if it is not known yet.
+     * \param features Feature mask; bits without a feature are ignored.
+     */
+    void Request(uint32_t features);
+
+    /**
+     * \brief Get a variant, or the fallback while it is compiling.
+     *
+     * Requests the variant if needed. A variant that failed to compile is answered with
+     * the fallback for good.
+     *
+     * \param features Feature mask.
+     * \return The shader to draw with.
+     */
+    const Shader& Get(uint32_t features);
+
+    /**
+     * \brief Check whether a variant has linked.
+     * \param features Feature mask.
+     * \return True if Get() returns the variant itself.
+     */
+    bool IsReady(uint32_t features) const;
+
+    /**
+     * \brief Collect variants the driver has finished; call once per frame.
+     */
+    void Poll();
+
+    /**
+     * \brief Wait for every requested variant, e.g. behind a loading screen.
+     */
+    void WaitAll();
+
+    /**
+     * \brief Get the fallback variant.
+     * \return The shader without features.
+     */
+    const Shader& GetFallback() const { return *m_fallback; }
+
+    /**
+     * \brief Get the bit of a feature.
+     * \param name Define name.
+     * \return Mask with the feature's bit set; 0 if the set has no such feature.
+     */
+    uint32_t GetFeatureMask(const std::string& name) const;
+
+    /**
+     * \brief Get the variant a material needs.
+     * \param parameters Shading parameters of the material.
+     * \return Feature mask, e.g. ALPHA_TEST for alpha-tested materials if the set has that feature.
+     */
+    uint32_t GetMaterialFeatures(const MaterialParameters& parameters) const;
+
+    /**
+     * \brief Use the variant a material needs with the calling thread's current set.
+     *
+     * Does nothing without a current set, or if the variant is already in use.
+     *
+     * \param parameters Shading parameters of the material.
+     */
+    static void UseForMaterial(const MaterialParameters& parameters);
+
+    /**
+     * \brief Get the calling thread's current set.
+     * \return The set installed by the innermost Scope, or nullptr.
+     */
+    static ShaderPermutations* GetCurrent() { return t_current; }
+
+    /**
+     * \brief Get the preprocessor lines of a variant.
+     * \param features Feature mask.
+     * \return One "#define <name>" line per feature, in feature order.
+     */
+    std::string GetDefines(uint32_t features) const;
+
+    /**
+     * \brief Get the counters.
+     * \return A copy of the counters.
+     */
+    ShaderPermutationStats GetStats() const;
+
+    /**
+     * \brief Run unit tests for the ShaderPermutations class.
+     */
+    static void test();
+
+    /**
+     * \brief Measure compiling variants in parallel against one after another, and the longest frame stall.
+     */
+    static void benchmark();
+
+private:
+    /**
+     * \struct Variant
+     * \brief A requested variant.
+     */
+    struct Variant
+    {
+        std::unique_ptr<Shader> shader;                         ///< Shader, pending until linked
+        bool failed = false;                                    ///< Compile or link failed
+        std::chrono::steady_clock::time_point requestTime;      ///< When the compile started
+    };
+
+    /**
+     * \brief Start compiling a variant if it is not known yet. Requires m_mutex.
+     * \param features Feature mask, within m_featureMask.
+     */
+    void Start(uint32_t features);
+
+    /**
+     * \brief Record that a variant stopped pending.
+     * \param variant The variant.
+     */
+    void Complete(Variant& variant);
+
+    std::string m_vertexPath;                           ///< Vertex shader file
+    std::string m_fragmentPath;                         ///< Fragment shader file
+    std::vector<std::string> m_features;                ///< Define names by bit
+    uint32_t m_featureMask;                             ///< Bits that have a feature
+    uint32_t m_alphaTestFeature;                        ///< Bit of ALPHA_TEST, 0 if the set has no such feature
+    std::unique_ptr<Shader> m_fallback;                 ///< Variant without features
+    std::unordered_map<uint32_t, Variant> m_variants;   ///< Requested variants by mask
+    std::vector<uint32_t> m_pending;                    ///< Masks of variants still compiling, in request order
+    ShaderPermutationStats m_stats;                     ///< Counters
+    mutable std::mutex m_mutex;                         ///< Guards the variants, pending list and counters
+
+    static inline thread_local ShaderPermutations* t_current = nullptr;    ///< Calling thread's current set
+    static inline thread_local bool t_inUse = false;                        ///< A variant of t_current is in use
+    static inline thread_local uint32_t t_inUseFeatures = 0;                ///< Feature mask of that variant
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+/**
+ * \file Simd.h
+ * \brief Compile-time detection of the SIMD instruction sets used by CPU-side kernels.
+ *
+ * SNAPENGINE_SSE is defined when SSE2 (and therefore 4-wide float intrinsics) is available,
+ * SNAPENGINE_AVX when 8-wide AVX intrinsics are. Kernels must always keep a scalar fallback.
+ */
+
+#if defined(__AVX__) || defined(__AVX2__)
+    #define SNAPENGINE_AVX 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SNAPENGINE_SSE 1
+#endif
+
+#if defined(SNAPENGINE_SSE) || defined(SNAPENGINE_AVX)
+    #include <immintrin.h>
+#endif
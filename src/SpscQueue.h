@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * \class SpscQueue
+ * \brief Bounded lock-free queue between exactly one producer and one consumer thread.
+ *
+ * Head and tail are free-running counters on separate cache lines; each side only
+ * writes its own counter, so TryPush() and TryPop() are wait-free. Push() and Pop()
+ * sleep on the other side's counter with C++20 atomic wait/notify instead of spinning.
+ *
+ * \tparam T Element type, moved in and out.
+ * \tparam Capacity Maximum number of queued elements; must be a power of two.
+ */
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    /**
+     * \brief Append an element. Producer thread only.
+     * \param value The element.
+     * \return False if the queue is full.
+     */
+    bool TryPush(T value)
+    {
+        const uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+            return false;
+
+        m_items[tail & (Capacity - 1)] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        m_tail.notify_one();
+        return true;
+    }
+
+    /**
+     * \brief Append an element, waiting while the queue is full. Producer thread only.
+     * \param value The element.
+     */
+    void Push(T value)
+    {
+        for (;;)
+        {
+            const uint64_t head = m_head.load(std::memory_order_acquire);
+            if (m_tail.load(std::memory_order_relaxed) - head < Capacity)
+                break;
+            m_head.wait(head, std::memory_order_acquire);
+        }
+        TryPush(std::move(value));
+    }
+
+    /**
+     * \brief Remove the oldest element. Consumer thread only.
+     * \param value Receives the element.
+     * \return False if the queue is empty.
+     */
+    bool TryPop(T& value)
+    {
+        const uint64_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+
+        value = std::move(m_items[head & (Capacity - 1)]);
+        m_head.store(head + 1, std::memory_order_release);
+        m_head.notify_one();
+        return true;
+    }
+
+    /**
+     * \brief Remove the oldest element, waiting while the queue is empty. Consumer thread only.
+     * \param value Receives the element.
+     */
+    void Pop(T& value)
+    {
+        for (;;)
+        {
+            const uint64_t tail = m_tail.load(std::memory_order_acquire);
+            if (tail != m_head.load(std::memory_order_relaxed))
+                break;
+            m_tail.wait(tail, std::memory_order_acquire);
+        }
+        TryPop(value);
+    }
+
+    /**
+     * \brief Get the number of queued elements. Exact only on the producer or consumer thread.
+     * \return Element count.
+     */
+    size_t GetSize() const
+    {
+        return static_cast<size_t>(m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire));
+    }
+
+private:
+    T m_items[Capacity];                            ///< Ring storage
+    alignas(64) std::atomic<uint64_t> m_head{ 0 };  ///< Next element to pop, written by the consumer
+    alignas(64) std::atomic<uint64_t> m_tail{ 0 };  ///< Next free element, written by the producer
+};
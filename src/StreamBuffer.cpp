@@ -0,0 +1,421 @@
+#include "StreamBuffer.h"
+#include "GlApi.h"
+#include "HeadlessContext.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <glm/glm.hpp>
+
+// Initialize static members
+bool StreamBuffer::s_testMode = false;
+
+namespace {
+
+// Smallest offset alignment handed out, enough for std140 vec4 members
+constexpr size_t MIN_ALIGNMENT = 16;
+
+// Alignment assumed for uniform and storage buffers in test mode, the usual desktop value
+constexpr size_t TEST_MODE_ALIGNMENT = 256;
+
+// Timeout of one glClientWaitSync call while waiting for a region
+constexpr GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+size_t RoundUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+size_t RoundUpToPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+} // namespace
+
+StreamBuffer::StreamBuffer(GLenum target, size_t frameSize, unsigned framesInFlight)
+    : m_alignment(MIN_ALIGNMENT)
+    , m_regionSize(0)
+    , m_framesInFlight(framesInFlight > 0 ? framesInFlight : 1)
+    , m_buffer(0)
+    , m_mapped(nullptr)
+    , m_fences(m_framesInFlight, nullptr)
+    , m_region(m_framesInFlight - 1)
+    , m_head(0)
+    , m_inFrame(false)
+{
+    GLenum alignmentQuery = 0;
+    if (target == GL_UNIFORM_BUFFER)
+        alignmentQuery = GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT;
+    else if (target == GL_SHADER_STORAGE_BUFFER)
+        alignmentQuery = GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT;
+
+    if (alignmentQuery != 0)
+    {
+        GLint alignment = static_cast<GLint>(TEST_MODE_ALIGNMENT);
+        if (!s_testMode)
+            GlApi::GetIntegerv(alignmentQuery, &alignment);
+        m_alignment = std::max(m_alignment, RoundUpToPowerOfTwo(static_cast<size_t>(std::max(alignment, 1))));
+    }
+
+    if (!s_testMode && !GLEW_VERSION_4_5 && !(GLEW_ARB_direct_state_access && GLEW_ARB_buffer_storage))
+        throw std::runtime_error("StreamBuffer requires OpenGL 4.5 or ARB_direct_state_access and ARB_buffer_storage");
+
+    m_regionSize = GetAlignedSize(std::max<size_t>(frameSize, 1));
+    Create();
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    Destroy();
+}
+
+void StreamBuffer::Create()
+{
+    size_t size = m_regionSize * m_framesInFlight;
+    m_stats.regionSize = m_regionSize;
+    if (s_testMode)
+    {
+        m_testStorage.assign(size, 0);
+        m_mapped = m_testStorage.data();
+        return;
+    }
+
+    // Immutable storage mapped once for the lifetime of the buffer
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GlApi::CreateBuffers(1, &m_buffer);
+    GlApi::NamedBufferStorage(m_buffer, static_cast<GLsizeiptr>(size), nullptr, flags);
+    m_mapped = static_cast<uint8_t*>(GlApi::MapNamedBufferRange(m_buffer, 0, static_cast<GLsizeiptr>(size), flags));
+    if (m_mapped == nullptr)
+    {
+        GlApi::DeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+        throw std::runtime_error("Failed to map stream buffer");
+    }
+}
+
+void StreamBuffer::Destroy()
+{
+    for (unsigned region = 0; region < m_framesInFlight; ++region)
+        WaitForRegion(region);
+
+    if (m_buffer != 0)
+    {
+        GlApi::UnmapNamedBuffer(m_buffer);
+        GlApi::DeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+    }
+    m_mapped = nullptr;
+    m_testStorage.clear();
+}
+
+bool StreamBuffer::WaitForRegion(unsigned region)
+{
+    GLsync fence = m_fences[region];
+    if (fence == nullptr)
+        return false;
+
+    // Poll first; only a fence that has not signalled yet counts as a wait
+    GLenum status = GlApi::ClientWaitSync(fence, 0, 0);
+    bool waited = status == GL_TIMEOUT_EXPIRED;
+    while (status == GL_TIMEOUT_EXPIRED)
+        status = GlApi::ClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+    if (status == GL_WAIT_FAILED)
+        std::cerr << "Waiting for a stream buffer fence failed" << std::endl;
+
+    GlApi::DeleteSync(fence);
+    m_fences[region] = nullptr;
+    return waited;
+}
+
+void StreamBuffer::Reserve(size_t frameSize)
+{
+    assert(!m_inFrame && "Reserve must not be called inside a frame");
+    size_t regionSize = GetAlignedSize(frameSize);
+    if (regionSize <= m_regionSize)
+        return;
+
+    // Grow by at least half so a slowly growing scene does not recreate every frame
+    Destroy();
+    m_regionSize = std::max(regionSize, GetAlignedSize(m_regionSize + m_regionSize / 2));
+    ++m_stats.reallocations;
+    Create();
+}
+
+void StreamBuffer::BeginFrame()
+{
+    assert(!m_inFrame && "BeginFrame called twice");
+    m_region = (m_region + 1) % m_framesInFlight;
+    m_head = 0;
+    m_inFrame = true;
+
+    using Clock = std::chrono::high_resolution_clock;
+    auto start = Clock::now();
+    if (WaitForRegion(m_region))
+    {
+        ++m_stats.fenceWaits;
+        m_stats.fenceWaitMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+}
+
+StreamAllocation StreamBuffer::Allocate(size_t size, size_t alignment)
+{
+    assert(m_inFrame && "Allocate called outside a frame");
+    assert((alignment & (alignment - 1)) == 0 && "Alignment must be a power of two");
+
+    size_t offset = RoundUp(m_head, std::max(alignment, m_alignment));
+    if (size == 0 || offset + size > m_regionSize)
+    {
+        ++m_stats.failedAllocations;
+        return StreamAllocation();
+    }
+
+    size_t start = m_region * m_regionSize + offset;
+    m_stats.bytesAllocated += offset + size - m_head;
+    ++m_stats.allocations;
+    m_head = offset + size;
+
+    StreamAllocation allocation;
+    allocation.pointer = m_mapped + start;
+    allocation.offset = static_cast<GLintptr>(start);
+    allocation.size = static_cast<GLsizeiptr>(size);
+    return allocation;
+}
+
+void StreamBuffer::Commit(const StreamAllocation& allocation)
+{
+    if (allocation)
+        GlApi::NoteMappedWrite(m_buffer, allocation.offset, allocation.size, allocation.pointer);
+}
+
+void StreamBuffer::EndFrame()
+{
+    assert(m_inFrame && "EndFrame without BeginFrame");
+    m_inFrame = false;
+
+    // Unused regions need no fence
+    if (m_head > 0)
+        m_fences[m_region] = GlApi::FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_stats.frameBytes = m_head;
+    m_stats.peakFrameBytes = std::max(m_stats.peakFrameBytes, m_head);
+    ++m_stats.frames;
+}
+
+std::string StreamBuffer::FormatStats(const StreamBufferStats& stats)
+{
+    std::ostringstream line;
+    line << stats.frameBytes << "/" << stats.regionSize << " bytes per frame (" << static_cast<int>(stats.GetOccupancy() * 100.0 + 0.5)
+         << "% occupancy, peak " << stats.peakFrameBytes << "), " << stats.allocations << " allocations ("
+         << stats.failedAllocations << " failed), " << stats.fenceWaits << " fence waits (" << stats.fenceWaitMs << " ms), "
+         << stats.reallocations << " reallocations";
+    return line.str();
+}
+
+void StreamBuffer::test()
+{
+    std::cout << "[StreamBuffer] Running tests...\n";
+
+    bool testMode = s_testMode;
+    SetTestMode(true);
+
+    // Test alignment and sub-allocation
+    {
+        StreamBuffer ring(GL_UNIFORM_BUFFER, 1000, 2);
+        assert(ring.GetAlignment() == TEST_MODE_ALIGNMENT && "Uniform buffers should use the offset alignment");
+        assert(ring.GetStats().regionSize == 1024 && "Region should be rounded up to the alignment");
+
+        ring.BeginFrame();
+        StreamAllocation a = ring.Allocate(100);
+        StreamAllocation b = ring.Allocate(100);
+        assert(a && b && "Allocations should succeed");
+        assert(a.offset == 0 && b.offset == 256 && "Offsets should be aligned");
+        assert(static_cast<uint8_t*>(b.pointer) - static_cast<uint8_t*>(a.pointer) == 256 && "Pointers should match offsets");
+        std::memset(a.pointer, 0xAB, static_cast<size_t>(a.size));
+        ring.Commit(a);
+
+        StreamAllocation c = ring.Allocate(600);
+        assert(!c && "An allocation past the region should fail");
+        StreamAllocation d = ring.Allocate(512);
+        assert(d && d.offset == 512 && "Exactly filling the region should succeed");
+        StreamAllocation full = ring.Allocate(1);
+        assert(!full && "A full region should fail");
+        ring.EndFrame();
+
+        const StreamBufferStats& stats = ring.GetStats();
+        assert(stats.allocations == 3 && stats.failedAllocations == 2 && "Allocation counters wrong");
+        assert(stats.frameBytes == 1024 && stats.GetOccupancy() == 1.0 && "Occupancy should count padding");
+
+        // The next frame uses the other region, then the ring wraps around
+        ring.BeginFrame();
+        StreamAllocation e = ring.Allocate(16);
+        assert(e.offset == 1024 && "Second frame should use the second region");
+        ring.EndFrame();
+        ring.BeginFrame();
+        StreamAllocation f = ring.Allocate(16);
+        assert(f.offset == 0 && f.pointer == a.pointer && "Third frame should reuse the first region");
+        assert(static_cast<uint8_t*>(f.pointer)[0] == 0xAB && "Region memory should persist");
+        ring.EndFrame();
+        assert(ring.GetStats().frames == 3 && ring.GetStats().peakFrameBytes == 1024 && "Frame counters wrong");
+        assert(ring.GetStats().frameBytes == 16 && "Frame bytes should be those of the last frame");
+    }
+
+    // Test explicit alignment, other targets and growth
+    {
+        StreamBuffer ring(GL_ARRAY_BUFFER, 64);
+        assert(ring.GetAlignment() == MIN_ALIGNMENT && "Vertex data should use the minimum alignment");
+        ring.BeginFrame();
+        ring.Allocate(4);
+        StreamAllocation aligned = ring.Allocate(4, 32);
+        assert(aligned.offset == 32 && "Explicit alignment should apply");
+        ring.EndFrame();
+
+        ring.Reserve(32);
+        assert(ring.GetStats().reallocations == 0 && "Reserving less should not reallocate");
+        ring.Reserve(1000);
+        assert(ring.GetStats().reallocations == 1 && ring.GetStats().regionSize >= 1000 && "Reserving more should grow the region");
+        ring.BeginFrame();
+        StreamAllocation grown = ring.Allocate(1000);
+        assert(grown && "Grown region should fit the allocation");
+        ring.EndFrame();
+    }
+
+    // Test that commits are counted as uploads
+    {
+        bool glTestMode = GlApi::IsTestMode();
+        GlApi::SetTestMode(true);
+        GlApi::EndFrame();
+        StreamBuffer ring(GL_UNIFORM_BUFFER, 512);
+        ring.BeginFrame();
+        ring.Commit(ring.Allocate(112));
+        ring.Commit(StreamAllocation());
+        ring.EndFrame();
+        assert(GlApi::GetCurrentStats().bytesUploaded == 112 && "Commit should count the written bytes");
+        GlApi::EndFrame();
+        GlApi::SetTestMode(glTestMode);
+    }
+
+    SetTestMode(false);
+
+    // Test the real buffer if a context can be created
+    try
+    {
+        HeadlessContext context(16, 16);
+        StreamBuffer ring(GL_UNIFORM_BUFFER, 4096);
+        GLint alignment = 0;
+        GlApi::GetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        assert(ring.GetBuffer() != 0 && ring.GetAlignment() >= static_cast<size_t>(alignment) && "Buffer should be created");
+
+        for (int frame = 0; frame < 10; ++frame)
+        {
+            ring.BeginFrame();
+            for (int i = 0; i < 8; ++i)
+            {
+                StreamAllocation allocation = ring.Allocate(sizeof(glm::mat4));
+                assert(allocation && "Allocation should succeed");
+                glm::mat4 value(static_cast<float>(frame * 8 + i));
+                std::memcpy(allocation.pointer, &value, sizeof(value));
+                ring.Commit(allocation);
+                GlApi::BindBufferRange(GL_UNIFORM_BUFFER, 0, ring.GetBuffer(), allocation.offset, allocation.size);
+            }
+            ring.EndFrame();
+        }
+
+        // The GPU sees what was written through the mapping
+        GlApi::Finish();
+        StreamBufferStats stats = ring.GetStats();
+        assert(stats.frames == 10 && stats.allocations == 80 && stats.failedAllocations == 0 && "Counters wrong");
+        // The last frame used region 9 % 3, and its last allocation holds 79
+        GLintptr offset = static_cast<GLintptr>((9 % DEFAULT_FRAMES_IN_FLIGHT) * stats.regionSize + 7 * ring.GetAlignedSize(sizeof(glm::mat4)));
+        float value = 0.0f;
+        glGetNamedBufferSubData(ring.GetBuffer(), offset, sizeof(float), &value);
+        assert(value == 79.0f && "Mapped writes should reach the buffer");
+        assert(glGetError() == GL_NO_ERROR && "GL error in stream buffer test");
+        std::cout << "[StreamBuffer] " << FormatStats(stats) << "\n";
+    }
+    catch (const std::runtime_error&)
+    {
+        std::cout << "[StreamBuffer] Failed to create headless GL context, skipping GL tests\n";
+    }
+
+    SetTestMode(testMode);
+
+    std::cout << "[StreamBuffer] Tests passed!\n";
+}
+
+void StreamBuffer::benchmark()
+{
+    std::cout << "\nRunning StreamBuffer benchmarks...\n";
+
+    try
+    {
+        HeadlessContext context(16, 16);
+
+        // Per-object constants as the scene shader reads them: a mat4 and a std140 mat3
+        struct Constants
+        {
+            glm::mat4 model;
+            glm::vec4 normalMatrix[3];
+        };
+        const int objects = 10000;
+        const int frames = 20;
+        Constants constants{};
+
+        using BenchClock = std::chrono::high_resolution_clock;
+        auto time = [&](auto&& frame)
+        {
+            frame();
+            GlApi::Finish();
+            auto start = BenchClock::now();
+            for (int i = 0; i < frames; ++i)
+                frame();
+            GlApi::Finish();
+            return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count() / frames;
+        };
+
+        // One uniform buffer updated with glNamedBufferSubData before each object
+        GLuint buffer = 0;
+        GlApi::CreateBuffers(1, &buffer);
+        GlApi::NamedBufferStorage(buffer, sizeof(Constants), nullptr, GL_DYNAMIC_STORAGE_BIT);
+        double subDataMs = time([&]()
+        {
+            for (int i = 0; i < objects; ++i)
+            {
+                constants.model[3][0] = static_cast<float>(i);
+                GlApi::NamedBufferSubData(buffer, 0, sizeof(Constants), &constants);
+                GlApi::BindBufferRange(GL_UNIFORM_BUFFER, 0, buffer, 0, sizeof(Constants));
+            }
+        });
+        GlApi::DeleteBuffers(1, &buffer);
+
+        // The ring: one aligned slice per object
+        StreamBuffer ring(GL_UNIFORM_BUFFER, 0);
+        ring.Reserve(ring.GetAlignedSize(sizeof(Constants)) * objects);
+        double ringMs = time([&]()
+        {
+            ring.BeginFrame();
+            for (int i = 0; i < objects; ++i)
+            {
+                constants.model[3][0] = static_cast<float>(i);
+                StreamAllocation allocation = ring.Allocate(sizeof(Constants));
+                std::memcpy(allocation.pointer, &constants, sizeof(Constants));
+                ring.Commit(allocation);
+                GlApi::BindBufferRange(GL_UNIFORM_BUFFER, 0, ring.GetBuffer(), allocation.offset, allocation.size);
+            }
+            ring.EndFrame();
+        });
+
+        std::cout << "  " << objects << " objects: glNamedBufferSubData " << subDataMs << " ms/frame, ring " << ringMs << " ms/frame\n";
+        std::cout << "  ring: " << FormatStats(ring.GetStats()) << "\n";
+    }
+    catch (const std::runtime_error&)
+    {
+        std::cout << "  Failed to create headless GL context, skipping\n";
+    }
+}
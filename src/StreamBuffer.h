@@ -0,0 +1,207 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <GL/glew.h>
+
+/**
+ * \struct StreamAllocation
+ * \brief A range of a StreamBuffer valid for the current frame.
+ */
+struct StreamAllocation
+{
+    void* pointer = nullptr;    ///< Write-only pointer into the mapped buffer, nullptr if the allocation failed
+    GLintptr offset = 0;        ///< Offset of the range in the buffer, e.g. for glBindBufferRange
+    GLsizeiptr size = 0;        ///< Size of the range in bytes
+
+    /**
+     * \brief Check whether the allocation succeeded.
+     * \return True if pointer is valid.
+     */
+    explicit operator bool() const { return pointer != nullptr; }
+};
+
+/**
+ * \struct StreamBufferStats
+ * \brief Usage counters of a StreamBuffer.
+ */
+struct StreamBufferStats
+{
+    uint64_t frames = 0;            ///< Frames ended
+    uint64_t allocations = 0;       ///< Successful allocations
+    uint64_t failedAllocations = 0; ///< Allocations that did not fit in the frame's region
+    uint64_t bytesAllocated = 0;    ///< Bytes handed out, alignment padding included
+    size_t frameBytes = 0;          ///< Bytes used by the last ended frame
+    size_t peakFrameBytes = 0;      ///< Most bytes used by one frame
+    size_t regionSize = 0;          ///< Bytes available per frame
+    uint64_t fenceWaits = 0;        ///< BeginFrame() calls that found the GPU still reading the region
+    double fenceWaitMs = 0.0;       ///< Time spent in those waits
+    uint64_t reallocations = 0;     ///< Times the buffer was recreated larger
+
+    /**
+     * \brief Get the share of the per-frame region used by the last frame.
+     * \return Occupancy between 0 and 1.
+     */
+    double GetOccupancy() const { return regionSize > 0 ? static_cast<double>(frameBytes) / regionSize : 0.0; }
+};
+
+/**
+ * \class StreamBuffer
+ * \brief Ring buffer for data written by the CPU every frame, e.g. per-object constants.
+ *
+ * The buffer is created with immutable storage and mapped once, persistently and
+ * coherently, so writes need neither glBufferData nor glBufferSubData. It is split into
+ * one region per frame in flight; a fence placed at EndFrame() guards each region, and
+ * BeginFrame() only waits if the GPU is still reading the region about to be reused.
+ * Allocate() hands out aligned ranges of the current region by bumping an offset.
+ *
+ * Requires OpenGL 4.5, or ARB_buffer_storage with ARB_direct_state_access: the buffer is
+ * created by name so a GL capture keeps it even when it is created inside a frame. All
+ * calls must be made on the thread whose context created the buffer.
+ */
+class StreamBuffer
+{
+public:
+    static constexpr unsigned DEFAULT_FRAMES_IN_FLIGHT = 3; ///< Regions in the ring
+
+    /**
+     * \brief Constructor. Creates and maps the buffer; throws std::runtime_error if that fails.
+     * \param target Binding target the data is used with, e.g. GL_UNIFORM_BUFFER; selects the offset alignment.
+     * \param frameSize Bytes available to each frame.
+     * \param framesInFlight Frames the CPU may run ahead of the GPU.
+     */
+    StreamBuffer(GLenum target, size_t frameSize, unsigned framesInFlight = DEFAULT_FRAMES_IN_FLIGHT);
+
+    /**
+     * \brief Destructor. Waits for the GPU to finish with the buffer, then deletes it.
+     */
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    /**
+     * \brief Grow the per-frame region, recreating the buffer if it is too small.
+     *
+     * Waits for all frames in flight when it recreates. Call outside BeginFrame() and
+     * EndFrame(), since earlier allocations become invalid.
+     *
+     * \param frameSize Bytes needed by a frame.
+     */
+    void Reserve(size_t frameSize);
+
+    /**
+     * \brief Start a frame: move to the next region, waiting for its fence if needed.
+     */
+    void BeginFrame();
+
+    /**
+     * \brief Allocate a range of the current frame's region.
+     * \param size Bytes needed.
+     * \param alignment Offset alignment in addition to the target's, a power of two; 0 for the target's only.
+     * \return The range; empty if it does not fit.
+     */
+    StreamAllocation Allocate(size_t size, size_t alignment = 0);
+
+    /**
+     * \brief Mark an allocation as written, before the GL commands that read it.
+     *
+     * The mapping is coherent, so this only reports the write to GlApi for its counters
+     * and captures.
+     *
+     * \param allocation The written range.
+     */
+    void Commit(const StreamAllocation& allocation);
+
+    /**
+     * \brief End the frame: fence the region so it is not overwritten while the GPU reads it.
+     */
+    void EndFrame();
+
+    /**
+     * \brief Round a size up to the target's offset alignment.
+     * \param size Size in bytes.
+     * \return Aligned size.
+     */
+    size_t GetAlignedSize(size_t size) const { return (size + m_alignment - 1) & ~(m_alignment - 1); }
+
+    /**
+     * \brief Get the GL buffer.
+     * \return Buffer name; 0 in test mode.
+     */
+    GLuint GetBuffer() const { return m_buffer; }
+
+    /**
+     * \brief Get the offset alignment of the target.
+     * \return Alignment in bytes.
+     */
+    size_t GetAlignment() const { return m_alignment; }
+
+    /**
+     * \brief Get the usage counters.
+     * \return The counters.
+     */
+    const StreamBufferStats& GetStats() const { return m_stats; }
+
+    /**
+     * \brief Format usage counters as one log line.
+     * \param stats The counters.
+     * \return Text without a trailing newline.
+     */
+    static std::string FormatStats(const StreamBufferStats& stats);
+
+    /**
+     * \brief Run unit tests for the StreamBuffer class.
+     */
+    static void test();
+
+    /**
+     * \brief Measure per-object constant uploads through the ring against glNamedBufferSubData.
+     */
+    static void benchmark();
+
+    /**
+     * \brief Enable or disable test mode, in which the ring is backed by client memory.
+     * \param enabled Whether to enable test mode.
+     */
+    static void SetTestMode(bool enabled) { s_testMode = enabled; }
+
+    /**
+     * \brief Check if test mode is enabled.
+     * \return Whether test mode is enabled.
+     */
+    static bool IsTestMode() { return s_testMode; }
+
+private:
+    /**
+     * \brief Create and map the buffer for the current region size.
+     */
+    void Create();
+
+    /**
+     * \brief Wait for all fences, then unmap and delete the buffer.
+     */
+    void Destroy();
+
+    /**
+     * \brief Wait for a region's fence and delete it.
+     * \param region Region index.
+     * \return True if the GPU was still using the region.
+     */
+    bool WaitForRegion(unsigned region);
+
+    size_t m_alignment;                 ///< Offset alignment of the target
+    size_t m_regionSize;                ///< Bytes per frame, a multiple of m_alignment
+    unsigned m_framesInFlight;          ///< Number of regions
+    GLuint m_buffer;                    ///< GL buffer
+    uint8_t* m_mapped;                  ///< Persistent mapping of the whole buffer
+    std::vector<uint8_t> m_testStorage; ///< Client memory standing in for the mapping in test mode
+    std::vector<GLsync> m_fences;       ///< Fence per region, nullptr when the region is free
+    unsigned m_region;                  ///< Region of the current frame
+    size_t m_head;                      ///< Next free offset within the current region
+    bool m_inFrame;                     ///< Between BeginFrame() and EndFrame()
+    StreamBufferStats m_stats;          ///< Usage counters
+
+    static bool s_testMode;             ///< Test mode flag
+};
@@ -10,6 +10,28 @@
 #include "Scene.h"
 #include "Camera.h"
 #include "Shader.h"
+#include "BoundingBox.h"
+#include "ThreadPool.h"
+#include "Frustum.h"
+#include "DynamicBvh.h"
+#include "OcclusionCuller.h"
+#include "TransformHierarchy.h"
+#include "RenderThread.h"
+#include "FrameClock.h"
+#include "HeadlessContext.h"
+#include "ThumbnailRenderer.h"
+#include "Profiler.h"
+#include "GlApi.h"
+#include "GlReplay.h"
+#include "StreamBuffer.h"
+#include "ProgramCache.h"
+#include "ShaderPermutations.h"
+#include "Material.h"
+#include "AllocationCounter.h"
+#include "LightClusters.h"
+#include "ResourcePool.h"
+#include "VertexArrayCache.h"
+#include "MappedFile.h"
 
 namespace Tests {
 
@@ -44,6 +66,72 @@ bool RunAllTests()
         std::cout << "\nRunning Shader tests...\n";
         Shader::test();
 
+        std::cout << "\nRunning BoundingBox tests...\n";
+        BoundingBox::test();
+
+        std::cout << "\nRunning ThreadPool tests...\n";
+        ThreadPool::test();
+
+        std::cout << "\nRunning Frustum tests...\n";
+        Frustum::test();
+
+        std::cout << "\nRunning DynamicBvh tests...\n";
+        DynamicBvh::test();
+
+        std::cout << "\nRunning OcclusionCuller tests...\n";
+        OcclusionCuller::test();
+
+        std::cout << "\nRunning TransformHierarchy tests...\n";
+        TransformHierarchy::test();
+
+        std::cout << "\nRunning RenderThread tests...\n";
+        RenderThread::test();
+
+        std::cout << "\nRunning FrameClock tests...\n";
+        FrameClock::test();
+
+        std::cout << "\nRunning HeadlessContext tests...\n";
+        HeadlessContext::test();
+
+        std::cout << "\nRunning ThumbnailRenderer tests...\n";
+        ThumbnailRenderer::test();
+
+        std::cout << "\nRunning Profiler tests...\n";
+        Profiler::test();
+
+        std::cout << "\nRunning GlApi tests...\n";
+        GlApi::test();
+
+        std::cout << "\nRunning GlReplay tests...\n";
+        GlReplay::test();
+
+        std::cout << "\nRunning StreamBuffer tests...\n";
+        StreamBuffer::test();
+
+        std::cout << "\nRunning ProgramCache tests...\n";
+        ProgramCache::test();
+
+        std::cout << "\nRunning ShaderPermutations tests...\n";
+        ShaderPermutations::test();
+
+        std::cout << "\nRunning AllocationCounter tests...\n";
+        AllocationCounter::test();
+
+        std::cout << "\nRunning Material tests...\n";
+        Material::test();
+
+        std::cout << "\nRunning LightClusters tests...\n";
+        LightClusters::test();
+
+        std::cout << "\nRunning VertexArrayCache tests...\n";
+        VertexArrayCache::test();
+
+        std::cout << "\nRunning ResourcePool tests...\n";
+        ResourcePool::test();
+
+        std::cout << "\nRunning MappedFile tests...\n";
+        MappedFile::test();
+
         std::cout << "\nAll tests passed!\n";
         return true;
     }
@@ -0,0 +1,145 @@
+#include "ThreadPool.h"
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    if (threadCount == 0)
+    {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threadCount = hardware > 1 ? hardware - 1 : 0;
+    }
+
+    m_workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::Get()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t batchSize, const RangeFunction& function)
+{
+    if (count == 0)
+        return;
+
+    batchSize = std::max<size_t>(batchSize, 1);
+
+    // Not worth waking anybody up
+    if (m_workers.empty() || count <= batchSize)
+    {
+        function(0, count, 0);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(m_submitMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_function = &function;
+        m_count = count;
+        m_batchSize = batchSize;
+        m_next.store(0, std::memory_order_relaxed);
+        m_busyWorkers = m_workers.size();
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    // The caller works too instead of just waiting
+    RunBatches(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_function = nullptr;
+}
+
+void ThreadPool::WorkerLoop(size_t workerIndex)
+{
+    size_t seenGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, seenGeneration] { return m_stop || m_generation != seenGeneration; });
+            if (m_stop)
+                return;
+            seenGeneration = m_generation;
+        }
+
+        RunBatches(workerIndex);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_busyWorkers;
+        }
+        m_done.notify_one();
+    }
+}
+
+void ThreadPool::RunBatches(size_t workerIndex)
+{
+    while (true)
+    {
+        size_t begin = m_next.fetch_add(m_batchSize, std::memory_order_relaxed);
+        if (begin >= m_count)
+            break;
+        size_t end = std::min(begin + m_batchSize, m_count);
+        (*m_function)(begin, end, workerIndex);
+    }
+}
+
+void ThreadPool::test()
+{
+    std::cout << "[ThreadPool] Running tests...\n";
+
+    ThreadPool pool(3);
+    assert(pool.GetWorkerCount() == 3 && "Worker count incorrect");
+    assert(pool.GetThreadCount() == 4 && "Thread count incorrect");
+
+    // Every index must be visited exactly once
+    std::vector<int> visits(100000, 0);
+    std::vector<size_t> perThread(pool.GetThreadCount(), 0);
+    pool.ParallelFor(visits.size(), 1000, [&](size_t begin, size_t end, size_t worker)
+    {
+        for (size_t i = begin; i < end; ++i)
+            ++visits[i];
+        perThread[worker] += end - begin;
+    });
+    assert(std::all_of(visits.begin(), visits.end(), [](int v) { return v == 1; }) && "ParallelFor missed or repeated indices");
+
+    size_t total = 0;
+    for (size_t n : perThread)
+        total += n;
+    assert(total == visits.size() && "Per-thread counts do not add up");
+
+    // Small ranges run inline and the pool is reusable
+    size_t inlineCount = 0;
+    pool.ParallelFor(10, 1000, [&](size_t begin, size_t end, size_t worker)
+    {
+        assert(worker == 0 && "Small range should run on the caller");
+        inlineCount += end - begin;
+    });
+    assert(inlineCount == 10 && "Inline ParallelFor incorrect");
+
+    std::cout << "[ThreadPool] Tests passed!\n";
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * \class ThreadPool
+ * \brief A fixed set of worker threads for data-parallel CPU work.
+ *
+ * The pool is built around ParallelFor: a range is cut into batches that the workers
+ * and the calling thread pull from a shared atomic counter until the range is exhausted.
+ * ParallelFor blocks until every batch has run, so callers can treat it as a plain loop.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * \brief Function invoked for each batch.
+     * \param begin First index of the batch.
+     * \param end One past the last index of the batch.
+     * \param worker Index of the executing thread in [0, GetWorkerCount()], 0 being the caller.
+     */
+    using RangeFunction = std::function<void(size_t begin, size_t end, size_t worker)>;
+
+    /**
+     * \brief Constructor.
+     * \param threadCount Number of worker threads. 0 uses hardware_concurrency() - 1.
+     */
+    explicit ThreadPool(size_t threadCount = 0);
+
+    /**
+     * \brief Destructor. Joins all workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * \brief Run a function over [0, count) split into batches.
+     *
+     * Ranges of at most one batch, or any range without workers, run inline on the
+     * calling thread.
+     *
+     * \param count Number of items.
+     * \param batchSize Items per batch.
+     * \param function Function to run on each batch.
+     */
+    void ParallelFor(size_t count, size_t batchSize, const RangeFunction& function);
+
+    /**
+     * \brief Get the number of worker threads, not counting the calling thread.
+     * \return Worker count.
+     */
+    size_t GetWorkerCount() const { return m_workers.size(); }
+
+    /**
+     * \brief Get the number of threads that may execute a batch, including the caller.
+     *
+     * Use this to size per-thread scratch buffers indexed by the worker argument.
+     *
+     * \return Worker count + 1.
+     */
+    size_t GetThreadCount() const { return m_workers.size() + 1; }
+
+    /**
+     * \brief Get the shared engine-wide pool.
+     * \return The pool instance.
+     */
+    static ThreadPool& Get();
+
+    /**
+     * \brief Run unit tests for the ThreadPool class.
+     */
+    static void test();
+
+private:
+    /**
+     * \brief Worker thread entry point.
+     * \param workerIndex Index passed to range functions run by this worker.
+     */
+    void WorkerLoop(size_t workerIndex);
+
+    /**
+     * \brief Pull and run batches of the current job until none are left.
+     * \param workerIndex Index passed to the range function.
+     */
+    void RunBatches(size_t workerIndex);
+
+    std::vector<std::thread> m_workers;         ///< Worker threads
+    std::mutex m_mutex;                         ///< Guards job publication
+    std::mutex m_submitMutex;                   ///< Serializes concurrent ParallelFor callers
+    std::condition_variable m_wake;             ///< Signals workers that a job is available
+    std::condition_variable m_done;             ///< Signals the caller that workers are idle
+
+    const RangeFunction* m_function = nullptr;  ///< Current job
+    size_t m_count = 0;                         ///< Item count of the current job
+    size_t m_batchSize = 1;                     ///< Batch size of the current job
+    std::atomic<size_t> m_next{0};              ///< Next unclaimed item
+    size_t m_generation = 0;                    ///< Incremented for each job
+    size_t m_busyWorkers = 0;                   ///< Workers still running the current job
+    bool m_stop = false;                        ///< Shutdown flag
+};
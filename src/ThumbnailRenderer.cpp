@@ -0,0 +1,380 @@
+#include "ThumbnailRenderer.h"
+#include "HeadlessContext.h"
+#include "Scene.h"
+#include "Model.h"
+#include <iostream>
+#include <fstream>
+#include <cassert>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <stdexcept>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+
+// Extensions handed to Model::LoadFromFile, lower case
+const char* const MODEL_EXTENSIONS[] = { ".obj", ".fbx", ".gltf", ".glb", ".dae", ".3ds", ".ply", ".stl", ".blend" };
+
+// Free space around the framed bounding sphere
+constexpr float FRAME_MARGIN = 1.05f;
+
+// Largest payload of a stored (uncompressed) deflate block
+constexpr size_t MAX_STORED_BLOCK = 65535;
+
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+    static const std::array<uint32_t, 256> table = []
+    {
+        std::array<uint32_t, 256> entries{};
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[n] = c;
+        }
+        return entries;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void AppendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void AppendChunk(std::vector<uint8_t>& out, const char* type, const std::vector<uint8_t>& data)
+{
+    AppendBigEndian(out, static_cast<uint32_t>(data.size()));
+    size_t typeStart = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    AppendBigEndian(out, Crc32(out.data() + typeStart, out.size() - typeStart));
+}
+
+// Output file of one view: the model's path below root, with the view number appended
+std::filesystem::path GetOutputPath(const std::filesystem::path& outputDirectory, const std::filesystem::path& root,
+                                    const std::filesystem::path& model, int view)
+{
+    std::filesystem::path relative = model.lexically_relative(root);
+    if (relative.empty() || *relative.begin() == "..")
+        relative = model.filename();
+    std::string name = relative.stem().string() + "_" + std::to_string(view) + ".png";
+    return outputDirectory / relative.parent_path() / name;
+}
+
+} // namespace
+
+ThumbnailRenderer::ThumbnailRenderer(const ThumbnailSettings& settings)
+    : m_settings(settings)
+    , m_nextModel(0)
+{
+    m_settings.views = std::max(m_settings.views, 1);
+    m_settings.workers = std::max(m_settings.workers, 1);
+}
+
+std::vector<std::filesystem::path> ThumbnailRenderer::FindModels(const std::filesystem::path& directory)
+{
+    std::vector<std::filesystem::path> models;
+    std::error_code error;
+    for (auto it = std::filesystem::recursive_directory_iterator(directory, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+    {
+        if (!it->is_regular_file())
+            continue;
+
+        std::string extension = it->path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (std::find(std::begin(MODEL_EXTENSIONS), std::end(MODEL_EXTENSIONS), extension) != std::end(MODEL_EXTENSIONS))
+            models.push_back(it->path());
+    }
+    if (error)
+        std::cerr << "Failed to scan " << directory << ": " << error.message() << std::endl;
+
+    std::sort(models.begin(), models.end());
+    return models;
+}
+
+ThumbnailStats ThumbnailRenderer::Run(const std::vector<std::filesystem::path>& models, const std::filesystem::path& root)
+{
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+
+    // Each worker owns a context and a scene, and pulls models until none are left
+    m_nextModel = 0;
+    std::vector<ThumbnailStats> workerStats(static_cast<size_t>(m_settings.workers));
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < workerStats.size(); ++w)
+    {
+        workers.emplace_back(&ThumbnailRenderer::RunWorker, this, std::cref(models), std::cref(root), std::ref(workerStats[w]));
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    ThumbnailStats stats;
+    for (const ThumbnailStats& worker : workerStats)
+    {
+        stats.models += worker.models;
+        stats.failed += worker.failed;
+        stats.images += worker.images;
+    }
+    // Models never handed out (every worker failed to start) count as failed
+    stats.failed += models.size() - std::min(m_nextModel, models.size());
+    stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return stats;
+}
+
+void ThumbnailRenderer::RunWorker(const std::vector<std::filesystem::path>& models, const std::filesystem::path& root, ThumbnailStats& stats)
+{
+    try
+    {
+        HeadlessContext context(m_settings.width, m_settings.height);
+        Scene scene;
+        const float aspect = static_cast<float>(m_settings.width) / static_cast<float>(m_settings.height);
+        std::vector<uint8_t> pixels;
+
+        for (;;)
+        {
+            size_t index;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_nextModel >= models.size())
+                    break;
+                index = m_nextModel++;
+            }
+            const std::filesystem::path& file = models[index];
+
+            auto model = std::make_shared<Model>();
+            if (!model->LoadFromFile(file.string()) || !model->GetBounds().IsValid())
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                std::cerr << "Failed to load " << file << std::endl;
+                ++stats.failed;
+                continue;
+            }
+
+            // Orbit the camera around the model, one view per turntable step
+            size_t object = scene.AddModel(model);
+            bool written = true;
+            for (int view = 0; view < m_settings.views; ++view)
+            {
+                float azimuth = 360.0f * static_cast<float>(view) / static_cast<float>(m_settings.views);
+                ThumbnailView framing = FrameBounds(model->GetBounds(), azimuth, m_settings.elevation, m_settings.fieldOfView, aspect);
+                scene.GetCamera()->LookAt(framing.position, framing.target);
+                scene.SetProjectionMatrix(glm::perspective(glm::radians(m_settings.fieldOfView), aspect, framing.nearPlane, framing.farPlane));
+
+                context.Render(scene);
+                std::filesystem::path output = GetOutputPath(m_settings.outputDirectory, root, file, view);
+                std::error_code error;
+                std::filesystem::create_directories(output.parent_path(), error);
+                if (context.ReadColor(pixels) && WritePng(output, pixels, m_settings.width, m_settings.height))
+                    ++stats.images;
+                else
+                    written = false;
+            }
+            // Released, with its GL objects, by the next Render()
+            scene.RemoveModel(object);
+
+            if (written)
+                ++stats.models;
+            else
+                ++stats.failed;
+        }
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::cerr << "Thumbnail worker failed: " << e.what() << std::endl;
+    }
+}
+
+ThumbnailView ThumbnailRenderer::FrameBounds(const BoundingBox& bounds, float azimuth, float elevation, float fieldOfView, float aspect)
+{
+    // Fit the bounding sphere inside the narrower of the two view angles
+    glm::vec3 center = bounds.GetCenter();
+    float radius = std::max(bounds.GetRadius(), 1e-4f);
+    float halfHeight = glm::radians(fieldOfView) * 0.5f;
+    float halfWidth = std::atan(std::tan(halfHeight) * aspect);
+    float distance = radius / std::sin(std::min(halfWidth, halfHeight)) * FRAME_MARGIN;
+
+    float yaw = glm::radians(azimuth);
+    float pitch = glm::radians(elevation);
+    glm::vec3 direction(std::cos(pitch) * std::sin(yaw), std::sin(pitch), std::cos(pitch) * std::cos(yaw));
+
+    ThumbnailView view;
+    view.position = center + direction * distance;
+    view.target = center;
+    view.nearPlane = (distance - radius) * 0.9f;
+    view.farPlane = (distance + radius) * 1.1f;
+    return view;
+}
+
+bool ThumbnailRenderer::WritePng(const std::filesystem::path& path, const std::vector<uint8_t>& pixels, int width, int height)
+{
+    const size_t rowBytes = static_cast<size_t>(width) * 4;
+    if (width <= 0 || height <= 0 || pixels.size() != rowBytes * static_cast<size_t>(height))
+        return false;
+
+    // Scanlines with filter type 0 (none)
+    std::vector<uint8_t> raw;
+    raw.reserve((rowBytes + 1) * static_cast<size_t>(height));
+    for (int y = 0; y < height; ++y)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels.begin() + y * rowBytes, pixels.begin() + (y + 1) * rowBytes);
+    }
+
+    // zlib stream of stored deflate blocks: no compressor needed, and thumbnails are small
+    std::vector<uint8_t> zlib = { 0x78, 0x01 };
+    for (size_t offset = 0; offset < raw.size() || offset == 0; offset += MAX_STORED_BLOCK)
+    {
+        uint16_t length = static_cast<uint16_t>(std::min(MAX_STORED_BLOCK, raw.size() - offset));
+        bool last = offset + length >= raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(length));
+        zlib.push_back(static_cast<uint8_t>(length >> 8));
+        zlib.push_back(static_cast<uint8_t>(~length));
+        zlib.push_back(static_cast<uint8_t>(~length >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+        if (last)
+            break;
+    }
+    uint32_t a = 1, b = 0;
+    for (uint8_t byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    AppendBigEndian(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> header;
+    AppendBigEndian(header, static_cast<uint32_t>(width));
+    AppendBigEndian(header, static_cast<uint32_t>(height));
+    header.insert(header.end(), { 8, 6, 0, 0, 0 });     // 8-bit RGBA, deflate, no filter set, no interlace
+
+    std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    AppendChunk(png, "IHDR", header);
+    AppendChunk(png, "IDAT", zlib);
+    AppendChunk(png, "IEND", {});
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+    return static_cast<bool>(file);
+}
+
+void ThumbnailRenderer::test()
+{
+    std::cout << "[ThumbnailRenderer] Running tests...\n";
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "snapengine_thumbnail_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory / "models" / "props");
+
+    // Test finding models
+    {
+        for (const char* name : { "models/a.obj", "models/props/b.FBX", "models/notes.txt" })
+        {
+            std::ofstream(directory / name) << "x";
+        }
+        auto models = FindModels(directory / "models");
+        assert(models.size() == 2 && "Only files with model extensions should be found");
+        assert(models[0].filename() == "a.obj" && models[1].filename() == "b.FBX" && "Models should be sorted");
+        assert(GetOutputPath("out", directory / "models", models[1], 3) == std::filesystem::path("out") / "props" / "b_3.png" &&
+               "Output should mirror the model directory");
+        assert(FindModels(directory / "missing").empty() && "Missing directory should yield no models");
+    }
+
+    // Test framing: the bounds fit inside the view and depth range from every angle
+    {
+        BoundingBox bounds(glm::vec3(-3.0f, 0.0f, -1.0f), glm::vec3(5.0f, 2.0f, 1.0f));
+        for (float aspect : { 1.0f, 0.5f, 16.0f / 9.0f })
+        {
+            for (float azimuth = 0.0f; azimuth < 360.0f; azimuth += 45.0f)
+            {
+                ThumbnailView view = FrameBounds(bounds, azimuth, 30.0f, 45.0f, aspect);
+                glm::mat4 viewProjection = glm::perspective(glm::radians(45.0f), aspect, view.nearPlane, view.farPlane) *
+                                           glm::lookAt(view.position, view.target, glm::vec3(0.0f, 1.0f, 0.0f));
+                bool inside = view.nearPlane > 0.0f;
+                for (int corner = 0; corner < 8; ++corner)
+                {
+                    glm::vec3 p((corner & 1) ? bounds.max.x : bounds.min.x, (corner & 2) ? bounds.max.y : bounds.min.y,
+                                (corner & 4) ? bounds.max.z : bounds.min.z);
+                    glm::vec4 clip = viewProjection * glm::vec4(p, 1.0f);
+                    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+                    inside = inside && clip.w > 0.0f && std::abs(ndc.x) <= 1.0f && std::abs(ndc.y) <= 1.0f && std::abs(ndc.z) <= 1.0f;
+                }
+                assert(inside && "Framed bounds should be fully visible");
+            }
+        }
+        ThumbnailView front = FrameBounds(bounds, 0.0f, 0.0f, 45.0f, 1.0f);
+        assert(front.position.z > bounds.max.z && std::abs(front.position.x - 1.0f) < 1e-4f && "Azimuth 0 should look down -Z");
+    }
+
+    // Test PNG output: signature, header and stored scanlines
+    {
+        const int width = 3;
+        const int height = 2;
+        std::vector<uint8_t> pixels(width * height * 4);
+        for (size_t i = 0; i < pixels.size(); ++i)
+        {
+            pixels[i] = static_cast<uint8_t>(i * 7);
+        }
+        std::filesystem::path file = directory / "image.png";
+        bool written = WritePng(file, pixels, width, height);
+        assert(written && "WritePng failed");
+        written = WritePng(file, pixels, width + 1, height);
+        assert(!written && "Mismatched size should be rejected");
+
+        std::ifstream stream(file, std::ios::binary);
+        std::vector<uint8_t> png((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        assert(png.size() > 33 && png[0] == 0x89 && png[1] == 'P' && png[12] == 'I' && png[15] == 'R' && "Bad PNG signature");
+        assert(png[19] == width && png[23] == height && png[24] == 8 && png[25] == 6 && "Bad IHDR");
+        assert(Crc32(png.data() + 12, 17) == (static_cast<uint32_t>(png[29]) << 24 | png[30] << 16 | png[31] << 8 | png[32]) && "Bad IHDR CRC");
+
+        // IDAT: zlib header, one stored block, then filter byte + row for each scanline
+        const uint8_t* idat = png.data() + 33 + 8;
+        assert(idat[0] == 0x78 && idat[2] == 1 && "Expected a single stored block");
+        const uint8_t* data = idat + 7;
+        bool matches = true;
+        for (int y = 0; y < height; ++y)
+        {
+            matches = matches && data[y * (width * 4 + 1)] == 0 &&
+                      std::equal(pixels.begin() + y * width * 4, pixels.begin() + (y + 1) * width * 4, data + y * (width * 4 + 1) + 1);
+        }
+        assert(matches && "Scanlines should be stored verbatim");
+        assert(Crc32(reinterpret_cast<const uint8_t*>("123456789"), 9) == 0xCBF43926u && "CRC-32 check value mismatch");
+    }
+
+    // Test that failures are counted rather than fatal
+    {
+        ThumbnailSettings settings;
+        settings.workers = 2;
+        settings.outputDirectory = directory / "out";
+        ThumbnailRenderer renderer(settings);
+        ThumbnailStats stats = renderer.Run({ directory / "models" / "missing.obj" }, directory / "models");
+        assert(stats.models == 0 && stats.failed == 1 && stats.images == 0 && "Missing model should count as failed");
+    }
+
+    std::filesystem::remove_all(directory);
+    std::cout << "[ThumbnailRenderer] Tests passed!\n";
+}
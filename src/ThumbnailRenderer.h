@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <glm/glm.hpp>
+#include "BoundingBox.h"
+
+/**
+ * \struct ThumbnailSettings
+ * \brief What ThumbnailRenderer renders and where it writes it.
+ */
+struct ThumbnailSettings
+{
+    int width = 256;                    ///< Image width in pixels
+    int height = 256;                   ///< Image height in pixels
+    int views = 1;                      ///< Turntable views per model, evenly spaced around the vertical axis
+    float elevation = 20.0f;            ///< Camera elevation above the model centre, in degrees
+    float fieldOfView = 45.0f;          ///< Vertical field of view, in degrees
+    int workers = 1;                    ///< Worker threads, each with its own headless context
+    std::filesystem::path outputDirectory = "thumbnails"; ///< Root of the written PNGs
+};
+
+/**
+ * \struct ThumbnailStats
+ * \brief Outcome of a ThumbnailRenderer run.
+ */
+struct ThumbnailStats
+{
+    size_t models = 0;                  ///< Models rendered
+    size_t failed = 0;                  ///< Models that failed to load or render
+    size_t images = 0;                  ///< PNGs written
+    double seconds = 0.0;               ///< Wall-clock time of the run
+
+    /**
+     * \brief Get the throughput of the run.
+     * \return Models rendered per minute.
+     */
+    double GetModelsPerMinute() const { return seconds > 0.0 ? static_cast<double>(models) * 60.0 / seconds : 0.0; }
+};
+
+/**
+ * \struct ThumbnailView
+ * \brief Camera placement that frames a bounding box.
+ */
+struct ThumbnailView
+{
+    glm::vec3 position;                 ///< Camera position
+    glm::vec3 target;                   ///< Point the camera looks at
+    float nearPlane;                    ///< Near clip distance
+    float farPlane;                     ///< Far clip distance
+};
+
+/**
+ * \class ThumbnailRenderer
+ * \brief Renders preview images of model files offscreen for the asset pipeline.
+ *
+ * Each model is loaded with Model::LoadFromFile, framed from its bounds and rendered
+ * from one or more turntable angles into a HeadlessContext, and each view is written
+ * as a PNG. Models are handed out to the workers one at a time, so slow models do not
+ * hold up the others.
+ */
+class ThumbnailRenderer
+{
+public:
+    /**
+     * \brief Constructor.
+     * \param settings Image size, views, workers and output directory.
+     */
+    explicit ThumbnailRenderer(const ThumbnailSettings& settings);
+
+    /**
+     * \brief Find the model files under a directory, recursively.
+     * \param directory Directory to search.
+     * \return Paths of files with a known model extension, sorted.
+     */
+    static std::vector<std::filesystem::path> FindModels(const std::filesystem::path& directory);
+
+    /**
+     * \brief Render thumbnails of models.
+     *
+     * The PNG of view v of model root/a/b.obj is written to outputDirectory/a/b_v.png.
+     *
+     * \param models Model files.
+     * \param root Directory the output paths are made relative to.
+     * \return Counts and timing of the run.
+     */
+    ThumbnailStats Run(const std::vector<std::filesystem::path>& models, const std::filesystem::path& root);
+
+    /**
+     * \brief Place a camera so that a bounding box fills the view.
+     * \param bounds Bounds to frame; must be valid.
+     * \param azimuth Angle around the vertical axis, in degrees; 0 looks down -Z.
+     * \param elevation Angle above the horizontal plane, in degrees.
+     * \param fieldOfView Vertical field of view, in degrees.
+     * \param aspect Width / height of the image.
+     * \return Camera placement and a depth range enclosing the bounds.
+     */
+    static ThumbnailView FrameBounds(const BoundingBox& bounds, float azimuth, float elevation, float fieldOfView, float aspect);
+
+    /**
+     * \brief Write an RGBA8 image as a PNG file.
+     * \param path File to write.
+     * \param pixels Width * height RGBA8 pixels, top row first.
+     * \param width Image width.
+     * \param height Image height.
+     * \return True on success.
+     */
+    static bool WritePng(const std::filesystem::path& path, const std::vector<uint8_t>& pixels, int width, int height);
+
+    /**
+     * \brief Run unit tests for the ThumbnailRenderer class.
+     */
+    static void test();
+
+private:
+    /**
+     * \brief Worker thread body: render models until none are left.
+     * \param models Model files.
+     * \param root Directory the output paths are made relative to.
+     * \param stats Receives the worker's counts.
+     */
+    void RunWorker(const std::vector<std::filesystem::path>& models, const std::filesystem::path& root, ThumbnailStats& stats);
+
+    ThumbnailSettings m_settings;       ///< Run settings
+    size_t m_nextModel;                 ///< Next model to hand out, guarded by m_mutex
+    std::mutex m_mutex;                 ///< Guards m_nextModel and progress output
+};
@@ -0,0 +1,705 @@
+#include "TransformHierarchy.h"
+#include "Simd.h"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+
+// out = a * b; out must not alias a or b
+void MultiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#if defined(SNAPENGINE_SSE)
+    const float* pa = glm::value_ptr(a);
+    const float* pb = glm::value_ptr(b);
+    float* po = glm::value_ptr(out);
+    const __m128 a0 = _mm_loadu_ps(pa);
+    const __m128 a1 = _mm_loadu_ps(pa + 4);
+    const __m128 a2 = _mm_loadu_ps(pa + 8);
+    const __m128 a3 = _mm_loadu_ps(pa + 12);
+    for (int column = 0; column < 4; ++column)
+    {
+        const float* bc = pb + 4 * column;
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(bc[0])), _mm_mul_ps(a1, _mm_set1_ps(bc[1]))),
+                              _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(bc[2])), _mm_mul_ps(a3, _mm_set1_ps(bc[3]))));
+        _mm_storeu_ps(po + 4 * column, r);
+    }
+#else
+    out = a * b;
+#endif
+}
+
+} // namespace
+
+TransformHierarchy::NodeId TransformHierarchy::CreateNode(NodeId parent, uint32_t userData)
+{
+    assert((parent == INVALID_NODE || IsValid(parent)) && "CreateNode: invalid parent");
+
+    NodeId node;
+    if (!m_freeIds.empty())
+    {
+        node = m_freeIds.back();
+        m_freeIds.pop_back();
+    }
+    else
+    {
+        node = static_cast<NodeId>(m_slots.size());
+        m_slots.push_back(INVALID_SLOT);
+        m_parents.push_back(INVALID_NODE);
+        m_firstChild.push_back(INVALID_NODE);
+        m_lastChild.push_back(INVALID_NODE);
+        m_nextSibling.push_back(INVALID_NODE);
+    }
+
+    uint32_t slot = static_cast<uint32_t>(m_slotNodes.size());
+    uint32_t parentSlot = parent != INVALID_NODE ? m_slots[parent] : INVALID_SLOT;
+    uint32_t depth = parent != INVALID_NODE ? GetDepth(parent) + 1 : 0;
+
+    // Appending keeps the slots depth-sorted unless the new node is shallower than the last one
+    if (slot > 0 && depth < m_depths.back())
+        m_orderDirty = true;
+
+    m_slotNodes.push_back(node);
+    m_parentSlots.push_back(parentSlot);
+    m_depths.push_back(depth);
+    m_positions.emplace_back(0.0f);
+    m_orientations.emplace_back(1.0f, 0.0f, 0.0f, 0.0f);
+    m_scales.emplace_back(1.0f);
+    m_local.emplace_back(1.0f);
+    m_world.emplace_back(1.0f);
+    m_userData.push_back(userData);
+    m_dirty.push_back(0);
+    m_compose.push_back(0);
+
+    m_slots[node] = slot;
+    m_parents[node] = parent;
+    m_firstChild[node] = INVALID_NODE;
+    m_lastChild[node] = INVALID_NODE;
+    m_nextSibling[node] = INVALID_NODE;
+    if (parent != INVALID_NODE)
+        Link(node, parent);
+
+    MarkDirty(slot, false);
+    return node;
+}
+
+void TransformHierarchy::DestroyNode(NodeId node)
+{
+    assert(IsValid(node) && "DestroyNode: invalid node");
+
+    Unlink(node);
+
+    std::vector<NodeId> stack = { node };
+    while (!stack.empty())
+    {
+        NodeId current = stack.back();
+        stack.pop_back();
+        for (NodeId child = m_firstChild[current]; child != INVALID_NODE; child = m_nextSibling[child])
+        {
+            stack.push_back(child);
+        }
+
+        // The slot stays until the next Reorder(); detached and clean, the sweep skips it
+        uint32_t slot = m_slots[current];
+        if (m_dirty[slot])
+        {
+            m_dirty[slot] = 0;
+            --m_dirtyCount;
+        }
+        m_slotNodes[slot] = INVALID_NODE;
+        m_parentSlots[slot] = INVALID_SLOT;
+        m_userData[slot] = NO_USER_DATA;
+        m_compose[slot] = 0;
+
+        m_slots[current] = INVALID_SLOT;
+        m_parents[current] = INVALID_NODE;
+        m_firstChild[current] = INVALID_NODE;
+        m_lastChild[current] = INVALID_NODE;
+        m_nextSibling[current] = INVALID_NODE;
+        m_freeIds.push_back(current);
+        ++m_deadSlots;
+    }
+}
+
+void TransformHierarchy::SetParent(NodeId node, NodeId parent)
+{
+    assert(IsValid(node) && (parent == INVALID_NODE || IsValid(parent)) && "SetParent: invalid node");
+    if (m_parents[node] == parent)
+        return;
+
+    for (NodeId ancestor = parent; ancestor != INVALID_NODE; ancestor = m_parents[ancestor])
+    {
+        assert(ancestor != node && "SetParent: a node cannot become its own descendant");
+    }
+
+    Unlink(node);
+    m_parents[node] = parent;
+    if (parent != INVALID_NODE)
+        Link(node, parent);
+
+    uint32_t slot = m_slots[node];
+    m_parentSlots[slot] = parent != INVALID_NODE ? m_slots[parent] : INVALID_SLOT;
+    m_orderDirty = true;
+    MarkDirty(slot, false);
+}
+
+std::vector<TransformHierarchy::NodeId> TransformHierarchy::GetChildren(NodeId node) const
+{
+    std::vector<NodeId> children;
+    for (NodeId child = m_firstChild[node]; child != INVALID_NODE; child = m_nextSibling[child])
+    {
+        children.push_back(child);
+    }
+    return children;
+}
+
+void TransformHierarchy::SetLocalTransform(NodeId node, const glm::vec3& position, const glm::quat& orientation, const glm::vec3& scale)
+{
+    uint32_t slot = m_slots[node];
+    m_positions[slot] = position;
+    m_orientations[slot] = orientation;
+    m_scales[slot] = scale;
+    MarkDirty(slot, true);
+}
+
+void TransformHierarchy::SetLocalPosition(NodeId node, const glm::vec3& position)
+{
+    uint32_t slot = m_slots[node];
+    m_positions[slot] = position;
+    MarkDirty(slot, true);
+}
+
+void TransformHierarchy::SetLocalOrientation(NodeId node, const glm::quat& orientation)
+{
+    uint32_t slot = m_slots[node];
+    m_orientations[slot] = orientation;
+    MarkDirty(slot, true);
+}
+
+void TransformHierarchy::SetLocalScale(NodeId node, const glm::vec3& scale)
+{
+    uint32_t slot = m_slots[node];
+    m_scales[slot] = scale;
+    MarkDirty(slot, true);
+}
+
+void TransformHierarchy::SetLocalMatrix(NodeId node, const glm::mat4& local)
+{
+    uint32_t slot = m_slots[node];
+    m_local[slot] = local;
+    m_compose[slot] = 0;
+    MarkDirty(slot, false);
+}
+
+uint32_t TransformHierarchy::GetDepth(NodeId node) const
+{
+    uint32_t depth = 0;
+    for (NodeId parent = m_parents[node]; parent != INVALID_NODE; parent = m_parents[parent])
+    {
+        ++depth;
+    }
+    return depth;
+}
+
+void TransformHierarchy::MarkDirty(uint32_t slot, bool compose)
+{
+    if (!m_dirty[slot])
+    {
+        m_dirty[slot] = 1;
+        ++m_dirtyCount;
+    }
+    m_firstDirtySlot = std::min(m_firstDirtySlot, slot);
+
+    if (compose && !m_compose[slot])
+    {
+        m_compose[slot] = 1;
+        m_composeList.push_back(slot);
+    }
+}
+
+void TransformHierarchy::Link(NodeId node, NodeId parent)
+{
+    m_nextSibling[node] = INVALID_NODE;
+    if (m_lastChild[parent] == INVALID_NODE)
+        m_firstChild[parent] = node;
+    else
+        m_nextSibling[m_lastChild[parent]] = node;
+    m_lastChild[parent] = node;
+}
+
+void TransformHierarchy::Unlink(NodeId node)
+{
+    NodeId parent = m_parents[node];
+    if (parent == INVALID_NODE)
+        return;
+
+    NodeId previous = INVALID_NODE;
+    for (NodeId child = m_firstChild[parent]; child != node; child = m_nextSibling[child])
+    {
+        previous = child;
+    }
+
+    if (previous == INVALID_NODE)
+        m_firstChild[parent] = m_nextSibling[node];
+    else
+        m_nextSibling[previous] = m_nextSibling[node];
+    if (m_lastChild[parent] == node)
+        m_lastChild[parent] = previous;
+    m_nextSibling[node] = INVALID_NODE;
+}
+
+void TransformHierarchy::Reorder()
+{
+    // Roots keep their relative order, then each level follows the previous one
+    std::vector<NodeId> order;
+    order.reserve(m_slotNodes.size() - m_deadSlots);
+    for (size_t slot = 0; slot < m_slotNodes.size(); ++slot)
+    {
+        NodeId node = m_slotNodes[slot];
+        if (node != INVALID_NODE && m_parents[node] == INVALID_NODE)
+            order.push_back(node);
+    }
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        for (NodeId child = m_firstChild[order[i]]; child != INVALID_NODE; child = m_nextSibling[child])
+        {
+            order.push_back(child);
+        }
+    }
+
+    const size_t count = order.size();
+    std::vector<NodeId> slotNodes(count);
+    std::vector<uint32_t> parentSlots(count), depths(count), userData(count);
+    std::vector<glm::vec3> positions(count), scales(count);
+    std::vector<glm::quat> orientations(count);
+    std::vector<glm::mat4> local(count), world(count);
+    std::vector<uint8_t> dirty(count), compose(count);
+
+    for (size_t slot = 0; slot < count; ++slot)
+    {
+        NodeId node = order[slot];
+        uint32_t old = m_slots[node];
+        slotNodes[slot] = node;
+        positions[slot] = m_positions[old];
+        orientations[slot] = m_orientations[old];
+        scales[slot] = m_scales[old];
+        local[slot] = m_local[old];
+        world[slot] = m_world[old];
+        userData[slot] = m_userData[old];
+        dirty[slot] = m_dirty[old];
+        compose[slot] = m_compose[old];
+    }
+
+    // Parents precede children, so their new slots are known by the time children need them
+    for (size_t slot = 0; slot < count; ++slot)
+    {
+        NodeId node = order[slot];
+        m_slots[node] = static_cast<uint32_t>(slot);
+        NodeId parent = m_parents[node];
+        parentSlots[slot] = parent != INVALID_NODE ? m_slots[parent] : INVALID_SLOT;
+        depths[slot] = parent != INVALID_NODE ? depths[parentSlots[slot]] + 1 : 0;
+    }
+
+    m_slotNodes.swap(slotNodes);
+    m_parentSlots.swap(parentSlots);
+    m_depths.swap(depths);
+    m_positions.swap(positions);
+    m_orientations.swap(orientations);
+    m_scales.swap(scales);
+    m_local.swap(local);
+    m_world.swap(world);
+    m_userData.swap(userData);
+    m_dirty.swap(dirty);
+    m_compose.swap(compose);
+
+    m_composeList.clear();
+    m_firstDirtySlot = INVALID_SLOT;
+    for (size_t slot = 0; slot < count; ++slot)
+    {
+        if (m_compose[slot])
+            m_composeList.push_back(static_cast<uint32_t>(slot));
+        if (m_dirty[slot] && m_firstDirtySlot == INVALID_SLOT)
+            m_firstDirtySlot = static_cast<uint32_t>(slot);
+    }
+
+    m_deadSlots = 0;
+    m_orderDirty = false;
+}
+
+size_t TransformHierarchy::Update(std::vector<uint32_t>* updated)
+{
+    // Removal keeps the order valid, so dead slots are only compacted once they dominate
+    if (m_orderDirty || m_deadSlots > m_slotNodes.size() / 2)
+        Reorder();
+
+    if (m_firstDirtySlot == INVALID_SLOT)
+        return 0;
+
+    // Drop entries overridden by SetLocalMatrix() or destroyed since they were queued
+    m_composeList.erase(std::remove_if(m_composeList.begin(), m_composeList.end(),
+                                       [this](uint32_t slot) { return !m_compose[slot]; }),
+                        m_composeList.end());
+    ComposeLocalMatrices(m_composeList.data(), m_composeList.size());
+    for (uint32_t slot : m_composeList)
+    {
+        m_compose[slot] = 0;
+    }
+    m_composeList.clear();
+
+    // Parents precede children: a node is recomputed when it or its parent was
+    size_t recomputed = 0;
+    const size_t count = m_slotNodes.size();
+    for (size_t slot = m_firstDirtySlot; slot < count; ++slot)
+    {
+        uint32_t parent = m_parentSlots[slot];
+        if (!m_dirty[slot])
+        {
+            if (parent == INVALID_SLOT || !m_dirty[parent])
+                continue;
+            m_dirty[slot] = 1;
+        }
+
+        if (parent == INVALID_SLOT)
+            m_world[slot] = m_local[slot];
+        else
+            MultiplyMatrices(m_world[parent], m_local[slot], m_world[slot]);
+
+        ++recomputed;
+        if (updated != nullptr && m_userData[slot] != NO_USER_DATA)
+            updated->push_back(m_userData[slot]);
+    }
+
+    std::fill(m_dirty.begin() + m_firstDirtySlot, m_dirty.end(), uint8_t(0));
+    m_firstDirtySlot = INVALID_SLOT;
+    m_dirtyCount = 0;
+    return recomputed;
+}
+
+void TransformHierarchy::ComposeLocalMatrices(const uint32_t* slots, size_t count)
+{
+    // translate * scale * mat3_cast(q): column c, row r of the upper 3x3 is scale[r] * R[c][r]
+    size_t k = 0;
+
+#if defined(SNAPENGINE_SSE)
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    for (; k + 4 <= count; k += 4)
+    {
+        const uint32_t s0 = slots[k], s1 = slots[k + 1], s2 = slots[k + 2], s3 = slots[k + 3];
+        const glm::quat& q0 = m_orientations[s0];
+        const glm::quat& q1 = m_orientations[s1];
+        const glm::quat& q2 = m_orientations[s2];
+        const glm::quat& q3 = m_orientations[s3];
+
+        // Gather four nodes into one lane each
+        __m128 qx = _mm_setr_ps(q0.x, q1.x, q2.x, q3.x);
+        __m128 qy = _mm_setr_ps(q0.y, q1.y, q2.y, q3.y);
+        __m128 qz = _mm_setr_ps(q0.z, q1.z, q2.z, q3.z);
+        __m128 qw = _mm_setr_ps(q0.w, q1.w, q2.w, q3.w);
+        __m128 sx = _mm_setr_ps(m_scales[s0].x, m_scales[s1].x, m_scales[s2].x, m_scales[s3].x);
+        __m128 sy = _mm_setr_ps(m_scales[s0].y, m_scales[s1].y, m_scales[s2].y, m_scales[s3].y);
+        __m128 sz = _mm_setr_ps(m_scales[s0].z, m_scales[s1].z, m_scales[s2].z, m_scales[s3].z);
+        __m128 px = _mm_setr_ps(m_positions[s0].x, m_positions[s1].x, m_positions[s2].x, m_positions[s3].x);
+        __m128 py = _mm_setr_ps(m_positions[s0].y, m_positions[s1].y, m_positions[s2].y, m_positions[s3].y);
+        __m128 pz = _mm_setr_ps(m_positions[s0].z, m_positions[s1].z, m_positions[s2].z, m_positions[s3].z);
+
+        __m128 x2 = _mm_add_ps(qx, qx), y2 = _mm_add_ps(qy, qy), z2 = _mm_add_ps(qz, qz);
+        __m128 xx = _mm_mul_ps(qx, x2), yy = _mm_mul_ps(qy, y2), zz = _mm_mul_ps(qz, z2);
+        __m128 xy = _mm_mul_ps(qx, y2), xz = _mm_mul_ps(qx, z2), yz = _mm_mul_ps(qy, z2);
+        __m128 wx = _mm_mul_ps(qw, x2), wy = _mm_mul_ps(qw, y2), wz = _mm_mul_ps(qw, z2);
+
+        __m128 c0r0 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+        __m128 c0r1 = _mm_mul_ps(_mm_add_ps(xy, wz), sy);
+        __m128 c0r2 = _mm_mul_ps(_mm_sub_ps(xz, wy), sz);
+        __m128 c1r0 = _mm_mul_ps(_mm_sub_ps(xy, wz), sx);
+        __m128 c1r1 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+        __m128 c1r2 = _mm_mul_ps(_mm_add_ps(yz, wx), sz);
+        __m128 c2r0 = _mm_mul_ps(_mm_add_ps(xz, wy), sx);
+        __m128 c2r1 = _mm_mul_ps(_mm_sub_ps(yz, wx), sy);
+        __m128 c2r2 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+        __m128 c3r3 = one;
+        __m128 c0r3 = zero, c1r3 = zero, c2r3 = zero;
+
+        // Back to one matrix column per register
+        _MM_TRANSPOSE4_PS(c0r0, c0r1, c0r2, c0r3);
+        _MM_TRANSPOSE4_PS(c1r0, c1r1, c1r2, c1r3);
+        _MM_TRANSPOSE4_PS(c2r0, c2r1, c2r2, c2r3);
+        _MM_TRANSPOSE4_PS(px, py, pz, c3r3);
+
+        float* m0 = glm::value_ptr(m_local[s0]);
+        float* m1 = glm::value_ptr(m_local[s1]);
+        float* m2 = glm::value_ptr(m_local[s2]);
+        float* m3 = glm::value_ptr(m_local[s3]);
+        _mm_storeu_ps(m0, c0r0); _mm_storeu_ps(m0 + 4, c1r0); _mm_storeu_ps(m0 + 8, c2r0); _mm_storeu_ps(m0 + 12, px);
+        _mm_storeu_ps(m1, c0r1); _mm_storeu_ps(m1 + 4, c1r1); _mm_storeu_ps(m1 + 8, c2r1); _mm_storeu_ps(m1 + 12, py);
+        _mm_storeu_ps(m2, c0r2); _mm_storeu_ps(m2 + 4, c1r2); _mm_storeu_ps(m2 + 8, c2r2); _mm_storeu_ps(m2 + 12, pz);
+        _mm_storeu_ps(m3, c0r3); _mm_storeu_ps(m3 + 4, c1r3); _mm_storeu_ps(m3 + 8, c2r3); _mm_storeu_ps(m3 + 12, c3r3);
+    }
+#endif
+
+    for (; k < count; ++k)
+    {
+        const uint32_t slot = slots[k];
+        glm::mat3 rotation = glm::mat3_cast(m_orientations[slot]);
+
+        glm::mat4& local = m_local[slot];
+        for (int column = 0; column < 3; ++column)
+        {
+            local[column] = glm::vec4(rotation[column] * m_scales[slot], 0.0f);
+        }
+        local[3] = glm::vec4(m_positions[slot], 1.0f);
+    }
+}
+
+bool TransformHierarchy::Validate() const
+{
+    if (m_orderDirty)
+        return false;
+
+    for (size_t slot = 0; slot < m_slotNodes.size(); ++slot)
+    {
+        if (slot > 0 && m_depths[slot] < m_depths[slot - 1])
+            return false;
+
+        NodeId node = m_slotNodes[slot];
+        if (node == INVALID_NODE)
+            continue;
+        if (m_slots[node] != slot)
+            return false;
+
+        uint32_t parentSlot = m_parentSlots[slot];
+        NodeId parent = m_parents[node];
+        if (parent == INVALID_NODE)
+        {
+            if (parentSlot != INVALID_SLOT || m_depths[slot] != 0)
+                return false;
+        }
+        else if (parentSlot != m_slots[parent] || parentSlot >= slot || m_depths[slot] != m_depths[parentSlot] + 1)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+
+glm::mat4 ComposeReference(const glm::vec3& position, const glm::quat& orientation, const glm::vec3& scale)
+{
+    return glm::translate(glm::mat4(1.0f), position) * glm::scale(glm::mat4(1.0f), scale) * glm::mat4_cast(orientation);
+}
+
+bool NearlyEqual(const glm::mat4& a, const glm::mat4& b, float tolerance)
+{
+    for (int c = 0; c < 4; ++c)
+        for (int r = 0; r < 4; ++r)
+            if (std::abs(a[c][r] - b[c][r]) > tolerance)
+                return false;
+    return true;
+}
+
+} // namespace
+
+void TransformHierarchy::test()
+{
+    std::cout << "[TransformHierarchy] Running tests...\n";
+
+    const glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+
+    // Test propagation down a chain
+    {
+        TransformHierarchy hierarchy;
+        NodeId a = hierarchy.CreateNode(INVALID_NODE, 0);
+        NodeId b = hierarchy.CreateNode(a, 1);
+        NodeId c = hierarchy.CreateNode(b, 2);
+        assert(hierarchy.GetNodeCount() == 3 && hierarchy.GetDepth(c) == 2 && "Wrong chain structure");
+        assert(hierarchy.GetParent(c) == b && hierarchy.GetChildren(a) == std::vector<NodeId>({ b }) && "Wrong links");
+
+        glm::quat qa = glm::angleAxis(glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        hierarchy.SetLocalTransform(a, glm::vec3(1.0f, 2.0f, 3.0f), qa, glm::vec3(2.0f));
+        hierarchy.SetLocalTransform(b, glm::vec3(0.0f, 1.0f, 0.0f), identity, glm::vec3(1.0f, 0.5f, 1.0f));
+        hierarchy.SetLocalMatrix(c, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -4.0f)));
+
+        std::vector<uint32_t> updated;
+        size_t updatedCount = hierarchy.Update(&updated);
+        assert(updatedCount == 3 && updated.size() == 3 && "All new nodes should update");
+        assert(hierarchy.Validate() && "Order invalid");
+
+        glm::mat4 worldA = ComposeReference(glm::vec3(1.0f, 2.0f, 3.0f), qa, glm::vec3(2.0f));
+        glm::mat4 worldB = worldA * ComposeReference(glm::vec3(0.0f, 1.0f, 0.0f), identity, glm::vec3(1.0f, 0.5f, 1.0f));
+        glm::mat4 worldC = worldB * glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -4.0f));
+        assert(NearlyEqual(hierarchy.GetWorldMatrix(a), worldA, 1e-5f) && "Root world incorrect");
+        assert(NearlyEqual(hierarchy.GetWorldMatrix(b), worldB, 1e-5f) && "Child world incorrect");
+        assert(NearlyEqual(hierarchy.GetWorldMatrix(c), worldC, 1e-5f) && "Grandchild world incorrect");
+
+        // Only the dirty subtree is recomputed
+        updatedCount = hierarchy.Update();
+        assert(updatedCount == 0 && "Clean hierarchy should not update");
+        hierarchy.SetLocalTransform(b, glm::vec3(0.0f, 2.0f, 0.0f), identity, glm::vec3(1.0f));
+        assert(hierarchy.GetDirtyCount() == 1 && "Setter should mark one node dirty");
+        updated.clear();
+        updatedCount = hierarchy.Update(&updated);
+        assert(updatedCount == 2 && "Moving a child should update its subtree only");
+        std::sort(updated.begin(), updated.end());
+        assert(updated == std::vector<uint32_t>({ 1, 2 }) && "Wrong nodes reported");
+        glm::vec3 origin = glm::vec3(hierarchy.GetWorldMatrix(c)[3]);
+        glm::vec3 expected = glm::vec3(worldA * glm::vec4(0.0f, 2.0f, -4.0f, 1.0f));
+        assert(glm::length(origin - expected) < 1e-4f && "Subtree should follow its parent");
+
+        // A new root after deeper nodes forces a re-sort
+        NodeId d = hierarchy.CreateNode(INVALID_NODE, 3);
+        hierarchy.SetLocalTransform(d, glm::vec3(10.0f, 0.0f, 0.0f), identity, glm::vec3(1.0f));
+        hierarchy.Update();
+        assert(hierarchy.Validate() && hierarchy.GetDepth(d) == 0 && "Order invalid after adding a root");
+        assert(NearlyEqual(hierarchy.GetWorldMatrix(c), worldA * glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 2.0f, -4.0f)), 1e-4f) &&
+               "Re-sorting should keep world matrices");
+
+        // Reparenting keeps the local transform
+        hierarchy.SetParent(c, d);
+        updated.clear();
+        hierarchy.Update(&updated);
+        assert(hierarchy.Validate() && updated == std::vector<uint32_t>({ 2 }) && "Reparented node should update");
+        assert(glm::length(glm::vec3(hierarchy.GetWorldMatrix(c)[3]) - glm::vec3(10.0f, 0.0f, -4.0f)) < 1e-5f && "Reparented world incorrect");
+        assert(hierarchy.GetChildren(b).empty() && hierarchy.GetChildren(d) == std::vector<NodeId>({ c }) && "Reparent links incorrect");
+
+        // Destroying a node destroys its subtree
+        hierarchy.DestroyNode(d);
+        assert(!hierarchy.IsValid(d) && !hierarchy.IsValid(c) && hierarchy.IsValid(b) && hierarchy.GetNodeCount() == 2 && "DestroyNode failed");
+        hierarchy.Update();
+        assert(hierarchy.Validate() && "Order invalid after destroy");
+        NodeId reused = hierarchy.CreateNode(a);
+        assert((reused == c || reused == d) && "Ids should be reused");
+    }
+
+    // Test random hierarchies against a recursive reference
+    {
+        std::mt19937 rng(5);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_real_distribution<float> scaleDist(0.5f, 2.0f);
+
+        TransformHierarchy hierarchy;
+        std::vector<NodeId> nodes;
+        std::vector<glm::mat4> locals;
+        auto randomLocal = [&](NodeId node)
+        {
+            glm::vec3 position(unit(rng) * 5.0f, unit(rng) * 5.0f, unit(rng) * 5.0f);
+            glm::quat orientation = glm::angleAxis(unit(rng) * 3.0f, glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, 2.0f)));
+            glm::vec3 scale(scaleDist(rng), scaleDist(rng), scaleDist(rng));
+            hierarchy.SetLocalTransform(node, position, orientation, scale);
+            locals[node] = ComposeReference(position, orientation, scale);
+        };
+
+        for (int i = 0; i < 500; ++i)
+        {
+            NodeId parent = nodes.empty() || rng() % 8 == 0 ? INVALID_NODE : nodes[rng() % nodes.size()];
+            NodeId node = hierarchy.CreateNode(parent, static_cast<uint32_t>(i));
+            nodes.push_back(node);
+            locals.resize(std::max<size_t>(locals.size(), node + 1));
+            randomLocal(node);
+        }
+
+        auto check = [&]()
+        {
+            hierarchy.Update();
+            assert(hierarchy.Validate() && "Random hierarchy order invalid");
+            for (NodeId node : nodes)
+            {
+                glm::mat4 world = locals[node];
+                for (NodeId parent = hierarchy.GetParent(node); parent != INVALID_NODE; parent = hierarchy.GetParent(parent))
+                {
+                    world = locals[parent] * world;
+                }
+                float tolerance = 1e-3f * std::max(1.0f, std::abs(world[3][0]) + std::abs(world[3][1]) + std::abs(world[3][2]));
+                assert(NearlyEqual(hierarchy.GetWorldMatrix(node), world, tolerance) && "Random world matrix incorrect");
+            }
+        };
+        check();
+
+        for (int round = 0; round < 5; ++round)
+        {
+            for (int i = 0; i < 50; ++i)
+            {
+                randomLocal(nodes[rng() % nodes.size()]);
+            }
+            for (int i = 0; i < 10; ++i)
+            {
+                NodeId node = nodes[rng() % nodes.size()];
+                NodeId parent = nodes[rng() % nodes.size()];
+                bool cycle = false;
+                for (NodeId ancestor = parent; ancestor != INVALID_NODE; ancestor = hierarchy.GetParent(ancestor))
+                {
+                    cycle = cycle || ancestor == node;
+                }
+                hierarchy.SetParent(node, cycle ? INVALID_NODE : parent);
+            }
+            check();
+        }
+    }
+
+    std::cout << "[TransformHierarchy] Tests passed!\n";
+}
+
+void TransformHierarchy::benchmark()
+{
+    std::cout << "\nRunning TransformHierarchy benchmarks...\n";
+
+    using Clock = std::chrono::high_resolution_clock;
+    auto timeMs = [](auto&& body)
+    {
+        auto start = Clock::now();
+        body();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    // Many small imported models: a root with two levels of children each
+    const size_t rootCount = 10000;
+    const size_t childrenPerNode = 3;
+    TransformHierarchy hierarchy;
+    std::vector<NodeId> roots;
+    const glm::quat identity(1.0f, 0.0f, 0.0f, 0.0f);
+    for (size_t r = 0; r < rootCount; ++r)
+    {
+        NodeId root = hierarchy.CreateNode();
+        hierarchy.SetLocalTransform(root, glm::vec3(static_cast<float>(r), 0.0f, 0.0f), identity, glm::vec3(1.0f));
+        roots.push_back(root);
+        for (size_t c = 0; c < childrenPerNode; ++c)
+        {
+            NodeId child = hierarchy.CreateNode(root);
+            hierarchy.SetLocalMatrix(child, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+            for (size_t g = 0; g < childrenPerNode; ++g)
+            {
+                NodeId grandchild = hierarchy.CreateNode(child);
+                hierarchy.SetLocalMatrix(grandchild, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+            }
+        }
+    }
+
+    double buildMs = timeMs([&] { hierarchy.Update(); });
+    double staticMs = timeMs([&] { hierarchy.Update(); });
+
+    for (size_t r = 0; r < rootCount; r += 100)
+    {
+        hierarchy.SetLocalTransform(roots[r], glm::vec3(static_cast<float>(r), 1.0f, 0.0f), identity, glm::vec3(1.0f));
+    }
+    size_t subtreeNodes = 0;
+    double onePercentMs = timeMs([&] { subtreeNodes = hierarchy.Update(); });
+
+    for (size_t r = 0; r < rootCount; ++r)
+    {
+        hierarchy.SetLocalTransform(roots[r], glm::vec3(static_cast<float>(r), 2.0f, 0.0f), identity, glm::vec3(1.0f));
+    }
+    double allMs = timeMs([&] { hierarchy.Update(); });
+
+    hierarchy.SetParent(roots[1], roots[0]);
+    double reorderMs = timeMs([&] { hierarchy.Update(); });
+
+    std::cout << "  " << hierarchy.GetNodeCount() << " nodes: first update (sort + all) " << buildMs << " ms, static "
+              << staticMs << " ms\n";
+    std::cout << "  1% of roots moved (" << subtreeNodes << " nodes): " << onePercentMs << " ms, all roots moved: "
+              << allMs << " ms, reparent (re-sort + subtree): " << reorderMs << " ms\n";
+}
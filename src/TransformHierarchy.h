@@ -0,0 +1,249 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+/**
+ * \class TransformHierarchy
+ * \brief Parent/child transform nodes with incremental world-matrix propagation.
+ *
+ * Nodes are addressed by stable ids, but their data lives in slots sorted by depth
+ * (breadth-first), so every parent precedes its children. Update() is then one linear
+ * sweep: starting at the first dirty slot, a node is recomputed when it or its parent
+ * was, and untouched subtrees cost a flag test each. Nothing dirty costs nothing.
+ *
+ * A node's local transform is either position/orientation/scale, composed as
+ * translate * scale * rotate in a batched SIMD pass, or a fixed matrix (e.g. from an
+ * imported file). Structural changes (new roots after deeper nodes, reparenting) only
+ * flag the order; the slots are re-sorted once, at the next Update(). Destroyed nodes
+ * leave detached slots behind that are compacted once they make up half of the slots.
+ */
+class TransformHierarchy
+{
+public:
+    using NodeId = uint32_t;
+
+    /// Id of a missing node, e.g. the parent of a root.
+    static constexpr NodeId INVALID_NODE = 0xFFFFFFFFu;
+
+    /// User data of nodes that do not report updates.
+    static constexpr uint32_t NO_USER_DATA = 0xFFFFFFFFu;
+
+    /**
+     * \brief Create a node with an identity local transform.
+     * \param parent Parent node, or INVALID_NODE for a root.
+     * \param userData Value reported by Update() when the node's world matrix changes.
+     * \return Node id.
+     */
+    NodeId CreateNode(NodeId parent = INVALID_NODE, uint32_t userData = NO_USER_DATA);
+
+    /**
+     * \brief Destroy a node and its whole subtree.
+     * \param node The node.
+     */
+    void DestroyNode(NodeId node);
+
+    /**
+     * \brief Move a node (with its subtree) under another parent, keeping its local transform.
+     * \param node The node.
+     * \param parent New parent, or INVALID_NODE to make it a root. Must not be in node's subtree.
+     */
+    void SetParent(NodeId node, NodeId parent);
+
+    /**
+     * \brief Get the parent of a node.
+     * \param node The node.
+     * \return Parent id, or INVALID_NODE for roots.
+     */
+    NodeId GetParent(NodeId node) const { return m_parents[node]; }
+
+    /**
+     * \brief Get the children of a node.
+     * \param node The node.
+     * \return Child ids in creation order.
+     */
+    std::vector<NodeId> GetChildren(NodeId node) const;
+
+    /**
+     * \brief Set the local transform from position, orientation and scale.
+     * \param node The node.
+     * \param position Translation relative to the parent.
+     * \param orientation Rotation, applied before scale.
+     * \param scale Scale along the parent's axes.
+     */
+    void SetLocalTransform(NodeId node, const glm::vec3& position, const glm::quat& orientation, const glm::vec3& scale);
+
+    /**
+     * \brief Set the local translation, keeping orientation and scale.
+     * \param node The node.
+     * \param position Translation relative to the parent.
+     */
+    void SetLocalPosition(NodeId node, const glm::vec3& position);
+
+    /**
+     * \brief Set the local rotation, keeping position and scale.
+     * \param node The node.
+     * \param orientation Rotation, applied before scale.
+     */
+    void SetLocalOrientation(NodeId node, const glm::quat& orientation);
+
+    /**
+     * \brief Set the local scale, keeping position and orientation.
+     * \param node The node.
+     * \param scale Scale along the parent's axes.
+     */
+    void SetLocalScale(NodeId node, const glm::vec3& scale);
+
+    /**
+     * \brief Set the local transform to a fixed matrix.
+     *
+     * A later position/orientation/scale setter replaces it with a matrix composed from
+     * the node's stored components (identity unless set before).
+     *
+     * \param node The node.
+     * \param local Transform relative to the parent.
+     */
+    void SetLocalMatrix(NodeId node, const glm::mat4& local);
+
+    /**
+     * \brief Get the world matrix of a node.
+     * \param node The node.
+     * \return World matrix as of the last Update().
+     */
+    const glm::mat4& GetWorldMatrix(NodeId node) const { return m_world[m_slots[node]]; }
+
+    /**
+     * \brief Get the local matrix of a node.
+     * \param node The node.
+     * \return Local matrix as of the last Update().
+     */
+    const glm::mat4& GetLocalMatrix(NodeId node) const { return m_local[m_slots[node]]; }
+
+    /**
+     * \brief Set the value reported by Update() for a node.
+     * \param node The node.
+     * \param userData New user data, or NO_USER_DATA.
+     */
+    void SetUserData(NodeId node, uint32_t userData) { m_userData[m_slots[node]] = userData; }
+
+    /**
+     * \brief Get the user data of a node.
+     * \param node The node.
+     * \return User data.
+     */
+    uint32_t GetUserData(NodeId node) const { return m_userData[m_slots[node]]; }
+
+    /**
+     * \brief Recompute the world matrices of dirty nodes and their descendants.
+     * \param updated Optional output: user data of every recomputed node that has some.
+     * \return Number of recomputed nodes.
+     */
+    size_t Update(std::vector<uint32_t>* updated = nullptr);
+
+    /**
+     * \brief Check whether a node id refers to a live node.
+     * \param node The node.
+     * \return True if the node exists.
+     */
+    bool IsValid(NodeId node) const { return node < m_slots.size() && m_slots[node] != INVALID_SLOT; }
+
+    /**
+     * \brief Get the number of live nodes.
+     * \return Node count.
+     */
+    size_t GetNodeCount() const { return m_slotNodes.size() - m_deadSlots; }
+
+    /**
+     * \brief Get the number of nodes whose local transform changed since the last Update().
+     * \return Dirty node count, not counting their descendants.
+     */
+    size_t GetDirtyCount() const { return m_dirtyCount; }
+
+    /**
+     * \brief Get the depth of a node.
+     * \param node The node.
+     * \return 0 for roots.
+     */
+    uint32_t GetDepth(NodeId node) const;
+
+    /**
+     * \brief Check that slots are depth-sorted and parents precede children.
+     * \return True if the order is valid. Only meaningful right after Update().
+     */
+    bool Validate() const;
+
+    /**
+     * \brief Run unit tests for the TransformHierarchy class.
+     */
+    static void test();
+
+    /**
+     * \brief Run performance benchmarks for the TransformHierarchy class.
+     */
+    static void benchmark();
+
+private:
+    static constexpr uint32_t INVALID_SLOT = 0xFFFFFFFFu;
+
+    /**
+     * \brief Flag a slot for recomputation.
+     * \param slot The slot.
+     * \param compose Whether its local matrix must be composed from position/orientation/scale.
+     */
+    void MarkDirty(uint32_t slot, bool compose);
+
+    /**
+     * \brief Re-sort the slots breadth-first and drop destroyed nodes.
+     */
+    void Reorder();
+
+    /**
+     * \brief Compose local matrices from position, orientation and scale, four slots at a time.
+     * \param slots Slots to compose.
+     * \param count Number of slots.
+     */
+    void ComposeLocalMatrices(const uint32_t* slots, size_t count);
+
+    /**
+     * \brief Unlink a node from its parent's child list.
+     * \param node The node.
+     */
+    void Unlink(NodeId node);
+
+    /**
+     * \brief Append a node to a parent's child list.
+     * \param node The node.
+     * \param parent The parent.
+     */
+    void Link(NodeId node, NodeId parent);
+
+    // Per node id
+    std::vector<uint32_t> m_slots;              ///< Slot of each node, INVALID_SLOT if free
+    std::vector<NodeId> m_parents;              ///< Parent of each node
+    std::vector<NodeId> m_firstChild;           ///< First child of each node
+    std::vector<NodeId> m_lastChild;            ///< Last child of each node
+    std::vector<NodeId> m_nextSibling;          ///< Next sibling of each node
+    std::vector<NodeId> m_freeIds;              ///< Ids available for reuse
+
+    // Per slot, depth-sorted
+    std::vector<NodeId> m_slotNodes;            ///< Node in each slot, INVALID_NODE once destroyed
+    std::vector<uint32_t> m_parentSlots;        ///< Slot of the parent, INVALID_SLOT for roots
+    std::vector<uint32_t> m_depths;             ///< Depth of each slot
+    std::vector<glm::vec3> m_positions;         ///< Local translation
+    std::vector<glm::quat> m_orientations;      ///< Local rotation
+    std::vector<glm::vec3> m_scales;            ///< Local scale
+    std::vector<glm::mat4> m_local;             ///< Local matrix
+    std::vector<glm::mat4> m_world;             ///< World matrix
+    std::vector<uint32_t> m_userData;           ///< Reported by Update()
+    std::vector<uint8_t> m_dirty;               ///< World matrix needs recomputing
+    std::vector<uint8_t> m_compose;             ///< Local matrix needs composing
+
+    std::vector<uint32_t> m_composeList;        ///< Slots with m_compose set
+    uint32_t m_firstDirtySlot = INVALID_SLOT;   ///< Lowest dirty slot
+    size_t m_dirtyCount = 0;                    ///< Slots with m_dirty set by a setter
+    size_t m_deadSlots = 0;                     ///< Destroyed nodes not yet compacted away
+    bool m_orderDirty = false;                  ///< Slots must be re-sorted before the sweep
+};
@@ -0,0 +1,179 @@
+#include "VertexArrayCache.h"
+#include "Mesh.h"
+#include "GlApi.h"
+#include "AllocationCounter.h"
+#include <iostream>
+#include <cassert>
+#include <mutex>
+#include <algorithm>
+
+namespace {
+
+// Every live cache, for Release(); also guards their m_arrays writes and m_released
+std::mutex s_registryMutex;
+std::vector<VertexArrayCache*> s_caches;
+
+} // namespace
+
+VertexArrayCache::VertexArrayCache()
+{
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    s_caches.push_back(this);
+}
+
+VertexArrayCache::~VertexArrayCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        s_caches.erase(std::find(s_caches.begin(), s_caches.end(), this));
+    }
+    Clear();
+}
+
+GLuint VertexArrayCache::Get(const Mesh& mesh)
+{
+    // Only this cache's thread writes m_arrays, so it may read without the lock
+    auto it = m_arrays.find(mesh.id);
+    if (it != m_arrays.end())
+        return it->second;
+
+    GLuint vao = 0;
+    GlApi::CreateVertexArrays(1, &vao);
+    Mesh::SetupVertexArray(vao, mesh.vbo, mesh.ebo);
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    m_arrays.emplace(mesh.id, vao);
+    return vao;
+}
+
+void VertexArrayCache::DeleteReleased()
+{
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    for (uint64_t id : m_released)
+    {
+        auto it = m_arrays.find(id);
+        if (it == m_arrays.end())
+            continue;
+        GlApi::DeleteVertexArrays(1, &it->second);
+        m_arrays.erase(it);
+    }
+    m_released.clear();
+}
+
+void VertexArrayCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    for (const auto& entry : m_arrays)
+        GlApi::DeleteVertexArrays(1, &entry.second);
+    m_arrays.clear();
+    m_released.clear();
+}
+
+void VertexArrayCache::Release(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    for (VertexArrayCache* cache : s_caches)
+    {
+        if (cache->m_arrays.count(id) != 0)
+            cache->m_released.push_back(id);
+    }
+}
+
+size_t VertexArrayCache::GetReleasedCount() const
+{
+    std::lock_guard<std::mutex> lock(s_registryMutex);
+    return m_released.size();
+}
+
+void VertexArrayCache::test()
+{
+    std::cout << "[VertexArrayCache] Running tests...\n";
+
+    bool testMode = GlApi::IsTestMode();
+    GlApi::SetTestMode(true);
+    GlApi::ResetStateCache();
+
+    auto material = std::make_shared<Material>(std::vector<Texture>(), MaterialParameters());
+    Mesh first({ Vertex(), Vertex(), Vertex() }, { 0, 1, 2 }, material);
+    Mesh second({ Vertex(), Vertex(), Vertex() }, { 0, 1, 2 }, material);
+    assert(first.id != 0 && second.id != first.id && "Meshes should get distinct ids");
+
+    // Without a cache, meshes draw with their own vertex arrays
+    assert(VertexArrayCache::GetCurrent() == nullptr && "No cache should be current by default");
+    {
+        VertexArrayCache cache;
+        {
+            VertexArrayCache::Scope scope(&cache);
+            assert(VertexArrayCache::GetCurrent() == &cache && "Scope should install the cache");
+
+            // The first draw creates a vertex array over the shared buffers, later ones reuse it
+            first.Draw(DEPTH_PASS);
+            assert(cache.GetCount() == 1 && "First draw should create a vertex array");
+            GLuint vao = cache.Get(first);
+            assert(vao != 0 && first.vao == 0 && "A mesh drawn through a cache should not create its own vertex array");
+
+            GlApi::BeginFrame();
+            uint64_t allocations = AllocationCounter::GetCount();
+            first.Draw(DEPTH_PASS);
+            assert((!AllocationCounter::IsEnabled() || AllocationCounter::GetCount() == allocations) && GlApi::GetCurrentStats().calls == 2 &&
+                   "A cached draw should be one bind and one draw");
+            assert(GlApi::GetCurrentStats().redundantStateChanges == 1 && "The cached vertex array should be bound again");
+
+            second.Draw(DEPTH_PASS);
+            GLuint secondVao = cache.Get(second);
+            assert(cache.GetCount() == 2 && secondVao != vao && "Each mesh should get its own vertex array");
+
+            // Scopes nest
+            {
+                VertexArrayCache::Scope inner(nullptr);
+                assert(VertexArrayCache::GetCurrent() == nullptr && "Inner scope should replace the cache");
+            }
+            assert(VertexArrayCache::GetCurrent() == &cache && "Leaving a scope should restore the previous cache");
+        }
+        assert(VertexArrayCache::GetCurrent() == nullptr && "Leaving the scope should uninstall the cache");
+
+        // Without a cache, the first draw creates the mesh's own vertex array
+        first.Draw(DEPTH_PASS);
+        GLuint cachedVao = cache.Get(first);
+        assert(first.vao != 0 && first.vao != cachedVao && "A mesh drawn without a cache should get its own vertex array");
+        GlApi::BeginFrame();
+        first.Draw(DEPTH_PASS);
+        assert(GlApi::GetCurrentStats().calls == 2 && "Later draws should reuse the mesh's own vertex array");
+
+        // Destroying a mesh queues its vertex array in every cache holding one, until the owner deletes it
+        {
+            VertexArrayCache other;
+            Mesh doomed({ Vertex(), Vertex(), Vertex() }, { 0, 1, 2 }, material);
+            Mesh moved({ Vertex(), Vertex(), Vertex() }, { 0, 1, 2 }, material);
+            {
+                VertexArrayCache::Scope scope(&cache);
+                doomed.Draw(DEPTH_PASS);
+                moved.Draw(DEPTH_PASS);
+            }
+            {
+                Mesh owner(std::move(moved));
+                Mesh released(std::move(doomed));
+            }
+            assert(cache.GetCount() == 4 && cache.GetReleasedCount() == 2 && other.GetReleasedCount() == 0 &&
+                   "Only caches holding the meshes should queue them, once per mesh");
+
+            GlApi::BeginFrame();
+            cache.DeleteReleased();
+            assert(cache.GetCount() == 2 && cache.GetReleasedCount() == 0 && GlApi::GetCurrentStats().calls == 2 &&
+                   "DeleteReleased should delete the queued vertex arrays");
+            cache.Get(first);
+            cache.Get(second);
+            assert(cache.GetCount() == 2 && "Live meshes should keep their vertex arrays");
+        }
+
+        // Clearing deletes every vertex array
+        GlApi::BeginFrame();
+        cache.Clear();
+        assert(cache.GetCount() == 0 && GlApi::GetCurrentStats().calls == 2 && "Clear should delete each vertex array");
+    }
+
+    GlApi::BeginFrame();
+    GlApi::ResetStateCache();
+    GlApi::SetTestMode(testMode);
+
+    std::cout << "[VertexArrayCache] Tests passed!\n";
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <GL/glew.h>
+
+struct Mesh;
+
+/**
+ * \class VertexArrayCache
+ * \brief Vertex arrays of shared meshes for one GL context.
+ *
+ * Buffers, textures and programs are shared by every context of a share group, but
+ * vertex arrays are not: a mesh's own vertex array only exists in the context that first
+ * drew it. A context drawing shared meshes installs its cache with a Scope, and
+ * Mesh::Draw() then binds the vertex array the cache creates on first use, over the
+ * mesh's shared buffers; such meshes never create a vertex array of their own.
+ *
+ * The cache must be used and destroyed with its context current. Meshes may be
+ * destroyed on any thread: each one queues its id in every cache holding a vertex array
+ * for it, and the owner deletes those with DeleteReleased(), e.g. once per frame.
+ */
+class VertexArrayCache
+{
+public:
+    /**
+     * \class Scope
+     * \brief Makes a cache the calling thread's current one for its lifetime.
+     */
+    class Scope
+    {
+    public:
+        /**
+         * \brief Constructor.
+         * \param cache The cache; nullptr to draw with the meshes' own vertex arrays.
+         */
+        explicit Scope(VertexArrayCache* cache) : m_previous(t_current) { t_current = cache; }
+
+        /**
+         * \brief Destructor. Restores the previous cache.
+         */
+        ~Scope() { t_current = m_previous; }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        VertexArrayCache* m_previous;   ///< Cache current before this scope
+    };
+
+    /**
+     * \brief Constructor. Registers the cache for mesh releases.
+     */
+    VertexArrayCache();
+
+    /**
+     * \brief Destructor. Deletes the vertex arrays.
+     */
+    ~VertexArrayCache();
+
+    VertexArrayCache(const VertexArrayCache&) = delete;
+    VertexArrayCache& operator=(const VertexArrayCache&) = delete;
+
+    /**
+     * \brief Get the vertex array of a mesh, creating it on first use.
+     * \param mesh The mesh.
+     * \return Vertex array name in this cache's context.
+     */
+    GLuint Get(const Mesh& mesh);
+
+    /**
+     * \brief Delete the vertex arrays of meshes destroyed since the last call.
+     */
+    void DeleteReleased();
+
+    /**
+     * \brief Delete every vertex array, e.g. after the meshes were unloaded.
+     */
+    void Clear();
+
+    /**
+     * \brief Queue a destroyed mesh's vertex array for deletion in every cache holding one.
+     *
+     * Called by the Mesh destructor; safe on any thread.
+     *
+     * \param id Mesh::id of the destroyed mesh.
+     */
+    static void Release(uint64_t id);
+
+    /**
+     * \brief Get the number of vertex arrays created.
+     * \return Cached vertex arrays.
+     */
+    size_t GetCount() const { return m_arrays.size(); }
+
+    /**
+     * \brief Get the number of vertex arrays waiting for DeleteReleased().
+     * \return Queued vertex arrays.
+     */
+    size_t GetReleasedCount() const;
+
+    /**
+     * \brief Get the calling thread's current cache.
+     * \return The cache, nullptr if meshes draw with their own vertex arrays.
+     */
+    static VertexArrayCache* GetCurrent() { return t_current; }
+
+    /**
+     * \brief Run unit tests for the VertexArrayCache class.
+     */
+    static void test();
+
+private:
+    std::unordered_map<uint64_t, GLuint> m_arrays;      ///< Vertex array by Mesh::id; written under the registry lock
+    std::vector<uint64_t> m_released;                   ///< Ids of destroyed meshes in m_arrays; under the registry lock
+
+    static inline thread_local VertexArrayCache* t_current = nullptr;  ///< Calling thread's current cache
+};
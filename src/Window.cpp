@@ -1,20 +1,33 @@
 #include "Window.h"
+#include "Profiler.h"
+#include "GlApi.h"
 #include <iostream>
 #include <stdexcept>
+#include <cmath>
 
 // Initialize static members
 bool Window::s_testMode = false;
+int Window::s_windowCount = 0;
 
-Window::Window(const std::string& title, int width, int height)
+Window::Window(const std::string& title, int width, int height, Window* shareWith)
     : m_title(title)
     , m_width(width)
     , m_height(height)
     , m_window(nullptr)
+    , m_shareWith(shareWith != nullptr ? shareWith->m_window : nullptr)
+    , m_renderThreadEnabled(false)
+    , m_maxFrameRate(0)
+    , m_swapInterval(1)
+    , m_renderMode(CONTINUOUS_RENDERING)
+    , m_idleTimeout(0.5)
+    , m_renderedFrames(0)
+    , m_closeRequested(false)
 {
     // Skip window creation in test mode
     if (s_testMode)
     {
         std::cout << "Window creation skipped in test mode\n";
+        m_scene = std::make_unique<Scene>(shareWith != nullptr ? shareWith->GetScene()->GetResources() : nullptr);
         return;
     }
 
@@ -25,8 +38,9 @@ Window::Window(const std::string& title, int width, int height)
     }
 
     // Configure GLFW
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    // 4.5 for direct state access and immutable storage
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     // Create window
@@ -35,40 +49,63 @@ Window::Window(const std::string& title, int width, int height)
         throw std::runtime_error("Failed to create GLFW window");
     }
 
-    // Create scene
-    m_scene = std::make_unique<Scene>();
+    // Create scene, drawing from the shared window's resources
+    m_scene = std::make_unique<Scene>(shareWith != nullptr ? shareWith->GetScene()->GetResources() : nullptr);
 
     // Set callbacks
     glfwSetWindowUserPointer(m_window, this);
     glfwSetKeyCallback(m_window, keyCallback);
     glfwSetCursorPosCallback(m_window, mouseCallback);
     glfwSetScrollCallback(m_window, scrollCallback);
+    glfwSetWindowRefreshCallback(m_window, refreshCallback);
 
     // Configure OpenGL
-    glEnable(GL_DEPTH_TEST);
+    GlApi::Enable(GL_DEPTH_TEST);
 }
 
 Window::~Window()
 {
+    // The render thread draws the scene, so it goes first
+    StopRenderThread();
+
     if (m_window != nullptr)
     {
+        // The scene's GL objects go while the context still exists
+        MakeCurrent();
+        m_scene.reset();
+        PROFILE_CALL(Profiler::Get().ReleaseGpuQueries());
         glfwDestroyWindow(m_window);
-        glfwTerminate();
+
+        // Terminating destroys every window, so only the last one does
+        if (--s_windowCount == 0)
+            glfwTerminate();
     }
 }
 
+void Window::MakeCurrent()
+{
+    if (m_window == nullptr || glfwGetCurrentContext() == m_window)
+        return;
+
+    glfwMakeContextCurrent(m_window);
+
+    // The shadowed bindings were those of the previous context
+    GlApi::ResetStateCache();
+}
+
 bool Window::Create()
 {
     // Create GLFW window
-    m_window = glfwCreateWindow(m_width, m_height, m_title.c_str(), nullptr, nullptr);
+    m_window = glfwCreateWindow(m_width, m_height, m_title.c_str(), nullptr, m_shareWith);
     if (!m_window)
     {
         std::cerr << "Failed to create GLFW window" << std::endl;
         return false;
     }
+    ++s_windowCount;
 
     // Make the window's context current
-    glfwMakeContextCurrent(m_window);
+    MakeCurrent();
 
     // Initialize GLEW
     if (glewInit() != GLEW_OK)
@@ -78,13 +115,10 @@ bool Window::Create()
     }
 
     // Set viewport
-    glViewport(0, 0, m_width, m_height);
+    GlApi::Viewport(0, 0, m_width, m_height);
 
     // Set up window resize callback
-    glfwSetFramebufferSizeCallback(m_window, [](GLFWwindow* window, int width, int height)
-    {
-        glViewport(0, 0, width, height);
-    });
+    glfwSetFramebufferSizeCallback(m_window, framebufferSizeCallback);
 
     return true;
 }
@@ -94,25 +128,198 @@ void Window::Run()
     if (s_testMode || m_window == nullptr)
         return;
 
+    // Another window may have been drawn to since
+    MakeCurrent();
+    glfwSwapInterval(m_swapInterval);
+
+    if (m_renderThreadEnabled)
+    {
+        RunThreaded();
+        return;
+    }
+
     // Main render loop
-    float lastFrame = 0.0f;
+    m_renderedFrames = 0;
+    auto lastFrame = FrameClock::Clock::now();
+    while (!glfwWindowShouldClose(m_window))
+    {
+        // Handle events, sleeping first if nothing changed
+        if (WaitForRedraw())
+            lastFrame = FrameClock::Clock::now();
+        if (glfwWindowShouldClose(m_window))
+            break;
+
+        auto frameStart = FrameClock::Clock::now();
+        double frameTime = std::chrono::duration<double>(frameStart - lastFrame).count();
+        lastFrame = frameStart;
+        {
+            PROFILE_SCOPE("Window::Frame");
+
+            // Advance the simulation
+            Simulate(frameTime);
+
+            // Render scene and swap buffers
+            GlApi::BeginFrame();
+            m_scene->Render();
+            {
+                PROFILE_SCOPE("Window::SwapBuffers");
+                glfwSwapBuffers(m_window);
+            }
+            GlApi::EndFrame();
+            ++m_renderedFrames;
+        }
+
+        // Hand this frame's scopes to the profiler
+        PROFILE_CALL(Profiler::Get().ResolveGpuQueries());
+        PROFILE_CALL(Profiler::Get().Collect());
+
+        LimitFrameRate(frameStart);
+    }
+}
+
+void Window::RunThreaded()
+{
+    StartRenderThread();
+
+    // Simulation loop: frame N + 1 is built while frame N renders
+    auto lastFrame = FrameClock::Clock::now();
     while (!glfwWindowShouldClose(m_window))
     {
-        // Calculate delta time
-        float currentFrame = static_cast<float>(glfwGetTime());
-        float deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        // Handle events, sleeping first if nothing changed
+        if (WaitForRedraw())
+            lastFrame = FrameClock::Clock::now();
+        if (glfwWindowShouldClose(m_window))
+            break;
+
+        auto frameStart = FrameClock::Clock::now();
+        double frameTime = std::chrono::duration<double>(frameStart - lastFrame).count();
+        lastFrame = frameStart;
+        {
+            PROFILE_SCOPE("Window::Frame");
+
+            // Advance the simulation
+            Simulate(frameTime);
+
+            // Build the next snapshot, waiting for the render thread to free one
+            SubmitSnapshot(m_renderThread->AcquireSnapshot());
+            ++m_renderedFrames;
+        }
+
+        // Collect this thread's scopes and whatever the render thread has finished
+        PROFILE_CALL(Profiler::Get().Collect());
+
+        LimitFrameRate(frameStart);
+    }
+
+    StopRenderThread();
+    std::cout << "Render thread: " << m_frameTimings.frames << " frames\n"
+              << "  simulation: " << m_frameTimings.simulateMs << " ms work, " << m_frameTimings.waitMs << " ms waiting\n"
+              << "  render:     " << m_frameTimings.renderMs << " ms submit, " << m_frameTimings.presentMs << " ms present, "
+              << m_frameTimings.idleMs << " ms waiting\n";
+}
 
-        // Update scene
-        m_scene->Update(deltaTime);
+void Window::StartRenderThread(std::atomic<uint64_t>* presented, RenderThread::RenderFunction render)
+{
+    if ((m_window == nullptr && !s_testMode) || m_renderThread)
+        return;
 
-        // Render scene
-        m_scene->Render();
+    // The swap interval belongs to the context, so set it before handing it over
+    if (m_window != nullptr)
+    {
+        MakeCurrent();
+        glfwSwapInterval(m_swapInterval);
+        glfwMakeContextCurrent(nullptr);
+    }
 
-        // Swap buffers and poll events
-        glfwSwapBuffers(m_window);
-        glfwPollEvents();
+    if (!render)
+    {
+        Scene* scene = m_scene.get();
+        render = [scene](const RenderSnapshot& snapshot)
+        {
+            scene->Submit(snapshot);
+        };
     }
+
+    m_renderedFrames = 0;
+    m_renderThread = std::make_unique<RenderThread>(m_window, std::move(render), presented);
+}
+
+FrameResult Window::SubmitFrame(double frameTime)
+{
+    Simulate(frameTime);
+    if (!NeedsRedraw())
+        return FRAME_IDLE;
+
+    RenderSnapshot* snapshot = m_renderThread->TryAcquireSnapshot();
+    if (snapshot == nullptr)
+        return FRAME_SKIPPED;
+
+    SubmitSnapshot(*snapshot);
+    ++m_renderedFrames;
+    return FRAME_SUBMITTED;
+}
+
+void Window::StopRenderThread()
+{
+    if (!m_renderThread)
+        return;
+
+    // Take the context back
+    m_renderThread->Stop();
+    m_frameTimings = m_renderThread->GetTimings();
+    m_renderThread.reset();
+    MakeCurrent();
+}
+
+void Window::SubmitSnapshot(RenderSnapshot& snapshot)
+{
+    m_scene->BuildSnapshot(snapshot);
+    snapshot.viewportWidth = m_width;
+    snapshot.viewportHeight = m_height;
+    m_renderThread->SubmitSnapshot();
+}
+
+bool Window::ShouldClose() const
+{
+    return m_window != nullptr ? glfwWindowShouldClose(m_window) : m_closeRequested;
+}
+
+bool Window::WaitForRedraw()
+{
+    glfwPollEvents();
+    if (m_renderMode != ON_DEMAND_RENDERING)
+        return false;
+
+    // Nothing to show: sleep until input, a resize or the timeout
+    bool slept = false;
+    while (!m_scene->NeedsRedraw() && !glfwWindowShouldClose(m_window))
+    {
+        glfwWaitEventsTimeout(m_idleTimeout);
+        slept = true;
+    }
+    return slept;
+}
+
+void Window::Simulate(double frameTime)
+{
+    PROFILE_SCOPE("Window::Simulate");
+
+    int steps = m_frameClock.Advance(frameTime);
+    float step = static_cast<float>(m_frameClock.GetFixedTimestep());
+    for (int i = 0; i < steps; ++i)
+    {
+        m_scene->Update(step);
+    }
+    m_scene->SetInterpolationAlpha(static_cast<float>(m_frameClock.GetAlpha()));
+}
+
+void Window::LimitFrameRate(FrameClock::Clock::time_point frameStart) const
+{
+    if (m_maxFrameRate <= 0)
+        return;
+
+    auto frameDuration = std::chrono::duration_cast<FrameClock::Clock::duration>(std::chrono::duration<double>(1.0 / m_maxFrameRate));
+    FrameClock::SleepUntil(frameStart + frameDuration);
 }
 
 void Window::Close()
@@ -121,6 +328,18 @@ void Window::Close()
     {
         glfwSetWindowShouldClose(m_window, true);
     }
+    else
+    {
+        m_closeRequested = true;
+    }
+}
+
+void Window::Hide()
+{
+    if (m_window != nullptr)
+    {
+        glfwHideWindow(m_window);
+    }
 }
 
 void Window::AddModel(std::shared_ptr<Model> model, const glm::vec3& position, const glm::vec3& scale, const glm::vec3& rotation)
@@ -138,7 +357,21 @@ void Window::framebufferSizeCallback(GLFWwindow* window, int width, int height)
     {
         win->m_width = width;
         win->m_height = height;
-        glViewport(0, 0, width, height);
+        if (win->m_scene)
+            win->m_scene->MarkDirty();
+        // The render thread applies the size from the next snapshot, and another
+        // window's context may be current
+        if (!win->m_renderThread && glfwGetCurrentContext() == window)
+            GlApi::Viewport(0, 0, width, height);
+    }
+}
+
+void Window::refreshCallback(GLFWwindow* window)
+{
+    Window* win = static_cast<Window*>(glfwGetWindowUserPointer(window));
+    if (win != nullptr && win->m_scene)
+    {
+        win->m_scene->MarkDirty();
     }
 }
 
@@ -201,6 +434,26 @@ void Window::test()
     assert(window.m_width == 800 && "Window width not set correctly");
     assert(window.m_height == 600 && "Window height not set correctly");
 
+    // Test frame loop settings
+    assert(window.GetSwapInterval() == 1 && window.GetMaxFrameRate() == 0 && "Wrong frame loop defaults");
+    window.SetFixedTimestep(1.0 / 120.0);
+    window.SetMaxFrameTime(0.1);
+    window.SetMaxFrameRate(144);
+    window.SetSwapInterval(0);
+    assert(window.GetFrameClock().GetFixedTimestep() == 1.0 / 120.0 && window.GetFrameClock().GetMaxFrameTime() == 0.1 &&
+           "Frame clock settings not applied");
+    assert(window.GetMaxFrameRate() == 144 && window.GetSwapInterval() == 0 && "Frame cap settings not applied");
+
+    // Simulating a frame runs whole steps and leaves the remainder for interpolation
+    window.Simulate(1.5 / 120.0);
+    assert(std::abs(window.GetScene()->GetInterpolationAlpha() - 0.5f) < 1e-4f && "Scene interpolation not set");
+
+    // Test render mode settings
+    assert(window.GetRenderMode() == CONTINUOUS_RENDERING && "Window should render continuously by default");
+    window.SetRenderMode(ON_DEMAND_RENDERING);
+    window.SetIdleTimeout(0.1);
+    assert(window.GetRenderMode() == ON_DEMAND_RENDERING && "Render mode not set");
+
     // Test model addition
     auto model = std::make_shared<Model>();
     window.AddModel(model);
@@ -5,10 +5,35 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include "Scene.h"
+#include "RenderThread.h"
+#include "FrameClock.h"
+
+/**
+ * \brief How Window::Run() decides when to render.
+ */
+enum RenderMode
+{
+    CONTINUOUS_RENDERING,   ///< Render every frame
+    ON_DEMAND_RENDERING     ///< Sleep in the event queue until the scene needs a redraw
+};
+
+/**
+ * \brief What Window::SubmitFrame() did with a frame.
+ */
+enum FrameResult
+{
+    FRAME_SUBMITTED,        ///< A snapshot went to the render thread
+    FRAME_IDLE,             ///< Nothing to draw in on-demand mode
+    FRAME_SKIPPED           ///< The render thread was still busy with both snapshots
+};
 
 /**
  * \class Window
  * \brief A window for rendering 3D scenes.
+ *
+ * A window created to share with another gets a context in the same share group and a
+ * scene drawing from the other scene's ResourcePool, so shaders, meshes and textures are
+ * loaded once for both; only its vertex arrays, framebuffers and camera are its own.
  */
 class Window
 {
@@ -18,30 +43,191 @@ public:
      * \param title Window title.
      * \param width Window width.
      * \param height Window height.
+     * \param shareWith Window whose context and resources to share, or nullptr. Must
+     *                  outlive this window.
      */
-    Window(const std::string& title = "SnapEngine", int width = 800, int height = 600);
+    Window(const std::string& title = "SnapEngine", int width = 800, int height = 600, Window* shareWith = nullptr);
 
     /**
-     * \brief Create and initialize the window.
+     * \brief Create and initialize the window. Called by the constructor.
      * \return True if window creation was successful, false otherwise.
      */
     bool Create();
 
     /**
-     * \brief Destructor.
+     * \brief Destructor. Terminates GLFW when the last window goes.
      */
     ~Window();
 
     /**
-     * \brief Run the window's main loop.
+     * \brief Make the window's context current on the calling thread.
+     */
+    void MakeCurrent();
+
+    /**
+     * \brief Run the window's main loop until the window is closed.
+     *
+     * Each frame polls events, advances the scene in fixed steps, renders it interpolated
+     * between the last two steps, swaps buffers and then sleeps off the rest of the frame
+     * if a frame cap is set. With the render thread enabled, the calling thread handles
+     * input, updates the scene and builds snapshots while the render thread draws the
+     * previous frame.
      */
     void Run();
 
+    /**
+     * \brief Set the simulation step used by Run().
+     * \param seconds Step in seconds.
+     */
+    void SetFixedTimestep(double seconds) { m_frameClock.SetFixedTimestep(seconds); }
+
+    /**
+     * \brief Set the longest frame time simulated in one frame; longer frames are clamped.
+     * \param seconds Spike clamp in seconds.
+     */
+    void SetMaxFrameTime(double seconds) { m_frameClock.SetMaxFrameTime(seconds); }
+
+    /**
+     * \brief Cap the frame rate of Run().
+     * \param framesPerSecond Maximum frames per second, 0 for no cap.
+     */
+    void SetMaxFrameRate(int framesPerSecond) { m_maxFrameRate = framesPerSecond; }
+
+    /**
+     * \brief Get the frame rate cap of Run().
+     * \return Maximum frames per second, 0 for no cap.
+     */
+    int GetMaxFrameRate() const { return m_maxFrameRate; }
+
+    /**
+     * \brief Set the number of vertical blanks to wait for on each buffer swap.
+     * \param interval 0 disables vsync, 1 syncs to every refresh. Applied when Run() starts.
+     */
+    void SetSwapInterval(int interval) { m_swapInterval = interval; }
+
+    /**
+     * \brief Get the swap interval.
+     * \return Vertical blanks per buffer swap.
+     */
+    int GetSwapInterval() const { return m_swapInterval; }
+
+    /**
+     * \brief Choose when Run() renders.
+     *
+     * In on-demand mode the loop blocks in the event queue while Scene::NeedsRedraw() is
+     * false, so a static scene costs no CPU. Other threads that change the scene should
+     * call Scene::MarkDirty() and glfwPostEmptyEvent() to wake the loop, or hold it in
+     * continuous mode with Scene::BeginContinuousRendering(); both are thread-safe.
+     *
+     * \param mode The render mode.
+     */
+    void SetRenderMode(RenderMode mode) { m_renderMode = mode; }
+
+    /**
+     * \brief Get when Run() renders.
+     * \return The render mode.
+     */
+    RenderMode GetRenderMode() const { return m_renderMode; }
+
+    /**
+     * \brief Set how long an idle on-demand loop sleeps between checks of the scene.
+     * \param seconds Wait timeout in seconds.
+     */
+    void SetIdleTimeout(double seconds) { m_idleTimeout = seconds; }
+
+    /**
+     * \brief Get how long an idle on-demand loop sleeps between checks of the scene.
+     * \return Wait timeout in seconds.
+     */
+    double GetIdleTimeout() const { return m_idleTimeout; }
+
+    /**
+     * \brief Get the number of frames rendered by the last Run().
+     * \return Rendered frame count.
+     */
+    uint64_t GetRenderedFrames() const { return m_renderedFrames; }
+
+    /**
+     * \brief Get the fixed-timestep clock driving Run().
+     * \return The frame clock.
+     */
+    const FrameClock& GetFrameClock() const { return m_frameClock; }
+
+    /**
+     * \brief Choose whether Run() renders on a dedicated thread.
+     *
+     * Models must be loaded before Run(), as the render thread owns the GL context
+     * while it runs.
+     *
+     * \param enabled Whether to use a render thread.
+     */
+    void SetRenderThreadEnabled(bool enabled) { m_renderThreadEnabled = enabled; }
+
+    /**
+     * \brief Check whether Run() renders on a dedicated thread.
+     * \return True if the render thread is enabled.
+     */
+    bool IsRenderThreadEnabled() const { return m_renderThreadEnabled; }
+
+    /**
+     * \brief Get the per-thread frame timings of the last threaded Run().
+     * \return Average timings, all zero if the render thread was not used.
+     */
+    const FrameTimings& GetFrameTimings() const { return m_frameTimings; }
+
+    /**
+     * \brief Hand the context to a new render thread, for a caller running its own loop.
+     *
+     * The window must not be running. Events are left to the caller, who then calls
+     * SubmitFrame() once per frame and StopRenderThread() at the end. In test mode the
+     * thread runs without a context.
+     *
+     * \param presented Counter the render thread increments and notifies after each frame,
+     *                  or nullptr; see RenderThread.
+     * \param render Function drawing each snapshot, or nullptr for the scene's Submit().
+     */
+    void StartRenderThread(std::atomic<uint64_t>* presented = nullptr, RenderThread::RenderFunction render = nullptr);
+
+    /**
+     * \brief Advance the scene by a frame and hand a snapshot of it to the render thread.
+     *
+     * Never waits: if both snapshots are still in flight the frame is skipped for this
+     * window, so a slow window does not hold up the caller's other windows.
+     *
+     * \param frameTime Seconds since the previous frame.
+     * \return Whether the frame was submitted, idle or skipped.
+     */
+    FrameResult SubmitFrame(double frameTime);
+
+    /**
+     * \brief Render the submitted frames, stop the render thread and take the context back.
+     *
+     * The thread's timings are kept for GetFrameTimings().
+     */
+    void StopRenderThread();
+
+    /**
+     * \brief Check whether the window has something to draw in its render mode.
+     * \return False in on-demand mode while the scene needs no redraw.
+     */
+    bool NeedsRedraw() const { return m_renderMode != ON_DEMAND_RENDERING || m_scene->NeedsRedraw(); }
+
+    /**
+     * \brief Check whether the user or Close() asked the window to close.
+     * \return True if the window should close.
+     */
+    bool ShouldClose() const;
+
     /**
      * \brief Close the window.
      */
     void Close();
 
+    /**
+     * \brief Hide the window, e.g. once it stopped rendering after being closed.
+     */
+    void Hide();
+
     /**
      * \brief Process window messages.
      * \return True if window is still open, false if it should close.
@@ -100,11 +286,45 @@ public:
     static bool IsTestMode() { return s_testMode; }
 
 private:
+    /**
+     * \brief Main loop with rendering on a dedicated thread.
+     */
+    void RunThreaded();
+
+    /**
+     * \brief Build a snapshot of the scene for the render thread and submit it.
+     * \param snapshot Snapshot acquired from the render thread.
+     */
+    void SubmitSnapshot(RenderSnapshot& snapshot);
+
+    /**
+     * \brief Process pending events; in on-demand mode, block until a redraw is needed.
+     * \return True if the loop slept, so the idle time must not be simulated.
+     */
+    bool WaitForRedraw();
+
+    /**
+     * \brief Advance the scene by the fixed steps covering a frame and set its interpolation.
+     * \param frameTime Seconds since the previous frame.
+     */
+    void Simulate(double frameTime);
+
+    /**
+     * \brief Sleep until the frame cap allows the next frame.
+     * \param frameStart Time the current frame started.
+     */
+    void LimitFrameRate(FrameClock::Clock::time_point frameStart) const;
+
     /**
      * \brief Static callback for framebuffer resize events.
      */
     static void framebufferSizeCallback(GLFWwindow* window, int width, int height);
 
+    /**
+     * \brief Static callback for window contents damaged by the system.
+     */
+    static void refreshCallback(GLFWwindow* window);
+
     /**
      * \brief Static callback for keyboard events.
      */
@@ -124,7 +344,19 @@ private:
     int m_width;                   ///< Window width
     int m_height;                  ///< Window height
     GLFWwindow* m_window;         ///< GLFW window handle
+    GLFWwindow* m_shareWith;      ///< Window whose context this one shares, or nullptr
     std::unique_ptr<Scene> m_scene; ///< Scene to render
+    bool m_renderThreadEnabled;    ///< Render on a dedicated thread in Run()
+    std::unique_ptr<RenderThread> m_renderThread;   ///< Owns the context while running, else nullptr
+    FrameTimings m_frameTimings;   ///< Timings of the last threaded Run()
+    FrameClock m_frameClock;       ///< Fixed-timestep accumulator of Run()
+    int m_maxFrameRate;            ///< Frame cap, 0 for none
+    int m_swapInterval;            ///< Vertical blanks per buffer swap
+    RenderMode m_renderMode;       ///< When Run() renders
+    double m_idleTimeout;          ///< Event wait timeout when idle, in seconds
+    uint64_t m_renderedFrames;     ///< Frames rendered by the last Run()
+    bool m_closeRequested;         ///< Close() was called on a test-mode window, which has no GLFW window
 
     static bool s_testMode;        ///< Test mode flag
+    static int s_windowCount;      ///< Open GLFW windows
 };
@@ -1,6 +1,18 @@
 #include "WindowManager.h"
+#include "ResourcePool.h"
+#include "Model.h"
+#include "Profiler.h"
 #include <iostream>
+#include <sstream>
 #include <cassert>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+WindowManager::~WindowManager()
+{
+    destroyWindows();
+}
 
 bool WindowManager::Initialize()
 {
@@ -30,7 +42,7 @@ void WindowManager::createObjects()
     std::cout << "WindowManager creating objects..." << std::endl;
 
     // Clear any previously created windows
-    m_windows.clear();
+    destroyWindows();
 
     // Get the JSON objects stored in ManagerBase
     const auto& objects = getJsonObjects();
@@ -53,16 +65,9 @@ void WindowManager::createObjects()
 
             std::cout << "Creating window: " << title << " (" << width << "x" << height << ")" << std::endl;
 
-            // Create the window
-            auto window = std::make_unique<Window>(title, width, height);
-            
-            if (!m_testMode)
-            {
-                if (!window->Create())
-                {
-                    throw std::runtime_error("Failed to create window: " + title);
-                }
-            }
+            // Create the window, sharing the first one's context; the constructor throws if it fails
+            Window* shareWith = m_windows.empty() ? nullptr : m_windows.front().get();
+            auto window = std::make_unique<Window>(title, width, height, shareWith);
 
             std::cout << "Successfully created window: " << title << std::endl;
 
@@ -79,20 +84,33 @@ void WindowManager::createObjects()
     if (m_windows.empty())
     {
         std::cerr << "No windows created from JSON, creating default window" << std::endl;
-        auto window = std::make_unique<Window>("SnapEngine", 1280, 720);
-        
-        if (!m_testMode)
-        {
-            if (!window->Create())
-            {
-                throw std::runtime_error("Failed to create default window");
-            }
-        }
-        
-        m_windows.push_back(std::move(window));
+        m_windows.push_back(std::make_unique<Window>("SnapEngine", 1280, 720));
     }
 }
 
+void WindowManager::destroyWindows()
+{
+    // The others borrow the first window's context and resources
+    while (!m_windows.empty())
+        m_windows.pop_back();
+}
+
+std::shared_ptr<Model> WindowManager::LoadModel(const std::string& path)
+{
+    if (m_windows.empty())
+        return nullptr;
+
+    // Load in the context that owns the resources
+    Window& owner = *m_windows.front();
+    owner.MakeCurrent();
+    return owner.GetScene()->GetResources()->LoadModel(path);
+}
+
+std::shared_ptr<ResourcePool> WindowManager::GetResources() const
+{
+    return m_windows.empty() ? nullptr : m_windows.front()->GetScene()->GetResources();
+}
+
 bool WindowManager::ProcessMessages()
 {
     if (m_testMode)
@@ -101,18 +119,101 @@ bool WindowManager::ProcessMessages()
         return true;
     }
 
-    bool allWindowsOpen = true;
+    // One poll serves every window
+    glfwPollEvents();
+
+    return std::none_of(m_windows.begin(), m_windows.end(), [](const std::unique_ptr<Window>& window)
+    {
+        return window->ShouldClose();
+    });
+}
+
+void WindowManager::Run()
+{
+    if (m_testMode || m_windows.empty())
+        return;
 
-    // Process messages for all windows
+    // Every window renders on its own thread; this one handles events and simulates
+    std::atomic<uint64_t> presented{ 0 };
+    std::vector<Window*> open;
     for (auto& window : m_windows)
     {
-        if (!window->ProcessMessages())
+        window->StartRenderThread(&presented);
+        open.push_back(window.get());
+    }
+
+    std::vector<FrameResult> results;
+    auto lastFrame = FrameClock::Clock::now();
+    while (!open.empty())
+    {
+        uint64_t presentedBefore = presented.load(std::memory_order_acquire);
+
+        // Handle events once for all windows, sleeping first if none has anything to draw
+        bool idle = std::none_of(open.begin(), open.end(), [](const Window* window) { return window->NeedsRedraw(); });
+        if (idle)
+        {
+            double timeout = open.front()->GetIdleTimeout();
+            for (const Window* window : open)
+                timeout = std::min(timeout, window->GetIdleTimeout());
+            glfwWaitEventsTimeout(timeout);
+            lastFrame = FrameClock::Clock::now();
+        }
+        else
         {
-            allWindowsOpen = false;
+            glfwPollEvents();
         }
+
+        auto frameStart = FrameClock::Clock::now();
+        double frameTime = std::chrono::duration<double>(frameStart - lastFrame).count();
+        lastFrame = frameStart;
+        RunFrame(open, frameTime, results);
+        bool submitted = std::find(results.begin(), results.end(), FRAME_SUBMITTED) != results.end();
+        bool skipped = std::find(results.begin(), results.end(), FRAME_SKIPPED) != results.end();
+
+        // Collect this thread's scopes and whatever the render threads have finished
+        PROFILE_CALL(Profiler::Get().Collect());
+
+        // Every window with something to draw is two frames behind: sleep until one presents
+        if (!submitted && skipped)
+            presented.wait(presentedBefore, std::memory_order_acquire);
     }
 
-    return allWindowsOpen;
+    std::cout << FormatFrameTimings();
+}
+
+void WindowManager::RunFrame(std::vector<Window*>& open, double frameTime, std::vector<FrameResult>& results)
+{
+    PROFILE_SCOPE("WindowManager::Frame");
+
+    // Closed windows finish their frames and disappear; the rest carry on
+    for (auto it = open.begin(); it != open.end();)
+    {
+        if (!(*it)->ShouldClose())
+        {
+            ++it;
+            continue;
+        }
+        (*it)->StopRenderThread();
+        (*it)->Hide();
+        it = open.erase(it);
+    }
+
+    results.clear();
+    for (Window* window : open)
+        results.push_back(window->SubmitFrame(frameTime));
+}
+
+std::string WindowManager::FormatFrameTimings() const
+{
+    std::ostringstream out;
+    for (const auto& window : m_windows)
+    {
+        const FrameTimings& timings = window->GetFrameTimings();
+        out << window->GetTitle() << ": " << timings.frames << " frames, " << timings.frameMs << " ms per frame ("
+            << timings.renderMs << " ms submit, " << timings.presentMs << " ms present, " << timings.idleMs << " ms waiting), "
+            << timings.skipped << " skipped\n";
+    }
+    return out.str();
 }
 
 void WindowManager::test()
@@ -192,6 +293,69 @@ void WindowManager::test()
         assert(multiWindows.size() == 2 && "Incorrect number of windows");
         assert(multiWindows[0]->GetTitle() == "Window 1" && "Incorrect window 1 title");
         assert(multiWindows[1]->GetTitle() == "Window 2" && "Incorrect window 2 title");
+
+        // Windows share the first one's resources but keep their own vertex arrays
+        Scene* first = multiWindows[0]->GetScene();
+        Scene* second = multiWindows[1]->GetScene();
+        assert(multiManager.GetResources() && first->GetResources() == multiManager.GetResources() &&
+               second->GetResources() == multiManager.GetResources() && "Windows should share one resource pool");
+        assert(first->GetVertexArrays() != second->GetVertexArrays() && "Each window should keep its own vertex arrays");
+
+        // Models are loaded once for every window
+        bool modelTestMode = Model::IsTestMode();
+        Model::SetTestMode(true);
+        auto model = multiManager.LoadModel("test.obj");
+        auto sameModel = multiManager.LoadModel("test.obj");
+        assert(model && sameModel == model && "A model should be loaded once");
+        multiWindows[0]->AddModel(model);
+        multiWindows[1]->AddModel(model);
+        assert(multiManager.GetResources()->GetModelCount() == 1 && "Both windows should draw the same model");
+        Model::SetTestMode(modelTestMode);
+
+        // A window whose render thread is stuck skips frames while the other keeps going
+        Window* slow = multiWindows[0].get();
+        Window* fast = multiWindows[1].get();
+        std::atomic<uint64_t> presented{ 0 };
+        std::atomic<bool> release{ false };
+        slow->StartRenderThread(&presented, [&release](const RenderSnapshot&)
+        {
+            while (!release.load(std::memory_order_acquire))
+                std::this_thread::yield();
+        });
+        fast->StartRenderThread(&presented);
+
+        std::vector<Window*> open = { slow, fast };
+        std::vector<FrameResult> results;
+        for (int frame = 0; frame < 2; ++frame)
+        {
+            RunFrame(open, 1.0 / 60.0, results);
+            assert(results.size() == 2 && results[0] == FRAME_SUBMITTED && results[1] == FRAME_SUBMITTED &&
+                   "Both windows should take the first two frames");
+        }
+
+        // The stuck thread holds one snapshot and has the other queued; the fast one has presented both
+        for (uint64_t count = presented.load(); count < 2; count = presented.load())
+            presented.wait(count);
+        RunFrame(open, 1.0 / 60.0, results);
+        assert(results[0] == FRAME_SKIPPED && results[1] == FRAME_SUBMITTED &&
+               "A window behind its render thread should skip without holding up the other");
+
+        // An on-demand window whose scene is unchanged since its last snapshot stays idle
+        fast->SetRenderMode(ON_DEMAND_RENDERING);
+        RunFrame(open, 1.0 / 60.0, results);
+        assert(results[0] == FRAME_SKIPPED && results[1] == FRAME_IDLE && "A static on-demand window should be idle");
+
+        // A closed window finishes its frames and leaves the open set
+        release.store(true, std::memory_order_release);
+        slow->Close();
+        RunFrame(open, 1.0 / 60.0, results);
+        assert(open.size() == 1 && open[0] == fast && results.size() == 1 && "A closed window should leave the open set");
+        fast->StopRenderThread();
+
+        // Frame times are reported per window
+        std::string report = multiManager.FormatFrameTimings();
+        assert(report.find("Window 1: 2 frames") != std::string::npos && report.find("Window 2: 3 frames") != std::string::npos &&
+               report.find("2 skipped") != std::string::npos && "Each window should report its frame times");
     }
 
     // Test message processing in test mode
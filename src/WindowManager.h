@@ -18,14 +18,17 @@
 ///     "width": 800,
 ///     "height": 600
 /// }
+///
+/// Every window shares the first one's context and resources, so models loaded through
+/// LoadModel() can be added to any of them.
 class WindowManager : public ManagerBase
 {
 public:
     /// \brief Default constructor
     WindowManager() : m_testMode(false) {}
     
-    /// \brief Default destructor
-    ~WindowManager() = default;
+    /// \brief Destructor. Destroys the windows in reverse order, the resource owner last.
+    ~WindowManager();
 
     /// \brief Initializes the window manager.
     /// \return True if initialization was successful.
@@ -34,14 +37,36 @@ public:
     /// \brief Creates window objects from JSON data.
     void createObjects() override;
 
-    /// \brief Process window messages.
+    /// \brief Process window messages, polling events once for every window.
     /// \return True if all windows are still open.
     bool ProcessMessages();
 
+    /// \brief Run every window until all are closed, each rendering on its own thread.
+    ///
+    /// This thread polls events once per frame, simulates every window and hands each
+    /// render thread a snapshot if it has one free. A window whose render thread is behind
+    /// skips the frame instead of holding up the others; this thread only sleeps when all
+    /// of them are behind. Closed windows are hidden while the others carry on. Per-window
+    /// frame times are printed at the end.
+    void Run();
+
+    /// \brief Format the frame timings of each window's last threaded run, one line per window.
+    /// \return The report.
+    std::string FormatFrameTimings() const;
+
     /// \brief Get the list of windows.
     /// \return Vector of window pointers.
     const std::vector<std::unique_ptr<Window>>& GetWindows() const { return m_windows; }
 
+    /// \brief Load a model once for every window.
+    /// \param path Model file.
+    /// \return The shared model; nullptr if there are no windows or loading failed.
+    std::shared_ptr<Model> LoadModel(const std::string& path);
+
+    /// \brief Get the resources the windows share.
+    /// \return The resource pool; nullptr if there are no windows.
+    std::shared_ptr<ResourcePool> GetResources() const;
+
     /// \brief Enable or disable test mode.
     /// In test mode, no actual GLFW windows are created.
     /// \param enabled True to enable test mode.
@@ -55,6 +80,18 @@ public:
     static void test();
 
 private:
+    /// \brief Destroy the windows, last created first.
+    void destroyWindows();
+
+    /// \brief Run one frame of Run() over windows whose render threads are running.
+    ///
+    /// Closed windows finish their frames, are hidden and leave \p open; the others are
+    /// simulated and handed a snapshot if they have something to draw and one is free.
+    /// \param open Windows still open; closed ones are removed.
+    /// \param frameTime Seconds since the previous frame.
+    /// \param results Receives what each window left in \p open did with the frame, in order.
+    static void RunFrame(std::vector<Window*>& open, double frameTime, std::vector<FrameResult>& results);
+
     std::vector<std::unique_ptr<Window>> m_windows;  ///< Collection of managed windows
     bool m_testMode;                                 ///< True if running in test mode
 };
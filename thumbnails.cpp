@@ -0,0 +1,80 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+
+#include "ThumbnailRenderer.h"
+
+namespace {
+
+void PrintUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " <model-dir> <output-dir> [--views N] [--size WxH] [--workers N] [--elevation DEG]\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    std::filesystem::path modelDirectory = argv[1];
+    ThumbnailSettings settings;
+    settings.outputDirectory = argv[2];
+
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--views")
+        {
+            settings.views = std::atoi(value);
+        }
+        else if (arg == "--size")
+        {
+            if (std::sscanf(value, "%dx%d", &settings.width, &settings.height) != 2 || settings.width <= 0 || settings.height <= 0)
+            {
+                std::cerr << "Invalid size: " << value << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--workers")
+        {
+            settings.workers = std::atoi(value);
+        }
+        else if (arg == "--elevation")
+        {
+            settings.elevation = static_cast<float>(std::atof(value));
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<std::filesystem::path> models = ThumbnailRenderer::FindModels(modelDirectory);
+    if (models.empty())
+    {
+        std::cerr << "No models found in " << modelDirectory << std::endl;
+        return 1;
+    }
+
+    std::cout << "Rendering " << models.size() << " models with " << settings.workers << " worker(s)...\n";
+    ThumbnailRenderer renderer(settings);
+    ThumbnailStats stats = renderer.Run(models, modelDirectory);
+
+    std::cout << "Rendered " << stats.models << " models (" << stats.images << " images, "
+              << stats.failed << " failed) in " << stats.seconds << " s: "
+              << stats.GetModelsPerMinute() << " models/min\n";
+    return stats.failed == 0 ? 0 : 1;
+}